@@ -0,0 +1,855 @@
+#include "DeviceMemoryTracker.h"
+#include "FrameArena.h"
+#include "ImageWriter.h"
+#include "Microbench.h"
+#include "LightingSystem.h"
+#include "MeshOptimizer.h"
+#include "ParticleSystem.h"
+#include "PhysicsWorld.h"
+#include "Random.h"
+#include "RenderQueue.h"
+#include "SpriteRenderer.h"
+#include "TilemapRenderer.h"
+#include "TransformHierarchy.h"
+#include "Vertex.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <set>
+#include <string>
+
+// Benchmarks for engine code that runs every frame or every allocation and
+// needs no GPU. State is built once per benchmark, outside the timed body.
+// Where a result can be wrong in ways timing wouldn't show, a check next to
+// the benchmark verifies it.
+
+namespace {
+    constexpr size_t VERTEX_COUNT = 4096;
+
+    // Positions and colors as a simulation would hold them, one array each
+    struct VertexSource {
+        std::vector<glm::vec2> positions;
+        std::vector<glm::vec3> colors;
+        std::vector<Vertex> packed;
+        std::vector<Vertex> mapped;     // Stands in for a host-visible mapping
+    };
+
+    std::shared_ptr<VertexSource> makeVertexSource() {
+        auto source = std::make_shared<VertexSource>();
+        Random random(7);
+        for (size_t i = 0; i < VERTEX_COUNT; i++) {
+            source->positions.push_back({ random.range(-1.0f, 1.0f), random.range(-1.0f, 1.0f) });
+            source->colors.push_back({ random.nextFloat(), random.nextFloat(), random.nextFloat() });
+        }
+        source->packed.resize(VERTEX_COUNT);
+        source->mapped.resize(VERTEX_COUNT);
+        return source;
+    }
+
+    void registerVertexBenchmarks(MicrobenchSuite& suite) {
+        auto source = makeVertexSource();
+
+        suite.add("vertex/pack_soa_to_aos", [source](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                Vertex* out = source->packed.data();
+                for (size_t v = 0; v < VERTEX_COUNT; v++) {
+                    out[v].pos = source->positions[v];
+                    out[v].color = source->colors[v];
+                }
+                clobberMemory();
+            }
+        }, VERTEX_COUNT);
+
+        suite.add("vertex/copy_to_mapped", [source](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                std::memcpy(source->mapped.data(), source->packed.data(), VERTEX_COUNT * sizeof(Vertex));
+                clobberMemory();
+            }
+        }, VERTEX_COUNT);
+    }
+
+    // Mesh import on a 128x128 quad grid as an unindexed triangle soup in
+    // shuffled order: six copies of most vertices and no cache locality,
+    // like the meshes the importer gets
+    void registerMeshBenchmarks(MicrobenchSuite& suite) {
+        constexpr uint32_t GRID = 128;
+        struct MeshSource {
+            std::vector<Vertex> soup;
+            std::vector<uint32_t> remap;
+            std::vector<uint32_t> indices;
+            std::vector<uint32_t> shuffled;     // Unique indices in soup order
+            size_t uniqueCount = 0;
+        };
+        auto source = std::make_shared<MeshSource>();
+        Random random(19);
+        std::vector<glm::vec3> colors(static_cast<size_t>(GRID + 1) * (GRID + 1));
+        for (auto& color : colors) {
+            color = glm::vec3(random.nextFloat(), random.nextFloat(), random.nextFloat());
+        }
+        auto corner = [&colors](uint32_t x, uint32_t y) {
+            return Vertex{ glm::vec2(static_cast<float>(x), static_cast<float>(y)), colors[y * (GRID + 1) + x] };
+        };
+        for (uint32_t y = 0; y < GRID; y++) {
+            for (uint32_t x = 0; x < GRID; x++) {
+                Vertex quad[6] = { corner(x, y), corner(x + 1, y), corner(x + 1, y + 1),
+                                   corner(x, y), corner(x + 1, y + 1), corner(x, y + 1) };
+                source->soup.insert(source->soup.end(), std::begin(quad), std::end(quad));
+            }
+        }
+        size_t triangleCount = source->soup.size() / 3;
+        for (size_t i = triangleCount - 1; i > 0; i--) {
+            size_t j = random.next() % (i + 1);
+            std::swap_ranges(source->soup.begin() + i * 3, source->soup.begin() + i * 3 + 3,
+                             source->soup.begin() + j * 3);
+        }
+        source->remap.resize(source->soup.size());
+        source->uniqueCount = deduplicateVertices(source->soup.data(), source->soup.size(), sizeof(Vertex),
+                                                  source->remap.data());
+        source->shuffled = source->remap;
+        source->indices.resize(source->shuffled.size());
+
+        // Ids are numbered by first appearance, vertices sharing an id are
+        // bitwise identical, and vertices with different ids differ
+        suite.addCheck("mesh/deduplicate", [source](std::string& error) {
+            std::vector<uint32_t> remap(source->soup.size());
+            size_t unique = deduplicateVertices(source->soup.data(), source->soup.size(), sizeof(Vertex),
+                                                remap.data());
+            auto bytes = [](const Vertex& vertex) {
+                return std::string(reinterpret_cast<const char*>(&vertex), sizeof(Vertex));
+            };
+            std::vector<size_t> first;
+            std::set<std::string> seen;
+            for (size_t i = 0; i < remap.size(); i++) {
+                if (remap[i] == first.size()) {
+                    if (!seen.insert(bytes(source->soup[i])).second) {
+                        error = "vertex " + std::to_string(i) + " got a new id but has a duplicate before it";
+                        return false;
+                    }
+                    first.push_back(i);
+                } else if (remap[i] > first.size() ||
+                           bytes(source->soup[i]) != bytes(source->soup[first[remap[i]]])) {
+                    error = "vertex " + std::to_string(i) + " maps to id " + std::to_string(remap[i]) +
+                            ", which isn't an identical earlier vertex";
+                    return false;
+                }
+            }
+            if (unique != first.size()) {
+                error = "returned " + std::to_string(unique) + " unique vertices, found " +
+                        std::to_string(first.size());
+                return false;
+            }
+            return true;
+        });
+
+        // The optimized mesh must draw the soup's triangles: the same
+        // multiset of vertex triples, each with its winding, in any order
+        // and starting at any corner
+        suite.addCheck("mesh/optimize", [source](std::string& error) {
+            MeshData data;
+            MeshOptimizeStats stats;
+            if (!optimizeMesh(source->soup.data(), source->soup.size(), sizeof(Vertex), nullptr, 0, data, &stats)) {
+                error = "optimizeMesh failed";
+                return false;
+            }
+            if (data.vertexCount != source->uniqueCount || data.indexFormat != IndexFormat::Uint16) {
+                error = "expected " + std::to_string(source->uniqueCount) + " vertices with 16-bit indices";
+                return false;
+            }
+
+            auto triangle = [](const uint8_t* a, const uint8_t* b, const uint8_t* c) {
+                std::string corners[3] = { std::string(reinterpret_cast<const char*>(a), sizeof(Vertex)),
+                                           std::string(reinterpret_cast<const char*>(b), sizeof(Vertex)),
+                                           std::string(reinterpret_cast<const char*>(c), sizeof(Vertex)) };
+                size_t start = std::min_element(std::begin(corners), std::end(corners)) - std::begin(corners);
+                return corners[start] + corners[(start + 1) % 3] + corners[(start + 2) % 3];
+            };
+            std::vector<std::string> expected;
+            const uint8_t* soup = reinterpret_cast<const uint8_t*>(source->soup.data());
+            for (size_t i = 0; i < source->soup.size(); i += 3) {
+                expected.push_back(triangle(soup + i * sizeof(Vertex), soup + (i + 1) * sizeof(Vertex),
+                                            soup + (i + 2) * sizeof(Vertex)));
+            }
+            std::vector<std::string> optimized;
+            for (uint32_t i = 0; i < data.indexCount; i += 3) {
+                uint32_t corners[3] = { data.getIndex(i), data.getIndex(i + 1), data.getIndex(i + 2) };
+                for (uint32_t corner : corners) {
+                    if (corner >= data.vertexCount) {
+                        error = "index " + std::to_string(corner) + " past the vertices";
+                        return false;
+                    }
+                }
+                const uint8_t* vertices = data.vertices.data();
+                optimized.push_back(triangle(vertices + corners[0] * data.vertexStride,
+                                             vertices + corners[1] * data.vertexStride,
+                                             vertices + corners[2] * data.vertexStride));
+            }
+            std::sort(expected.begin(), expected.end());
+            std::sort(optimized.begin(), optimized.end());
+            if (expected != optimized) {
+                error = "the triangles differ from the input's";
+                return false;
+            }
+            if (stats.acmrAfter >= stats.acmrBefore) {
+                error = "ACMR didn't improve";
+                return false;
+            }
+            return true;
+        });
+
+        suite.add("mesh/deduplicate_98k", [source](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                size_t unique = deduplicateVertices(source->soup.data(), source->soup.size(), sizeof(Vertex),
+                                                    source->remap.data());
+                doNotOptimize(unique);
+            }
+        }, source->soup.size());
+
+        suite.add("mesh/vertex_cache_32k_triangles", [source](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                std::copy(source->shuffled.begin(), source->shuffled.end(), source->indices.begin());
+                optimizeVertexCache(source->indices.data(), source->indices.size(), source->uniqueCount);
+                clobberMemory();
+            }
+        }, triangleCount);
+
+        suite.add("mesh/optimize_98k", [source](uint64_t iterations) {
+            MeshData data;
+            for (uint64_t i = 0; i < iterations; i++) {
+                optimizeMesh(source->soup.data(), source->soup.size(), sizeof(Vertex), nullptr, 0, data);
+                doNotOptimize(data.indexCount);
+            }
+        }, source->soup.size());
+    }
+
+    // A memory type layout typical of a discrete GPU: device-local heap
+    // first, then the host-visible variants
+    vk::PhysicalDeviceMemoryProperties makeMemoryProperties() {
+        using Flags = vk::MemoryPropertyFlagBits;
+        vk::PhysicalDeviceMemoryProperties properties{};
+        const vk::MemoryPropertyFlags types[] = {
+            Flags::eDeviceLocal,
+            Flags::eDeviceLocal,
+            Flags::eHostVisible | Flags::eHostCoherent,
+            Flags::eHostVisible | Flags::eHostCoherent | Flags::eHostCached,
+            Flags::eDeviceLocal | Flags::eHostVisible | Flags::eHostCoherent,
+            Flags::eLazilyAllocated | Flags::eDeviceLocal
+        };
+        properties.memoryTypeCount = static_cast<uint32_t>(std::size(types));
+        for (uint32_t i = 0; i < properties.memoryTypeCount; i++) {
+            properties.memoryTypes[i].propertyFlags = types[i];
+            properties.memoryTypes[i].heapIndex = (types[i] & Flags::eDeviceLocal) ? 0 : 1;
+        }
+        properties.memoryHeapCount = 2;
+        properties.memoryHeaps[0].size = 8ull << 30;
+        properties.memoryHeaps[0].flags = vk::MemoryHeapFlagBits::eDeviceLocal;
+        properties.memoryHeaps[1].size = 16ull << 30;
+        return properties;
+    }
+
+    void registerMemoryTypeBenchmarks(MicrobenchSuite& suite) {
+        auto properties = std::make_shared<vk::PhysicalDeviceMemoryProperties>(makeMemoryProperties());
+
+        // The mix of requests made by buffer and texture creation
+        struct Query {
+            uint32_t typeBits;
+            vk::MemoryPropertyFlags flags;
+        };
+        auto queries = std::make_shared<std::vector<Query>>(std::vector<Query>{
+            { 0x3Fu, vk::MemoryPropertyFlagBits::eDeviceLocal },
+            { 0x3Fu, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent },
+            { 0x1Cu, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCached },
+            { 0x30u, vk::MemoryPropertyFlagBits::eDeviceLocal | vk::MemoryPropertyFlagBits::eHostVisible }
+        });
+
+        suite.add("memory/find_type_cached", [properties, queries](uint64_t iterations) {
+            uint32_t sum = 0;
+            for (uint64_t i = 0; i < iterations; i++) {
+                const Query& query = (*queries)[i & 3];
+                sum += DeviceMemoryTracker::findMemoryType(*properties, query.typeBits, query.flags);
+            }
+            doNotOptimize(sum);
+        });
+    }
+
+    // Allocation patterns seen in per-frame code: short-lived small blocks,
+    // staging-sized blocks and vectors that are either rebuilt or reused
+    void registerAllocatorBenchmarks(MicrobenchSuite& suite) {
+        suite.add("alloc/malloc_free_64", [](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                void* block = std::malloc(64);
+                doNotOptimize(block);
+                std::free(block);
+            }
+        });
+
+        suite.add("alloc/malloc_free_64k", [](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                void* block = std::malloc(64 * 1024);
+                doNotOptimize(block);
+                std::free(block);
+            }
+        });
+
+        suite.add("alloc/vector_grow_1024", [](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                std::vector<uint32_t> values;
+                for (uint32_t v = 0; v < 1024; v++) {
+                    values.push_back(v);
+                }
+                doNotOptimize(values.data());
+            }
+        }, 1024);
+
+        auto reused = std::make_shared<std::vector<uint32_t>>();
+        suite.add("alloc/vector_reuse_1024", [reused](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                reused->clear();
+                for (uint32_t v = 0; v < 1024; v++) {
+                    reused->push_back(v);
+                }
+                doNotOptimize(reused->data());
+            }
+        }, 1024);
+
+        // The frame arena equivalents: a reset per iteration stands in for
+        // the per-frame reset
+        auto arena = std::make_shared<FrameArena>();
+        suite.add("alloc/frame_arena_64", [arena](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                void* block = arena->allocate(64);
+                doNotOptimize(block);
+                arena->reset();
+            }
+        });
+
+        suite.add("alloc/arena_vector_1024", [arena](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                ArenaVector<uint32_t> values{ ArenaAllocator<uint32_t>(*arena) };
+                for (uint32_t v = 0; v < 1024; v++) {
+                    values.push_back(v);
+                }
+                doNotOptimize(values.data());
+                arena->reset();
+            }
+        }, 1024);
+    }
+
+    struct CullSource {
+        std::vector<SpriteInstance> sprites;
+        std::vector<SpriteInstance> visible;
+        SpriteBounds view;
+    };
+
+    // Sprites scattered over a world twice the view's width and height, so
+    // about a quarter survive; offsetting the view culls them all
+    std::shared_ptr<CullSource> makeCullSource(size_t count, bool noneVisible) {
+        auto source = std::make_shared<CullSource>();
+        Random random(11);
+        source->sprites.resize(count);
+        for (auto& sprite : source->sprites) {
+            sprite.position = { random.range(-1000.0f, 1000.0f), random.range(-1000.0f, 1000.0f) };
+            sprite.size = glm::vec2(random.range(4.0f, 32.0f));
+            sprite.rotation = random.range(0.0f, 6.2831853f);
+        }
+        source->visible.resize(count);
+        source->view = noneVisible ? SpriteBounds{ 5000.0f, 5000.0f, 6000.0f, 6000.0f }
+                                   : SpriteBounds{ -500.0f, -500.0f, 500.0f, 500.0f };
+        return source;
+    }
+
+    void registerCullingBenchmarks(MicrobenchSuite& suite) {
+        struct Case {
+            const char* name;
+            size_t count;
+            bool noneVisible;
+        };
+        const Case cases[] = {
+            { "culling/sprites_10k", 10000, false },
+            { "culling/sprites_100k", 100000, false },
+            { "culling/sprites_100k_offscreen", 100000, true }
+        };
+        for (const Case& c : cases) {
+            auto source = makeCullSource(c.count, c.noneVisible);
+            suite.add(c.name, [source](uint64_t iterations) {
+                for (uint64_t i = 0; i < iterations; i++) {
+                    size_t kept = cullSprites(source->sprites.data(), source->sprites.size(),
+                                              source->view, source->visible.data());
+                    doNotOptimize(kept);
+                }
+            }, c.count);
+        }
+    }
+
+    // The CPU particle path on a 64k pool that stays full: every particle is
+    // live, so every vector is integrated, collided and written out
+    void registerParticleBenchmarks(MicrobenchSuite& suite) {
+        constexpr uint32_t CAPACITY = 65536;
+        struct ParticleSource {
+            ParticleCpuState state;
+            ParticleStep step{};
+            std::vector<SpriteInstance> instances;
+        };
+        auto source = std::make_shared<ParticleSource>();
+        source->state.resize(CAPACITY);
+        source->instances.resize(source->state.age.size());
+
+        ParticleStep& step = source->step;
+        step.position = glm::vec2(1000.0f, 100.0f);
+        step.gravity = glm::vec2(0.0f, -300.0f);
+        step.direction = 1.5707964f;
+        step.spread = 1.2f;
+        step.speedMin = 200.0f;
+        step.speedMax = 600.0f;
+        step.lifetimeMin = 1000.0f;
+        step.lifetimeMax = 1000.0f;
+        step.size = 3.0f;
+        step.restitution = 0.6f;
+        step.dt = 1.0f / 60.0f;
+        step.color = 0xFFFFFFFF;
+        step.capacity = CAPACITY;
+        step.planeCount = 3;
+        step.planes[0] = glm::vec4(0.0f, 1.0f, 0.0f, 0.0f);
+        step.planes[1] = glm::vec4(1.0f, 0.0f, 0.0f, 0.0f);
+        step.planes[2] = glm::vec4(-1.0f, 0.0f, -2000.0f, 0.0f);
+
+        // Fill the pool once, then step without spawning
+        step.spawnCount = CAPACITY;
+        simulateParticlesCpu(source->state, step, source->instances.data());
+        step.spawnCount = 0;
+
+        std::string name = std::string("particles/cpu_step_64k_") + getParticleCpuPath();
+        suite.add(name, [source](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                size_t written = simulateParticlesCpu(source->state, source->step, source->instances.data());
+                doNotOptimize(written);
+            }
+        }, CAPACITY);
+    }
+
+    // Packing a frame's lights: 8k spread over four screens' worth of world,
+    // so about a quarter survive culling, written out as the GPU reads them
+    void registerLightingBenchmarks(MicrobenchSuite& suite) {
+        struct LightSource {
+            std::vector<PointLight> lights;
+            std::vector<GpuLight> packed;
+            LightView view;
+        };
+        auto source = std::make_shared<LightSource>();
+        source->lights.resize(LightingSystem::MAX_LIGHTS);
+        source->packed.resize(LightingSystem::MAX_LIGHTS);
+        source->view.cameraCenter = glm::vec2(1920.0f, 1080.0f);
+        source->view.renderSize = glm::vec2(1920.0f, 1080.0f);
+        Random random(17);
+        for (auto& light : source->lights) {
+            light.position = glm::vec2(random.range(0.0f, 3840.0f), random.range(0.0f, 2160.0f));
+            light.radius = random.range(40.0f, 160.0f);
+            light.color = glm::vec3(random.nextFloat(), random.nextFloat(), random.nextFloat());
+        }
+
+        suite.add("lights/pack_8k", [source](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                size_t written = packLights(source->lights.data(), source->lights.size(), source->view,
+                                            source->packed.data(), source->packed.size());
+                doNotOptimize(written);
+            }
+        }, LightingSystem::MAX_LIGHTS);
+    }
+
+    // Packing one chunk for upload, as the tilemap builder threads do, with
+    // 1 in 8 tiles empty
+    void registerTilemapBenchmarks(MicrobenchSuite& suite) {
+        struct ChunkSource {
+            std::vector<TileId> tiles;
+            std::vector<uint32_t> records;
+        };
+        auto source = std::make_shared<ChunkSource>();
+        source->tiles.resize(TilemapRenderer::CHUNK_TILES);
+        source->records.resize(TilemapRenderer::CHUNK_TILES);
+        Random random(13);
+        for (auto& tile : source->tiles) {
+            tile = random.below(8) == 0 ? EMPTY_TILE : static_cast<TileId>(1 + random.below(64));
+        }
+
+        suite.add("tilemap/build_chunk", [source](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                uint32_t count = buildTileChunk(source->tiles.data(), source->records.data());
+                doNotOptimize(count);
+            }
+        }, TilemapRenderer::CHUNK_TILES);
+    }
+
+    // Sorting a frame's worth of draw keys: four layers, random depths and
+    // a handful of pipelines and textures. The unsorted keys are copied in
+    // each iteration, the same for both sorts
+    void registerRenderQueueBenchmarks(MicrobenchSuite& suite) {
+        constexpr size_t COUNT = 100000;
+        struct SortSource {
+            std::vector<RenderSortEntry> keys;
+            std::vector<RenderSortEntry> entries;
+            std::vector<RenderSortEntry> scratch;
+        };
+        auto source = std::make_shared<SortSource>();
+        Random random(17);
+        for (size_t i = 0; i < COUNT; i++) {
+            uint32_t order = packRenderOrder(static_cast<uint8_t>(random.below(4) * 64), random.nextFloat());
+            uint64_t key = makeRenderKey(order, random.below(8), random.below(256));
+            source->keys.push_back(RenderSortEntry{ key, static_cast<uint32_t>(i), 0 });
+        }
+        source->entries.resize(COUNT);
+        source->scratch.resize(COUNT);
+
+        // Against std::stable_sort, which also shows nothing was lost or
+        // reordered among equal keys. Keys differing only in their low bytes
+        // and keys already in order take the skipped-pass shortcuts
+        suite.addCheck("render_queue/radix_sort", [source](std::string& error) {
+            auto byKey = [](const RenderSortEntry& a, const RenderSortEntry& b) { return a.key < b.key; };
+            std::vector<RenderSortEntry> lowBytes = source->keys;
+            for (auto& entry : lowBytes) {
+                entry.key = makeRenderKey(packRenderOrder(RENDER_LAYER_DEFAULT, 0.5f), 0,
+                                          static_cast<uint32_t>(entry.key & 0xFF));
+            }
+            std::vector<RenderSortEntry> presorted = source->keys;
+            std::stable_sort(presorted.begin(), presorted.end(), byKey);
+
+            const std::vector<RenderSortEntry>* inputs[] = { &source->keys, &lowBytes, &presorted };
+            for (const auto* input : inputs) {
+                std::vector<RenderSortEntry> expected = *input;
+                std::stable_sort(expected.begin(), expected.end(), byKey);
+                std::vector<RenderSortEntry> sorted = *input;
+                std::vector<RenderSortEntry> scratch(sorted.size());
+                radixSortRenderKeys(sorted.data(), scratch.data(), sorted.size());
+                for (size_t i = 0; i < sorted.size(); i++) {
+                    if (sorted[i].key != expected[i].key || sorted[i].index != expected[i].index) {
+                        error = "entry " + std::to_string(i) + " differs from std::stable_sort";
+                        return false;
+                    }
+                }
+            }
+            return true;
+        });
+
+        suite.add("render_queue/radix_sort_100k", [source](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                std::memcpy(source->entries.data(), source->keys.data(), COUNT * sizeof(RenderSortEntry));
+                radixSortRenderKeys(source->entries.data(), source->scratch.data(), COUNT);
+                doNotOptimize(source->entries.data());
+            }
+        }, COUNT);
+
+        suite.add("render_queue/std_stable_sort_100k", [source](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                std::memcpy(source->entries.data(), source->keys.data(), COUNT * sizeof(RenderSortEntry));
+                std::stable_sort(source->entries.begin(), source->entries.end(),
+                                 [](const RenderSortEntry& a, const RenderSortEntry& b) { return a.key < b.key; });
+                doNotOptimize(source->entries.data());
+            }
+        }, COUNT);
+    }
+    // Updating 4096 trees of 13 nodes (a root, four children, two
+    // grandchildren each) with an eighth of the roots moved per iteration,
+    // and with every root moved, on the calling thread and with workers
+    void registerTransformBenchmarks(MicrobenchSuite& suite) {
+        constexpr uint32_t ROOTS = 4096;
+        constexpr uint32_t NODES = ROOTS * 13;
+        struct TransformSource {
+            std::unique_ptr<TransformHierarchy> hierarchy;
+            std::vector<TransformId> roots;
+            uint32_t step = 0;
+        };
+
+        auto makeSource = [](uint32_t workerThreads) {
+            auto source = std::make_shared<TransformSource>();
+            source->hierarchy = std::make_unique<TransformHierarchy>(workerThreads);
+            Random random(19);
+            SpriteInstance sprite;
+            sprite.size = glm::vec2(8.0f);
+            for (uint32_t root = 0; root < ROOTS; root++) {
+                Transform2D local;
+                local.position = glm::vec2(random.range(0.0f, 4000.0f), random.range(0.0f, 4000.0f));
+                TransformId rootId = source->hierarchy->create(INVALID_TRANSFORM, local, &sprite);
+                source->roots.push_back(rootId);
+                for (uint32_t child = 0; child < 4; child++) {
+                    Transform2D orbit;
+                    orbit.position = glm::vec2(20.0f * (child + 1), 0.0f);
+                    orbit.rotation = random.range(0.0f, 6.28f);
+                    TransformId childId = source->hierarchy->create(rootId, orbit, &sprite);
+                    for (uint32_t grandchild = 0; grandchild < 2; grandchild++) {
+                        orbit.position = glm::vec2(5.0f * (grandchild + 1), 0.0f);
+                        source->hierarchy->create(childId, orbit, &sprite);
+                    }
+                }
+            }
+            source->hierarchy->update();
+            return source;
+        };
+
+        auto addUpdate = [&suite](const std::string& name, std::shared_ptr<TransformSource> source, uint32_t share) {
+            suite.add(name, [source, share](uint64_t iterations) {
+                TransformHierarchy& hierarchy = *source->hierarchy;
+                for (uint64_t i = 0; i < iterations; i++) {
+                    uint32_t first = source->step++ % share;
+                    for (uint32_t root = first; root < ROOTS; root += share) {
+                        Transform2D local = hierarchy.getLocal(source->roots[root]);
+                        local.rotation += 0.01f;
+                        hierarchy.setLocal(source->roots[root], local);
+                    }
+                    hierarchy.update();
+                    doNotOptimize(hierarchy.getSprites());
+                }
+            }, NODES);
+        };
+
+        std::string path = getTransformPath();
+        addUpdate("transforms/update_53k_dirty_1in8_" + path, makeSource(0), 8);
+        addUpdate("transforms/update_53k_dirty_all_" + path, makeSource(0), 1);
+        addUpdate("transforms/update_53k_dirty_all_" + path + "_threads", makeSource(TransformHierarchy::DEFAULT_WORKER_THREADS), 1);
+    }
+    // A step of 20k circles and boxes bouncing around a box without gravity
+    // or losses, so the load stays the same from iteration to iteration: on
+    // the calling thread and with narrowphase workers
+    void registerPhysicsBenchmarks(MicrobenchSuite& suite) {
+        constexpr uint32_t BODIES = 20000;
+        auto makeWorld = [](uint32_t workerThreads) {
+            auto physics = std::make_shared<PhysicsWorld>(workerThreads);
+            PhysicsSettings settings;
+            settings.bounded = true;
+            settings.boundsMax = glm::vec2(4000.0f);
+            physics->setSettings(settings);
+
+            Random random(23);
+            for (uint32_t i = 0; i < BODIES; i++) {
+                BodyDesc desc;
+                desc.shape = random.below(3) == 0 ? BodyShape::Box : BodyShape::Circle;
+                desc.position = glm::vec2(random.range(0.0f, 4000.0f), random.range(0.0f, 4000.0f));
+                desc.velocity = glm::vec2(random.range(-100.0f, 100.0f), random.range(-100.0f, 100.0f));
+                desc.radius = random.range(4.0f, 12.0f);
+                desc.halfExtents = glm::vec2(random.range(4.0f, 12.0f), random.range(4.0f, 12.0f));
+                desc.restitution = 1.0f;
+                physics->createBody(desc);
+            }
+            // Past the first full sort
+            physics->step(PhysicsWorld::FIXED_TIMESTEP);
+            return physics;
+        };
+
+        // Every sweep path this CPU has must find the scalar path's pairs,
+        // in the same order, step after step. Bodies are packed closely so
+        // most sweeps cover more than one register of neighbors
+        suite.addCheck("physics/sweep_paths", [](std::string& error) {
+            constexpr uint32_t CHECK_BODIES = 4000;
+            constexpr uint32_t CHECK_STEPS = 20;
+            auto makeCheckWorld = [](SimdLevel level) {
+                auto physics = std::make_unique<PhysicsWorld>(0);
+                physics->setSimdLevel(level);
+                PhysicsSettings settings;
+                settings.bounded = true;
+                settings.boundsMax = glm::vec2(600.0f);
+                physics->setSettings(settings);
+
+                Random random(29);
+                for (uint32_t i = 0; i < CHECK_BODIES; i++) {
+                    BodyDesc desc;
+                    desc.shape = random.below(3) == 0 ? BodyShape::Box : BodyShape::Circle;
+                    desc.position = glm::vec2(random.range(0.0f, 600.0f), random.range(0.0f, 600.0f));
+                    desc.velocity = glm::vec2(random.range(-100.0f, 100.0f), random.range(-100.0f, 100.0f));
+                    desc.radius = random.range(2.0f, 8.0f);
+                    desc.halfExtents = glm::vec2(random.range(2.0f, 8.0f), random.range(2.0f, 8.0f));
+                    desc.mass = random.below(16) == 0 ? 0.0f : 1.0f;
+                    physics->createBody(desc);
+                }
+                return physics;
+            };
+
+            for (SimdLevel level : { SimdLevel::SSE2, SimdLevel::AVX2 }) {
+                if (level > getSimdLevel()) break;
+                auto scalar = makeCheckWorld(SimdLevel::Scalar);
+                auto simd = makeCheckWorld(level);
+                for (uint32_t step = 0; step < CHECK_STEPS; step++) {
+                    scalar->step(PhysicsWorld::FIXED_TIMESTEP);
+                    simd->step(PhysicsWorld::FIXED_TIMESTEP);
+                    const auto& expected = scalar->getPairs();
+                    const auto& pairs = simd->getPairs();
+                    bool same = expected.size() == pairs.size() &&
+                                std::equal(expected.begin(), expected.end(), pairs.begin(),
+                                           [](const BodyPair& a, const BodyPair& b) { return a.a == b.a && a.b == b.b; });
+                    if (!same) {
+                        error = std::string(getSimdLevelName(level)) + " sweep found " + std::to_string(pairs.size()) +
+                                " pairs at step " + std::to_string(step) + ", scalar " + std::to_string(expected.size());
+                        return false;
+                    }
+                }
+            }
+            return true;
+        });
+
+        auto addStep = [&suite](const std::string& name, std::shared_ptr<PhysicsWorld> physics) {
+            suite.add(name, [physics](uint64_t iterations) {
+                for (uint64_t i = 0; i < iterations; i++) {
+                    physics->step(PhysicsWorld::FIXED_TIMESTEP);
+                    doNotOptimize(physics->getStats().contacts);
+                }
+            }, BODIES);
+        };
+
+        std::string path = getPhysicsPath();
+        addStep("physics/step_20k_" + path, makeWorld(0));
+        addStep("physics/step_20k_" + path + "_threads", makeWorld(PhysicsWorld::DEFAULT_WORKER_THREADS));
+    }
+
+    // Screenshots have no benchmark, since the time goes to the disk, but
+    // the encoder is checked: the file is parsed back and its stored
+    // deflate blocks unpacked. A 300 pixel wide image needs two blocks
+    void registerImageChecks(MicrobenchSuite& suite) {
+        suite.addCheck("image/write_png", [](std::string& error) {
+            constexpr uint32_t WIDTH = 300;
+            constexpr uint32_t HEIGHT = 100;
+            std::vector<uint8_t> rgba(static_cast<size_t>(WIDTH) * HEIGHT * 4);
+            Random random(31);
+            for (auto& value : rgba) {
+                value = static_cast<uint8_t>(random.below(256));
+            }
+
+            std::error_code directoryError;
+            std::filesystem::path directory = std::filesystem::temp_directory_path(directoryError);
+            if (directoryError) {
+                error = "no temporary directory";
+                return false;
+            }
+            std::string path = (directory / "cgame_microbench_check.png").string();
+            if (!writePng(path, rgba.data(), WIDTH, HEIGHT)) {
+                error = "writePng failed";
+                return false;
+            }
+            std::ifstream file(path, std::ios::binary);
+            std::vector<uint8_t> png((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            file.close();
+            std::remove(path.c_str());
+
+            auto readBigEndian = [](const std::vector<uint8_t>& bytes, size_t offset) {
+                return (uint32_t(bytes[offset]) << 24) | (uint32_t(bytes[offset + 1]) << 16) |
+                       (uint32_t(bytes[offset + 2]) << 8) | uint32_t(bytes[offset + 3]);
+            };
+            auto readU32 = [&](size_t offset) { return readBigEndian(png, offset); };
+            auto crc = [&png](size_t offset, size_t size) {
+                uint32_t value = 0xFFFFFFFFu;
+                for (size_t i = offset; i < offset + size; i++) {
+                    value ^= png[i];
+                    for (int bit = 0; bit < 8; bit++) {
+                        value = (value & 1) ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+                    }
+                }
+                return value ^ 0xFFFFFFFFu;
+            };
+
+            const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+            if (png.size() < 8 || std::memcmp(png.data(), signature, 8) != 0) {
+                error = "bad signature";
+                return false;
+            }
+            std::string chunks;
+            std::vector<uint8_t> zlib;
+            for (size_t offset = 8; offset < png.size();) {
+                if (offset + 12 > png.size() || offset + 12 + readU32(offset) > png.size()) {
+                    error = "truncated chunk";
+                    return false;
+                }
+                uint32_t length = readU32(offset);
+                std::string type(reinterpret_cast<const char*>(&png[offset + 4]), 4);
+                if (crc(offset + 4, length + 4) != readU32(offset + 8 + length)) {
+                    error = "bad CRC on " + type;
+                    return false;
+                }
+                const uint8_t* data = &png[offset + 8];
+                if (type == "IHDR") {
+                    const uint8_t format[5] = { 8, 2, 0, 0, 0 };
+                    if (length != 13 || readU32(offset + 8) != WIDTH || readU32(offset + 12) != HEIGHT ||
+                        std::memcmp(data + 8, format, 5) != 0) {
+                        error = "bad IHDR";
+                        return false;
+                    }
+                } else if (type == "IDAT") {
+                    zlib.insert(zlib.end(), data, data + length);
+                }
+                chunks += type + " ";
+                offset += 12 + length;
+            }
+            if (chunks != "IHDR IDAT IEND ") {
+                error = "unexpected chunks " + chunks;
+                return false;
+            }
+
+            // zlib header, stored blocks (BTYPE 00, LEN, NLEN), Adler-32
+            if (zlib.size() < 6 || (zlib[0] & 0x0F) != 8 || ((zlib[0] << 8) | zlib[1]) % 31 != 0) {
+                error = "bad zlib header";
+                return false;
+            }
+            std::vector<uint8_t> scanlines;
+            size_t position = 2;
+            for (bool final = false; !final;) {
+                if (position + 5 > zlib.size() || (zlib[position] & 0x06) != 0) {
+                    error = "expected a stored block at " + std::to_string(position);
+                    return false;
+                }
+                final = (zlib[position] & 1) != 0;
+                uint32_t length = zlib[position + 1] | (zlib[position + 2] << 8);
+                uint32_t inverse = zlib[position + 3] | (zlib[position + 4] << 8);
+                position += 5;
+                if ((length ^ 0xFFFFu) != inverse || position + length > zlib.size()) {
+                    error = "bad stored block length";
+                    return false;
+                }
+                scanlines.insert(scanlines.end(), zlib.begin() + position, zlib.begin() + position + length);
+                position += length;
+            }
+            uint32_t a = 1;
+            uint32_t b = 0;
+            for (uint8_t value : scanlines) {
+                a = (a + value) % 65521;
+                b = (b + a) % 65521;
+            }
+            if (position + 4 != zlib.size() || readBigEndian(zlib, position) != ((b << 16) | a)) {
+                error = "bad Adler-32";
+                return false;
+            }
+
+            // Filter type 0, then the pixels without alpha
+            if (scanlines.size() != static_cast<size_t>(1 + WIDTH * 3) * HEIGHT) {
+                error = "expected " + std::to_string((1 + WIDTH * 3) * HEIGHT) + " bytes of scanlines, got " +
+                        std::to_string(scanlines.size());
+                return false;
+            }
+            const uint8_t* row = scanlines.data();
+            for (uint32_t y = 0; y < HEIGHT; y++, row += 1 + WIDTH * 3) {
+                bool same = row[0] == 0;
+                for (uint32_t x = 0; x < WIDTH && same; x++) {
+                    same = std::memcmp(row + 1 + x * 3, &rgba[(static_cast<size_t>(y) * WIDTH + x) * 4], 3) == 0;
+                }
+                if (!same) {
+                    error = "row " + std::to_string(y) + " differs from the image";
+                    return false;
+                }
+            }
+            return true;
+        });
+    }
+}
+
+void registerCpuBenchmarks(MicrobenchSuite& suite) {
+    registerVertexBenchmarks(suite);
+    registerMeshBenchmarks(suite);
+    registerMemoryTypeBenchmarks(suite);
+    registerAllocatorBenchmarks(suite);
+    registerCullingBenchmarks(suite);
+    registerParticleBenchmarks(suite);
+    registerLightingBenchmarks(suite);
+    registerTilemapBenchmarks(suite);
+    registerRenderQueueBenchmarks(suite);
+    registerTransformBenchmarks(suite);
+    registerPhysicsBenchmarks(suite);
+    registerImageChecks(suite);
+}
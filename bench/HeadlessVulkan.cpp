@@ -0,0 +1,116 @@
+#include "HeadlessVulkan.h"
+#include <iostream>
+
+bool HeadlessVulkan::create() {
+    try {
+        vk::ApplicationInfo appInfo{};
+        appInfo.pApplicationName = "cGame microbench";
+        appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+        appInfo.pEngineName = "cGame Engine";
+        appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
+        appInfo.apiVersion = VK_API_VERSION_1_2;
+
+        vk::InstanceCreateInfo instanceInfo{};
+        instanceInfo.pApplicationInfo = &appInfo;
+        instance = vk::createInstance(instanceInfo);
+
+        auto devices = instance.enumeratePhysicalDevices();
+        if (devices.empty()) {
+            std::cerr << "No Vulkan devices found" << std::endl;
+            destroy();
+            return false;
+        }
+
+        // Prefer a discrete GPU, matching what the game would run on
+        physicalDevice = devices[0];
+        for (const auto& candidate : devices) {
+            if (candidate.getProperties().deviceType == vk::PhysicalDeviceType::eDiscreteGpu) {
+                physicalDevice = candidate;
+                break;
+            }
+        }
+
+        bool foundQueue = false;
+        auto families = physicalDevice.getQueueFamilyProperties();
+        for (uint32_t i = 0; i < families.size(); i++) {
+            if (families[i].queueFlags & vk::QueueFlagBits::eGraphics) {
+                queueFamily = i;
+                foundQueue = true;
+                break;
+            }
+        }
+        if (!foundQueue) {
+            std::cerr << "No graphics queue on " << physicalDevice.getProperties().deviceName << std::endl;
+            destroy();
+            return false;
+        }
+
+        // Enable whatever descriptor indexing the device offers; bindless is
+        // usable under the same conditions the renderer checks for
+        vk::PhysicalDeviceDescriptorIndexingFeatures indexingFeatures{};
+        vk::PhysicalDeviceFeatures2 features{};
+        bool hasVulkan12 = physicalDevice.getProperties().apiVersion >= VK_API_VERSION_1_2;
+        if (hasVulkan12) {
+            features.pNext = &indexingFeatures;
+            physicalDevice.getFeatures2(&features);
+            bindlessSupported = indexingFeatures.runtimeDescriptorArray &&
+                                indexingFeatures.descriptorBindingPartiallyBound &&
+                                indexingFeatures.descriptorBindingUpdateUnusedWhilePending &&
+                                indexingFeatures.descriptorBindingSampledImageUpdateAfterBind &&
+                                indexingFeatures.descriptorBindingStorageBufferUpdateAfterBind &&
+                                indexingFeatures.shaderSampledImageArrayNonUniformIndexing;
+        }
+
+        float priority = 1.0f;
+        vk::DeviceQueueCreateInfo queueInfo{};
+        queueInfo.queueFamilyIndex = queueFamily;
+        queueInfo.queueCount = 1;
+        queueInfo.pQueuePriorities = &priority;
+
+        vk::DeviceCreateInfo deviceInfo{};
+        deviceInfo.pNext = hasVulkan12 ? &features : nullptr;
+        deviceInfo.queueCreateInfoCount = 1;
+        deviceInfo.pQueueCreateInfos = &queueInfo;
+        device = physicalDevice.createDevice(deviceInfo);
+        queue = device.getQueue(queueFamily, 0);
+        memory.initialize(device, physicalDevice, false);
+
+        vk::CommandPoolCreateInfo poolInfo{};
+        poolInfo.flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer;
+        poolInfo.queueFamilyIndex = queueFamily;
+        commandPool = device.createCommandPool(poolInfo);
+
+        vk::CommandBufferAllocateInfo allocInfo{};
+        allocInfo.commandPool = commandPool;
+        allocInfo.level = vk::CommandBufferLevel::ePrimary;
+        allocInfo.commandBufferCount = 1;
+        commandBuffer = device.allocateCommandBuffers(allocInfo)[0];
+
+        std::cout << "Vulkan benchmarks on " << physicalDevice.getProperties().deviceName << std::endl;
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Vulkan unavailable: " << e.what() << std::endl;
+        destroy();
+        return false;
+    }
+}
+
+void HeadlessVulkan::destroy() {
+    if (device) {
+        device.waitIdle();
+        for (auto it = m_cleanup.rbegin(); it != m_cleanup.rend(); ++it) {
+            (*it)();
+        }
+        m_cleanup.clear();
+        memory.cleanup();
+        if (commandPool) device.destroyCommandPool(commandPool);
+        device.destroy();
+    }
+    if (instance) {
+        instance.destroy();
+    }
+    commandPool = nullptr;
+    commandBuffer = nullptr;
+    device = nullptr;
+    instance = nullptr;
+}
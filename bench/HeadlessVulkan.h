@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include "DeviceMemoryTracker.h"
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class MicrobenchSuite;
+
+// Minimal Vulkan device without a window or swapchain, for benchmarks that
+// record commands or create objects. create() returns false when no device
+// is available so those benchmarks can be skipped
+class HeadlessVulkan {
+public:
+    ~HeadlessVulkan() { destroy(); }
+
+    bool create();
+    void destroy();
+
+    // Runs before the device is destroyed, in reverse order of registration
+    void onDestroy(std::function<void()> callback) { m_cleanup.push_back(std::move(callback)); }
+
+    vk::Instance instance;
+    vk::PhysicalDevice physicalDevice;
+    vk::Device device;
+    uint32_t queueFamily = 0;
+    vk::Queue queue;
+    vk::CommandPool commandPool;
+    vk::CommandBuffer commandBuffer;
+    DeviceMemoryTracker memory;
+    bool bindlessSupported = false;
+
+private:
+    std::vector<std::function<void()>> m_cleanup;
+};
+
+void registerVulkanBenchmarks(MicrobenchSuite& suite, HeadlessVulkan& context);
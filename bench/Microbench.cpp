@@ -0,0 +1,293 @@
+#include "Microbench.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <numeric>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define CGAME_HAS_RDTSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CGAME_HAS_RDTSC 1
+#endif
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    double elapsedNs(Clock::time_point start, Clock::time_point end) {
+        return std::chrono::duration<double, std::nano>(end - start).count();
+    }
+
+    // Linear interpolation between the closest ranks of sorted values
+    double percentile(const std::vector<double>& sorted, double fraction) {
+        if (sorted.empty()) return 0.0;
+        double rank = fraction * static_cast<double>(sorted.size() - 1);
+        size_t lower = static_cast<size_t>(rank);
+        size_t upper = std::min(lower + 1, sorted.size() - 1);
+        double weight = rank - static_cast<double>(lower);
+        return sorted[lower] + (sorted[upper] - sorted[lower]) * weight;
+    }
+
+    // Two-sided 95% Student t quantiles for 1..30 degrees of freedom
+    double tQuantile95(size_t degreesOfFreedom) {
+        static const double table[] = {
+            12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+            2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+            2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+        };
+        if (degreesOfFreedom == 0) return 0.0;
+        if (degreesOfFreedom <= 30) return table[degreesOfFreedom - 1];
+        return 1.960;
+    }
+
+    // Whole decimal number with nothing after it; strtoul alone would take
+    // "abc" as 0 and "-1" as its largest value
+    bool parseUnsigned(const char* text, uint32_t& value) {
+        if (!std::isdigit(static_cast<unsigned char>(text[0]))) return false;
+        char* end = nullptr;
+        unsigned long long parsed = std::strtoull(text, &end, 10);
+        if (*end != '\0' || parsed > UINT32_MAX) return false;
+        value = static_cast<uint32_t>(parsed);
+        return true;
+    }
+
+    void writeJsonString(std::ostream& out, const std::string& value) {
+        out << '"';
+        for (char c : value) {
+            if (c == '"' || c == '\\') out << '\\';
+            out << c;
+        }
+        out << '"';
+    }
+}
+
+uint64_t readCycleCounter() {
+#if defined(CGAME_HAS_RDTSC)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t value;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(value));
+    return value;
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        Clock::now().time_since_epoch()).count());
+#endif
+}
+
+const char* cycleCounterName() {
+#if defined(CGAME_HAS_RDTSC)
+    return "tsc";
+#elif defined(__aarch64__)
+    return "cntvct";
+#else
+    return "ns";
+#endif
+}
+
+bool MicrobenchOptions::parse(int argc, char** argv, std::string& error) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = [&](const char* name) -> const char* {
+            if (i + 1 >= argc) {
+                error = std::string(name) + " needs a value";
+                return nullptr;
+            }
+            return argv[++i];
+        };
+
+        if (arg == "--help" || arg == "-h") {
+            showHelp = true;
+        } else if (arg == "--list") {
+            list = true;
+        } else if (arg == "--cpu-only") {
+            skipVulkan = true;
+        } else if (arg == "--check") {
+            checkOnly = true;
+        } else if (arg == "--filter") {
+            const char* v = value("--filter");
+            if (!v) return false;
+            filter = v;
+        } else if (arg == "--repetitions") {
+            const char* v = value("--repetitions");
+            if (!v) return false;
+            if (!parseUnsigned(v, repetitions) || repetitions < 2) {
+                error = "--repetitions needs a whole number of at least 2, got '" + std::string(v) + "'";
+                return false;
+            }
+        } else if (arg == "--warmup-ms") {
+            const char* v = value("--warmup-ms");
+            if (!v) return false;
+            warmupMs = std::strtod(v, nullptr);
+        } else if (arg == "--sample-ms") {
+            const char* v = value("--sample-ms");
+            if (!v) return false;
+            minSampleMs = std::max(0.01, std::strtod(v, nullptr));
+        } else if (arg == "--json") {
+            const char* v = value("--json");
+            if (!v) return false;
+            jsonPath = v;
+        } else {
+            error = "Unknown option " + arg;
+            return false;
+        }
+    }
+    return true;
+}
+
+void MicrobenchOptions::printUsage(std::ostream& out) {
+    out << "Usage: cGame_microbench [options]\n"
+        << "  --filter <text>       Only run benchmarks whose name contains text\n"
+        << "  --repetitions <n>     Timed samples per benchmark (default 30)\n"
+        << "  --warmup-ms <ms>      Untimed warmup per benchmark (default 100)\n"
+        << "  --sample-ms <ms>      Minimum duration of one sample (default 2)\n"
+        << "  --json <path>         Also write results as JSON\n"
+        << "  --cpu-only            Skip benchmarks that need a Vulkan device\n"
+        << "  --check               Only run the correctness checks\n"
+        << "  --list                List benchmark names and exit\n";
+}
+
+void MicrobenchSuite::add(const std::string& name, MicrobenchBody body, uint64_t itemsPerOp) {
+    m_benchmarks.push_back({ name, std::move(body), std::max<uint64_t>(itemsPerOp, 1) });
+}
+
+void MicrobenchSuite::addCheck(const std::string& name, MicrobenchCheck check) {
+    m_checks.push_back({ name, std::move(check) });
+}
+
+size_t MicrobenchSuite::runChecks(const MicrobenchOptions& options, std::ostream& out) const {
+    size_t run = 0;
+    size_t failed = 0;
+    for (const auto& check : m_checks) {
+        if (!options.filter.empty() && check.name.find(options.filter) == std::string::npos) continue;
+        run++;
+        std::string error;
+        if (!check.check(error)) {
+            out << "FAILED " << check.name << ": " << error << '\n';
+            failed++;
+        }
+    }
+    if (run > 0) out << (run - failed) << " of " << run << " checks passed\n";
+    return failed;
+}
+
+void MicrobenchSuite::list(std::ostream& out) const {
+    for (const auto& benchmark : m_benchmarks) {
+        out << benchmark.name << '\n';
+    }
+}
+
+MicrobenchStats MicrobenchSuite::measure(const Benchmark& benchmark, const MicrobenchOptions& options) const {
+    // Scale the batch until one sample is long enough for the clock to
+    // resolve it comfortably
+    const double minSampleNs = options.minSampleMs * 1e6;
+    uint64_t iterations = 1;
+    while (true) {
+        auto start = Clock::now();
+        benchmark.body(iterations);
+        double ns = elapsedNs(start, Clock::now());
+        if (ns >= minSampleNs || iterations >= (1ull << 32)) break;
+        // Jump close to the target once the timing is meaningful
+        double scale = ns > minSampleNs / 100.0 ? std::ceil(minSampleNs * 1.2 / ns) : 10.0;
+        iterations = static_cast<uint64_t>(static_cast<double>(iterations) * std::clamp(scale, 2.0, 10.0));
+    }
+
+    auto warmupStart = Clock::now();
+    while (elapsedNs(warmupStart, Clock::now()) < options.warmupMs * 1e6) {
+        benchmark.body(iterations);
+    }
+
+    std::vector<double> nsPerOp;
+    std::vector<double> cyclesPerOp;
+    nsPerOp.reserve(options.repetitions);
+    cyclesPerOp.reserve(options.repetitions);
+    for (uint32_t i = 0; i < options.repetitions; i++) {
+        auto start = Clock::now();
+        uint64_t startCycles = readCycleCounter();
+        benchmark.body(iterations);
+        uint64_t endCycles = readCycleCounter();
+        auto end = Clock::now();
+        nsPerOp.push_back(elapsedNs(start, end) / static_cast<double>(iterations));
+        cyclesPerOp.push_back(static_cast<double>(endCycles - startCycles) / static_cast<double>(iterations));
+    }
+
+    MicrobenchStats stats;
+    stats.name = benchmark.name;
+    stats.itemsPerOp = benchmark.itemsPerOp;
+    stats.iterationsPerSample = iterations;
+    stats.samples = options.repetitions;
+
+    double n = static_cast<double>(nsPerOp.size());
+    stats.meanNs = std::accumulate(nsPerOp.begin(), nsPerOp.end(), 0.0) / n;
+    double squares = 0.0;
+    for (double value : nsPerOp) {
+        squares += (value - stats.meanNs) * (value - stats.meanNs);
+    }
+    stats.stddevNs = std::sqrt(squares / (n - 1.0));
+    stats.ci95Ns = tQuantile95(nsPerOp.size() - 1) * stats.stddevNs / std::sqrt(n);
+
+    std::sort(nsPerOp.begin(), nsPerOp.end());
+    std::sort(cyclesPerOp.begin(), cyclesPerOp.end());
+    stats.minNs = nsPerOp.front();
+    stats.medianNs = percentile(nsPerOp, 0.5);
+    stats.p95Ns = percentile(nsPerOp, 0.95);
+    stats.medianCycles = percentile(cyclesPerOp, 0.5);
+    return stats;
+}
+
+size_t MicrobenchSuite::run(const MicrobenchOptions& options, std::ostream& out) {
+    m_results.clear();
+
+    out << std::left << std::setw(40) << "benchmark" << std::right
+        << std::setw(12) << "median ns" << std::setw(10) << "+/- 95%"
+        << std::setw(12) << "min ns" << std::setw(12) << "p95 ns"
+        << std::setw(12) << cycleCounterName() << std::setw(14) << "items/s" << '\n';
+
+    for (const auto& benchmark : m_benchmarks) {
+        if (!options.filter.empty() && benchmark.name.find(options.filter) == std::string::npos) continue;
+
+        MicrobenchStats stats = measure(benchmark, options);
+        double itemsPerSecond = static_cast<double>(stats.itemsPerOp) * 1e9 / stats.medianNs;
+
+        out << std::left << std::setw(40) << stats.name << std::right << std::fixed << std::setprecision(1)
+            << std::setw(12) << stats.medianNs << std::setw(10) << stats.ci95Ns
+            << std::setw(12) << stats.minNs << std::setw(12) << stats.p95Ns
+            << std::setw(12) << stats.medianCycles
+            << std::setw(14) << std::scientific << std::setprecision(3) << itemsPerSecond
+            << std::defaultfloat << '\n';
+        out.flush();
+
+        m_results.push_back(std::move(stats));
+    }
+    return m_results.size();
+}
+
+bool MicrobenchSuite::writeJson(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file) return false;
+
+    file << "{\n  \"counter\": \"" << cycleCounterName() << "\",\n  \"benchmarks\": [\n";
+    file << std::setprecision(6);
+    for (size_t i = 0; i < m_results.size(); i++) {
+        const MicrobenchStats& stats = m_results[i];
+        file << "    { \"name\": ";
+        writeJsonString(file, stats.name);
+        file << ", \"items_per_op\": " << stats.itemsPerOp
+             << ", \"iterations\": " << stats.iterationsPerSample
+             << ", \"samples\": " << stats.samples
+             << ", \"median_ns\": " << stats.medianNs
+             << ", \"mean_ns\": " << stats.meanNs
+             << ", \"stddev_ns\": " << stats.stddevNs
+             << ", \"ci95_ns\": " << stats.ci95Ns
+             << ", \"min_ns\": " << stats.minNs
+             << ", \"p95_ns\": " << stats.p95Ns
+             << ", \"median_cycles\": " << stats.medianCycles << " }"
+             << (i + 1 < m_results.size() ? "," : "") << '\n';
+    }
+    file << "  ]\n}\n";
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+// Keeps the compiler from discarding a value or the computation producing it
+template <typename T>
+inline void doNotOptimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+    _ReadWriteBarrier();
+#endif
+}
+
+// Forces pending writes to be treated as observable
+inline void clobberMemory() {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : : "memory");
+#else
+    _ReadWriteBarrier();
+#endif
+}
+
+// Raw cycle counter: the TSC on x86, the virtual counter on ARM64, and
+// nanoseconds elsewhere. cycleCounterName() says which one is in use
+uint64_t readCycleCounter();
+const char* cycleCounterName();
+
+// A benchmark body performs `iterations` operations per call. Setup belongs
+// outside the body, where it is not timed
+using MicrobenchBody = std::function<void(uint64_t iterations)>;
+
+// Verifies that the code a benchmark times gives the right answer, e.g. that
+// a SIMD path matches the scalar one. Returns false with a message in error
+using MicrobenchCheck = std::function<bool(std::string& error)>;
+
+struct MicrobenchOptions {
+    std::string filter;                 // Substring match on names
+    uint32_t repetitions = 30;          // Timed samples per benchmark
+    double warmupMs = 100.0;
+    double minSampleMs = 2.0;           // Iterations are scaled to reach this
+    std::string jsonPath;
+    bool list = false;
+    bool skipVulkan = false;
+    bool checkOnly = false;             // Run the checks and no benchmarks
+    bool showHelp = false;
+
+    bool parse(int argc, char** argv, std::string& error);
+    static void printUsage(std::ostream& out);
+};
+
+struct MicrobenchStats {
+    std::string name;
+    uint64_t itemsPerOp = 1;
+    uint64_t iterationsPerSample = 0;
+    uint32_t samples = 0;
+    // Per operation, over the timed samples
+    double minNs = 0.0;
+    double medianNs = 0.0;
+    double meanNs = 0.0;
+    double stddevNs = 0.0;
+    double p95Ns = 0.0;
+    double ci95Ns = 0.0;                // Half-width of the 95% interval of the mean
+    double medianCycles = 0.0;
+};
+
+// Registers benchmarks and runs them: calibrate the iteration count until a
+// sample takes minSampleMs, warm up, then take `repetitions` samples and
+// summarize them
+class MicrobenchSuite {
+public:
+    // itemsPerOp is how many elements one operation processes (e.g. sprites
+    // culled), used to report throughput
+    void add(const std::string& name, MicrobenchBody body, uint64_t itemsPerOp = 1);
+    void addCheck(const std::string& name, MicrobenchCheck check);
+
+    // Runs the checks the filter selects, before any timing, so a fast
+    // but wrong path fails instead of reporting a result. Returns the
+    // number that failed
+    size_t runChecks(const MicrobenchOptions& options, std::ostream& out) const;
+
+    // Returns the number of benchmarks run
+    size_t run(const MicrobenchOptions& options, std::ostream& out);
+
+    bool writeJson(const std::string& path) const;
+    void list(std::ostream& out) const;
+
+private:
+    struct Benchmark {
+        std::string name;
+        MicrobenchBody body;
+        uint64_t itemsPerOp;
+    };
+
+    struct Check {
+        std::string name;
+        MicrobenchCheck check;
+    };
+
+    std::vector<Benchmark> m_benchmarks;
+    std::vector<Check> m_checks;
+    std::vector<MicrobenchStats> m_results;
+
+    MicrobenchStats measure(const Benchmark& benchmark, const MicrobenchOptions& options) const;
+};
+
+// Benchmark sets, each in its own translation unit
+void registerCpuBenchmarks(MicrobenchSuite& suite);
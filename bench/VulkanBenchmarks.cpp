@@ -0,0 +1,223 @@
+#include "HeadlessVulkan.h"
+#include "Microbench.h"
+#include "DescriptorManager.h"
+#include "RenderGraph.h"
+#include <iostream>
+#include <memory>
+
+// Benchmarks of CPU-side Vulkan work: command recording, render graph
+// compilation and descriptor bookkeeping. Nothing is submitted, so the
+// numbers are what the frame costs the CPU before the GPU sees it.
+
+namespace {
+    constexpr vk::Extent2D TARGET_EXTENT{ 1280, 720 };
+    constexpr vk::Format TARGET_FORMAT = vk::Format::eR8G8B8A8Unorm;
+
+    // Stands in for the swapchain image the game renders to
+    struct OffscreenTarget {
+        vk::Image image;
+        vk::DeviceMemory memory;
+        vk::ImageView view;
+    };
+
+    OffscreenTarget createOffscreenTarget(HeadlessVulkan& context) {
+        OffscreenTarget target;
+
+        vk::ImageCreateInfo imageInfo{};
+        imageInfo.imageType = vk::ImageType::e2D;
+        imageInfo.format = TARGET_FORMAT;
+        imageInfo.extent = vk::Extent3D{ TARGET_EXTENT.width, TARGET_EXTENT.height, 1 };
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = vk::SampleCountFlagBits::e1;
+        imageInfo.tiling = vk::ImageTiling::eOptimal;
+        imageInfo.usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled;
+        imageInfo.initialLayout = vk::ImageLayout::eUndefined;
+        target.image = context.device.createImage(imageInfo);
+
+        target.memory = context.memory.allocate(context.device.getImageMemoryRequirements(target.image),
+                                                vk::MemoryPropertyFlagBits::eDeviceLocal,
+                                                MemoryCategory::RenderTarget, "benchmark target");
+        context.device.bindImageMemory(target.image, target.memory, 0);
+
+        vk::ImageViewCreateInfo viewInfo{};
+        viewInfo.image = target.image;
+        viewInfo.viewType = vk::ImageViewType::e2D;
+        viewInfo.format = TARGET_FORMAT;
+        viewInfo.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.layerCount = 1;
+        target.view = context.device.createImageView(viewInfo);
+
+        vk::Device device = context.device;
+        DeviceMemoryTracker* memory = &context.memory;
+        context.onDestroy([device, memory, target] {
+            device.destroyImageView(target.view);
+            device.destroyImage(target.image);
+            memory->free(target.memory);
+        });
+        return target;
+    }
+
+    // Declares a chain of full-screen passes ending in the target, the shape
+    // post-processing gives a frame. Every transient is read by the next
+    // pass only, so the graph can alias all but two of them
+    void declareChain(RenderGraph& graph, const OffscreenTarget& target, uint32_t intermediates) {
+        RGResource output = graph.importImage("target", target.image, target.view, TARGET_FORMAT, TARGET_EXTENT,
+                                              vk::ImageLayout::eUndefined,
+                                              vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                                              vk::ImageLayout::eShaderReadOnlyOptimal);
+
+        auto recordPass = [](const RGPassContext& context) {
+            vk::Viewport viewport(0.0f, 0.0f, static_cast<float>(context.extent.width),
+                                  static_cast<float>(context.extent.height), 0.0f, 1.0f);
+            context.commandBuffer.setViewport(0, viewport);
+            context.commandBuffer.setScissor(0, vk::Rect2D({ 0, 0 }, context.extent));
+        };
+
+        const vk::ClearColorValue clear(std::array<float, 4>{ 0.0f, 0.0f, 0.0f, 1.0f });
+        RGResource previous = INVALID_RG_RESOURCE;
+        for (uint32_t i = 0; i < intermediates; i++) {
+            RGResource image = graph.createImage("intermediate", { TARGET_FORMAT, TARGET_EXTENT });
+            auto pass = graph.addPass("intermediate", RGPassType::Graphics);
+            if (previous != INVALID_RG_RESOURCE) pass.read(previous, RGAccess::FragmentSampled);
+            pass.writeColor(image, clear).execute(recordPass);
+            previous = image;
+        }
+
+        auto last = graph.addPass("composite", RGPassType::Graphics);
+        if (previous != INVALID_RG_RESOURCE) last.read(previous, RGAccess::FragmentSampled);
+        last.writeColor(output, clear).execute(recordPass);
+    }
+
+    void registerMemoryTypeBenchmarks(MicrobenchSuite& suite, HeadlessVulkan& context) {
+        // The lookup as it was before the properties were cached: one driver
+        // query per allocation. Compare with memory/find_type_cached
+        vk::PhysicalDevice physicalDevice = context.physicalDevice;
+        suite.add("memory/find_type_queried", [physicalDevice](uint64_t iterations) {
+            uint32_t sum = 0;
+            for (uint64_t i = 0; i < iterations; i++) {
+                sum += DeviceMemoryTracker::findMemoryType(physicalDevice.getMemoryProperties(), ~0u,
+                                                           vk::MemoryPropertyFlagBits::eDeviceLocal);
+            }
+            doNotOptimize(sum);
+        });
+    }
+
+    void registerRenderGraphBenchmarks(MicrobenchSuite& suite, HeadlessVulkan& context,
+                                       const OffscreenTarget& target) {
+        auto graph = std::make_shared<RenderGraph>();
+        if (!graph->initialize(context.device, context.memory)) {
+            std::cerr << "Skipping render graph benchmarks: initialization failed" << std::endl;
+            return;
+        }
+        context.onDestroy([graph] { graph->cleanup(); });
+
+        // Declaration and compilation only, as when nothing changes between frames
+        suite.add("render_graph/compile_chain_8", [graph, target](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                graph->reset();
+                declareChain(*graph, target, 7);
+                bool compiled = graph->compile();
+                doNotOptimize(compiled);
+            }
+        }, 8);
+
+        // Everything drawFrame() does on the CPU for a single-pass frame
+        vk::CommandBuffer commandBuffer = context.commandBuffer;
+        suite.add("render_graph/record_frame", [graph, target, commandBuffer](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                graph->reset();
+                declareChain(*graph, target, 0);
+                graph->compile();
+                commandBuffer.begin(vk::CommandBufferBeginInfo{ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+                graph->execute(commandBuffer);
+                commandBuffer.end();
+            }
+        });
+
+        suite.add("render_graph/record_chain_8", [graph, target, commandBuffer](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                graph->reset();
+                declareChain(*graph, target, 7);
+                graph->compile();
+                commandBuffer.begin(vk::CommandBufferBeginInfo{ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+                graph->execute(commandBuffer);
+                commandBuffer.end();
+            }
+        }, 8);
+    }
+
+    void registerCommandBenchmarks(MicrobenchSuite& suite, HeadlessVulkan& context) {
+        vk::PushConstantRange pushRange{};
+        pushRange.stageFlags = DescriptorManager::PUSH_CONSTANT_STAGES;
+        pushRange.size = DescriptorManager::PUSH_CONSTANT_SIZE;
+
+        vk::PipelineLayoutCreateInfo layoutInfo{};
+        layoutInfo.pushConstantRangeCount = 1;
+        layoutInfo.pPushConstantRanges = &pushRange;
+        vk::PipelineLayout layout = context.device.createPipelineLayout(layoutInfo);
+
+        vk::Device device = context.device;
+        context.onDestroy([device, layout] { device.destroyPipelineLayout(layout); });
+
+        // Per-draw state as sprite batches and the HUD set it: scissor plus
+        // a push constant block
+        constexpr uint32_t DRAWS = 256;
+        vk::CommandBuffer commandBuffer = context.commandBuffer;
+        suite.add("commands/scissor_push_constants", [commandBuffer, layout](uint64_t iterations) {
+            struct { float values[16]; } constants{};
+            for (uint64_t i = 0; i < iterations; i++) {
+                commandBuffer.begin(vk::CommandBufferBeginInfo{ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+                for (uint32_t draw = 0; draw < DRAWS; draw++) {
+                    constants.values[0] = static_cast<float>(draw);
+                    commandBuffer.setScissor(0, vk::Rect2D({ 0, 0 }, TARGET_EXTENT));
+                    commandBuffer.pushConstants(layout, DescriptorManager::PUSH_CONSTANT_STAGES, 0,
+                                                sizeof(constants), &constants);
+                }
+                commandBuffer.end();
+            }
+        }, DRAWS);
+    }
+
+    void registerDescriptorBenchmarks(MicrobenchSuite& suite, HeadlessVulkan& context,
+                                      const OffscreenTarget& target) {
+        if (!context.bindlessSupported) {
+            std::cout << "Skipping descriptor benchmarks: no descriptor indexing" << std::endl;
+            return;
+        }
+
+        auto descriptors = std::make_shared<DescriptorManager>();
+        if (!descriptors->initialize(context.device, context.physicalDevice, 2)) {
+            std::cerr << "Skipping descriptor benchmarks: initialization failed" << std::endl;
+            return;
+        }
+        context.onDestroy([descriptors] { descriptors->cleanup(); });
+
+        // Register, release and advance a frame, so released slots are
+        // recycled the way a streaming texture's would be
+        auto frameNumber = std::make_shared<uint64_t>(0);
+        vk::ImageView view = target.view;
+        suite.add("descriptors/register_release_texture", [descriptors, frameNumber, view](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                uint64_t frame = ++*frameNumber;
+                descriptors->beginFrame(frame);
+                uint32_t index = descriptors->registerTexture(view);
+                doNotOptimize(index);
+                descriptors->releaseTexture(index);
+            }
+        });
+    }
+}
+
+void registerVulkanBenchmarks(MicrobenchSuite& suite, HeadlessVulkan& context) {
+    try {
+        OffscreenTarget target = createOffscreenTarget(context);
+        registerMemoryTypeBenchmarks(suite, context);
+        registerRenderGraphBenchmarks(suite, context, target);
+        registerCommandBenchmarks(suite, context);
+        registerDescriptorBenchmarks(suite, context, target);
+    } catch (const std::exception& e) {
+        std::cerr << "Skipping remaining Vulkan benchmarks: " << e.what() << std::endl;
+    }
+}
@@ -0,0 +1,53 @@
+#include "HeadlessVulkan.h"
+#include "Microbench.h"
+#include <iostream>
+
+int main(int argc, char** argv) {
+    MicrobenchOptions options;
+    std::string error;
+    if (!options.parse(argc, argv, error)) {
+        std::cerr << error << std::endl;
+        MicrobenchOptions::printUsage(std::cerr);
+        return 1;
+    }
+    if (options.showHelp) {
+        MicrobenchOptions::printUsage(std::cout);
+        return 0;
+    }
+
+    // Declared before the suite so benchmark state captured by the suite
+    // is released before the device it was created on
+    HeadlessVulkan vulkan;
+    MicrobenchSuite suite;
+    registerCpuBenchmarks(suite);
+    if (!options.skipVulkan) {
+        if (vulkan.create()) {
+            registerVulkanBenchmarks(suite, vulkan);
+        } else {
+            std::cout << "Skipping Vulkan benchmarks" << std::endl;
+        }
+    }
+
+    if (options.list) {
+        suite.list(std::cout);
+        return 0;
+    }
+
+    if (suite.runChecks(options, std::cout) > 0) {
+        return 1;
+    }
+    if (options.checkOnly) {
+        return 0;
+    }
+
+    if (suite.run(options, std::cout) == 0) {
+        std::cerr << "No benchmark matches '" << options.filter << "'" << std::endl;
+        return 1;
+    }
+
+    if (!options.jsonPath.empty() && !suite.writeJson(options.jsonPath)) {
+        std::cerr << "Failed to write " << options.jsonPath << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -23,9 +23,14 @@ if [ $? -ne 0 ]; then
     exit 1
 fi
 
-# Build the project
-echo "Building project..."
-make -j$(nproc)
+# Build the project; --pgo builds the profile-guided game in build/pgo
+if [ "$1" == "--pgo" ]; then
+    echo "Building profile-guided project..."
+    make pgo
+else
+    echo "Building project..."
+    make -j$(nproc)
+fi
 
 # Check if build was successful
 if [ $? -ne 0 ]; then
@@ -34,6 +39,10 @@ if [ $? -ne 0 ]; then
 fi
 
 echo "Build completed successfully!"
+if [ "$1" == "--pgo" ]; then
+    echo "Executable location: build/pgo/bin/cGame"
+    exit 0
+fi
 echo "Executable location: build/bin/cGame"
 
 # Optionally run the application
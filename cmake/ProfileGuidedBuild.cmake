@@ -0,0 +1,87 @@
+# Runs the stages of a profile-guided build; the pgo target in the top-level
+# CMakeLists.txt invokes it with cmake -P. Expects SOURCE_DIR, BINARY_DIR,
+# GENERATOR, CXX_COMPILER, COMPILER_ID, TRAIN_SCENES and, for Clang,
+# LLVM_PROFDATA.
+#
+# 1. Configure BINARY_DIR for CGAME_PGO=GENERATE and build it
+# 2. Train: the CPU microbenchmarks, which need no GPU or display. With
+#    TRAIN_SCENES the benchmark scenes run too; they drive the real frame
+#    loop, so they need a Vulkan device and a window
+# 3. Switch the same tree to CGAME_PGO=USE and CGAME_LTO=ON and rebuild.
+#    GCC matches profiles to objects by path, so both builds share one tree
+#
+# Each phase configures the tree once, and not at all when its cache
+# already holds that phase's settings.
+
+cmake_minimum_required(VERSION 3.16)
+
+set(PROFILE_DIR ${BINARY_DIR}/profile)
+
+function(run_step description)
+    message(STATUS "PGO: ${description}")
+    execute_process(COMMAND ${ARGN} WORKING_DIRECTORY ${BINARY_DIR} RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        string(REPLACE ";" " " command "${ARGN}")
+        message(FATAL_ERROR "PGO: ${description} failed (${result}): ${command}")
+    endif()
+endfunction()
+
+# The first configure sets up the whole cache; after that a phase only
+# changes the two settings that differ between the builds
+function(configure_stage stage lto)
+    set(cache ${BINARY_DIR}/CMakeCache.txt)
+    if(EXISTS ${cache})
+        load_cache(${BINARY_DIR} READ_WITH_PREFIX CACHED_ CGAME_PGO CGAME_LTO)
+        if(CACHED_CGAME_PGO STREQUAL stage AND CACHED_CGAME_LTO STREQUAL lto)
+            return()
+        endif()
+        run_step("configuring the ${stage} build"
+            ${CMAKE_COMMAND} -S ${SOURCE_DIR} -B ${BINARY_DIR} -DCGAME_PGO=${stage} -DCGAME_LTO=${lto})
+    else()
+        run_step("configuring the ${stage} build"
+            ${CMAKE_COMMAND} -S ${SOURCE_DIR} -B ${BINARY_DIR} -G ${GENERATOR}
+            -DCMAKE_BUILD_TYPE=Release
+            -DCMAKE_CXX_COMPILER=${CXX_COMPILER}
+            -DCGAME_BUILD_MICROBENCH=ON
+            -DCGAME_PGO=${stage}
+            -DCGAME_PGO_DIR=${PROFILE_DIR}
+            -DCGAME_LTO=${lto})
+    endif()
+endfunction()
+
+function(build_stage stage)
+    run_step("building the ${stage} build" ${CMAKE_COMMAND} --build ${BINARY_DIR} --config Release --parallel)
+endfunction()
+
+if(COMPILER_ID MATCHES "Clang" AND NOT LLVM_PROFDATA)
+    message(FATAL_ERROR "PGO: llvm-profdata, which merges Clang profiles, wasn't found next to ${CXX_COMPILER}")
+endif()
+
+file(MAKE_DIRECTORY ${BINARY_DIR})
+configure_stage(GENERATE OFF)
+build_stage(GENERATE)
+
+# Profiles from an earlier run would be counted again
+file(REMOVE_RECURSE ${PROFILE_DIR})
+file(MAKE_DIRECTORY ${PROFILE_DIR})
+run_step("training on the CPU microbenchmarks"
+    ${BINARY_DIR}/bin/cGame_microbench --cpu-only --repetitions 5)
+if(TRAIN_SCENES)
+    message(STATUS "PGO: training on the benchmark scenes")
+    execute_process(COMMAND ${BINARY_DIR}/bin/cGame --benchmark --output ${BINARY_DIR}/training.json
+                    WORKING_DIRECTORY ${BINARY_DIR} RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "PGO: the benchmark scenes failed (${result}). They need a Vulkan device and "
+                            "a display; configure with -DCGAME_PGO_TRAIN_SCENES=OFF to train on the CPU "
+                            "microbenchmarks alone")
+    endif()
+endif()
+
+if(COMPILER_ID MATCHES "Clang")
+    file(GLOB RAW_PROFILES ${PROFILE_DIR}/*.profraw)
+    run_step("merging profiles" ${LLVM_PROFDATA} merge -output=${PROFILE_DIR}/cgame.profdata ${RAW_PROFILES})
+endif()
+
+configure_stage(USE ON)
+build_stage(USE)
+message(STATUS "PGO: profile-guided build is ${BINARY_DIR}/bin/cGame")
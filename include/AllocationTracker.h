@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Part of the frame a thread is working on. Heap allocations are counted per
+// phase for threads that have set one; allocations on other threads (asset
+// IO, driver threads) are untracked
+enum class AllocationPhase : uint8_t {
+    Untracked,
+    Game,           // Between endFrame() and the next beginFrame()
+    BeginFrame,
+    Record,
+    Submit,
+    Count
+};
+
+const char* getAllocationPhaseName(AllocationPhase phase);
+
+struct AllocationFrameStats {
+    std::array<uint64_t, static_cast<size_t>(AllocationPhase::Count)> allocations{};
+    std::array<uint64_t, static_cast<size_t>(AllocationPhase::Count)> bytes{};
+
+    // Tracked phases only
+    uint64_t totalAllocations() const;
+    uint64_t totalBytes() const;
+};
+
+// Counts heap allocations by replacing the global operator new and delete.
+// The renderer marks frame boundaries, so each frame's allocations can be
+// reported per phase (the HUD and benchmark results show them).
+//
+// In debug builds with CGAME_ALLOCATION_CHECK=1 in the environment, a heap
+// allocation on a tracked thread once the game has reached steady state
+// asserts. Steady state is STEADY_STATE_WARMUP_FRAMES frames without a call
+// to markUnsteady(), which code calls on paths that legitimately allocate
+// (loading, resizing, device memory changes). The check is opt-in because
+// validation layers allocate on the calling thread.
+class AllocationTracker {
+public:
+    static constexpr uint64_t STEADY_STATE_WARMUP_FRAMES = 120;
+
+    // Phase of the calling thread
+    static void setPhase(AllocationPhase phase);
+    static AllocationPhase getPhase();
+
+    // Closes the previous frame's counts
+    static void beginFrame(uint64_t frameNumber);
+    static const AllocationFrameStats& getLastFrameStats();
+
+    // Restarts the warmup. Safe to call from any thread
+    static void markUnsteady();
+    static void setSteadyStateCheck(bool enabled);
+    static bool isSteadyStateCheckEnabled();
+    static bool isSteady();
+
+    // Called from operator new; not for other use
+    static void recordAllocation(size_t size);
+};
+
+// Sets the calling thread's phase for a scope
+class AllocationPhaseScope {
+public:
+    explicit AllocationPhaseScope(AllocationPhase phase) : m_previous(AllocationTracker::getPhase()) {
+        AllocationTracker::setPhase(phase);
+    }
+    ~AllocationPhaseScope() { AllocationTracker::setPhase(m_previous); }
+
+    AllocationPhaseScope(const AllocationPhaseScope&) = delete;
+    AllocationPhaseScope& operator=(const AllocationPhaseScope&) = delete;
+
+private:
+    AllocationPhase m_previous;
+};
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "DeviceMemoryTracker.h"
+#include "RenderGraph.h"
+
+// Streaming priority. Lower values are serviced first by the I/O threads
+enum class AssetPriority : uint8_t {
+    VisibleNow = 0,     // Needed by the frame being built
+    Prefetch = 1        // Likely needed soon, load when idle
+};
+
+enum class AssetState : uint8_t {
+    Queued,             // Waiting for an I/O thread
+    Loading,            // Being read by an I/O thread
+    Loaded,             // Host copy ready, waiting for upload
+    Resident,           // Copied to device-local memory
+    Evicted,            // Dropped to stay within budget
+    Failed              // File could not be read or uploaded
+};
+
+using AssetHandle = uint32_t;
+constexpr AssetHandle INVALID_ASSET_HANDLE = UINT32_MAX;
+
+// Residency limits. Uploads are spread over frames so a burst of
+// completed loads never turns into a single long frame
+struct AssetBudget {
+    vk::DeviceSize hostBytes = 256ull << 20;
+    vk::DeviceSize deviceBytes = 512ull << 20;
+    vk::DeviceSize uploadBytesPerFrame = 16ull << 20;
+};
+
+struct AssetStats {
+    vk::DeviceSize hostBytes = 0;
+    vk::DeviceSize deviceBytes = 0;
+    uint32_t residentCount = 0;
+    uint32_t pendingCount = 0;
+    uint64_t evictionCount = 0;
+};
+
+// Loads files on background I/O threads and uploads them to device memory
+// from the render thread, keeping host and device usage within an
+// AssetBudget by evicting least recently used assets. Uploads go through a
+// per-frame staging buffer into device-local memory, copied by a transfer
+// pass at the start of the frame's graph.
+class AssetStreamer {
+public:
+    using ResidentCallback = std::function<void(AssetHandle handle, uint64_t frame)>;
+
+    // A failed asset is read again if it is requested this many frames
+    // after it failed, so a missing file isn't retried every frame
+    static constexpr uint64_t FAILED_RETRY_FRAMES = 120;
+
+    AssetStreamer();
+    ~AssetStreamer();
+
+    bool initialize(vk::Device device, DeviceMemoryTracker& memory,
+                    const AssetBudget& budget, uint32_t ioThreadCount = 2,
+                    uint32_t framesInFlight = 2);
+    void cleanup();
+
+    // Requests an asset. Requesting an already known path returns the same
+    // handle, raises its priority if needed and marks it as used this frame.
+    // Evicted assets, and failed ones after FAILED_RETRY_FRAMES, are queued
+    // again
+    AssetHandle request(const std::string& path, AssetPriority priority,
+                        vk::BufferUsageFlags usage = vk::BufferUsageFlagBits::eVertexBuffer,
+                        bool keepHostCopy = false);
+
+    // Marks an asset as used by the current frame so it is not evicted
+    void touch(AssetHandle handle);
+
+    // Render thread, once per frame after the frame's fence has signaled.
+    // Evicts to stay within budget
+    void update(uint64_t frameNumber);
+    // Called from drawFrame before any pass that reads assets: stages
+    // completed loads and adds the pass copying them to device memory.
+    // Assets are resident from this frame on
+    void prepare(RenderGraph& graph, uint32_t frameIndex);
+
+    AssetState getState(AssetHandle handle) const;
+    bool isResident(AssetHandle handle) const { return getState(handle) == AssetState::Resident; }
+    vk::Buffer getBuffer(AssetHandle handle) const;
+    vk::DeviceSize getSize(AssetHandle handle) const;
+    uint64_t getResidentFrame(AssetHandle handle) const;
+    AssetStats getStats() const;
+
+    void setResidentCallback(ResidentCallback callback) { m_residentCallback = std::move(callback); }
+    void setBudget(const AssetBudget& budget);
+
+private:
+    struct Asset {
+        std::string path;
+        AssetPriority priority = AssetPriority::Prefetch;
+        AssetState state = AssetState::Queued;
+        vk::BufferUsageFlags usage;
+        bool keepHostCopy = false;
+
+        std::vector<char> hostData;
+        vk::Buffer buffer;
+        vk::DeviceMemory memory;
+        vk::DeviceSize deviceSize = 0;
+
+        uint64_t residentFrame = 0;
+        uint64_t lastUsedFrame = 0;
+        uint64_t failedFrame = 0;
+        std::list<AssetHandle>::iterator lruPosition;
+        bool inLru = false;
+    };
+
+    struct LoadJob {
+        AssetPriority priority;
+        uint64_t sequence;
+        AssetHandle handle;
+
+        bool operator<(const LoadJob& other) const {
+            // std::priority_queue pops the largest element
+            if (priority != other.priority) return priority > other.priority;
+            return sequence > other.sequence;
+        }
+    };
+
+    struct StagedCopy {
+        vk::Buffer buffer;
+        vk::BufferCopy region;
+    };
+
+    // Reused once the frame's fence has signaled; grows past the upload
+    // budget only for an asset larger than it
+    struct FrameUpload {
+        vk::Buffer staging;
+        vk::DeviceMemory stagingMemory;
+        char* mapped = nullptr;
+        vk::DeviceSize capacity = 0;
+        std::vector<StagedCopy> copies;
+    };
+
+    vk::Device m_device;
+    DeviceMemoryTracker* m_memory = nullptr;
+    AssetBudget m_budget;
+    uint32_t m_framesInFlight = 2;
+
+    // Guards everything below
+    mutable std::mutex m_mutex;
+    std::condition_variable m_jobAvailable;
+    std::priority_queue<LoadJob> m_jobs;
+    uint64_t m_jobSequence = 0;
+    std::vector<Asset> m_assets;
+    std::unordered_map<std::string, AssetHandle> m_handlesByPath;
+    std::vector<AssetHandle> m_loaded;
+    std::list<AssetHandle> m_lru;           // Front is most recently used
+    vk::DeviceSize m_hostBytes = 0;
+    vk::DeviceSize m_deviceBytes = 0;
+    uint64_t m_evictionCount = 0;
+    uint64_t m_frameNumber = 0;
+    bool m_stopping = false;
+
+    std::vector<std::thread> m_ioThreads;
+    ResidentCallback m_residentCallback;
+    // Frame thread only
+    std::vector<FrameUpload> m_frames;
+    // Handles made resident by prepare(), for callbacks run after the lock
+    // is released
+    std::vector<std::pair<AssetHandle, uint64_t>> m_newlyResident;
+    bool m_initialized = false;
+
+    void ioThreadMain();
+    void enqueue(AssetHandle handle);
+    void touchLocked(AssetHandle handle);
+    bool upload(Asset& asset, FrameUpload& frame, vk::DeviceSize stagingOffset);
+    bool reserveStaging(FrameUpload& frame, vk::DeviceSize bytes);
+    void destroyStaging(FrameUpload& frame);
+    void releaseDevice(Asset& asset);
+    void releaseHost(Asset& asset);
+    void evictToBudget();
+};
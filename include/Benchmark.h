@@ -0,0 +1,128 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class VulkanRenderer;
+class Window;
+struct GameOptions;
+
+// Fixed simulation step; scenes never see wall-clock time, so the same seed
+// and input produce the same frames on every run
+constexpr float BENCHMARK_TIMESTEP = 1.0f / 60.0f;
+
+// Camera input for one frame
+struct InputFrame {
+    float panX = 0.0f;      // Screen widths per second
+    float panY = 0.0f;
+    float zoom = 1.0f;      // Multiplier applied this frame
+};
+
+constexpr float MIN_CAMERA_ZOOM = 0.05f;
+constexpr float MAX_CAMERA_ZOOM = 20.0f;
+
+// Per-frame camera input that benchmarks replay instead of reading the
+// keyboard. Stored as text: a header line, then "panX panY zoom" per frame
+class InputRecording {
+public:
+    // A smooth camera path derived from the seed
+    static InputRecording scripted(uint64_t seed, uint32_t frameCount);
+
+    // Live input: arrow keys pan, Q/E zoom out/in
+    static InputFrame sample(const Window& window);
+
+    bool load(const std::string& path);
+    bool save(const std::string& path) const;
+
+    void push(const InputFrame& frame) { m_frames.push_back(frame); }
+    InputFrame at(uint32_t frame) const;    // Holds still past the end
+    size_t size() const { return m_frames.size(); }
+
+private:
+    std::vector<InputFrame> m_frames;
+};
+
+// A workload driven through VulkanRenderer's frame API. Everything a scene
+// does must follow from the seed and the frame number
+class BenchmarkScene {
+public:
+    virtual ~BenchmarkScene() = default;
+
+    virtual const char* getName() const = 0;
+    virtual glm::vec2 getWorldSize() const = 0;
+
+    // Creates textures, materials and the initial state
+    virtual bool setup(VulkanRenderer& renderer, uint64_t seed) = 0;
+    // Advances one BENCHMARK_TIMESTEP and submits this frame's sprites;
+    // called between beginFrame and drawFrame
+    virtual void update(VulkanRenderer& renderer, uint32_t frame) = 0;
+    // Called once the GPU is idle
+    virtual void teardown(VulkanRenderer& renderer) = 0;
+};
+
+std::vector<std::string> getBenchmarkSceneNames();
+std::unique_ptr<BenchmarkScene> createBenchmarkScene(const std::string& name);
+
+// What only --benchmark runs read; GameOptions holds the settings they
+// share with the game
+struct BenchmarkOptions {
+    bool enabled = false;
+    std::vector<std::string> scenes;        // Empty runs every scene
+    uint32_t warmupFrames = 120;
+    uint32_t measureFrames = 600;
+    std::string inputPath;                  // Replay this instead of the scripted path
+    std::string recordPath;                 // Save the input that was used
+    bool liveInput = false;                 // Take input from the keyboard
+    std::string outputPath = "benchmark_results.json";
+    std::string baselinePath;
+    double tolerance = 0.05;                // Allowed slowdown as a fraction
+    std::string screenshotDir;              // Save each scene's last frame here as a PNG
+};
+
+enum class MetricKind : uint8_t {
+    Timing,     // Lower is better; compared with the tolerance
+    Exact,      // Describes the workload; must match the baseline
+    Info        // Reported only
+};
+
+struct BenchmarkMetric {
+    std::string name;
+    double value;
+    MetricKind kind;
+};
+
+struct BenchmarkResult {
+    std::string scene;
+    std::vector<BenchmarkMetric> metrics;
+};
+
+// Runs scenes for warmup + measured frames, writes the results as JSON and
+// optionally compares them with a baseline file written by an earlier run
+class BenchmarkRunner {
+public:
+    // Runs options.benchmark with the seed, render scale and capture path
+    // the game would use
+    explicit BenchmarkRunner(const GameOptions& options);
+
+    // Process exit code: 0 passed, 1 could not run, 2 slower than the
+    // baseline or a different workload
+    int run(Window& window, VulkanRenderer& renderer);
+
+    const std::vector<BenchmarkResult>& getResults() const { return m_results; }
+
+private:
+    BenchmarkOptions m_options;
+    uint64_t m_seed = 1;
+    float m_renderScale = 0.0f;
+    std::string m_capturePath;
+    std::vector<BenchmarkResult> m_results;
+
+    bool runScene(Window& window, VulkanRenderer& renderer, BenchmarkScene& scene,
+                  const InputRecording& input, InputRecording& recorded);
+    bool writeJson(const std::string& path, const VulkanRenderer& renderer) const;
+    bool compareWithBaseline(const std::string& path, std::ostream& out) const;
+};
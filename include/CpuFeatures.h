@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+
+// Instruction sets the SIMD kernels (CPU particles, transform composing, the
+// physics sweep) have a path for. Every build compiles all the paths its
+// architecture has and picks one at runtime, so the same binary uses AVX2
+// where the CPU has it and still runs on one that doesn't
+enum class SimdLevel : uint8_t {
+    Scalar,
+    SSE2,           // Baseline on x86-64
+    AVX2
+};
+
+// Widest level this CPU and OS support, detected on first use. CGAME_SIMD
+// set to scalar, sse2 or avx2 in the environment lowers it, e.g. to compare
+// the paths in a benchmark
+SimdLevel getSimdLevel();
+
+const char* getSimdLevelName(SimdLevel level);
+
+// The vector paths are x86-64 only; elsewhere the kernels run scalar
+#if defined(__x86_64__) || defined(_M_X64)
+#define CGAME_SIMD_X64 1
+#else
+#define CGAME_SIMD_X64 0
+#endif
+
+// Functions defined between these are compiled for AVX2 whatever the build
+// targets, and must only be called when getSimdLevel() is AVX2. Functions
+// they call from outside keep the build's target, so no AVX2 code leaks
+// into inline functions shared with the rest of the program. MSVC compiles
+// AVX2 intrinsics anywhere
+#if defined(__clang__)
+#define CGAME_AVX2_BEGIN _Pragma("clang attribute push (__attribute__((target(\"avx2\"))), apply_to = function)")
+#define CGAME_AVX2_END _Pragma("clang attribute pop")
+#elif defined(__GNUC__)
+#define CGAME_AVX2_BEGIN _Pragma("GCC push_options") _Pragma("GCC target(\"avx2\")")
+#define CGAME_AVX2_END _Pragma("GCC pop_options")
+#else
+#define CGAME_AVX2_BEGIN
+#define CGAME_AVX2_END
+#endif
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+constexpr uint32_t INVALID_BINDLESS_INDEX = UINT32_MAX;
+
+enum class SamplerType : uint8_t {
+    Linear,
+    Nearest,
+    Count
+};
+
+// Owns the descriptor set shared by every pipeline: one large bindless
+// array of textures (binding 0) and storage buffers (binding 1), written
+// once when a resource is registered. Pipeline layouts built from this set
+// plus PUSH_CONSTANT_SIZE bytes of push constants are compatible, so the
+// set is bound once per pass and draws select their texture or buffer
+// through push constants. Per-frame values such as the camera travel in
+// the push constants too, so no set is allocated per frame.
+class DescriptorManager {
+public:
+    static constexpr uint32_t MAX_BINDLESS_TEXTURES = 4096;
+    static constexpr uint32_t MAX_BINDLESS_BUFFERS = 1024;
+    static constexpr uint32_t PUSH_CONSTANT_SIZE = 128;
+    // The single push constant range is visible to every stage, so
+    // pushConstants() calls must name all of them
+    static constexpr vk::ShaderStageFlags PUSH_CONSTANT_STAGES =
+        vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment | vk::ShaderStageFlagBits::eCompute;
+
+    DescriptorManager();
+    ~DescriptorManager();
+
+    bool initialize(vk::Device device, vk::PhysicalDevice physicalDevice, uint32_t framesInFlight);
+    void cleanup();
+
+    // Recycles bindless slots released long enough ago that no frame in
+    // flight can still read them
+    void beginFrame(uint64_t frameNumber);
+
+    // Long-lived resources; the returned index is what shaders read.
+    // Safe to call from any thread
+    uint32_t registerTexture(vk::ImageView view, SamplerType sampler = SamplerType::Linear);
+    uint32_t registerBuffer(vk::Buffer buffer, vk::DeviceSize offset = 0, vk::DeviceSize range = VK_WHOLE_SIZE);
+    void releaseTexture(uint32_t index);
+    void releaseBuffer(uint32_t index);
+
+    void bindGlobalSets(vk::CommandBuffer commandBuffer, vk::PipelineBindPoint bindPoint,
+                        vk::PipelineLayout layout) const;
+
+    vk::DescriptorSetLayout getBindlessLayout() const { return m_bindlessLayout; }
+    vk::DescriptorSet getBindlessSet() const { return m_bindlessSet; }
+    vk::Sampler getSampler(SamplerType type) const { return m_samplers[static_cast<size_t>(type)]; }
+
+private:
+    struct PendingRelease {
+        uint32_t index;
+        bool isTexture;
+        uint64_t frameNumber;
+    };
+
+    vk::Device m_device;
+    uint32_t m_framesInFlight = 2;
+    uint32_t m_textureCapacity = 0;
+    uint32_t m_bufferCapacity = 0;
+
+    vk::DescriptorSetLayout m_bindlessLayout;
+    vk::DescriptorPool m_bindlessPool;
+    vk::DescriptorSet m_bindlessSet;
+    vk::Sampler m_samplers[static_cast<size_t>(SamplerType::Count)];
+
+    uint32_t m_nextTexture = 0;
+    uint32_t m_nextBuffer = 0;
+    std::vector<uint32_t> m_freeTextures;
+    std::vector<uint32_t> m_freeBuffers;
+    std::vector<PendingRelease> m_pendingReleases;
+    std::mutex m_slotMutex;
+
+    uint64_t m_frameNumber = 0;
+
+    bool m_initialized = false;
+
+    bool createSamplers();
+    bool createBindlessSet(vk::PhysicalDevice physicalDevice);
+};
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// What an allocation is for. Every device memory allocation carries one so
+// usage can be broken down when memory runs short
+enum class MemoryCategory : uint8_t {
+    Vertex,
+    Index,
+    Uniform,
+    Storage,
+    Staging,
+    RenderTarget,
+    Texture,
+    Other,
+    Count
+};
+
+const char* getMemoryCategoryName(MemoryCategory category);
+
+// Category of a buffer judged by its usage, for code that allocates buffers
+// of several kinds through one path
+MemoryCategory getMemoryCategory(vk::BufferUsageFlags usage);
+
+struct MemoryHeapStats {
+    vk::DeviceSize size = 0;
+    vk::DeviceSize budget = 0;          // What the driver says this process may use
+    vk::DeviceSize usage = 0;           // Process-wide with the budget extension, else tracked
+    vk::DeviceSize tracked = 0;         // Allocated through the tracker
+    uint32_t allocationCount = 0;
+    bool deviceLocal = false;
+};
+
+// Sent when a heap's usage crosses BUDGET_WARNING_FRACTION of its budget,
+// and again when it drops back below
+struct MemoryBudgetEvent {
+    uint32_t heap = 0;
+    vk::DeviceSize usage = 0;
+    vk::DeviceSize budget = 0;
+    bool nearBudget = false;
+};
+
+// Allocates and frees device memory on behalf of every subsystem, recording
+// each allocation's category, heap and name. Usage is compared against the
+// per-heap budget from VK_EXT_memory_budget when the device has it, and
+// against the heap size otherwise. Allocations still alive at cleanup are
+// reported as leaks.
+//
+// allocate() and free() are safe to call from any thread; budget callbacks
+// run on the thread calling updateBudget().
+class DeviceMemoryTracker {
+public:
+    static constexpr float BUDGET_WARNING_FRACTION = 0.9f;
+    // Callbacks are not repeated until usage drops this far below the warning level
+    static constexpr float BUDGET_HYSTERESIS = 0.05f;
+
+    using BudgetCallback = std::function<void(const MemoryBudgetEvent& event)>;
+
+    DeviceMemoryTracker();
+    ~DeviceMemoryTracker();
+
+    DeviceMemoryTracker(const DeviceMemoryTracker&) = delete;
+    DeviceMemoryTracker& operator=(const DeviceMemoryTracker&) = delete;
+
+    // budgetExtension: VK_EXT_memory_budget was enabled on the device
+    bool initialize(vk::Device device, vk::PhysicalDevice physicalDevice, bool budgetExtension);
+    // Prints the leak report, then forgets all allocations. Leaked memory is
+    // not freed: its owner may still destroy it
+    void cleanup();
+
+    // Memory type with every required flag, preferring types that also have
+    // the preferred flags and as few other flags as possible. Throws if
+    // no type qualifies
+    static uint32_t findMemoryType(const vk::PhysicalDeviceMemoryProperties& memProperties, uint32_t typeFilter,
+                                   vk::MemoryPropertyFlags required, vk::MemoryPropertyFlags preferred = {});
+    uint32_t findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags required,
+                            vk::MemoryPropertyFlags preferred = {}) const;
+
+    // Allocates from the best memory type whose heap still has room in its
+    // budget, falling back to the other qualifying types when the driver is
+    // out of memory. On failure the usage breakdown is printed and the
+    // Vulkan error is rethrown. name identifies the allocation in reports
+    vk::DeviceMemory allocate(const vk::MemoryRequirements& requirements, vk::MemoryPropertyFlags required,
+                              MemoryCategory category, const std::string& name,
+                              vk::MemoryPropertyFlags preferred = {});
+    void free(vk::DeviceMemory memory);
+
+    // Re-reads the driver's budget and fires callbacks for heaps that crossed
+    // the warning level. Called once a frame
+    void updateBudget();
+    void addBudgetCallback(BudgetCallback callback);
+
+    bool hasBudgetExtension() const { return m_budgetExtension; }
+    const vk::PhysicalDeviceMemoryProperties& getMemoryProperties() const { return m_memoryProperties; }
+    vk::DeviceSize getCategoryBytes(MemoryCategory category) const;
+    vk::DeviceSize getTotalBytes() const;
+    // One heap at a time, so per-frame readers such as the HUD don't allocate
+    uint32_t getHeapCount() const;
+    MemoryHeapStats getHeapStats(uint32_t heap) const;
+
+    void printReport(std::ostream& out) const;
+    // Lists allocations that were never freed. Returns how many there are
+    size_t reportLeaks(std::ostream& out) const;
+
+private:
+    struct Allocation {
+        vk::DeviceSize size = 0;
+        uint32_t memoryType = 0;
+        MemoryCategory category = MemoryCategory::Other;
+        std::string name;
+        uint64_t sequence = 0;
+    };
+
+    struct Heap {
+        vk::DeviceSize budget = 0;
+        vk::DeviceSize driverUsage = 0;     // At the last updateBudget()
+        vk::DeviceSize trackedAtUpdate = 0;
+        vk::DeviceSize tracked = 0;
+        uint32_t allocationCount = 0;
+        bool nearBudget = false;
+    };
+
+    vk::Device m_device;
+    vk::PhysicalDevice m_physicalDevice;
+    vk::PhysicalDeviceMemoryProperties m_memoryProperties;
+    bool m_budgetExtension = false;
+
+    // Guards everything below
+    mutable std::mutex m_mutex;
+    std::unordered_map<VkDeviceMemory, Allocation> m_allocations;
+    std::vector<Heap> m_heaps;
+    std::array<vk::DeviceSize, static_cast<size_t>(MemoryCategory::Count)> m_categoryBytes{};
+    uint64_t m_sequence = 0;
+    std::vector<BudgetCallback> m_callbacks;
+
+    bool m_initialized = false;
+
+    vk::DeviceSize estimatedUsageLocked(const Heap& heap) const;
+    void readBudgetLocked();
+    void printReportLocked(std::ostream& out) const;
+};
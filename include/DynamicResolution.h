@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include <cstdint>
+
+struct DynamicResolutionSettings {
+    float targetGpuMs = 14.0f;      // GPU frame time to stay under
+    float minScale = 0.5f;          // Per axis, of the output resolution
+    float maxScale = 1.0f;
+    uint32_t interval = 8;          // Frames averaged per adjustment
+};
+
+// Chooses the resolution the scene is rendered at from measured GPU frame
+// time. Every interval frames the average is compared with the target: over
+// it, the scale drops to where the time should land just under the target;
+// well under it, the scale creeps back up. GPU time is taken to follow the
+// pixel count, the square of the scale. Timings arrive a few frames late, so
+// the frames right after a change are not counted.
+class DynamicResolution {
+public:
+    // Scale up only when under this share of the target; the gap keeps the
+    // scale from oscillating
+    static constexpr float HEADROOM = 0.85f;
+    // Largest change per adjustment
+    static constexpr float MAX_STEP_UP = 0.05f;
+    static constexpr float MAX_STEP_DOWN = 0.15f;
+    // Scales are multiples of this
+    static constexpr float SCALE_STEP = 1.0f / 64.0f;
+    // Frames whose timings still reflect the previous scale
+    static constexpr uint32_t SETTLE_FRAMES = 3;
+
+    void setSettings(const DynamicResolutionSettings& settings);
+    const DynamicResolutionSettings& getSettings() const { return m_settings; }
+
+    // Pins the scale and stops the controller; 0 starts it again
+    void setFixedScale(float scale);
+    bool isFixed() const { return m_fixedScale > 0.0f; }
+
+    // One frame's GPU time. Returns true when the scale changed
+    bool addFrame(float gpuMs);
+
+    float getScale() const { return m_scale; }
+    // output scaled by getScale(), at least one pixel each way
+    vk::Extent2D getRenderExtent(vk::Extent2D output) const;
+
+private:
+    DynamicResolutionSettings m_settings;
+    float m_scale = 1.0f;
+    float m_fixedScale = 0.0f;
+    float m_sumMs = 0.0f;
+    uint32_t m_samples = 0;
+    uint32_t m_settleFrames = 0;
+
+    void restart();
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// Linear allocator for data that lives for one frame. Allocation bumps an
+// offset; nothing is freed individually and reset() releases everything at
+// once. One arena is used per frame in flight and reset after that frame's
+// fence has signaled, so the GPU may still read a frame's data while the
+// next one is being built.
+//
+// A frame that outgrows the block spills into extra blocks, and the next
+// reset() grows the block to the frame's peak, so after the first frames a
+// steady workload never touches the heap. Not thread safe: an arena belongs
+// to the thread building the frame.
+class FrameArena {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 1 << 20;
+
+    explicit FrameArena(size_t capacity = DEFAULT_CAPACITY);
+    ~FrameArena();
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    // alignment must be a power of two
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    // Uninitialized storage for count objects. Destructors are never run,
+    // hence the restriction
+    template <typename T>
+    T* allocateArray(size_t count) {
+        static_assert(std::is_trivially_destructible<T>::value, "Frame arena objects are never destroyed");
+        return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+    }
+
+    void reset();
+
+    size_t getUsedBytes() const { return m_offset + m_overflowBytes; }
+    size_t getCapacity() const { return m_capacity; }
+    size_t getPeakBytes() const { return m_peakBytes; }     // Largest frame since construction
+    size_t getOverflowCount() const { return m_overflowCount; }  // Spill blocks since construction
+
+private:
+    struct Block {
+        std::unique_ptr<unsigned char[]> data;
+        size_t capacity = 0;
+        size_t offset = 0;
+    };
+
+    std::unique_ptr<unsigned char[]> m_block;
+    size_t m_capacity = 0;
+    size_t m_offset = 0;
+
+    // Spill blocks for the current frame, freed by reset()
+    std::vector<Block> m_overflow;
+    size_t m_overflowBytes = 0;
+    size_t m_overflowCount = 0;
+    size_t m_peakBytes = 0;
+
+    static void* bump(unsigned char* base, size_t capacity, size_t& offset, size_t size, size_t alignment);
+};
+
+// Standard allocator drawing from a FrameArena, for containers that only
+// live for one frame. Deallocation is a no-op; the storage goes away with
+// the arena's next reset()
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    explicit ArenaAllocator(FrameArena& arena) noexcept : m_arena(&arena) {}
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : m_arena(other.getArena()) {}
+
+    T* allocate(size_t count) {
+        return static_cast<T*>(m_arena->allocate(sizeof(T) * count, alignof(T)));
+    }
+    void deallocate(T*, size_t) noexcept {}
+
+    FrameArena* getArena() const { return m_arena; }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const { return m_arena == other.getArena(); }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return m_arena != other.getArena(); }
+
+private:
+    FrameArena* m_arena;
+};
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+class Window;
+
+enum class PowerState : uint8_t {
+    Active,         // Focused: paced by activeFps, or vsync when uncapped
+    Background,     // Visible but unfocused: paced by backgroundFps
+    Paused          // Minimized, hidden or zero-sized: nothing is rendered
+};
+
+const char* getPowerStateName(PowerState state);
+
+struct FrameGovernorSettings {
+    float activeFps = 0.0f;         // 0 leaves the pace to the present mode
+    float backgroundFps = 10.0f;    // 0 pauses while unfocused as well
+};
+
+// Decides when the game loop makes its next frame from what the window is
+// doing, so frames nobody sees aren't rendered at full speed. Between
+// frames the loop sleeps in the window system's event wait instead of
+// spinning; any event ends the wait early and is re-evaluated, so focusing
+// or restoring the window makes the very next frame a full-speed one.
+class FrameGovernor {
+public:
+    // Longest single wait while paused; events end it sooner
+    static constexpr double PAUSED_WAIT_SECONDS = 1.0;
+
+    void setSettings(const FrameGovernorSettings& settings) { m_settings = settings; }
+    const FrameGovernorSettings& getSettings() const { return m_settings; }
+
+    // Handles window events until the next frame is due, taking the place
+    // of Window::pollEvents(). Returns false once the window should close
+    bool waitForFrame(Window& window);
+
+    PowerState getState() const { return m_state; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    FrameGovernorSettings m_settings;
+    PowerState m_state = PowerState::Active;
+    Clock::time_point m_lastFrame{};
+
+    PowerState classify(const Window& window) const;
+};
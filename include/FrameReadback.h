@@ -0,0 +1,129 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "RenderGraph.h"
+
+class VulkanRenderer;
+
+// One finished frame: RGBA8 rows top to bottom with no padding. pixels is
+// only valid during the callback
+struct ReadbackImage {
+    const uint8_t* pixels = nullptr;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint64_t frameNumber = 0;
+};
+
+// Runs on the readback thread, so it may take its time (e.g. encoding)
+// without holding up the render loop; a slow callback only means later
+// frames are dropped
+using ReadbackCallback = std::function<void(const ReadbackImage& image)>;
+
+struct ReadbackStats {
+    uint64_t captured = 0;          // Frames handed to callbacks
+    uint64_t dropped = 0;           // Frames not copied because every slot was busy
+};
+
+// Copies presented frames back to the CPU without stalling. The last pass
+// of a frame that asked for a copy writes the swap chain image into one of
+// a ring of host-visible buffers. Once a later beginFrame() has waited on
+// that frame's fence, the slot goes to a background thread, which converts
+// it to RGBA and runs the callback; only then is the slot reused. The
+// render loop never waits for the GPU or the callback: with every slot
+// busy, a frame is dropped and counted instead.
+class FrameReadback {
+public:
+    // Enough for the frames in flight plus two being encoded
+    static constexpr uint32_t RING_SIZE = 4;
+
+    FrameReadback();
+    ~FrameReadback();
+
+    FrameReadback(const FrameReadback&) = delete;
+    FrameReadback& operator=(const FrameReadback&) = delete;
+
+    // format is the swap chain's, which must be an 8-bit RGBA or BGRA
+    // format the swap chain allows copying from. Returns false otherwise
+    bool initialize(VulkanRenderer& renderer, vk::Format format);
+    void cleanup();
+    bool isAvailable() const { return m_initialized; }
+
+    // Copies the next frame drawn
+    void capture(ReadbackCallback callback);
+    // Copies every frame from the next one until called with no callback
+    void setStream(ReadbackCallback callback);
+    bool isStreaming() const { return m_stream != nullptr; }
+
+    // Writes the next frame to a PNG
+    void saveScreenshot(const std::string& path);
+    // Streams every frame to a raw RGBA file until stopped. The file is
+    // closed once the frames already copied have been written
+    bool startRecording(const std::string& path);
+    void stopRecording();
+
+    // Called by the renderer after waiting on frameIndex's fence: copies
+    // made the last time that slot was used are complete
+    void beginFrame(uint32_t frameIndex);
+    // Adds the copy pass when this frame was asked for. image must be
+    // finished by the passes declared before this
+    void declareCopy(RenderGraph& graph, RGResource image, vk::Extent2D extent,
+                     uint32_t frameIndex, uint64_t frameNumber);
+    // With the GPU idle: hands over every copy made and waits until their
+    // callbacks have run. Requests not yet copied are dropped
+    void flush();
+
+    ReadbackStats getStats() const;
+
+private:
+    enum class SlotState : uint8_t {
+        Free,
+        Copying,        // Recorded into a frame the GPU may still be running
+        Queued,         // Waiting for or being processed by the thread
+    };
+
+    struct Slot {
+        vk::Buffer buffer;
+        vk::DeviceMemory memory;
+        uint8_t* mapped = nullptr;
+        vk::DeviceSize size = 0;
+        SlotState state = SlotState::Free;
+        uint32_t frameIndex = 0;
+        uint64_t frameNumber = 0;
+        vk::Extent2D extent{};
+        std::vector<std::shared_ptr<ReadbackCallback>> callbacks;
+    };
+
+    VulkanRenderer* m_renderer = nullptr;
+    vk::Device m_device;
+    bool m_swapRedBlue = false;
+    bool m_initialized = false;
+
+    // One-shot requests wait here for the next frame; the stream callback
+    // applies to every frame. Shared with the slots so copying it per
+    // frame doesn't allocate
+    std::vector<std::shared_ptr<ReadbackCallback>> m_requests;
+    std::shared_ptr<ReadbackCallback> m_stream;
+    uint64_t m_droppedAtRecordStart = 0;
+
+    // Slot state is shared with the thread
+    std::vector<Slot> m_slots;
+    std::vector<uint32_t> m_queue;     // Slots in the order their frames finished
+    mutable std::mutex m_mutex;
+    std::condition_variable m_workAvailable;
+    std::condition_variable m_slotFreed;
+    std::thread m_thread;
+    bool m_stopping = false;
+    ReadbackStats m_stats;
+
+    bool ensureCapacity(Slot& slot, vk::DeviceSize size);
+    void releaseBuffer(Slot& slot);
+    void threadMain();
+};
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include "Benchmark.h"
+
+// Command line of the cGame executable. The game and --benchmark runs share
+// the seed, display and capture settings; what only benchmark runs read is
+// kept apart in benchmark
+struct GameOptions {
+    bool showHelp = false;
+    uint64_t seed = 1;                      // Benchmark content, the scripted camera and generated worlds
+    std::string worldPath;                  // Explore this world file instead of the empty scene
+    uint32_t generateWorldSize = 0;         // Write a procedural world this many tiles square first
+    float renderScale = 0.0f;               // Fixed scene resolution scale; 0 lets GPU time pick it
+    float maxFps = 0.0f;                    // Game frame cap; 0 leaves pacing to the display
+    float backgroundFps = 10.0f;            // Game frame rate while unfocused; 0 pauses
+    std::string capturePath;                // Record every presented frame to this raw RGBA file
+    BenchmarkOptions benchmark;
+
+    // Returns false with a message on malformed arguments
+    bool parse(int argc, char** argv, std::string& error);
+    static void printUsage(std::ostream& out);
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include <cstdint>
+#include <vector>
+
+struct GpuPassTiming {
+    const char* name = nullptr;     // Pass name as given to the render graph
+    float milliseconds = 0.0f;
+};
+
+// Measures GPU time per render graph pass with timestamp queries. Each frame
+// in flight owns a query pool whose results are collected when that slot is
+// recorded again, after its fence has signaled, so reading never stalls.
+// Reported timings are therefore MAX_FRAMES_IN_FLIGHT frames old.
+class GpuProfiler {
+public:
+    static constexpr uint32_t MAX_SCOPES = 32;
+
+    GpuProfiler();
+    ~GpuProfiler();
+
+    bool initialize(vk::Device device, vk::PhysicalDevice physicalDevice,
+                    uint32_t queueFamilyIndex, uint32_t framesInFlight);
+    void cleanup();
+
+    // Call right after beginning the frame's command buffer, outside any
+    // render pass: collects this slot's previous results and resets it
+    void beginFrame(vk::CommandBuffer commandBuffer, uint32_t frameIndex);
+
+    // Scopes may nest; names must outlive the frame (string literals)
+    void beginScope(vk::CommandBuffer commandBuffer, const char* name);
+    void endScope(vk::CommandBuffer commandBuffer);
+
+    bool isSupported() const { return m_supported; }
+    const std::vector<GpuPassTiming>& getPassTimings() const { return m_timings; }
+    float getFrameMs() const { return m_frameMs; }
+
+private:
+    struct Scope {
+        const char* name;
+        uint32_t beginQuery;
+        uint32_t endQuery;
+    };
+
+    struct FrameQueries {
+        vk::QueryPool pool;
+        std::vector<Scope> scopes;
+        uint32_t queryCount = 0;
+    };
+
+    vk::Device m_device;
+    bool m_supported = false;
+    float m_nanosecondsPerTick = 1.0f;
+    uint64_t m_timestampMask = ~0ull;
+
+    std::vector<FrameQueries> m_frames;
+    uint32_t m_frameIndex = 0;
+    std::vector<uint32_t> m_openScopes;
+    std::vector<uint64_t> m_results;
+
+    std::vector<GpuPassTiming> m_timings;
+    float m_frameMs = 0.0f;
+
+    bool m_initialized = false;
+
+    void collect(FrameQueries& frame);
+};
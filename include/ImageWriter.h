@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+// Writes RGBA8 pixels, rows top to bottom with no padding, as an RGB PNG;
+// alpha is dropped since swap chain alpha means nothing once presented. The
+// deflate stream uses stored blocks, so files are as large as the pixels
+// but cost no compression time; any PNG optimizer shrinks them afterwards.
+// Returns false with a message if the file can't be written
+bool writePng(const std::string& path, const uint8_t* rgba, uint32_t width, uint32_t height);
+
+// Appends frames to a headerless stream of RGBA8 frames, which video tools
+// read as rawvideo given the size, e.g.
+//   ffmpeg -f rawvideo -pixel_format rgba -video_size WxH -framerate 60 -i FILE out.mp4
+// The first frame fixes the size; frames of another size are skipped.
+class RawFrameWriter {
+public:
+    RawFrameWriter() = default;
+    ~RawFrameWriter();
+
+    RawFrameWriter(const RawFrameWriter&) = delete;
+    RawFrameWriter& operator=(const RawFrameWriter&) = delete;
+
+    bool open(const std::string& path);
+    // Prints the frame count and the command that converts the stream
+    void close();
+    bool isOpen() const { return m_file.is_open(); }
+
+    // Returns false if the frame was skipped or the write failed
+    bool write(const uint8_t* rgba, uint32_t width, uint32_t height);
+
+    uint64_t getFrameCount() const { return m_frames; }
+    uint64_t getSkippedCount() const { return m_skipped; }
+
+private:
+    std::ofstream m_file;
+    std::string m_path;
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+    uint64_t m_frames = 0;
+    uint64_t m_skipped = 0;
+};
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "DescriptorManager.h"
+#include "RenderGraph.h"
+#include "RenderQueue.h"
+
+class VulkanRenderer;
+
+// A point light in world space. Brightness falls off smoothly to nothing at
+// radius
+struct PointLight {
+    glm::vec2 position{ 0.0f };
+    float radius = 100.0f;          // World units
+    glm::vec3 color{ 1.0f };
+    float intensity = 1.0f;
+};
+
+// Layout of a light in the frame's light buffer, in the scene pass's pixels;
+// matches Light in lights.comp and sprite.frag
+struct alignas(16) GpuLight {
+    glm::vec2 position;
+    float radius;
+    float invRadiusSq;
+    glm::vec4 color;                // rgb premultiplied by intensity
+};
+
+// Maps world units to the pixels the scene pass rasterizes
+struct LightView {
+    glm::vec2 cameraCenter{ 0.0f };
+    glm::vec2 worldToPixel{ 1.0f }; // Zoom times render over output extent
+    glm::vec2 renderSize{ 0.0f };
+};
+
+// Writes the lights that reach the render area to out, converted to pixels,
+// stopping at capacity. Returns how many were written. out may be mapped
+// device memory: it is only written, front to back
+size_t packLights(const PointLight* lights, size_t count, const LightView& view, GpuLight* out, size_t capacity);
+
+// Pushed after the draws' own constants every scene pass; matches the block
+// in sprite.frag. tileBuffer is INVALID_BINDLESS_INDEX when lighting is off
+struct LightingPushConstants {
+    uint32_t lightBuffer;
+    uint32_t tileBuffer;
+    uint32_t tilesX;
+    uint32_t lightCount;
+    glm::vec4 ambient;
+};
+
+// Lights the scene with many point lights at a cost that follows how many
+// lights touch each pixel rather than how many there are.
+//
+// Every frame the lights added are culled against the view and packed into
+// a host-visible storage buffer. A compute pass (lights.comp) then bins them
+// into 16x16 pixel tiles, one workgroup per tile, writing each tile's light
+// list to a device-local buffer. sprite.frag looks up its pixel's tile and
+// loops over that list only. Sprites, tile maps and worlds are lit;
+// additive sprites such as particles are treated as emitters and aren't.
+class LightingSystem {
+public:
+    // Matches TILE_SIZE in lights.comp and sprite.frag
+    static constexpr uint32_t TILE_SIZE = 16;
+    // Lights past this many in one tile are dropped from it; one slot of
+    // each tile's entry holds the count
+    static constexpr uint32_t MAX_LIGHTS_PER_TILE = 63;
+    static constexpr uint32_t TILE_STRIDE = MAX_LIGHTS_PER_TILE + 1;
+    // Lights packed per frame; more are ignored
+    static constexpr uint32_t MAX_LIGHTS = 8192;
+    // Where LightingPushConstants go in the push constant range
+    static constexpr uint32_t PUSH_OFFSET = 96;
+
+    LightingSystem();
+    ~LightingSystem();
+
+    bool initialize(VulkanRenderer& renderer, uint32_t framesInFlight);
+    void cleanup();
+
+    // Off by default, leaving colors as drawn. Lights added while off are
+    // discarded
+    void setEnabled(bool enabled) { m_enabled = enabled && m_initialized; }
+    bool isEnabled() const { return m_enabled; }
+    // Light every pixel gets; black leaves only what the lights reach
+    void setAmbient(const glm::vec3& ambient) { m_ambient = ambient; }
+    const glm::vec3& getAmbient() const { return m_ambient; }
+
+    // Lights for the next drawFrame only
+    void addLight(const PointLight& light);
+    void addLights(const PointLight* lights, size_t count);
+
+    // Called from drawFrame once the render extent is known and before the
+    // scene pass is declared: packs the lights and adds the binning pass.
+    // output is the extent the camera is framed for
+    void prepare(RenderGraph& graph, uint32_t frameIndex, vk::Extent2D output, vk::Extent2D render);
+    // Declares the scene pass's read of this frame's tile lists
+    void declareSceneReads(RGPassBuilder& scene, uint32_t frameIndex) const;
+    // What the scene pass pushes at PUSH_OFFSET
+    LightingPushConstants getSceneConstants(uint32_t frameIndex) const;
+
+    bool isAvailable() const { return m_initialized; }
+    // Lights added for the last frame prepared, and how many of them reached it
+    uint32_t getSubmittedCount() const { return m_submittedCount; }
+    uint32_t getVisibleCount() const { return m_visibleCount; }
+
+private:
+    struct FrameBuffers {
+        vk::Buffer lights;
+        vk::DeviceMemory lightMemory;
+        GpuLight* mappedLights = nullptr;
+        uint32_t lightIndex = INVALID_BINDLESS_INDEX;
+        vk::Buffer tiles;
+        vk::DeviceMemory tileMemory;
+        uint32_t tileIndex = INVALID_BINDLESS_INDEX;
+        uint32_t tileCapacity = 0;
+        uint32_t lightCount = 0;
+        uint32_t tilesX = 0;
+        bool active = false;
+        RGResource tileResource = INVALID_RG_RESOURCE;
+    };
+
+    VulkanRenderer* m_renderer = nullptr;
+    vk::Device m_device;
+    vk::PipelineLayout m_pipelineLayout;
+    vk::Pipeline m_binningPipeline;
+    std::vector<FrameBuffers> m_frames;
+
+    std::vector<PointLight> m_lights;
+    glm::vec3 m_ambient{ 0.1f };
+    bool m_enabled = false;
+    uint32_t m_submittedCount = 0;
+    uint32_t m_visibleCount = 0;
+
+    bool m_initialized = false;
+
+    bool ensureTileCapacity(FrameBuffers& frame, uint32_t tileCount);
+    void releaseTiles(FrameBuffers& frame);
+    void releaseResources();
+};
+
+static_assert(sizeof(GpuLight) == 32, "GpuLight must match the std430 Light struct");
+static_assert(LightingSystem::PUSH_OFFSET >= RenderDraw::MAX_PUSH_BYTES &&
+              LightingSystem::PUSH_OFFSET + sizeof(LightingPushConstants) <= DescriptorManager::PUSH_CONSTANT_SIZE,
+              "Lighting push constants must sit past the draws' and within the range");
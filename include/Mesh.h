@@ -0,0 +1,17 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include <cstdint>
+
+// Indexed triangle list in device-local memory, created by
+// VulkanRenderer::createMesh from optimized MeshData and drawn with
+// VulkanRenderer::drawMesh
+struct Mesh {
+    vk::Buffer vertexBuffer;
+    vk::DeviceMemory vertexMemory;
+    vk::Buffer indexBuffer;
+    vk::DeviceMemory indexMemory;
+    vk::IndexType indexType = vk::IndexType::eUint16;
+    uint32_t indexCount = 0;
+    uint32_t vertexCount = 0;
+};
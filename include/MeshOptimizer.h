@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class IndexFormat : uint8_t {
+    Uint16,
+    Uint32
+};
+
+// Post-transform cache size the optimizer plans for and ACMR is measured
+// with. Small enough to suit any GPU; a larger real cache only does better
+constexpr uint32_t MESH_CACHE_SIZE = 16;
+
+// Triangle list ready for upload: no duplicate vertices, triangles in
+// vertex cache order and vertices in the order the triangles first use them
+struct MeshData {
+    std::vector<uint8_t> vertices;      // vertexCount * vertexStride bytes
+    std::vector<uint8_t> indices;       // indexCount indices of indexFormat
+    uint32_t vertexStride = 0;
+    uint32_t vertexCount = 0;
+    uint32_t indexCount = 0;
+    IndexFormat indexFormat = IndexFormat::Uint16;
+
+    uint32_t getIndex(size_t i) const;
+};
+
+struct MeshOptimizeStats {
+    uint32_t inputVertices = 0;
+    uint32_t outputVertices = 0;
+    uint32_t triangles = 0;             // After dropping degenerate ones
+    float acmrBefore = 0.0f;            // Vertex shader runs per triangle
+    float acmrAfter = 0.0f;
+};
+
+// The import stage: the steps below in order. vertices are stride bytes
+// each and compared bitwise, so padding must be zeroed. With no indices,
+// vertices is a triangle list of its own (three per triangle). Triangles
+// that deduplication makes degenerate are dropped. Returns false on
+// malformed input, e.g. an index past vertexCount
+bool optimizeMesh(const void* vertices, size_t vertexCount, size_t stride,
+                  const uint32_t* indices, size_t indexCount, MeshData& out,
+                  MeshOptimizeStats* stats = nullptr);
+
+// Gives each vertex the index of the first bitwise-identical one, numbered
+// in order of first appearance. remap needs vertexCount entries. Returns the
+// number of distinct vertices
+size_t deduplicateVertices(const void* vertices, size_t vertexCount, size_t stride, uint32_t* remap);
+
+// Reorders triangles in place so consecutive ones share vertices still in
+// a cacheSize FIFO (Tipsify, Sander et al. 2007). Linear in the mesh size
+void optimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount,
+                         uint32_t cacheSize = MESH_CACHE_SIZE);
+
+// Copies vertices to destination in the order indices first use them and
+// rewrites indices to match, so the vertex fetch walks memory forwards.
+// Unused vertices are dropped. Returns the number written; destination
+// needs room for vertexCount and must not overlap vertices
+size_t optimizeVertexFetch(void* destination, uint32_t* indices, size_t indexCount,
+                           const void* vertices, size_t vertexCount, size_t stride);
+
+// Average vertex shader invocations per triangle with a FIFO cache of
+// cacheSize: 3 with no reuse, approaching 0.5 for a regular grid
+float computeAcmr(const uint32_t* indices, size_t indexCount, size_t vertexCount,
+                  uint32_t cacheSize = MESH_CACHE_SIZE);
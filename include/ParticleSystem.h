@@ -0,0 +1,206 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include <glm/glm.hpp>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "DescriptorManager.h"
+#include "RenderGraph.h"
+#include "SpriteRenderer.h"
+
+class VulkanRenderer;
+
+enum class ParticleSimulation : uint8_t {
+    Auto,       // GPU when the device can run it, else CPU
+    Gpu,
+    Cpu
+};
+
+// Half-plane particles collide with: dot(normal, position) >= distance is
+// free space. normal must be unit length
+struct ParticlePlane {
+    glm::vec2 normal{ 0.0f, 1.0f };
+    float distance = 0.0f;
+};
+
+struct ParticleSettings {
+    static constexpr uint32_t MAX_PLANES = 4;
+
+    // Emitter
+    glm::vec2 position{ 0.0f };
+    float direction = 1.5707964f;   // Radians; +Y by default
+    float spread = 0.5f;            // Full cone angle, radians
+    float speedMin = 50.0f;
+    float speedMax = 150.0f;
+    float lifetimeMin = 1.0f;       // Seconds
+    float lifetimeMax = 2.0f;
+    float size = 2.0f;              // World units
+    uint32_t color = 0xFFFFFFFF;    // RGBA8; alpha fades to zero over the lifetime
+    float rate = 1000.0f;           // Particles per second
+
+    glm::vec2 gravity{ 0.0f, -98.0f };
+    float restitution = 0.5f;       // Fraction of normal speed kept on a bounce
+    std::array<ParticlePlane, MAX_PLANES> planes{};
+    uint32_t planeCount = 0;
+};
+
+// Particle state as the CPU path keeps it: one array per field so a SIMD
+// register holds the same field of consecutive particles. Arrays are padded
+// to a multiple of PARTICLE_CPU_LANES; padding particles are always dead
+struct ParticleCpuState {
+    std::vector<float> positionX;
+    std::vector<float> positionY;
+    std::vector<float> velocityX;
+    std::vector<float> velocityY;
+    std::vector<float> age;
+    std::vector<float> lifetime;
+    std::vector<float> size;
+    std::vector<uint32_t> color;
+    uint32_t capacity = 0;
+
+    void resize(uint32_t particleCapacity);
+};
+
+constexpr uint32_t PARTICLE_CPU_LANES = 8;
+
+// One simulation step, shared by the compute shader (where it is the
+// control buffer's parameter block, see particles.comp) and the CPU path.
+// Particles in the ring range [spawnStart, spawnStart + spawnCount) are
+// re-emitted before the step
+struct alignas(16) ParticleStep {
+    glm::vec2 position;
+    glm::vec2 gravity;
+    float direction;
+    float spread;
+    float speedMin;
+    float speedMax;
+    float lifetimeMin;
+    float lifetimeMax;
+    float size;
+    float restitution;
+    float dt;
+    uint32_t color;
+    uint32_t spawnStart;
+    uint32_t spawnCount;
+    uint32_t capacity;
+    uint32_t seed;
+    uint32_t planeCount;
+    uint32_t textureIndex;
+    glm::vec4 planes[ParticleSettings::MAX_PLANES];     // xy normal, z distance
+};
+
+// Steps every particle in state and writes the live ones to instances, which
+// needs room for state.capacity entries. Returns how many were written. Uses
+// AVX2 or SSE2 when the CPU has them (see CpuFeatures.h); the results match
+// the compute shader up to floating-point rounding
+size_t simulateParticlesCpu(ParticleCpuState& state, const ParticleStep& step, SpriteInstance* instances);
+
+// Name of the instruction set simulateParticlesCpu uses on this CPU
+const char* getParticleCpuPath();
+
+// Emits, integrates, collides and retires particles every frame, then draws
+// the live ones as additive sprite instances in the scene pass.
+//
+// On the GPU, particles.comp steps the whole pool in place in a storage
+// buffer and appends live particles to the frame's instance buffer, counting
+// them into an indirect draw, so particle data never crosses the bus. The
+// CPU path steps a structure-of-arrays copy with SIMD and writes instances
+// straight into mapped memory; it exists for devices whose graphics queue
+// cannot run compute, and for comparison.
+class ParticleSystem {
+public:
+    // Matches local_size_x in particles.comp
+    static constexpr uint32_t WORKGROUP_SIZE = 256;
+    // One dispatch, within the smallest maxComputeWorkGroupCount
+    static constexpr uint32_t MAX_CAPACITY = 65535 * WORKGROUP_SIZE;
+
+    ParticleSystem();
+    ~ParticleSystem();
+
+    bool initialize(VulkanRenderer& renderer, uint32_t framesInFlight);
+    void cleanup();
+
+    // Allocates a pool of capacity particles, all dead. Like the renderer's
+    // destroy helpers, stop() is immediate: call it once the GPU is idle
+    bool start(uint32_t capacity, ParticleSimulation simulation = ParticleSimulation::Auto);
+    void stop();
+
+    void setSettings(const ParticleSettings& settings) { m_settings = settings; }
+    const ParticleSettings& getSettings() const { return m_settings; }
+
+    // Advances the simulation by dt at the next drawFrame. Steps from several
+    // calls in one frame are merged
+    void simulate(float dt);
+
+    // Called from drawFrame before the scene pass is declared. GPU: adds the
+    // compute pass. CPU: runs the step into the frame's instance buffer
+    void prepare(RenderGraph& graph, uint32_t frameIndex);
+    // Declares the scene pass's reads of this frame's instances
+    void declareSceneReads(RGPassBuilder& scene, uint32_t frameIndex) const;
+    // Called from the scene pass, which has set the viewport. extent is the
+    // output size the camera is framed for
+    void record(vk::CommandBuffer commandBuffer, vk::Extent2D extent, uint32_t frameIndex);
+
+    bool isAvailable() const { return m_initialized; }
+    bool isRunning() const { return m_capacity > 0; }
+    bool isGpuSupported() const { return m_gpuSupported; }
+    ParticleSimulation getSimulation() const { return m_simulation; }
+    uint32_t getCapacity() const { return m_capacity; }
+    // Exact on the CPU path; on the GPU it comes back with the frame's fence,
+    // so it trails by the frames in flight
+    uint32_t getLiveCount() const { return m_liveCount; }
+
+private:
+    // Host-visible; the draw command the compute shader appends to, then the
+    // step parameters
+    struct Control {
+        vk::DrawIndirectCommand draw;
+        ParticleStep step;
+    };
+
+    struct FrameBuffers {
+        vk::Buffer instances;
+        vk::DeviceMemory instanceMemory;
+        SpriteInstance* mappedInstances = nullptr;      // CPU path
+        uint32_t instanceIndex = INVALID_BINDLESS_INDEX;
+        vk::Buffer control;
+        vk::DeviceMemory controlMemory;
+        Control* mappedControl = nullptr;
+        uint32_t controlIndex = INVALID_BINDLESS_INDEX;
+        uint32_t instanceCount = 0;                     // CPU path
+        RGResource instanceResource = INVALID_RG_RESOURCE;
+        RGResource controlResource = INVALID_RG_RESOURCE;
+    };
+
+    VulkanRenderer* m_renderer = nullptr;
+    vk::Device m_device;
+    vk::PipelineLayout m_pipelineLayout;
+    vk::Pipeline m_computePipeline;
+    vk::Pipeline m_drawPipeline;
+    uint32_t m_framesInFlight = 0;
+    bool m_gpuSupported = false;
+
+    ParticleSettings m_settings;
+    ParticleSimulation m_simulation = ParticleSimulation::Cpu;
+    uint32_t m_capacity = 0;
+
+    // GPU path: the pool, stepped in place
+    vk::Buffer m_stateBuffer;
+    vk::DeviceMemory m_stateMemory;
+    uint32_t m_stateIndex = INVALID_BINDLESS_INDEX;
+
+    ParticleCpuState m_cpuState;
+    std::vector<FrameBuffers> m_frames;
+
+    float m_pendingDt = 0.0f;
+    float m_spawnCarry = 0.0f;
+    uint32_t m_spawnCursor = 0;
+    uint32_t m_stepCount = 0;
+    uint32_t m_liveCount = 0;
+
+    bool m_initialized = false;
+
+    ParticleStep buildStep();
+};
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "Texture.h"
+
+class VulkanRenderer;
+
+// On-screen performance overlay: frame time graph, GPU pass timings, draw
+// and triangle counts and memory use. Everything is drawn from one glyph
+// atlas as a single batched draw, so it can be appended to the last pass
+// of the frame. Text is reformatted a few times per second from averaged
+// values; the graph and quads are rebuilt every frame straight into a
+// persistently mapped per-frame vertex buffer.
+class PerformanceHud {
+public:
+    static constexpr uint32_t MAX_QUADS = 4096;
+    static constexpr uint32_t GRAPH_SAMPLES = 120;
+
+    PerformanceHud();
+    ~PerformanceHud();
+
+    // Needs the renderer's descriptor manager, pipeline layout and render
+    // pass. Returns false if the HUD cannot run (e.g. its font atlas failed)
+    bool initialize(VulkanRenderer& renderer, uint32_t framesInFlight);
+    void cleanup();
+
+    void setVisible(bool visible) { m_visible = visible; }
+    bool isVisible() const { return m_visible && m_initialized; }
+
+    // Records a frame's CPU time; called every frame even while hidden so
+    // the graph is current when the HUD is shown
+    void addFrameTime(float cpuFrameMs);
+
+    // Builds this frame's vertices; call before recording
+    void update(uint32_t frameIndex, vk::Extent2D extent);
+
+    // Inside the final render pass: one pipeline bind and one draw
+    void record(vk::CommandBuffer commandBuffer, vk::Extent2D extent);
+
+    // CPU time spent in update() + record() last frame
+    float getOverheadMs() const { return m_overheadMs; }
+
+private:
+    struct HudVertex {
+        float x, y;
+        float u, v;
+        uint32_t color;     // RGBA8
+    };
+
+    struct FrameVertices {
+        vk::Buffer buffer;
+        vk::DeviceMemory memory;
+        HudVertex* mapped = nullptr;
+    };
+
+    static constexpr size_t MAX_LINES = 16;
+    static constexpr size_t LINE_LENGTH = 64;
+
+    VulkanRenderer* m_renderer = nullptr;
+    vk::Device m_device;
+    vk::Pipeline m_pipeline;
+    vk::PipelineLayout m_pipelineLayout;
+
+    Texture m_atlas;
+
+    std::vector<FrameVertices> m_frames;
+    uint32_t m_frameIndex = 0;
+    uint32_t m_vertexCount = 0;
+    HudVertex* m_cursor = nullptr;
+    HudVertex* m_end = nullptr;
+
+    // Frame time history (ring) and the averages shown as text
+    std::array<float, GRAPH_SAMPLES> m_frameTimes{};
+    uint32_t m_frameTimeHead = 0;
+    float m_accumulatedMs = 0.0f;
+    uint32_t m_accumulatedFrames = 0;
+    double m_lastTextUpdate = 0.0;
+
+    char m_lines[MAX_LINES][LINE_LENGTH] = {};
+    size_t m_lineCount = 0;
+
+    float m_overheadMs = 0.0f;
+    float m_updateMs = 0.0f;
+    bool m_visible = false;
+    bool m_initialized = false;
+
+    bool createAtlas();
+    bool createPipeline();
+    bool createVertexBuffers(uint32_t framesInFlight);
+
+    void formatText();
+    void pushQuad(float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1, uint32_t color);
+    void pushRect(float x0, float y0, float x1, float y1, uint32_t color);
+    float pushText(float x, float y, const char* text, uint32_t color);
+};
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include "CpuFeatures.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using BodyId = uint32_t;
+constexpr BodyId INVALID_BODY = UINT32_MAX;
+
+enum class BodyShape : uint8_t {
+    Circle,
+    Box             // Axis-aligned; boxes don't rotate
+};
+
+struct BodyDesc {
+    BodyShape shape = BodyShape::Circle;
+    glm::vec2 position{ 0.0f };
+    glm::vec2 velocity{ 0.0f };
+    float radius = 0.5f;                // Circles
+    glm::vec2 halfExtents{ 0.5f };      // Boxes
+    float mass = 1.0f;                  // 0 makes the body static
+    float restitution = 0.5f;
+};
+
+// Bodies whose bounds overlap, found by the broadphase
+struct BodyPair {
+    BodyId a;
+    BodyId b;
+};
+
+// A touching pair. normal points from a to b; depth is how far they overlap
+struct Contact {
+    BodyId a;
+    BodyId b;
+    glm::vec2 normal;
+    float depth;
+};
+
+struct PhysicsSettings {
+    glm::vec2 gravity{ 0.0f };
+    // Dynamic bodies bounce off the inside of these bounds when set
+    bool bounded = false;
+    glm::vec2 boundsMin{ 0.0f };
+    glm::vec2 boundsMax{ 0.0f };
+};
+
+// What the last step did
+struct PhysicsStats {
+    uint32_t bodies = 0;
+    uint32_t pairs = 0;             // Broadphase pairs whose bounds overlap
+    uint32_t contacts = 0;          // Pairs the narrowphase found touching
+    uint32_t sortSwaps = 0;         // Moves the incremental sort made
+    bool fullSort = false;          // The sort order was rebuilt from scratch
+};
+
+// Name of the instruction set the broadphase sweep uses on this CPU
+const char* getPhysicsPath();
+
+// 2D rigid bodies (circles and axis-aligned boxes) stepped at a fixed rate.
+//
+// The broadphase is sweep-and-prune along x: bodies are kept in order of
+// their bounds' left edge from step to step, so re-sorting the nearly sorted
+// order is an insertion sort costing one move per pair of bodies that
+// crossed. The sweep then tests a body's bounds against the ones after it
+// several at a time with SIMD compares, stopping at the first that starts
+// past its right edge. Candidate pairs are split into batches whose
+// contacts are generated in parallel on worker threads, and the contacts
+// are resolved in pair order on the calling thread, so a step is
+// deterministic whatever the thread count.
+//
+// The game itself has no bodies yet; the physics benchmark scene and
+// cGame_microbench are what step a world today.
+class PhysicsWorld {
+public:
+    static constexpr float FIXED_TIMESTEP = 1.0f / 60.0f;
+    // Steps a long frame may run before the rest of the time is dropped, so
+    // a slow step can't snowball
+    static constexpr uint32_t MAX_STEPS_PER_FRAME = 4;
+    static constexpr uint32_t DEFAULT_WORKER_THREADS = 3;
+    static constexpr uint32_t NARROWPHASE_BATCH = 1024;    // Pairs per batch
+    // Fewer pairs than this are handled on the calling thread alone
+    static constexpr uint32_t PARALLEL_THRESHOLD = 4096;
+
+    explicit PhysicsWorld(uint32_t workerThreads = DEFAULT_WORKER_THREADS);
+    ~PhysicsWorld();
+
+    PhysicsWorld(const PhysicsWorld&) = delete;
+    PhysicsWorld& operator=(const PhysicsWorld&) = delete;
+
+    void setSettings(const PhysicsSettings& settings) { m_settings = settings; }
+    const PhysicsSettings& getSettings() const { return m_settings; }
+
+    BodyId createBody(const BodyDesc& desc);
+    void destroyBody(BodyId body);
+    void clear();
+
+    glm::vec2 getPosition(BodyId body) const { return m_bodies[body].position; }
+    glm::vec2 getVelocity(BodyId body) const { return m_bodies[body].velocity; }
+    void setPosition(BodyId body, glm::vec2 position) { m_bodies[body].position = position; }
+    void setVelocity(BodyId body, glm::vec2 velocity) { m_bodies[body].velocity = velocity; }
+
+    // Adds a frame's time and runs the fixed steps now due. Returns how many
+    // ran
+    uint32_t advance(float frameTime);
+    // How far between the last step and the next the frame is, in [0, 1),
+    // for interpolating what is drawn
+    float getInterpolation() const { return m_accumulator / FIXED_TIMESTEP; }
+
+    void step(float dt);
+
+    // The last step's contacts, in a stable order
+    const std::vector<Contact>& getContacts() const { return m_contacts; }
+    // The last step's broadphase pairs, in sweep order
+    const std::vector<BodyPair>& getPairs() const { return m_pairs; }
+    const PhysicsStats& getStats() const { return m_stats; }
+    size_t getBodyCount() const { return m_bodies.size() - m_freeIds.size(); }
+
+    // Lowers the instruction set this world's sweep uses from getSimdLevel(),
+    // e.g. to check a SIMD path against the scalar one. A level the CPU
+    // lacks falls back to the widest it has
+    void setSimdLevel(SimdLevel level);
+
+private:
+    struct Body {
+        glm::vec2 position{ 0.0f };
+        glm::vec2 velocity{ 0.0f };
+        glm::vec2 halfExtents{ 0.0f };  // Of the bounds, for either shape
+        float radius = 0.0f;
+        float inverseMass = 0.0f;
+        float restitution = 0.0f;
+        BodyShape shape = BodyShape::Circle;
+        bool alive = false;
+    };
+
+    PhysicsSettings m_settings;
+    std::vector<Body> m_bodies;
+    std::vector<BodyId> m_freeIds;
+    float m_accumulator = 0.0f;
+
+    // Live bodies in order of their bounds' left edge, and those bounds in
+    // the same order, padded so the sweep can read a full register past the
+    // end
+    std::vector<BodyId> m_order;
+    std::vector<float> m_minX;
+    std::vector<float> m_maxX;
+    std::vector<float> m_minY;
+    std::vector<float> m_maxY;
+    bool m_orderDirty = false;
+    SimdLevel m_simdLevel = getSimdLevel();
+
+    // Rebuilt every step in the space earlier steps left; findPairs reports
+    // m_pairs outgrowing it to AllocationTracker
+    std::vector<BodyPair> m_pairs;
+    std::vector<Contact> m_pairContacts;        // By pair
+    std::vector<uint8_t> m_pairTouching;        // By pair
+    std::vector<Contact> m_contacts;
+    PhysicsStats m_stats;
+
+    // Workers take batches of m_pairs through m_nextBatch
+    uint32_t m_workerCount;
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_workAvailable;
+    std::condition_variable m_workDone;
+    uint64_t m_generation = 0;
+    uint32_t m_busyWorkers = 0;
+    bool m_stopping = false;
+    std::atomic<size_t> m_nextBatch{ 0 };
+
+    void integrate(float dt);
+    void sortBounds();
+    void findPairs();
+    void collideBatch(size_t batch);
+    void runNarrowphase();
+    void solveContacts();
+    void applyBounds();
+    void workerMain(uint64_t generation);
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class BlendMode : uint8_t {
+    Opaque,
+    Alpha,          // Straight alpha: src * a + dst * (1 - a)
+    Additive
+};
+
+// What varies between our graphics pipelines. Viewport and scissor are
+// always dynamic, so pipelines do not depend on the swap chain extent
+struct GraphicsPipelineDesc {
+    std::string vertexShader;       // Compiled shader names, see ShaderLoader::shaderPath
+    std::string fragmentShader;
+    std::vector<vk::VertexInputBindingDescription> bindings;
+    std::vector<vk::VertexInputAttributeDescription> attributes;
+    vk::PrimitiveTopology topology = vk::PrimitiveTopology::eTriangleList;
+    BlendMode blend = BlendMode::Opaque;
+    std::vector<uint32_t> fragmentConstants;    // Specialization constants, constant_id = index
+    vk::PipelineLayout layout;
+    vk::RenderPass renderPass;      // Any render pass compatible with where it draws
+};
+
+struct ComputePipelineDesc {
+    std::string shader;
+    std::vector<uint32_t> constants;    // Specialization constants, constant_id = index
+    vk::PipelineLayout layout;
+};
+
+class PipelineFactory {
+public:
+    static vk::Pipeline createGraphicsPipeline(vk::Device device, const GraphicsPipelineDesc& desc);
+    static vk::Pipeline createComputePipeline(vk::Device device, const ComputePipelineDesc& desc);
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+
+// PCG32 generator. Unlike the <random> distributions, its output is the same
+// on every platform and standard library, which seeded scenes depend on.
+class Random {
+public:
+    explicit Random(uint64_t seed = 1, uint64_t stream = 1)
+        : m_state(0), m_increment((stream << 1u) | 1u) {
+        next();
+        m_state += seed;
+        next();
+    }
+
+    uint32_t next() {
+        uint64_t old = m_state;
+        m_state = old * 6364136223846793005ull + m_increment;
+        uint32_t xorShifted = static_cast<uint32_t>(((old >> 18u) ^ old) >> 27u);
+        uint32_t rotation = static_cast<uint32_t>(old >> 59u);
+        return (xorShifted >> rotation) | (xorShifted << ((32 - rotation) & 31));
+    }
+
+    // Uniform in [0, 1)
+    float nextFloat() { return static_cast<float>(next() >> 8) * (1.0f / 16777216.0f); }
+    float range(float min, float max) { return min + (max - min) * nextFloat(); }
+
+    // Uniform in [0, bound)
+    uint32_t below(uint32_t bound) {
+        return static_cast<uint32_t>((static_cast<uint64_t>(next()) * bound) >> 32);
+    }
+
+private:
+    uint64_t m_state;
+    uint64_t m_increment;
+};
@@ -0,0 +1,294 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+class RenderGraph;
+class DeviceMemoryTracker;
+
+// Handle to a graph resource, valid until the next RenderGraph::reset()
+using RGResource = uint32_t;
+constexpr RGResource INVALID_RG_RESOURCE = UINT32_MAX;
+
+enum class RGPassType : uint8_t {
+    Graphics,           // Runs inside a render pass built from its attachments
+    Compute,
+    Transfer
+};
+
+// How a pass touches a resource. Each access maps to one pipeline stage,
+// access mask and image layout, which is all the barrier derivation needs
+enum class RGAccess : uint8_t {
+    ColorAttachmentWrite,
+    DepthAttachmentWrite,
+    FragmentSampled,
+    FragmentStorageRead,
+    ComputeSampled,
+    ComputeStorageRead,
+    ComputeStorageWrite,
+    VertexShaderStorageRead,
+    VertexAttributeRead,        // Vertex or instance buffer
+    IndirectCommandRead,        // Draw or dispatch parameters
+    TransferRead,
+    TransferWrite
+};
+
+struct RGImageDesc {
+    vk::Format format = vk::Format::eUndefined;
+    vk::Extent2D extent{};
+};
+
+struct RGStats {
+    uint32_t declaredPasses = 0;
+    uint32_t culledPasses = 0;
+    uint32_t barriers = 0;
+    vk::DeviceSize transientBytesRequested = 0;
+    vk::DeviceSize transientBytesAllocated = 0;
+};
+
+// Handed to pass callbacks while the graph is executing
+struct RGPassContext {
+    vk::CommandBuffer commandBuffer;
+    vk::RenderPass renderPass;          // Null for compute and transfer passes
+    vk::Extent2D extent;                // Attachment extent of graphics passes
+    const RenderGraph* graph = nullptr;
+
+    vk::Image getImage(RGResource resource) const;
+    vk::ImageView getImageView(RGResource resource) const;
+    vk::Buffer getBuffer(RGResource resource) const;
+};
+
+using RGExecuteCallback = std::function<void(const RGPassContext& context)>;
+
+// Fluent helper returned by RenderGraph::addPass
+class RGPassBuilder {
+public:
+    RGPassBuilder(RenderGraph& graph, uint32_t pass) : m_graph(graph), m_pass(pass) {}
+
+    RGPassBuilder& read(RGResource resource, RGAccess access);
+    RGPassBuilder& write(RGResource resource, RGAccess access);
+
+    // Color and depth writes; with no clear value the previous contents are loaded
+    RGPassBuilder& writeColor(RGResource resource, const vk::ClearColorValue& clear);
+    RGPassBuilder& writeColor(RGResource resource);
+    RGPassBuilder& writeDepth(RGResource resource, const vk::ClearDepthStencilValue& clear);
+
+    // Keeps the pass even if nothing reads what it writes
+    RGPassBuilder& sideEffect();
+    RGPassBuilder& execute(RGExecuteCallback callback);
+
+private:
+    RenderGraph& m_graph;
+    uint32_t m_pass;
+};
+
+// Per-frame render graph. Passes are declared every frame together with the
+// resources they read and write; compile() culls passes that contribute
+// nothing to an output, derives the pipeline barriers and layout transitions
+// between passes and places transient images with disjoint lifetimes in the
+// same device memory. Vulkan objects are cached across frames.
+//
+// One graph is used per frame in flight, so transient images and cached
+// objects are only rebuilt once that frame's fence has signaled.
+class RenderGraph {
+public:
+    RenderGraph();
+    ~RenderGraph();
+
+    RenderGraph(const RenderGraph&) = delete;
+    RenderGraph& operator=(const RenderGraph&) = delete;
+
+    bool initialize(vk::Device device, DeviceMemoryTracker& memory);
+    void cleanup();
+
+    // Starts a new frame's declaration
+    void reset();
+
+    // External images such as the swapchain image. The graph transitions the
+    // image from initialLayout (made available at initialStage) and leaves it
+    // in finalLayout. Imported resources count as graph outputs when a final
+    // layout is given
+    RGResource importImage(const char* name, vk::Image image, vk::ImageView view,
+                           vk::Format format, vk::Extent2D extent,
+                           vk::ImageLayout initialLayout, vk::PipelineStageFlags initialStage,
+                           vk::ImageLayout finalLayout = vk::ImageLayout::eUndefined);
+    RGResource importBuffer(const char* name, vk::Buffer buffer, vk::DeviceSize size,
+                            bool isOutput = false);
+
+    // Transient image owned by the graph. Its memory may alias other
+    // transients that are not alive during the same passes
+    RGResource createImage(const char* name, const RGImageDesc& desc);
+
+    RGPassBuilder addPass(const char* name, RGPassType type);
+
+    // Returns false, with the reason in getError(), when the graph can't be
+    // built, e.g. a graphics pass without attachments or transient memory
+    // that couldn't be allocated
+    bool compile();
+    void execute(vk::CommandBuffer commandBuffer);
+
+    // Destroys framebuffers, e.g. after the swapchain views were recreated
+    void clearFramebufferCache();
+
+    vk::Image getImage(RGResource resource) const;
+    vk::ImageView getImageView(RGResource resource) const;
+    vk::Buffer getBuffer(RGResource resource) const;
+    const RGStats& getStats() const { return m_stats; }
+    const std::string& getError() const { return m_error; }
+
+    // Called around every executed pass, e.g. for GPU timestamps
+    using PassHook = std::function<void(vk::CommandBuffer commandBuffer, const char* passName, bool begin)>;
+    void setPassHook(PassHook hook) { m_passHook = std::move(hook); }
+
+private:
+    friend class RGPassBuilder;
+
+    struct Resource {
+        const char* name = nullptr;
+        bool isImage = true;
+        bool imported = false;
+        bool isOutput = false;
+
+        // Images
+        RGImageDesc desc;
+        vk::ImageUsageFlags usage;
+        vk::ImageLayout initialLayout = vk::ImageLayout::eUndefined;
+        vk::PipelineStageFlags initialStage = vk::PipelineStageFlagBits::eTopOfPipe;
+        vk::ImageLayout finalLayout = vk::ImageLayout::eUndefined;
+        vk::Image image;
+        vk::ImageView view;
+
+        // Buffers
+        vk::Buffer buffer;
+        vk::DeviceSize size = 0;
+
+        // Alive pass range, filled in by compile()
+        uint32_t firstPass = UINT32_MAX;
+        uint32_t lastPass = 0;
+        uint32_t physicalIndex = UINT32_MAX;
+    };
+
+    struct Use {
+        RGResource resource;
+        RGAccess access;
+        bool isWrite;
+        bool load = true;           // Attachment writes: keep previous contents
+        vk::ClearValue clear;
+    };
+
+    struct Pass {
+        const char* name = nullptr;
+        RGPassType type = RGPassType::Graphics;
+        std::vector<Use> uses;
+        RGExecuteCallback callback;
+        bool sideEffect = false;
+        bool alive = false;
+
+        // Filled in by compile()
+        size_t firstBarrier = 0;
+        size_t barrierCount = 0;
+        vk::PipelineStageFlags srcStages;
+        vk::PipelineStageFlags dstStages;
+        vk::RenderPass renderPass;
+        vk::Framebuffer framebuffer;
+        vk::Extent2D extent;
+    };
+
+    struct ResourceState {
+        vk::ImageLayout layout = vk::ImageLayout::eUndefined;
+        vk::PipelineStageFlags writeStages;
+        vk::AccessFlags writeAccess;
+        vk::PipelineStageFlags readStages;      // Readers since the last write
+        vk::AccessFlags readAccess;
+    };
+
+    struct Barrier {
+        RGResource resource;
+        vk::AccessFlags srcAccess;
+        vk::AccessFlags dstAccess;
+        vk::ImageLayout oldLayout;
+        vk::ImageLayout newLayout;
+    };
+
+    // Transient image backed by a slice of an aliased memory block
+    struct PhysicalImage {
+        RGImageDesc desc;
+        vk::ImageUsageFlags usage;
+        uint32_t firstPass = 0;
+        uint32_t lastPass = 0;
+        vk::Image image;
+        vk::ImageView view;
+        vk::DeviceSize size = 0;
+        uint32_t block = 0;
+    };
+
+    struct MemoryBlock {
+        vk::DeviceMemory memory;
+        vk::DeviceSize size = 0;
+        vk::DeviceSize alignment = 1;
+        uint32_t memoryTypeBits = ~0u;
+        uint32_t availableAfterPass = 0;
+    };
+
+    struct RenderPassEntry {
+        std::vector<uint64_t> key;
+        vk::RenderPass renderPass;
+    };
+
+    struct FramebufferEntry {
+        vk::RenderPass renderPass;
+        std::vector<vk::ImageView> views;
+        vk::Extent2D extent;
+        vk::Framebuffer framebuffer;
+    };
+
+    vk::Device m_device;
+    DeviceMemoryTracker* m_memory = nullptr;
+
+    std::vector<Resource> m_resources;
+    std::vector<Pass> m_passes;             // Slots are reused across frames
+    uint32_t m_passCount = 0;
+    std::vector<Barrier> m_barriers;
+    std::vector<ResourceState> m_states;
+    std::vector<Barrier> m_finalBarriers;
+    vk::PipelineStageFlags m_finalSrcStages;
+
+    std::vector<PhysicalImage> m_physicalImages;
+    std::vector<MemoryBlock> m_memoryBlocks;
+    std::vector<vk::PipelineStageFlags> m_blockStages;      // Every stage that touched the block so far
+    std::vector<vk::AccessFlags> m_blockWriteAccess;        // Every write made to the block so far
+    std::vector<uint64_t> m_transientSignature;
+    std::vector<RenderPassEntry> m_renderPassCache;
+    std::vector<FramebufferEntry> m_framebufferCache;
+
+    // compile()'s working arrays, kept between frames rather than rebuilt
+    // from nothing for a graph that is mostly the same each time
+    std::vector<uint8_t> m_needed;
+    std::vector<uint64_t> m_signatureScratch;
+    std::vector<uint64_t> m_keyScratch;
+    std::vector<vk::ImageView> m_viewScratch;
+    std::vector<vk::ClearValue> m_clearScratch;
+    std::vector<vk::ImageMemoryBarrier> m_imageBarrierScratch;
+    std::vector<vk::BufferMemoryBarrier> m_bufferBarrierScratch;
+
+    RGStats m_stats;
+    std::string m_error;                    // Why the last compile failed
+    PassHook m_passHook;
+    bool m_compiled = false;
+    bool m_initialized = false;
+
+    void cullPasses();
+    void computeLifetimes();
+    bool allocateTransients();
+    bool createTransients();
+    void destroyTransients();
+    void deriveBarriers();
+    bool buildRenderPasses();
+    vk::RenderPass getRenderPass(const Pass& pass);
+    vk::Framebuffer getFramebuffer(vk::RenderPass renderPass, vk::Extent2D extent);
+    void emitBarriers(vk::CommandBuffer commandBuffer, const Barrier* barriers, size_t count,
+                      vk::PipelineStageFlags srcStages, vk::PipelineStageFlags dstStages);
+};
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "DescriptorManager.h"
+
+class VulkanRenderer;
+struct Mesh;
+
+// Layers order whole groups of scene draws, lowest first
+constexpr uint8_t RENDER_LAYER_BACKGROUND = 0;      // Tile maps and streamed worlds
+constexpr uint8_t RENDER_LAYER_DEFAULT = 128;       // Sprites unless told otherwise
+
+// Layer and depth packed into the top 32 bits of a sort key. depth is in
+// [0, 1], 0 nearest; farther draws sort first, since the scene pass has no
+// depth buffer and everything is drawn painter's-style
+inline uint32_t packRenderOrder(uint8_t layer, float depth) {
+    float clamped = depth > 0.0f ? (depth < 1.0f ? depth : 1.0f) : 0.0f;
+    // Truncated: 2^24 - 1 is exact in a float, rounding up could carry into the layer
+    uint32_t farness = static_cast<uint32_t>((1.0f - clamped) * 16777215.0f);
+    return (static_cast<uint32_t>(layer) << 24) | (farness & 0xFFFFFF);
+}
+
+// 64-bit sort key, most significant first: layer (8 bits), depth (24),
+// pipeline (12, from RenderQueue::registerPipeline) and texture (20, the
+// bindless index). Draws at the same layer and depth are free to be
+// reordered, and end up grouped by pipeline and then texture
+inline uint64_t makeRenderKey(uint32_t order, uint32_t pipeline, uint32_t texture) {
+    return (static_cast<uint64_t>(order) << 32) | (static_cast<uint64_t>(pipeline & 0xFFF) << 20) |
+           (texture & 0xFFFFF);
+}
+
+struct RenderSortEntry {
+    uint64_t key;
+    uint32_t index;
+    uint32_t padding;
+};
+
+// Stable LSD radix sort on key, one byte per pass. Input that is already in
+// order and bytes every key shares cost no scatter pass. scratch needs room
+// for count entries; the result ends up in entries
+void radixSortRenderKeys(RenderSortEntry* entries, RenderSortEntry* scratch, size_t count);
+
+// One draw in the scene pass. Everything shares the renderer's pipeline
+// layout and global descriptor sets
+struct RenderDraw {
+    static constexpr uint32_t MAX_PUSH_BYTES = 64;
+
+    uint32_t pipeline = 0;          // From RenderQueue::registerPipeline
+    vk::Buffer vertexBuffer;        // Bound at binding 0, offset 0
+    // Set instead of vertexBuffer for indexed meshes, which go through
+    // VulkanRenderer::drawMesh; the vertex ranges below are then unused
+    const Mesh* mesh = nullptr;
+    uint32_t vertexCount = 0;
+    uint32_t instanceCount = 1;
+    uint32_t firstVertex = 0;
+    uint32_t firstInstance = 0;
+    // Push constants written before the draw, unless those bytes already
+    // hold the same values
+    uint32_t pushOffset = 0;
+    uint32_t pushSize = 0;
+    alignas(4) uint8_t pushData[MAX_PUSH_BYTES];
+};
+
+// State changes the last flush() recorded and the ones it skipped
+struct RenderQueueStats {
+    uint32_t draws = 0;
+    uint32_t pipelineBinds = 0;
+    uint32_t vertexBufferBinds = 0;
+    uint32_t pushes = 0;
+    uint32_t skippedBinds = 0;      // Pipeline, vertex buffer and push constant updates elided
+};
+
+// Collects the scene pass's draws with 64-bit sort keys, sorts them with a
+// radix sort and records them in key order, binding a pipeline, vertex
+// buffer or push constant range only when it differs from what the previous
+// draw left bound. The global descriptor sets are bound once per flush:
+// textures are bindless, so changing texture never needs a rebind
+class RenderQueue {
+public:
+    static constexpr uint32_t MAX_PIPELINES = 1u << 12;
+
+    RenderQueue();
+    ~RenderQueue();
+
+    // Gives a pipeline the id sort keys and draws refer to it by. Asking
+    // again for the same pipeline returns the same id. Thread-safe, so
+    // systems can register from their initialization tasks
+    uint32_t registerPipeline(vk::Pipeline pipeline);
+
+    // Draws whose push range doesn't fit pushData and the layout's push
+    // constant range are dropped (an assert in debug builds)
+    void submit(uint64_t key, const RenderDraw& draw);
+
+    // Sorts and records everything submitted since the last flush. Called
+    // from the scene pass, which has set the viewport and scissor
+    void flush(VulkanRenderer& renderer, vk::CommandBuffer commandBuffer);
+
+    size_t getPendingCount() const { return m_draws.size(); }
+    const RenderQueueStats& getStats() const { return m_lastStats; }
+
+private:
+    std::mutex m_pipelineMutex;
+    std::vector<vk::Pipeline> m_pipelines;
+
+    std::vector<RenderDraw> m_draws;
+    std::vector<RenderSortEntry> m_entries;
+    std::vector<RenderSortEntry> m_scratch;
+
+    RenderQueueStats m_lastStats;
+};
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "FrameArena.h"
+#include "PipelineFactory.h"
+#include "RenderQueue.h"
+#include "Texture.h"
+
+class VulkanRenderer;
+
+using SpriteMaterial = uint32_t;
+
+// One instance in the per-frame instance buffer; matches sprite.vert
+struct SpriteInstance {
+    glm::vec2 position;         // Centre, world units
+    glm::vec2 size;
+    float rotation = 0.0f;      // Radians
+    uint32_t textureIndex = 0;  // Bindless index
+    uint32_t color = 0xFFFFFFFF; // RGBA8 tint
+    uint32_t sortOrder = 0;     // Set by SpriteRenderer::draw from the layer and depth; unused by the shaders
+};
+
+// Axis-aligned view rectangle in world units
+struct SpriteBounds {
+    float minX, minY, maxX, maxY;
+};
+
+// Copies the sprites whose conservative bounds overlap the view to visible,
+// which must have room for count entries. Returns how many were kept
+size_t cullSprites(const SpriteInstance* sprites, size_t count, const SpriteBounds& view,
+                   SpriteInstance* visible);
+
+// Instanced sprite batches. When drawFrame records the scene pass, the
+// sprites submitted during the frame are culled against the camera, sorted
+// by render key (layer, depth, material, texture) and written into the
+// frame's mapped instance buffer in that order. Each run of sorted sprites
+// sharing a layer and material becomes one instanced draw in the render
+// queue, so with one layer and depth that is one draw per material in use.
+// Submitted sprites are held in the renderer's frame arena, so draw() only
+// touches the heap through the arena's own growth.
+class SpriteRenderer {
+public:
+    SpriteRenderer();
+    ~SpriteRenderer();
+
+    bool initialize(VulkanRenderer& renderer, uint32_t framesInFlight, uint32_t maxSprites);
+    void cleanup();
+
+    // Pipelines are cached, so asking for the same combination again is cheap.
+    // Variants select a shading path in sprite.frag via a specialization constant
+    SpriteMaterial createMaterial(BlendMode blend, uint32_t shadingVariant = 0);
+    SpriteMaterial getDefaultMaterial() const { return 0; }
+    uint32_t getWhiteTexture() const { return m_whiteTexture.bindlessIndex; }
+
+    // Pipeline state for sprite-shaded instances, for systems that fill
+    // their own SpriteInstance buffers (e.g. particles)
+    static GraphicsPipelineDesc getPipelineDesc(VulkanRenderer& renderer, BlendMode blend,
+                                                uint32_t shadingVariant = 0);
+
+    // zoom is in pixels per world unit
+    void setCamera(glm::vec2 center, float zoom);
+    glm::vec2 getCameraCenter() const { return m_cameraCenter; }
+    float getZoom() const { return m_zoom; }
+    SpriteBounds getViewBounds(vk::Extent2D extent) const;
+
+    // Called by the renderer once the frame's arena has been reset. Sprites
+    // submitted before this and not yet recorded are dropped
+    void beginFrame(FrameArena& arena);
+
+    // Lower layers are drawn first (see RenderQueue.h). Within a layer,
+    // farther sprites (depth towards 1) are drawn under nearer ones; sprites
+    // at the same layer and depth may be drawn in any order
+    void draw(const SpriteInstance& sprite, SpriteMaterial material = 0,
+              uint8_t layer = RENDER_LAYER_DEFAULT, float depth = 0.0f);
+    void draw(const SpriteInstance* sprites, size_t count, SpriteMaterial material = 0,
+              uint8_t layer = RENDER_LAYER_DEFAULT, float depth = 0.0f);
+
+    // Called from the scene pass; consumes everything submitted since the
+    // last call
+    void submit(RenderQueue& queue, vk::Extent2D extent, uint32_t frameIndex);
+
+    bool isAvailable() const { return m_initialized; }
+    uint32_t getSubmittedCount() const { return m_lastSubmitted; }
+    uint32_t getVisibleCount() const { return m_lastVisible; }
+    uint32_t getBatchCount() const { return m_lastBatches; }
+
+private:
+    struct Material {
+        BlendMode blend;
+        uint32_t variant;
+        vk::Pipeline pipeline;
+        uint32_t pipelineId = 0;    // In the render queue
+        ArenaVector<SpriteInstance> pending;
+        size_t lastCount = 0;   // Reserved up front next frame
+
+        explicit Material(FrameArena& arena) : pending(ArenaAllocator<SpriteInstance>(arena)) {}
+    };
+
+    struct FrameInstances {
+        vk::Buffer buffer;
+        vk::DeviceMemory memory;
+        SpriteInstance* mapped = nullptr;
+    };
+
+    VulkanRenderer* m_renderer = nullptr;
+    vk::Device m_device;
+    vk::PipelineLayout m_pipelineLayout;
+    uint32_t m_maxSprites = 0;
+
+    std::vector<Material> m_materials;
+    std::vector<FrameInstances> m_frames;
+    Texture m_whiteTexture;
+
+    // Culled sprites and their sort order, maxSprites each
+    std::vector<SpriteInstance> m_visible;
+    std::vector<RenderSortEntry> m_sortEntries;
+    std::vector<RenderSortEntry> m_sortScratch;
+
+    glm::vec2 m_cameraCenter{ 0.0f };
+    float m_zoom = 1.0f;
+
+    uint32_t m_lastSubmitted = 0;
+    uint32_t m_lastVisible = 0;
+    uint32_t m_lastBatches = 0;
+
+    bool m_initialized = false;
+};
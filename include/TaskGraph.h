@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Runs a set of named steps with dependencies, executing independent steps
+// concurrently, and records when and where each one ran.
+// Dependencies must refer to previously added tasks.
+class TaskGraph {
+public:
+    using TaskId = uint32_t;
+    using TaskFunction = std::function<bool()>;
+
+    enum class TaskStatus : uint8_t {
+        Pending,
+        Succeeded,
+        Failed,         // Returned false or threw
+        Skipped         // Not run because a dependency failed
+    };
+
+    struct TaskTiming {
+        std::string name;
+        TaskStatus status = TaskStatus::Pending;
+        double startMs = 0.0;       // Relative to run()
+        double durationMs = 0.0;
+        uint32_t thread = 0;        // 0 is the calling thread
+        std::string error;
+        std::vector<std::string> notes;
+    };
+
+    TaskId addTask(const std::string& name, TaskFunction function,
+                   std::initializer_list<TaskId> dependencies = {});
+
+    // For steps that must run on the thread calling run(), such as window
+    // system calls on platforms that require the main thread
+    TaskId addCallingThreadTask(const std::string& name, TaskFunction function,
+                                std::initializer_list<TaskId> dependencies = {});
+
+    // Returns true when every task succeeded. After a failure no new tasks
+    // are started; tasks already running are allowed to finish
+    bool run(uint32_t maxThreads = 0);
+
+    const std::vector<TaskTiming>& getTimings() const { return m_timings; }
+    double getWallTimeMs() const { return m_wallTimeMs; }
+    double getSerialTimeMs() const;
+    double getCriticalPathMs() const;
+
+    void printReport(std::ostream& out, const std::string& title) const;
+
+    // Attaches a message to the task running on this thread, printed under
+    // it in the report so concurrent steps don't interleave their output.
+    // Outside a task the message goes straight to std::cout
+    static void note(const std::string& message);
+
+private:
+    struct Task {
+        TaskFunction function;
+        std::vector<TaskId> dependencies;
+        std::vector<TaskId> dependents;
+        bool callingThreadOnly = false;
+    };
+
+    std::vector<Task> m_tasks;
+    std::vector<TaskTiming> m_timings;
+    double m_wallTimeMs = 0.0;
+};
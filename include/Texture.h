@@ -0,0 +1,16 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include <cstdint>
+#include "DescriptorManager.h"
+
+// Sampled 2D image created by VulkanRenderer::createTexture. Shaders read it
+// through the bindless set at bindlessIndex
+struct Texture {
+    vk::Image image;
+    vk::DeviceMemory memory;
+    vk::ImageView view;
+    uint32_t bindlessIndex = INVALID_BINDLESS_INDEX;
+    uint32_t width = 0;
+    uint32_t height = 0;
+};
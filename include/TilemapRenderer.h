@@ -0,0 +1,179 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include <glm/glm.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "PipelineFactory.h"
+#include "RenderGraph.h"
+#include "RenderQueue.h"
+
+class VulkanRenderer;
+
+// Tile ids index the tileset atlas from 1, left to right and top to bottom;
+// 0 is an empty cell
+using TileId = uint16_t;
+constexpr TileId EMPTY_TILE = 0;
+
+struct TilemapDesc {
+    uint32_t width = 0;             // Tiles
+    uint32_t height = 0;
+    float tileSize = 16.0f;         // World units
+    glm::vec2 origin{ 0.0f };       // World position of tile (0, 0)'s minimum corner
+    uint32_t tilesetTexture = 0;    // Bindless index of the atlas
+    uint32_t tilesetColumns = 1;
+    uint32_t tilesetRows = 1;
+};
+
+// Push constants of tilemap.vert. Between chunks only chunkOrigin changes
+struct TilemapPushConstants {
+    float cameraCenter[2];
+    float worldToClip[2];
+    float chunkOrigin[2];
+    float tileSize;
+    uint32_t tilesetTexture;
+    uint32_t tilesetColumns;
+    uint32_t tilesetRows;
+};
+static_assert(sizeof(TilemapPushConstants) <= RenderDraw::MAX_PUSH_BYTES, "Tile map push constants must fit a RenderDraw");
+
+// Packs one non-empty tile of a chunk for tilemap.vert: x and y within the
+// chunk in bits 0-9, the atlas cell (id - 1) in the top 16 bits. Returns how
+// many records were written to records, which needs room for a whole chunk
+uint32_t buildTileChunk(const TileId* tiles, uint32_t* records);
+
+// Draws a tile map split into CHUNK_SIZE x CHUNK_SIZE chunks.
+//
+// Each chunk's tiles are packed once into a slot of one device-local buffer
+// and stay there until a tile in the chunk changes; setTile() only marks
+// the chunk dirty. Dirty chunks are packed on builder threads and copied in
+// by a transfer pass at the start of a later frame, visible chunks first and
+// within a per-frame upload budget, so a large map (or a burst of edits)
+// streams in over a few frames instead of stalling one. The scene pass
+// draws each visible, non-empty chunk with one instanced draw.
+class TilemapRenderer {
+public:
+    static constexpr uint32_t CHUNK_SIZE = 32;
+    static constexpr uint32_t CHUNK_TILES = CHUNK_SIZE * CHUNK_SIZE;
+    // Largest map side; chunk buffer slots are addressed with 32-bit instance offsets
+    static constexpr uint32_t MAX_MAP_SIZE = 16384;
+    static constexpr vk::DeviceSize UPLOAD_BYTES_PER_FRAME = 1ull << 20;
+    static constexpr uint32_t BUILDER_THREADS = 2;
+    // Chunks being built or waiting for upload at once
+    static constexpr uint32_t MAX_PENDING_BUILDS = 512;
+
+    TilemapRenderer();
+    ~TilemapRenderer();
+
+    bool initialize(VulkanRenderer& renderer, uint32_t framesInFlight);
+    void cleanup();
+
+    // Pipeline state for drawing buildTileChunk records, for other chunk
+    // sources (e.g. WorldStreamer)
+    static GraphicsPipelineDesc getPipelineDesc(VulkanRenderer& renderer);
+
+    // Replaces the map. tiles holds width * height ids, row by row starting
+    // at y = 0, or is null for an empty map. Like the renderer's destroy
+    // helpers, replacing or destroying is immediate: call it once the GPU
+    // is idle
+    bool createMap(const TilemapDesc& desc, const TileId* tiles = nullptr);
+    void destroyMap();
+
+    void setTile(uint32_t x, uint32_t y, TileId tile);
+    TileId getTile(uint32_t x, uint32_t y) const;
+
+    // Called from drawFrame before the scene pass is declared: queues dirty
+    // chunks for building and adds a transfer pass for the finished ones
+    void prepare(RenderGraph& graph, uint32_t frameIndex, vk::Extent2D extent);
+    // Declares the scene pass's read of the chunk buffer
+    void declareSceneReads(RGPassBuilder& scene) const;
+    // Called from the scene pass: one draw per visible chunk, on the
+    // background layer
+    void submit(RenderQueue& queue, vk::Extent2D extent);
+
+    bool isAvailable() const { return m_initialized; }
+    bool hasMap() const { return !m_chunks.empty(); }
+    const TilemapDesc& getDesc() const { return m_desc; }
+    uint32_t getChunkCount() const { return static_cast<uint32_t>(m_chunks.size()); }
+    uint32_t getDrawnChunkCount() const { return m_lastDrawnChunks; }
+    uint32_t getUploadedChunkCount() const { return m_lastUploadedChunks; }
+    // Changed chunks not yet uploaded
+    uint32_t getPendingChunkCount() const { return static_cast<uint32_t>(m_dirty.size()) + m_buildingChunks; }
+
+private:
+    struct Chunk {
+        uint32_t version = 0;           // Bumped by every tile change
+        uint32_t tileCount = 0;         // Records in the chunk's slot
+        bool dirty = false;             // In m_dirty
+        bool building = false;          // Handed to a builder
+    };
+
+    // A chunk's tiles on their way to the builders and its packed records on
+    // the way back. Preallocated and recycled, so rebuilding doesn't allocate
+    struct ChunkBuild {
+        uint32_t chunk = 0;
+        uint32_t version = 0;
+        uint32_t recordCount = 0;
+        TileId tiles[CHUNK_TILES];
+        uint32_t records[CHUNK_TILES];
+    };
+
+    struct FrameUpload {
+        vk::Buffer staging;
+        vk::DeviceMemory stagingMemory;
+        uint32_t* mapped = nullptr;
+        std::vector<vk::BufferCopy> regions;
+    };
+
+    VulkanRenderer* m_renderer = nullptr;
+    vk::Device m_device;
+    vk::Pipeline m_pipeline;
+    uint32_t m_pipelineId = 0;      // In the render queue
+
+    TilemapDesc m_desc;
+    uint32_t m_chunksX = 0;
+    uint32_t m_chunksY = 0;
+    std::vector<TileId> m_tiles;
+    std::vector<Chunk> m_chunks;
+    std::vector<uint32_t> m_dirty;
+    uint32_t m_buildingChunks = 0;
+    vk::Buffer m_chunkBuffer;
+    vk::DeviceMemory m_chunkMemory;
+    RGResource m_chunkResource = INVALID_RG_RESOURCE;
+    std::vector<FrameUpload> m_frames;
+
+    // Frame thread only
+    std::vector<std::unique_ptr<ChunkBuild>> m_buildStorage;
+    std::vector<ChunkBuild*> m_freeBuilds;
+    // Filled and drained within each prepare(); initialize() reserves
+    // MAX_PENDING_BUILDS, which is as many as can be outstanding
+    std::vector<ChunkBuild*> m_newBuilds;
+    std::vector<ChunkBuild*> m_ready;
+
+    // Builders. Guards everything below
+    std::mutex m_mutex;
+    std::condition_variable m_buildAvailable;
+    std::condition_variable m_buildersIdle;
+    std::vector<ChunkBuild*> m_queued;      // Taken in order from m_queueHead
+    size_t m_queueHead = 0;
+    std::vector<ChunkBuild*> m_finished;
+    uint32_t m_activeBuilds = 0;
+    bool m_stopping = false;
+    std::vector<std::thread> m_builders;
+
+    uint32_t m_lastDrawnChunks = 0;
+    uint32_t m_lastUploadedChunks = 0;
+    bool m_initialized = false;
+
+    void builderMain();
+    void markDirty(uint32_t chunk);
+    void dispatchDirty(vk::Extent2D extent);
+    void waitForBuilders();
+    // Inclusive chunk range under the camera; false when the view misses the map
+    bool getVisibleChunks(vk::Extent2D extent, uint32_t& minX, uint32_t& minY,
+                          uint32_t& maxX, uint32_t& maxY) const;
+};
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "SpriteRenderer.h"
+
+using TransformId = uint32_t;
+constexpr TransformId INVALID_TRANSFORM = UINT32_MAX;
+
+// A node's transform relative to its parent: scale, then rotate, then
+// translate
+struct Transform2D {
+    glm::vec2 position{ 0.0f };
+    float rotation = 0.0f;          // Radians
+    glm::vec2 scale{ 1.0f };
+};
+
+// World matrices of a range of nodes, one array per element so a SIMD
+// register holds the same element of consecutive nodes. A node's matrix is
+// [a c tx; b d ty]
+struct TransformMatrices {
+    std::vector<float> a, b, c, d, tx, ty;
+
+    void resize(size_t count);
+};
+
+// Computes world = parent world * local for nodes [first, end) of a
+// breadth-first block. parents holds each node's parent index (the block's
+// root has none and is skipped); dirty holds a flag per node, which on
+// return is set for every node whose world matrix changed. Uses AVX2 or SSE2
+// when the CPU has them
+void composeTransforms(const TransformMatrices& local, TransformMatrices& world, const uint32_t* parents,
+                       uint8_t* dirty, uint32_t first, uint32_t end);
+
+// Name of the instruction set composeTransforms uses on this CPU
+const char* getTransformPath();
+
+// Parent/child 2D transforms, kept as sprite instances ready to submit.
+//
+// Nodes live in flat arrays: each root's tree is one contiguous block in
+// breadth-first order, so a parent always comes before its children and a
+// single forward pass updates a block. setLocal() only marks a node and
+// its block dirty. update() skips clean blocks, recomputes the dirty
+// subtrees of the others with SIMD matrix multiplies, spreading blocks
+// across worker threads when there are enough dirty nodes, and rewrites the
+// sprite instances of the nodes that moved. Clean nodes cost nothing per
+// frame.
+//
+// Creating or destroying nodes rebuilds the layout on the next update().
+class TransformHierarchy {
+public:
+    static constexpr uint32_t DEFAULT_WORKER_THREADS = 3;
+    // Fewer dirty nodes than this are updated on the calling thread alone
+    static constexpr uint32_t PARALLEL_THRESHOLD = 16384;
+
+    explicit TransformHierarchy(uint32_t workerThreads = DEFAULT_WORKER_THREADS);
+    ~TransformHierarchy();
+
+    TransformHierarchy(const TransformHierarchy&) = delete;
+    TransformHierarchy& operator=(const TransformHierarchy&) = delete;
+
+    // parent INVALID_TRANSFORM makes a root. A node with a sprite is drawn
+    // at its world transform: sprite.size is scaled by the world scale and
+    // sprite.position and rotation are replaced. Non-uniform scale under a
+    // rotated parent would shear, which sprites can't show
+    TransformId create(TransformId parent, const Transform2D& local, const SpriteInstance* sprite = nullptr);
+    // Destroys the node and everything under it
+    void destroy(TransformId node);
+    void clear();
+
+    // The setters ignore ids that were never created or have been
+    // destroyed, as destroy() does
+    void setLocal(TransformId node, const Transform2D& local);
+    const Transform2D& getLocal(TransformId node) const { return m_nodes[node].local; }
+    void setSprite(TransformId node, const SpriteInstance& sprite);
+
+    void update();
+
+    // Valid after update()
+    glm::vec2 getWorldPosition(TransformId node) const;
+    float getWorldRotation(TransformId node) const;
+
+    // Instances of every node with a sprite, for SpriteRenderer::draw
+    const SpriteInstance* getSprites() const { return m_sprites.data(); }
+    size_t getSpriteCount() const { return m_sprites.size(); }
+
+    size_t getNodeCount() const { return m_parents.size(); }
+    uint32_t getLastUpdatedCount() const { return m_lastUpdated; }
+
+private:
+    static constexpr uint32_t NO_SLOT = UINT32_MAX;
+
+    // By id; stable while the layout moves
+    struct Node {
+        TransformId parent = INVALID_TRANSFORM;
+        Transform2D local;
+        SpriteInstance sprite;
+        bool hasSprite = false;
+        bool alive = false;
+        uint32_t index = 0;         // In the breadth-first arrays
+    };
+
+    struct Block {
+        uint32_t first;
+        uint32_t end;
+        bool dirty;
+    };
+
+    std::vector<Node> m_nodes;
+    std::vector<TransformId> m_freeIds;
+    bool m_layoutDirty = false;
+
+    // Breadth-first arrays, by index
+    std::vector<uint32_t> m_parents;
+    std::vector<TransformId> m_ids;
+    std::vector<uint32_t> m_blockOf;
+    std::vector<uint32_t> m_spriteSlots;
+    std::vector<uint8_t> m_dirty;
+    TransformMatrices m_local;
+    TransformMatrices m_world;
+    std::vector<Block> m_blocks;
+    std::vector<SpriteInstance> m_sprites;
+
+    // Blocks with a dirty node, gathered by update() for the workers.
+    // Reserved for every block whenever the layout is rebuilt
+    std::vector<uint32_t> m_dirtyBlocks;
+    std::atomic<uint32_t> m_updatedNodes{ 0 };
+    uint32_t m_lastUpdated = 0;
+
+    // Workers take dirty blocks from m_dirtyBlocks through m_nextBlock
+    uint32_t m_workerCount;
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_workAvailable;
+    std::condition_variable m_workDone;
+    uint64_t m_generation = 0;
+    uint32_t m_busyWorkers = 0;
+    bool m_stopping = false;
+    std::atomic<size_t> m_nextBlock{ 0 };
+
+    void rebuildLayout();
+    void writeLocal(uint32_t index, const Transform2D& local);
+    void updateBlock(uint32_t block);
+    void runBlocks();
+    void workerMain(uint64_t generation);
+};
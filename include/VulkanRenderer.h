@@ -5,10 +5,42 @@
 #include <vector>
 #include <optional>
 #include <memory>
+#include <array>
+#include <chrono>
+#include <functional>
+#include <mutex>
 #include "Vertex.h"
+#include "AssetStreamer.h"
+#include "RenderGraph.h"
+#include "DescriptorManager.h"
+#include "DeviceMemoryTracker.h"
+#include "DynamicResolution.h"
+#include "FrameArena.h"
+#include "FrameReadback.h"
+#include "TaskGraph.h"
+#include "GpuProfiler.h"
+#include "PerformanceHud.h"
+#include "RenderQueue.h"
+#include "SpriteRenderer.h"
+#include "ParticleSystem.h"
+#include "LightingSystem.h"
+#include "TilemapRenderer.h"
+#include "WorldStreamer.h"
+#include "Texture.h"
+#include "Mesh.h"
+#include "MeshOptimizer.h"
+
+// Draw submissions recorded during one frame
+struct FrameStats {
+    uint32_t drawCalls = 0;
+    uint64_t triangles = 0;
+};
 
 class VulkanRenderer {
 public:
+    static constexpr size_t MAX_FRAMES_IN_FLIGHT = 2;
+    static constexpr uint32_t MAX_SPRITES = 131072;
+
     VulkanRenderer();
     ~VulkanRenderer();
 
@@ -16,15 +48,87 @@ public:
     bool initialize(GLFWwindow* window);
     void cleanup();
 
-    // Main rendering functions
-    void beginFrame();
+    // Main rendering functions. beginFrame() returns false when there is
+    // no image to render to (e.g. the window is minimized); drawFrame() and
+    // endFrame() then do nothing
+    bool beginFrame();
     void endFrame();
     void drawFrame();
 
+    // The swap chain is rebuilt at the next beginFrame(). Presenting
+    // reports most size changes itself; not every platform does
+    void onFramebufferResized() { m_swapchainDirty = true; }
+
     // Getters
     bool isInitialized() const { return m_initialized; }
     vk::Device getDevice() const { return m_device; }
     vk::PhysicalDevice getPhysicalDevice() const { return m_physicalDevice; }
+    uint32_t getGraphicsQueueFamily() const { return m_graphicsQueueFamily; }
+    uint64_t getFrameNumber() const { return m_frameNumber; }
+    DescriptorManager& getDescriptorManager() { return m_descriptors; }
+    const std::vector<TaskGraph::TaskTiming>& getStartupTimings() const { return m_startupTimings; }
+    vk::PipelineLayout getPipelineLayout() const { return m_pipelineLayout; }
+    AssetStreamer& getAssetStreamer() { return m_assetStreamer; }
+    vk::RenderPass getRenderPass() const { return m_renderPass; }
+    const GpuProfiler& getGpuProfiler() const { return m_gpuProfiler; }
+    SpriteRenderer& getSpriteRenderer() { return m_sprites; }
+    RenderQueue& getRenderQueue() { return m_renderQueue; }
+    ParticleSystem& getParticleSystem() { return m_particles; }
+    LightingSystem& getLightingSystem() { return m_lighting; }
+    TilemapRenderer& getTilemapRenderer() { return m_tilemap; }
+    WorldStreamer& getWorldStreamer() { return m_world; }
+    vk::Extent2D getSwapchainExtent() const { return m_swapchainExtent; }
+    // Resolution the scene was last rendered at before being upscaled to
+    // the swap chain. Systems still frame the camera for the swap chain
+    // extent; only the rasterized size changes
+    vk::Extent2D getRenderExtent() const { return m_renderExtent; }
+    DynamicResolution& getDynamicResolution() { return m_resolution; }
+    bool isUpscaleSupported() const { return m_upscaleSupported; }
+    // Screenshots and frame recording without stalling the frame loop
+    FrameReadback& getFrameReadback() { return m_readback; }
+    DeviceMemoryTracker& getMemoryTracker() { return m_memory; }
+    const DeviceMemoryTracker& getMemoryTracker() const { return m_memory; }
+    // Scratch memory for the frame being built, valid until this frame
+    // slot's next beginFrame()
+    FrameArena& getFrameArena() { return m_frameArenas[m_currentFrame]; }
+
+    // Blocks until the GPU is idle, e.g. before destroying resources that
+    // frames in flight may still reference
+    void waitIdle() { m_device.waitIdle(); }
+
+    // Performance overlay, toggled from the window
+    void setHudVisible(bool visible) { m_hud.setVisible(visible); }
+
+    // Resource helpers for systems that render through this renderer.
+    // Destroying is immediate: callers make sure no frame in flight uses
+    // the resource (e.g. at shutdown after waitIdle). Buffer memory is
+    // categorized by usage; name appears in memory reports
+    void createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties,
+                      vk::Buffer& buffer, vk::DeviceMemory& memory, const char* name = "buffer");
+    void destroyBuffer(vk::Buffer& buffer, vk::DeviceMemory& memory);
+    Texture createTexture(uint32_t width, uint32_t height, vk::Format format,
+                          const void* pixels, size_t size, SamplerType sampler = SamplerType::Linear,
+                          const char* name = "texture");
+    void destroyTexture(Texture& texture);
+    // Uploads data as produced by optimizeMesh; meshes are imported through
+    // it so they arrive deduplicated and in cache order
+    Mesh createMesh(const MeshData& data, const char* name = "mesh");
+    void destroyMesh(Mesh& mesh);
+    // Binds the mesh to vertex binding 0 and draws it, indexed
+    void drawMesh(vk::CommandBuffer commandBuffer, const Mesh& mesh, uint32_t instanceCount = 1);
+    // Draws a Vertex mesh this frame with its origin at position, sorted
+    // into the scene pass like a sprite. Between beginFrame and drawFrame;
+    // the mesh must outlive the frame
+    void submitMesh(const Mesh& mesh, glm::vec2 position, float scale = 1.0f,
+                    uint8_t layer = RENDER_LAYER_DEFAULT, float depth = 0.5f);
+
+    // Records and submits a one-off command buffer and waits for it. For
+    // load-time uploads; safe to call from initialization tasks
+    void submitImmediate(const std::function<void(vk::CommandBuffer)>& record);
+
+    // Draw accounting; the HUD shows the previous frame's totals
+    void countDraw(uint32_t vertexCount, uint32_t instanceCount = 1);
+    const FrameStats& getLastFrameStats() const { return m_lastFrameStats; }
 
 private:
     // Vulkan instance and devices
@@ -33,6 +137,11 @@ private:
     vk::Device m_device;
     vk::Queue m_graphicsQueue;
     vk::Queue m_presentQueue;
+    uint32_t m_graphicsQueueFamily = 0;
+    std::mutex m_queueMutex;
+    
+    // Every device memory allocation, by category and heap
+    DeviceMemoryTracker m_memory;
 
     // Surface and swap chain
     vk::SurfaceKHR m_surface;
@@ -41,22 +150,39 @@ private:
     std::vector<vk::ImageView> m_swapchainImageViews;
     vk::Format m_swapchainImageFormat;
     vk::Extent2D m_swapchainExtent;
+    bool m_swapchainDirty = false;
+
+    // Scene resolution, picked from GPU frame time. Scaled frames render
+    // into an offscreen target and are blitted up to the swap chain image
+    DynamicResolution m_resolution;
+    vk::Extent2D m_renderExtent;
+    bool m_upscaleSupported = false;
+
+    // Copies of presented frames for the CPU, when the swap chain allows
+    FrameReadback m_readback;
+    bool m_readbackSupported = false;
 
-    // Render pass and framebuffers
+    // Render pass used for pipeline compatibility; the render graph builds
+    // the render passes and framebuffers actually used each frame
     vk::RenderPass m_renderPass;
-    std::vector<vk::Framebuffer> m_swapchainFramebuffers;
+    std::array<RenderGraph, MAX_FRAMES_IN_FLIGHT> m_renderGraphs;
+
+    // Descriptors: the bindless set every pipeline binds
+    DescriptorManager m_descriptors;
 
     // Pipeline
     vk::PipelineLayout m_pipelineLayout;
-    vk::Pipeline m_graphicsPipeline;
-    
-    // Shaders
-    vk::ShaderModule m_vertexShaderModule;
-    vk::ShaderModule m_fragmentShaderModule;
     
-    // Vertex buffer
-    vk::Buffer m_vertexBuffer;
-    vk::DeviceMemory m_vertexBufferMemory;
+    // Meshes submitted this frame, drawn with the Vertex layout pipeline
+    struct MeshDraw {
+        const Mesh* mesh;
+        glm::vec2 position;
+        float scale;
+        uint32_t order;         // packRenderOrder
+    };
+    vk::Pipeline m_meshPipeline;
+    uint32_t m_meshPipelineId = 0;
+    std::vector<MeshDraw> m_meshDraws;
 
     // Command pool and buffers
     vk::CommandPool m_commandPool;
@@ -68,12 +194,48 @@ private:
     std::vector<vk::Fence> m_inFlightFences;
     size_t m_currentFrame = 0;
     uint32_t m_currentImageIndex = 0;
+    uint64_t m_frameNumber = 0;
+    bool m_frameActive = false;         // An image was acquired for this frame
+    bool m_graphFailed = false;         // The last frame's graph didn't compile; reported once
+
+    // Per-frame CPU scratch, reset once the frame's fence has signaled
+    std::array<FrameArena, MAX_FRAMES_IN_FLIGHT> m_frameArenas;
+
+    // Background asset loading
+    AssetStreamer m_assetStreamer;
+
+    // Sorted draws of the scene pass, filled by the systems below
+    RenderQueue m_renderQueue;
+
+    // Chunked tile map, drawn under the sprites
+    TilemapRenderer m_tilemap;
+
+    // Chunks streamed from a world file, drawn over the tile map
+    WorldStreamer m_world;
+
+    // Instanced sprite batches drawn in the scene pass
+    SpriteRenderer m_sprites;
+
+    // Compute-simulated particles, drawn after the sprites
+    ParticleSystem m_particles;
+
+    // Point lights binned into screen tiles, applied by the sprite shader
+    LightingSystem m_lighting;
+
+    // Profiling and the performance overlay
+    GpuProfiler m_gpuProfiler;
+    PerformanceHud m_hud;
+    FrameStats m_frameStats;
+    FrameStats m_lastFrameStats;
+    std::chrono::steady_clock::time_point m_lastFrameStart;
 
     // Window reference
     GLFWwindow* m_window;
 
     // State
     bool m_initialized = false;
+    std::chrono::steady_clock::time_point m_initStart;
+    std::vector<TaskGraph::TaskTiming> m_startupTimings;
 
     // Private helper functions
     bool createInstance();
@@ -82,24 +244,41 @@ private:
     bool createLogicalDevice();
     bool createSurface();
     bool createSwapChain();
+    bool recreateSwapChain();
     bool createImageViews();
     bool createRenderPass();
     bool createGraphicsPipeline();
-    bool createFramebuffers();
+    void submitMeshDraws();
+    bool createRenderGraphs();
     bool createCommandPool();
     bool createCommandBuffers();
     bool createSyncObjects();
-    bool createVertexBuffer();
-    void cleanupVertexBuffer();
+    bool createAssetStreamer();
+    bool createDescriptorManager();
+    bool createGpuProfiler();
+    bool createPerformanceHud();
+    bool createSpriteRenderer();
+    bool createParticleSystem();
+    bool createLightingSystem();
+    bool createTilemapRenderer();
+    bool createWorldStreamer();
+    bool createFrameReadback();
+    // Presents the acquired image without the frame's passes
+    void recordSkippedFrame(vk::CommandBuffer commandBuffer);
 
     // Utility functions
-    bool isDeviceSuitable(vk::PhysicalDevice device);
+    // reason says why when it isn't
+    bool isDeviceSuitable(vk::PhysicalDevice device, std::string& reason);
     bool checkDeviceExtensionSupport(vk::PhysicalDevice device);
+    // Fills in the descriptor indexing features bindless needs, false if
+    // the device lacks any of them
+    bool queryDescriptorIndexingSupport(vk::PhysicalDevice device,
+                                        vk::PhysicalDeviceDescriptorIndexingFeatures& features);
+    bool queryMemoryBudgetSupport(std::vector<const char*>& extensions);
     bool checkValidationLayerSupport();
     bool checkSwapChainSupport();
     std::vector<const char*> getRequiredExtensions();
     vk::SurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<vk::SurfaceFormatKHR>& availableFormats);
     vk::PresentModeKHR chooseSwapPresentMode(const std::vector<vk::PresentModeKHR>& availablePresentModes);
     vk::Extent2D chooseSwapExtent(const vk::SurfaceCapabilitiesKHR& capabilities);
-    uint32_t findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties);
 }; 
\ No newline at end of file
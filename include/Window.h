@@ -13,6 +13,9 @@ public:
     void cleanup();
     bool shouldClose() const;
     void pollEvents();
+    // Sleeps until an event arrives or the timeout passes, then handles
+    // the events like pollEvents()
+    void waitEvents(double timeoutSeconds);
     void swapBuffers();
 
     // Getters
@@ -20,6 +23,18 @@ public:
     int getWidth() const { return m_width; }
     int getHeight() const { return m_height; }
     bool isInitialized() const { return m_initialized; }
+    bool isHudVisible() const { return m_hudVisible; }
+    // True once per F12 press
+    bool takeScreenshotRequest();
+    // True once after each change of framebuffer size
+    bool takeFramebufferResized();
+
+    // What the frame governor paces rendering by
+    bool isFocused() const { return m_focused; }
+    bool isIconified() const { return m_iconified; }
+    // Asks the window system, so it costs more than the others
+    bool isVisible() const;
+    bool hasFramebufferArea() const { return m_width > 0 && m_height > 0; }
 
     // Input handling
     bool isKeyPressed(int key) const;
@@ -32,9 +47,16 @@ private:
     int m_height;
     std::string m_title;
     bool m_initialized;
+    bool m_hudVisible = false;     // Performance overlay, toggled with F3
+    bool m_screenshotRequested = false;
+    bool m_framebufferResized = false;
+    bool m_focused = true;
+    bool m_iconified = false;
 
     // Callback functions
     static void framebufferSizeCallback(GLFWwindow* window, int width, int height);
+    static void focusCallback(GLFWwindow* window, int focused);
+    static void iconifyCallback(GLFWwindow* window, int iconified);
     static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
     static void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
     static void cursorPosCallback(GLFWwindow* window, double xpos, double ypos);
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include "TilemapRenderer.h"
+
+// Read-only memory mapping of a whole file. Pages are read from disk when
+// first touched, so only the parts that are used ever occupy memory, and
+// the OS can drop them again under pressure
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    const uint8_t* data() const { return m_data; }
+    size_t size() const { return m_size; }
+    bool isOpen() const { return m_data != nullptr; }
+
+private:
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+#ifdef _WIN32
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+#endif
+};
+
+constexpr uint32_t WORLD_FILE_VERSION = 1;
+
+// A world chunk file starts with this header, followed by a uint64_t file
+// offset per chunk (row by row, 0 for an empty chunk) and then the chunks'
+// tiles, CHUNK_TILES ids each, row by row. Chunks are aligned to their own
+// size so none straddles a page. Values are little-endian
+struct WorldFileHeader {
+    char magic[4] = { 'C', 'G', 'W', 'F' };
+    uint32_t version = WORLD_FILE_VERSION;
+    uint32_t chunkSize = TilemapRenderer::CHUNK_SIZE;   // Tiles per chunk side
+    uint32_t chunksX = 0;
+    uint32_t chunksY = 0;
+    float tileSize = 16.0f;                             // World units
+    uint32_t tilesetColumns = 1;
+    uint32_t tilesetRows = 1;
+};
+
+// Fills tiles (CHUNK_TILES ids) for one chunk. Returning false stores the
+// chunk as empty
+using WorldChunkGenerator = std::function<bool(uint32_t chunkX, uint32_t chunkY, TileId* tiles)>;
+
+// Writes a world file chunk by chunk, so worlds larger than memory can be
+// generated
+bool writeWorldFile(const std::string& path, const WorldFileHeader& header, const WorldChunkGenerator& generate);
+
+// Writes a seeded terrain world tilesPerSide tiles square for an 8x8
+// tileset: patches of the same tile with scattered holes, and whole empty
+// chunks for water. Each chunk follows from the seed and its position alone
+bool writeProceduralWorld(const std::string& path, uint32_t tilesPerSide, uint64_t seed);
+
+// A mapped world chunk file. Looking up a chunk touches mapped pages, which
+// may have to be read from disk: keep it off the frame thread
+class WorldFile {
+public:
+    static constexpr size_t CHUNK_BYTES = TilemapRenderer::CHUNK_TILES * sizeof(TileId);
+    // Chunk indices fit in 32 bits
+    static constexpr uint32_t MAX_CHUNKS_PER_SIDE = 65535;
+
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const { return m_file.isOpen(); }
+    const WorldFileHeader& getHeader() const { return m_header; }
+    uint32_t getChunkCount() const { return m_header.chunksX * m_header.chunksY; }
+
+    // The chunk's tiles inside the mapping, or null for an empty or
+    // out-of-range chunk
+    const TileId* getChunk(uint32_t chunk) const;
+
+private:
+    MappedFile m_file;
+    WorldFileHeader m_header;
+    const uint64_t* m_offsets = nullptr;
+};
@@ -0,0 +1,214 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+#include <glm/glm.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "RenderGraph.h"
+#include "SpriteRenderer.h"
+#include "WorldFile.h"
+
+class VulkanRenderer;
+
+struct WorldStreamingBudget {
+    // Device memory for resident chunk geometry; each non-empty chunk takes
+    // CHUNK_TILES * 4 bytes of it
+    vk::DeviceSize deviceBytes = 64ull << 20;
+    // Chunks loaded around the view on every side
+    uint32_t marginChunks = 1;
+    // How far ahead of the camera, in seconds of its current velocity,
+    // chunks are prefetched
+    float prefetchSeconds = 1.0f;
+};
+
+struct WorldStreamingStats {
+    uint32_t residentChunks = 0;        // Including empty ones, which take no device memory
+    uint32_t usedSlots = 0;
+    uint32_t slotCount = 0;
+    uint32_t pendingChunks = 0;         // Queued, loading or waiting for upload
+    uint64_t evictionCount = 0;
+};
+
+// Streams the chunks of a world file around the camera into device memory
+// and draws them like TilemapRenderer's chunks.
+//
+// The file is memory-mapped and only ever touched by the streamer's I/O
+// threads, so the frame thread never waits on a page fault. update() ranks
+// the missing chunks under the view, then those in a prefetch area pushed
+// ahead along the camera's velocity, and replaces the I/O queue with them.
+// Loaded chunks are copied by a transfer pass into fixed-size slots of one
+// device-local buffer sized by the budget; when the slots run out, the
+// least recently wanted chunk is evicted and its slot reused, so residency
+// never exceeds the cap however large the world is.
+class WorldStreamer {
+public:
+    static constexpr uint32_t IO_THREADS = 2;
+    // Chunks queued, loading or waiting for upload at once
+    static constexpr uint32_t MAX_PENDING_LOADS = 256;
+
+    WorldStreamer();
+    ~WorldStreamer();
+
+    bool initialize(VulkanRenderer& renderer, uint32_t framesInFlight);
+    void cleanup();
+
+    // tilesetTexture is the bindless atlas the file's tile ids index. Like
+    // the renderer's destroy helpers, opening and closing are immediate:
+    // call them once the GPU is idle
+    bool open(const std::string& path, uint32_t tilesetTexture,
+              const WorldStreamingBudget& budget = WorldStreamingBudget());
+    void close();
+
+    // Frame thread, once per frame before drawFrame. velocity is the
+    // camera's, in world units per second. Never waits on I/O
+    void update(const SpriteBounds& view, glm::vec2 velocity);
+
+    // Called from drawFrame before the scene pass is declared: uploads
+    // loaded chunks, evicting to make room
+    void prepare(RenderGraph& graph, uint32_t frameIndex);
+    void declareSceneReads(RGPassBuilder& scene) const;
+    // Called from the scene pass: one draw per visible resident chunk, on
+    // the background layer
+    void submit(RenderQueue& queue, vk::Extent2D extent);
+
+    bool isAvailable() const { return m_initialized; }
+    bool isOpen() const { return m_slotCount > 0; }
+    const WorldFileHeader& getHeader() const { return m_file.getHeader(); }
+    // World size in world units
+    glm::vec2 getWorldSize() const;
+    WorldStreamingStats getStats() const;
+    uint32_t getDrawnChunkCount() const { return m_lastDrawnChunks; }
+
+private:
+    static constexpr uint32_t NO_SLOT = UINT32_MAX;
+    static constexpr uint32_t NO_ENTRY = UINT32_MAX;
+
+    enum class ChunkState : uint8_t {
+        Requested,      // Queued or being loaded
+        Resident,
+        // Loaded while every slot held a chunk still in view; kept so it
+        // isn't read again each frame, and dropped once the view moves
+        Deferred
+    };
+
+    struct ChunkEntry {
+        uint32_t chunk = 0;
+        ChunkState state = ChunkState::Requested;
+        uint32_t slot = NO_SLOT;        // Empty chunks have none
+        uint32_t tileCount = 0;
+        uint64_t lastWantedFrame = 0;
+        // Links in m_resident or m_deferred, as indices into m_entries
+        uint32_t prev = NO_ENTRY;
+        uint32_t next = NO_ENTRY;
+    };
+
+    struct EntryList {
+        uint32_t head = NO_ENTRY;       // Most recently added
+        uint32_t tail = NO_ENTRY;
+        uint32_t count = 0;
+    };
+
+    struct ChunkRange {
+        uint32_t minX = 1, minY = 1, maxX = 0, maxY = 0;    // Empty
+
+        bool operator==(const ChunkRange& other) const {
+            return minX == other.minX && minY == other.minY && maxX == other.maxX && maxY == other.maxY;
+        }
+    };
+
+    // Recycled, so paging doesn't allocate per chunk
+    struct ChunkLoad {
+        uint32_t chunk = 0;
+        uint32_t recordCount = 0;
+        uint32_t records[TilemapRenderer::CHUNK_TILES];
+    };
+
+    struct WantedChunk {
+        uint32_t chunk;
+        uint32_t priority;              // 0 under the view, 1 prefetch
+        float distance;                 // From the view centre, in chunks
+    };
+
+    struct FrameUpload {
+        vk::Buffer staging;
+        vk::DeviceMemory stagingMemory;
+        uint32_t* mapped = nullptr;
+        std::vector<vk::BufferCopy> regions;
+    };
+
+    VulkanRenderer* m_renderer = nullptr;
+    vk::Device m_device;
+    vk::Pipeline m_pipeline;
+    uint32_t m_pipelineId = 0;      // In the render queue
+    std::vector<FrameUpload> m_frames;
+
+    // Read by the I/O threads; only opened and closed while they are idle
+    WorldFile m_file;
+
+    // Frame thread only
+    WorldStreamingBudget m_budget;
+    uint32_t m_tilesetTexture = 0;
+    uint32_t m_slotCount = 0;
+    vk::Buffer m_slotBuffer;
+    vk::DeviceMemory m_slotMemory;
+    RGResource m_slotResource = INVALID_RG_RESOURCE;
+    std::vector<uint32_t> m_freeSlots;
+    // Entries for every chunk that is requested, resident or deferred, sized
+    // at open. When none is free no more chunks are requested, so the pool
+    // also caps how far loading can run ahead of the slots
+    std::vector<ChunkEntry> m_entries;
+    std::vector<uint32_t> m_freeEntries;
+    // Open-addressed chunk -> entry index, at most half full
+    std::vector<uint32_t> m_chunkTable;
+    uint32_t m_chunkTableShift = 0;
+    EntryList m_resident;                       // Head is most recently wanted
+    EntryList m_deferred;
+    ChunkRange m_wantedRange;                   // Chunks collectWanted last looked at
+    uint64_t m_frameNumber = 0;
+    uint64_t m_evictionCount = 0;
+    std::vector<std::unique_ptr<ChunkLoad>> m_loadStorage;
+    std::vector<ChunkLoad*> m_freeLoads;
+    // Per-frame scratch kept between frames: m_ready never holds more than
+    // MAX_PENDING_LOADS, m_wanted grows to the largest area seen
+    std::vector<WantedChunk> m_wanted;
+    std::vector<ChunkLoad*> m_ready;
+
+    // I/O threads. Guards everything below
+    mutable std::mutex m_mutex;
+    std::condition_variable m_loadAvailable;
+    std::condition_variable m_ioIdle;
+    std::vector<ChunkLoad*> m_queue;            // Taken in order from m_queueHead
+    size_t m_queueHead = 0;
+    std::vector<ChunkLoad*> m_finished;
+    uint32_t m_activeLoads = 0;
+    bool m_stopping = false;
+    std::vector<std::thread> m_ioThreads;
+
+    uint32_t m_lastDrawnChunks = 0;
+    bool m_initialized = false;
+
+    void ioThreadMain();
+    void waitForIo();
+    void touch(uint32_t index);
+    void evict(uint32_t index);
+    uint32_t acquireSlot();
+    uint32_t findTablePosition(uint32_t chunk) const;
+    uint32_t findEntry(uint32_t chunk) const { return m_chunkTable[findTablePosition(chunk)]; }
+    // NO_ENTRY when the pool is exhausted
+    uint32_t allocateEntry(uint32_t chunk);
+    // Unlinks the entry from its list and returns it to the pool
+    void releaseEntry(uint32_t index);
+    void releaseDeferred();
+    void pushFront(EntryList& list, uint32_t index);
+    void unlink(EntryList& list, uint32_t index);
+    // Chunks in area that have no entry yet go to m_wanted, ranked ahead if
+    // they are in nearArea; those that have one are touched. Deferred
+    // chunks are released first if area covers different chunks than last
+    // time
+    void collectWanted(const SpriteBounds& area, const SpriteBounds& nearArea, glm::vec2 center);
+};
@@ -0,0 +1,19 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(set = 0, binding = 0) uniform sampler2D textures[];
+
+layout(push_constant) uniform PushConstants {
+    vec2 pixelToClip;
+    uint atlasIndex;
+} pc;
+
+layout(location = 0) in vec2 fragTexCoord;
+layout(location = 1) in vec4 fragColor;
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    // The atlas stores glyph coverage in the red channel
+    float coverage = texture(textures[pc.atlasIndex], fragTexCoord).r;
+    outColor = vec4(fragColor.rgb, fragColor.a * coverage);
+}
@@ -0,0 +1,21 @@
+#version 450
+
+// Performance HUD: screen-space quads in pixels, batched into one draw
+
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec2 inTexCoord;
+layout(location = 2) in vec4 inColor;
+
+layout(push_constant) uniform PushConstants {
+    vec2 pixelToClip;       // 2 / framebuffer size
+    uint atlasIndex;        // Bindless texture index of the glyph atlas
+} pc;
+
+layout(location = 0) out vec2 fragTexCoord;
+layout(location = 1) out vec4 fragColor;
+
+void main() {
+    gl_Position = vec4(inPosition * pc.pixelToClip - 1.0, 0.0, 1.0);
+    fragTexCoord = inTexCoord;
+    fragColor = inColor;
+}
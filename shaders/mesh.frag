@@ -5,4 +5,4 @@ layout(location = 0) out vec4 outColor;
 
 void main() {
     outColor = vec4(fragColor, 1.0);
-} 
\ No newline at end of file
+}
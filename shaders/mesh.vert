@@ -0,0 +1,21 @@
+#version 450
+
+// Matches MeshPushConstants; the camera half is laid out like the sprite
+// shader's, so consecutive mesh and sprite draws share those bytes
+layout(push_constant) uniform PushConstants {
+    vec2 cameraCenter;
+    vec2 worldToClip;       // 2 * zoom / framebuffer size
+    vec2 position;          // Mesh origin in world units
+    float scale;            // World units per mesh unit
+} pc;
+
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec3 inColor;
+
+layout(location = 0) out vec3 fragColor;
+
+void main() {
+    vec2 world = inPosition * pc.scale + pc.position;
+    gl_Position = vec4((world - pc.cameraCenter) * pc.worldToClip, 0.0, 1.0);
+    fragColor = inColor;
+}
@@ -0,0 +1,77 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(constant_id = 0) const uint SHADING_VARIANT = 0;
+// Zero for emitters (additive sprites), which the lights don't touch
+layout(constant_id = 1) const uint LIT = 1;
+
+const uint TILE_SIZE = 16;                  // LightingSystem::TILE_SIZE
+const uint TILE_STRIDE = 64;                // LightingSystem::TILE_STRIDE
+const uint INVALID_INDEX = 0xFFFFFFFFu;
+
+// Matches GpuLight
+struct Light {
+    vec2 position;
+    float radius;
+    float invRadiusSq;
+    vec4 color;
+};
+
+layout(set = 0, binding = 0) uniform sampler2D textures[];
+
+layout(std430, set = 0, binding = 1) readonly buffer LightBuffer {
+    Light lights[];
+} lightBuffers[];
+
+layout(std430, set = 0, binding = 1) readonly buffer TileBuffer {
+    uint entries[];
+} tileBuffers[];
+
+// After the vertex stage's constants; matches LightingPushConstants
+layout(push_constant) uniform PushConstants {
+    layout(offset = 96) uint lightBuffer;
+    uint tileBuffer;                        // INVALID_INDEX: lighting is off
+    uint tilesX;
+    uint lightCount;
+    vec4 ambient;
+} pc;
+
+layout(location = 0) in vec2 fragTexCoord;
+layout(location = 1) in vec4 fragColor;
+layout(location = 2) flat in uint fragTexture;
+layout(location = 0) out vec4 outColor;
+
+// Only the lights lights.comp binned into this pixel's tile are visited
+vec3 gatherLight() {
+    vec3 light = pc.ambient.rgb;
+    if (pc.lightCount == 0) return light;
+
+    uvec2 tile = uvec2(gl_FragCoord.xy) / TILE_SIZE;
+    uint base = (tile.y * pc.tilesX + tile.x) * TILE_STRIDE;
+    uint count = tileBuffers[pc.tileBuffer].entries[base];
+    for (uint i = 0; i < count; i++) {
+        Light l = lightBuffers[pc.lightBuffer].lights[tileBuffers[pc.tileBuffer].entries[base + 1u + i]];
+        vec2 offset = gl_FragCoord.xy - l.position;
+        float falloff = max(1.0 - dot(offset, offset) * l.invRadiusSq, 0.0);
+        light += l.color.rgb * (falloff * falloff);
+    }
+    return light;
+}
+
+void main() {
+    vec4 color = texture(textures[nonuniformEXT(fragTexture)], fragTexCoord) * fragColor;
+
+    // Variants exist so materials can differ by pipeline; each one is a
+    // small, distinct colour treatment
+    if (SHADING_VARIANT != 0) {
+        float t = float(SHADING_VARIANT % 16u) / 15.0;
+        float luma = dot(color.rgb, vec3(0.299, 0.587, 0.114));
+        color.rgb = mix(color.rgb, mix(vec3(luma), color.bgr, t), 0.5);
+    }
+
+    if (LIT != 0 && pc.tileBuffer != INVALID_INDEX) {
+        color.rgb *= gatherLight();
+    }
+
+    outColor = color;
+}
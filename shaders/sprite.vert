@@ -0,0 +1,36 @@
+#version 450
+
+// Instanced sprites: six vertices per instance, corners from gl_VertexIndex
+
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec2 inSize;
+layout(location = 2) in float inRotation;
+layout(location = 3) in uint inTexture;
+layout(location = 4) in vec4 inColor;
+
+layout(push_constant) uniform PushConstants {
+    vec2 cameraCenter;
+    vec2 worldToClip;       // 2 * zoom / framebuffer size
+} pc;
+
+layout(location = 0) out vec2 fragTexCoord;
+layout(location = 1) out vec4 fragColor;
+layout(location = 2) flat out uint fragTexture;
+
+const vec2 CORNERS[6] = vec2[](
+    vec2(-0.5, -0.5), vec2(0.5, -0.5), vec2(0.5, 0.5),
+    vec2(-0.5, -0.5), vec2(0.5, 0.5), vec2(-0.5, 0.5)
+);
+
+void main() {
+    vec2 corner = CORNERS[gl_VertexIndex];
+    vec2 local = corner * inSize;
+    float s = sin(inRotation);
+    float c = cos(inRotation);
+    vec2 world = inPosition + vec2(c * local.x - s * local.y, s * local.x + c * local.y);
+
+    gl_Position = vec4((world - pc.cameraCenter) * pc.worldToClip, 0.0, 1.0);
+    fragTexCoord = corner + 0.5;
+    fragColor = inColor;
+    fragTexture = inTexture;
+}
@@ -0,0 +1,40 @@
+#version 450
+
+// One instance per non-empty tile of a chunk, six vertices each. Records are
+// packed by buildTileChunk: x and y within the chunk in the low bits, the
+// tileset cell in the top 16. Shares sprite.frag
+
+layout(location = 0) in uint inTile;
+
+layout(push_constant) uniform PushConstants {
+    vec2 cameraCenter;
+    vec2 worldToClip;       // 2 * zoom / framebuffer size
+    vec2 chunkOrigin;
+    float tileSize;
+    uint tilesetTexture;
+    uint tilesetColumns;
+    uint tilesetRows;
+} pc;
+
+layout(location = 0) out vec2 fragTexCoord;
+layout(location = 1) out vec4 fragColor;
+layout(location = 2) flat out uint fragTexture;
+
+const vec2 CORNERS[6] = vec2[](
+    vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(1.0, 1.0),
+    vec2(0.0, 0.0), vec2(1.0, 1.0), vec2(0.0, 1.0)
+);
+
+void main() {
+    vec2 corner = CORNERS[gl_VertexIndex];
+    vec2 tile = vec2(float(inTile & 31u), float((inTile >> 5) & 31u));
+    vec2 world = pc.chunkOrigin + (tile + corner) * pc.tileSize;
+
+    uint cell = inTile >> 16;
+    vec2 atlasCell = vec2(float(cell % pc.tilesetColumns), float(cell / pc.tilesetColumns));
+
+    gl_Position = vec4((world - pc.cameraCenter) * pc.worldToClip, 0.0, 1.0);
+    fragTexCoord = (atlasCell + corner) / vec2(float(pc.tilesetColumns), float(pc.tilesetRows));
+    fragColor = vec4(1.0);
+    fragTexture = pc.tilesetTexture;
+}
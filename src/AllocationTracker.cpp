@@ -0,0 +1,260 @@
+#include "AllocationTracker.h"
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+// Everything here is reachable from operator new, so it must not allocate
+// and must work before static constructors have run: only constant-initialized
+// state and the C library
+
+namespace {
+    constexpr size_t PHASE_COUNT = static_cast<size_t>(AllocationPhase::Count);
+
+    thread_local AllocationPhase t_phase = AllocationPhase::Untracked;
+
+    std::atomic<uint64_t> g_allocations[PHASE_COUNT];
+    std::atomic<uint64_t> g_bytes[PHASE_COUNT];
+
+    // Totals at the last beginFrame(); only touched by the frame thread
+    uint64_t g_allocationsAtFrame[PHASE_COUNT];
+    uint64_t g_bytesAtFrame[PHASE_COUNT];
+    AllocationFrameStats g_lastFrame;
+
+    std::atomic<uint64_t> g_frameNumber{ 0 };
+    std::atomic<uint64_t> g_steadyFrom{ AllocationTracker::STEADY_STATE_WARMUP_FRAMES };
+    std::atomic<bool> g_checkEnabled{ false };
+    std::atomic<bool> g_reporting{ false };
+
+    // Out of line so the check costs operator new one predictable branch
+#if defined(_MSC_VER)
+    __declspec(noinline)
+#else
+    __attribute__((noinline))
+#endif
+    void onSteadyStateAllocation(size_t size, AllocationPhase phase) {
+        // The report itself may allocate inside stdio
+        if (g_reporting.exchange(true)) return;
+        std::fprintf(stderr, "Heap allocation of %zu bytes in %s phase at steady state (frame %llu)\n",
+                     size, getAllocationPhaseName(phase),
+                     static_cast<unsigned long long>(g_frameNumber.load(std::memory_order_relaxed)));
+        assert(!"Heap allocation at steady state; see CGAME_ALLOCATION_CHECK in README.md");
+        g_reporting.store(false);
+    }
+
+    void* allocateOrThrow(size_t size) {
+        if (size == 0) size = 1;
+        for (;;) {
+            if (void* memory = std::malloc(size)) return memory;
+            std::new_handler handler = std::get_new_handler();
+            if (!handler) throw std::bad_alloc();
+            handler();
+        }
+    }
+
+    void* allocateAlignedOrThrow(size_t size, size_t alignment) {
+        if (size == 0) size = 1;
+        if (alignment < sizeof(void*)) alignment = sizeof(void*);
+        for (;;) {
+#if defined(_MSC_VER)
+            void* memory = _aligned_malloc(size, alignment);
+#else
+            void* memory = nullptr;
+            if (posix_memalign(&memory, alignment, size) != 0) memory = nullptr;
+#endif
+            if (memory) return memory;
+            std::new_handler handler = std::get_new_handler();
+            if (!handler) throw std::bad_alloc();
+            handler();
+        }
+    }
+
+    void freeAligned(void* memory) {
+#if defined(_MSC_VER)
+        _aligned_free(memory);
+#else
+        std::free(memory);
+#endif
+    }
+}
+
+const char* getAllocationPhaseName(AllocationPhase phase) {
+    switch (phase) {
+        case AllocationPhase::Untracked: return "untracked";
+        case AllocationPhase::Game: return "game";
+        case AllocationPhase::BeginFrame: return "begin frame";
+        case AllocationPhase::Record: return "record";
+        case AllocationPhase::Submit: return "submit";
+        default: return "unknown";
+    }
+}
+
+uint64_t AllocationFrameStats::totalAllocations() const {
+    uint64_t total = 0;
+    for (size_t i = 1; i < PHASE_COUNT; i++) total += allocations[i];
+    return total;
+}
+
+uint64_t AllocationFrameStats::totalBytes() const {
+    uint64_t total = 0;
+    for (size_t i = 1; i < PHASE_COUNT; i++) total += bytes[i];
+    return total;
+}
+
+void AllocationTracker::setPhase(AllocationPhase phase) {
+    t_phase = phase;
+}
+
+AllocationPhase AllocationTracker::getPhase() {
+    return t_phase;
+}
+
+void AllocationTracker::beginFrame(uint64_t frameNumber) {
+    for (size_t i = 0; i < PHASE_COUNT; i++) {
+        uint64_t allocations = g_allocations[i].load(std::memory_order_relaxed);
+        uint64_t bytes = g_bytes[i].load(std::memory_order_relaxed);
+        g_lastFrame.allocations[i] = allocations - g_allocationsAtFrame[i];
+        g_lastFrame.bytes[i] = bytes - g_bytesAtFrame[i];
+        g_allocationsAtFrame[i] = allocations;
+        g_bytesAtFrame[i] = bytes;
+    }
+    g_frameNumber.store(frameNumber, std::memory_order_relaxed);
+}
+
+const AllocationFrameStats& AllocationTracker::getLastFrameStats() {
+    return g_lastFrame;
+}
+
+void AllocationTracker::markUnsteady() {
+    uint64_t steadyFrom = g_frameNumber.load(std::memory_order_relaxed) + STEADY_STATE_WARMUP_FRAMES;
+    g_steadyFrom.store(steadyFrom, std::memory_order_relaxed);
+}
+
+void AllocationTracker::setSteadyStateCheck(bool enabled) {
+    g_checkEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool AllocationTracker::isSteadyStateCheckEnabled() {
+    return g_checkEnabled.load(std::memory_order_relaxed);
+}
+
+bool AllocationTracker::isSteady() {
+    return g_frameNumber.load(std::memory_order_relaxed) >= g_steadyFrom.load(std::memory_order_relaxed);
+}
+
+void AllocationTracker::recordAllocation(size_t size) {
+    AllocationPhase phase = t_phase;
+    if (phase == AllocationPhase::Untracked) return;
+
+    size_t index = static_cast<size_t>(phase);
+    g_allocations[index].fetch_add(1, std::memory_order_relaxed);
+    g_bytes[index].fetch_add(size, std::memory_order_relaxed);
+
+    if (g_checkEnabled.load(std::memory_order_relaxed) && isSteady()) {
+        onSteadyStateAllocation(size, phase);
+    }
+}
+
+// Global replacements. Each form a program may call is replaced so no
+// allocation bypasses the count; the remaining forms forward to these
+
+void* operator new(size_t size) {
+    AllocationTracker::recordAllocation(size);
+    return allocateOrThrow(size);
+}
+
+void* operator new[](size_t size) {
+    AllocationTracker::recordAllocation(size);
+    return allocateOrThrow(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return operator new(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return operator new[](size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    AllocationTracker::recordAllocation(size);
+    return allocateAlignedOrThrow(size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+    AllocationTracker::recordAllocation(size);
+    return allocateAlignedOrThrow(size, static_cast<size_t>(alignment));
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    try {
+        return operator new(size, alignment);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    try {
+        return operator new[](size, alignment);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    operator delete(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    operator delete(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept {
+    operator delete(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept {
+    operator delete(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept {
+    operator delete(memory);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept {
+    freeAligned(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t alignment) noexcept {
+    operator delete(memory, alignment);
+}
+
+void operator delete(void* memory, size_t, std::align_val_t alignment) noexcept {
+    operator delete(memory, alignment);
+}
+
+void operator delete[](void* memory, size_t, std::align_val_t alignment) noexcept {
+    operator delete(memory, alignment);
+}
+
+void operator delete(void* memory, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    operator delete(memory, alignment);
+}
+
+void operator delete[](void* memory, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    operator delete(memory, alignment);
+}
@@ -0,0 +1,457 @@
+#include "AssetStreamer.h"
+#include "ShaderLoader.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+AssetStreamer::AssetStreamer() {
+}
+
+AssetStreamer::~AssetStreamer() {
+    cleanup();
+}
+
+bool AssetStreamer::initialize(vk::Device device, DeviceMemoryTracker& memory,
+                               const AssetBudget& budget, uint32_t ioThreadCount,
+                               uint32_t framesInFlight) {
+    m_device = device;
+    m_memory = &memory;
+    m_budget = budget;
+    m_framesInFlight = framesInFlight;
+    m_stopping = false;
+
+    m_frames.resize(framesInFlight);
+    for (auto& frame : m_frames) {
+        if (!reserveStaging(frame, budget.uploadBytesPerFrame)) {
+            for (auto& created : m_frames) {
+                destroyStaging(created);
+            }
+            m_frames.clear();
+            return false;
+        }
+    }
+
+    ioThreadCount = std::max(ioThreadCount, 1u);
+    for (uint32_t i = 0; i < ioThreadCount; i++) {
+        m_ioThreads.emplace_back(&AssetStreamer::ioThreadMain, this);
+    }
+
+    m_initialized = true;
+    return true;
+}
+
+void AssetStreamer::cleanup() {
+    if (!m_initialized) return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_jobAvailable.notify_all();
+    for (auto& thread : m_ioThreads) {
+        thread.join();
+    }
+    m_ioThreads.clear();
+
+    // The caller waits for the device to go idle before cleanup
+    for (auto& frame : m_frames) {
+        destroyStaging(frame);
+    }
+    m_frames.clear();
+    for (auto& asset : m_assets) {
+        releaseDevice(asset);
+        releaseHost(asset);
+    }
+    m_assets.clear();
+    m_handlesByPath.clear();
+    m_loaded.clear();
+    m_lru.clear();
+    m_jobs = std::priority_queue<LoadJob>();
+
+    m_initialized = false;
+}
+
+AssetHandle AssetStreamer::request(const std::string& path, AssetPriority priority,
+                                   vk::BufferUsageFlags usage, bool keepHostCopy) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    auto existing = m_handlesByPath.find(path);
+    if (existing != m_handlesByPath.end()) {
+        AssetHandle handle = existing->second;
+        Asset& asset = m_assets[handle];
+        touchLocked(handle);
+
+        bool retry = asset.state == AssetState::Failed &&
+                     m_frameNumber >= asset.failedFrame + FAILED_RETRY_FRAMES;
+        if (asset.state == AssetState::Evicted || retry) {
+            asset.priority = priority;
+            asset.state = AssetState::Queued;
+            enqueue(handle);
+        } else if (asset.state == AssetState::Queued && priority < asset.priority) {
+            // The stale lower priority job is skipped by the I/O thread
+            asset.priority = priority;
+            enqueue(handle);
+        } else if (priority < asset.priority) {
+            asset.priority = priority;
+        }
+
+        lock.unlock();
+        m_jobAvailable.notify_one();
+        return handle;
+    }
+
+    AssetHandle handle = static_cast<AssetHandle>(m_assets.size());
+    m_assets.emplace_back();
+    Asset& asset = m_assets.back();
+    asset.path = path;
+    asset.priority = priority;
+    asset.usage = usage;
+    asset.keepHostCopy = keepHostCopy;
+    m_handlesByPath.emplace(path, handle);
+
+    touchLocked(handle);
+    enqueue(handle);
+
+    lock.unlock();
+    m_jobAvailable.notify_one();
+    return handle;
+}
+
+void AssetStreamer::touch(AssetHandle handle) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (handle < m_assets.size()) {
+        touchLocked(handle);
+    }
+}
+
+void AssetStreamer::update(uint64_t frameNumber) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_frameNumber = frameNumber;
+        evictToBudget();
+    }
+
+    // Freed host memory may unblock prefetch loads
+    m_jobAvailable.notify_all();
+}
+
+void AssetStreamer::prepare(RenderGraph& graph, uint32_t frameIndex) {
+    FrameUpload& frame = m_frames[frameIndex];
+    frame.copies.clear();
+    m_newlyResident.clear();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // Visible assets go first, then in load completion order
+        std::stable_sort(m_loaded.begin(), m_loaded.end(), [this](AssetHandle a, AssetHandle b) {
+            return m_assets[a].priority < m_assets[b].priority;
+        });
+
+        vk::DeviceSize uploadedBytes = 0;
+        // Deferred prefetches are compacted to the front of m_loaded in
+        // place, so a steady frame doesn't allocate
+        size_t next = 0;
+        size_t kept = 0;
+        for (; next < m_loaded.size(); next++) {
+            Asset& asset = m_assets[m_loaded[next]];
+            if (asset.state != AssetState::Loaded) continue;
+
+            vk::DeviceSize size = asset.hostData.size();
+            if (uploadedBytes > 0 && uploadedBytes + size > m_budget.uploadBytesPerFrame) break;
+
+            // Prefetches wait until eviction has made room; visible assets
+            // are uploaded even if that temporarily exceeds the budget
+            if (asset.priority == AssetPriority::Prefetch &&
+                m_deviceBytes + size > m_budget.deviceBytes) {
+                m_loaded[kept++] = m_loaded[next];
+                continue;
+            }
+
+            // A staging buffer too small for the frame's first upload is
+            // replaced; the frame's fence has signaled, so nothing reads it
+            bool staged = true;
+            if (uploadedBytes + size > frame.capacity) {
+                if (uploadedBytes > 0) break;
+                staged = reserveStaging(frame, std::max(size, m_budget.uploadBytesPerFrame));
+            }
+
+            if (!staged || !upload(asset, frame, uploadedBytes)) {
+                asset.state = AssetState::Failed;
+                asset.failedFrame = m_frameNumber;
+                releaseHost(asset);
+                continue;
+            }
+
+            // The copy is in flight until this frame's fence signals
+            touchLocked(m_loaded[next]);
+            asset.residentFrame = m_frameNumber;
+            uploadedBytes += size;
+            m_newlyResident.emplace_back(m_loaded[next], m_frameNumber);
+        }
+
+        kept = std::copy(m_loaded.begin() + next, m_loaded.end(), m_loaded.begin() + kept) - m_loaded.begin();
+        m_loaded.resize(kept);
+    }
+
+    if (!frame.copies.empty()) {
+        graph.addPass("asset upload", RGPassType::Transfer)
+            .sideEffect()
+            .execute([this, frameIndex](const RGPassContext& context) {
+                const FrameUpload& frame = m_frames[frameIndex];
+                vk::CommandBuffer commandBuffer = context.commandBuffer;
+                for (const StagedCopy& copy : frame.copies) {
+                    commandBuffer.copyBuffer(frame.staging, copy.buffer, 1, &copy.region);
+                }
+
+                // Asset buffers aren't graph resources, so the graph can't
+                // order their readers after the copies
+                vk::MemoryBarrier barrier{};
+                barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+                barrier.dstAccessMask = vk::AccessFlagBits::eMemoryRead;
+                commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                              vk::PipelineStageFlagBits::eAllCommands, {},
+                                              1, &barrier, 0, nullptr, 0, nullptr);
+            });
+    }
+
+    if (m_residentCallback) {
+        for (const auto& [handle, frameNumber] : m_newlyResident) {
+            m_residentCallback(handle, frameNumber);
+        }
+    }
+}
+
+AssetState AssetStreamer::getState(AssetHandle handle) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (handle >= m_assets.size()) return AssetState::Failed;
+    return m_assets[handle].state;
+}
+
+vk::Buffer AssetStreamer::getBuffer(AssetHandle handle) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (handle >= m_assets.size()) return VK_NULL_HANDLE;
+    return m_assets[handle].buffer;
+}
+
+vk::DeviceSize AssetStreamer::getSize(AssetHandle handle) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (handle >= m_assets.size()) return 0;
+    return m_assets[handle].deviceSize;
+}
+
+uint64_t AssetStreamer::getResidentFrame(AssetHandle handle) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (handle >= m_assets.size() || m_assets[handle].state != AssetState::Resident) return UINT64_MAX;
+    return m_assets[handle].residentFrame;
+}
+
+AssetStats AssetStreamer::getStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    AssetStats stats;
+    stats.hostBytes = m_hostBytes;
+    stats.deviceBytes = m_deviceBytes;
+    stats.evictionCount = m_evictionCount;
+    for (const auto& asset : m_assets) {
+        if (asset.state == AssetState::Resident) {
+            stats.residentCount++;
+        } else if (asset.state == AssetState::Queued || asset.state == AssetState::Loading ||
+                   asset.state == AssetState::Loaded) {
+            stats.pendingCount++;
+        }
+    }
+    return stats;
+}
+
+void AssetStreamer::setBudget(const AssetBudget& budget) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_budget = budget;
+    }
+    m_jobAvailable.notify_all();
+}
+
+void AssetStreamer::ioThreadMain() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true) {
+        // Prefetches stall while the host budget is exhausted so they can't
+        // push out data the current frame still needs
+        m_jobAvailable.wait(lock, [this] {
+            if (m_stopping) return true;
+            if (m_jobs.empty()) return false;
+            return m_jobs.top().priority == AssetPriority::VisibleNow ||
+                   m_hostBytes < m_budget.hostBytes;
+        });
+        if (m_stopping) return;
+
+        LoadJob job = m_jobs.top();
+        m_jobs.pop();
+
+        if (m_assets[job.handle].state != AssetState::Queued) continue;
+        m_assets[job.handle].state = AssetState::Loading;
+        std::string path = m_assets[job.handle].path;
+
+        lock.unlock();
+        std::vector<char> data;
+        bool loaded = true;
+        try {
+            data = ShaderLoader::readFile(path);
+        } catch (const std::exception& e) {
+            std::cerr << "Asset load failed: " << e.what() << std::endl;
+            loaded = false;
+        }
+        lock.lock();
+
+        // m_assets may have grown while unlocked, so index again
+        Asset& asset = m_assets[job.handle];
+        if (!loaded) {
+            asset.state = AssetState::Failed;
+            asset.failedFrame = m_frameNumber;
+            continue;
+        }
+
+        m_hostBytes += data.size();
+        asset.hostData = std::move(data);
+        asset.state = AssetState::Loaded;
+        m_loaded.push_back(job.handle);
+    }
+}
+
+void AssetStreamer::enqueue(AssetHandle handle) {
+    m_jobs.push({ m_assets[handle].priority, m_jobSequence++, handle });
+}
+
+void AssetStreamer::touchLocked(AssetHandle handle) {
+    Asset& asset = m_assets[handle];
+    asset.lastUsedFrame = m_frameNumber;
+
+    if (asset.inLru) {
+        m_lru.splice(m_lru.begin(), m_lru, asset.lruPosition);
+    } else {
+        m_lru.push_front(handle);
+        asset.inLru = true;
+    }
+    asset.lruPosition = m_lru.begin();
+}
+
+bool AssetStreamer::upload(Asset& asset, FrameUpload& frame, vk::DeviceSize stagingOffset) {
+    vk::DeviceSize size = asset.hostData.size();
+    if (size == 0) return false;
+
+    try {
+        vk::BufferCreateInfo bufferInfo{};
+        bufferInfo.size = size;
+        bufferInfo.usage = asset.usage | vk::BufferUsageFlagBits::eTransferDst;
+        bufferInfo.sharingMode = vk::SharingMode::eExclusive;
+        asset.buffer = m_device.createBuffer(bufferInfo);
+
+        vk::MemoryRequirements memRequirements = m_device.getBufferMemoryRequirements(asset.buffer);
+
+        asset.memory = m_memory->allocate(memRequirements, vk::MemoryPropertyFlagBits::eDeviceLocal,
+                                          getMemoryCategory(asset.usage), asset.path);
+        m_device.bindBufferMemory(asset.buffer, asset.memory, 0);
+
+        asset.deviceSize = memRequirements.size;
+        m_deviceBytes += asset.deviceSize;
+    } catch (const std::exception& e) {
+        std::cerr << "Asset upload failed for " << asset.path << ": " << e.what() << std::endl;
+        releaseDevice(asset);
+        return false;
+    }
+
+    std::memcpy(frame.mapped + stagingOffset, asset.hostData.data(), size);
+    frame.copies.push_back(StagedCopy{ asset.buffer, vk::BufferCopy{ stagingOffset, 0, size } });
+
+    asset.state = AssetState::Resident;
+    if (!asset.keepHostCopy) {
+        releaseHost(asset);
+    }
+    return true;
+}
+
+bool AssetStreamer::reserveStaging(FrameUpload& frame, vk::DeviceSize bytes) {
+    destroyStaging(frame);
+
+    try {
+        vk::BufferCreateInfo bufferInfo{};
+        bufferInfo.size = bytes;
+        bufferInfo.usage = vk::BufferUsageFlagBits::eTransferSrc;
+        bufferInfo.sharingMode = vk::SharingMode::eExclusive;
+        frame.staging = m_device.createBuffer(bufferInfo);
+
+        vk::MemoryRequirements memRequirements = m_device.getBufferMemoryRequirements(frame.staging);
+        frame.stagingMemory = m_memory->allocate(memRequirements,
+            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+            MemoryCategory::Staging, "asset staging");
+        m_device.bindBufferMemory(frame.staging, frame.stagingMemory, 0);
+        frame.mapped = static_cast<char*>(m_device.mapMemory(frame.stagingMemory, 0, bytes));
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to create " << bytes << " byte asset staging buffer: " << e.what() << std::endl;
+        destroyStaging(frame);
+        return false;
+    }
+
+    frame.capacity = bytes;
+    return true;
+}
+
+void AssetStreamer::destroyStaging(FrameUpload& frame) {
+    if (frame.mapped) {
+        m_device.unmapMemory(frame.stagingMemory);
+        frame.mapped = nullptr;
+    }
+    if (frame.staging) {
+        m_device.destroyBuffer(frame.staging);
+        frame.staging = VK_NULL_HANDLE;
+    }
+    if (frame.stagingMemory) {
+        m_memory->free(frame.stagingMemory);
+        frame.stagingMemory = VK_NULL_HANDLE;
+    }
+    frame.capacity = 0;
+}
+
+void AssetStreamer::releaseDevice(Asset& asset) {
+    if (asset.buffer) {
+        m_device.destroyBuffer(asset.buffer);
+        asset.buffer = VK_NULL_HANDLE;
+    }
+    if (asset.memory) {
+        m_memory->free(asset.memory);
+        asset.memory = VK_NULL_HANDLE;
+    }
+    m_deviceBytes -= asset.deviceSize;
+    asset.deviceSize = 0;
+}
+
+void AssetStreamer::releaseHost(Asset& asset) {
+    m_hostBytes -= asset.hostData.size();
+    asset.hostData.clear();
+    asset.hostData.shrink_to_fit();
+}
+
+void AssetStreamer::evictToBudget() {
+    auto it = m_lru.end();
+    while ((m_deviceBytes > m_budget.deviceBytes || m_hostBytes > m_budget.hostBytes) &&
+           it != m_lru.begin()) {
+        --it;
+        Asset& asset = m_assets[*it];
+
+        bool freesDevice = m_deviceBytes > m_budget.deviceBytes && asset.deviceSize > 0;
+        bool freesHost = m_hostBytes > m_budget.hostBytes && !asset.hostData.empty();
+        if (!freesDevice && !freesHost) continue;
+
+        // Frames still in flight may read this asset, and everything further
+        // towards the front of the list was used even more recently
+        if (asset.lastUsedFrame + m_framesInFlight > m_frameNumber) break;
+
+        releaseDevice(asset);
+        releaseHost(asset);
+        asset.state = AssetState::Evicted;
+        asset.inLru = false;
+        it = m_lru.erase(it);
+        m_evictionCount++;
+    }
+}
@@ -0,0 +1,593 @@
+#include "Benchmark.h"
+#include "AllocationTracker.h"
+#include "FrameGovernor.h"
+#include "GameOptions.h"
+#include "Random.h"
+#include "VulkanRenderer.h"
+#include "Window.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+const char* INPUT_HEADER = "cGame-input 1";
+
+// Timing regressions smaller than this are treated as noise
+constexpr double TIMING_NOISE_MS = 0.01;
+
+double percentile(std::vector<double> values, double fraction) {
+    if (values.empty()) return 0.0;
+    size_t index = std::min(values.size() - 1, static_cast<size_t>(fraction * (values.size() - 1) + 0.5));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+double mean(const std::vector<double>& values) {
+    if (values.empty()) return 0.0;
+    double total = 0.0;
+    for (double value : values) total += value;
+    return total / values.size();
+}
+
+double standardDeviation(const std::vector<double>& values) {
+    if (values.size() < 2) return 0.0;
+    double average = mean(values);
+    double total = 0.0;
+    for (double value : values) total += (value - average) * (value - average);
+    return std::sqrt(total / (values.size() - 1));
+}
+
+uint32_t fnv1a(uint32_t hash, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        hash ^= (value >> (i * 8)) & 0xFF;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+std::string escapeJson(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            escaped += ' ';
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+// Just enough JSON to read back the files writeJson produces
+struct JsonValue {
+    enum class Type { Null, Bool, Number, String, Array, Object };
+
+    Type type = Type::Null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<JsonValue> items;       // Array elements or object values
+    std::vector<std::string> keys;      // Object keys, parallel to items
+
+    const JsonValue* find(const std::string& key) const {
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (keys[i] == key) return &items[i];
+        }
+        return nullptr;
+    }
+};
+
+class JsonParser {
+public:
+    explicit JsonParser(const std::string& text) : m_p(text.c_str()), m_end(text.c_str() + text.size()) {}
+
+    bool parse(JsonValue& value) {
+        if (!parseValue(value, 0)) return false;
+        skipWhitespace();
+        return m_p == m_end;
+    }
+
+private:
+    const char* m_p;
+    const char* m_end;
+
+    void skipWhitespace() {
+        while (m_p < m_end && (*m_p == ' ' || *m_p == '\t' || *m_p == '\n' || *m_p == '\r')) m_p++;
+    }
+
+    bool consume(char expected) {
+        skipWhitespace();
+        if (m_p < m_end && *m_p == expected) {
+            m_p++;
+            return true;
+        }
+        return false;
+    }
+
+    bool literal(const char* word) {
+        size_t length = strlen(word);
+        if (static_cast<size_t>(m_end - m_p) < length || strncmp(m_p, word, length) != 0) return false;
+        m_p += length;
+        return true;
+    }
+
+    bool parseString(std::string& out) {
+        if (!consume('"')) return false;
+        out.clear();
+        while (m_p < m_end && *m_p != '"') {
+            char c = *m_p++;
+            if (c == '\\' && m_p < m_end) {
+                char escape = *m_p++;
+                switch (escape) {
+                    case 'n': out += '\n'; break;
+                    case 't': out += '\t'; break;
+                    case 'r': out += '\r'; break;
+                    case 'b': out += '\b'; break;
+                    case 'f': out += '\f'; break;
+                    case 'u':
+                        // Non-ASCII is never written by us; keep a placeholder
+                        m_p += std::min<ptrdiff_t>(4, m_end - m_p);
+                        out += '?';
+                        break;
+                    default: out += escape; break;
+                }
+            } else {
+                out += c;
+            }
+        }
+        if (m_p >= m_end) return false;
+        m_p++;
+        return true;
+    }
+
+    bool parseValue(JsonValue& value, int depth) {
+        if (depth > 64) return false;
+        skipWhitespace();
+        if (m_p >= m_end) return false;
+
+        char c = *m_p;
+        if (c == '{') {
+            m_p++;
+            value.type = JsonValue::Type::Object;
+            if (consume('}')) return true;
+            do {
+                std::string key;
+                if (!parseString(key) || !consume(':')) return false;
+                value.keys.push_back(std::move(key));
+                value.items.emplace_back();
+                if (!parseValue(value.items.back(), depth + 1)) return false;
+            } while (consume(','));
+            return consume('}');
+        }
+        if (c == '[') {
+            m_p++;
+            value.type = JsonValue::Type::Array;
+            if (consume(']')) return true;
+            do {
+                value.items.emplace_back();
+                if (!parseValue(value.items.back(), depth + 1)) return false;
+            } while (consume(','));
+            return consume(']');
+        }
+        if (c == '"') {
+            value.type = JsonValue::Type::String;
+            return parseString(value.string);
+        }
+        if (literal("true")) {
+            value.type = JsonValue::Type::Bool;
+            value.boolean = true;
+            return true;
+        }
+        if (literal("false")) {
+            value.type = JsonValue::Type::Bool;
+            return true;
+        }
+        if (literal("null")) {
+            value.type = JsonValue::Type::Null;
+            return true;
+        }
+
+        std::string number;
+        while (m_p < m_end && (std::strchr("+-.eE", *m_p) || (*m_p >= '0' && *m_p <= '9'))) {
+            number += *m_p++;
+        }
+        char* parsedEnd = nullptr;
+        value.type = JsonValue::Type::Number;
+        value.number = std::strtod(number.c_str(), &parsedEnd);
+        return !number.empty() && parsedEnd == number.c_str() + number.size();
+    }
+};
+
+} // namespace
+
+InputRecording InputRecording::scripted(uint64_t seed, uint32_t frameCount) {
+    // Drift towards a new random heading every couple of seconds, with a
+    // slow zoom breathing in and out
+    Random random(seed, 100);
+    InputRecording recording;
+    recording.m_frames.reserve(frameCount);
+
+    float headingX = 0.0f, headingY = 0.0f;
+    float panX = 0.0f, panY = 0.0f;
+    for (uint32_t frame = 0; frame < frameCount; frame++) {
+        if (frame % 120 == 0) {
+            headingX = random.range(-0.25f, 0.25f);
+            headingY = random.range(-0.25f, 0.25f);
+        }
+        panX += (headingX - panX) * 0.05f;
+        panY += (headingY - panY) * 0.05f;
+
+        InputFrame input;
+        input.panX = panX;
+        input.panY = panY;
+        input.zoom = 1.0f + 0.004f * std::sin(frame * 0.01f);
+        recording.m_frames.push_back(input);
+    }
+    return recording;
+}
+
+InputFrame InputRecording::sample(const Window& window) {
+    InputFrame input;
+    if (window.isKeyPressed(GLFW_KEY_LEFT)) input.panX -= 0.5f;
+    if (window.isKeyPressed(GLFW_KEY_RIGHT)) input.panX += 0.5f;
+    if (window.isKeyPressed(GLFW_KEY_UP)) input.panY -= 0.5f;
+    if (window.isKeyPressed(GLFW_KEY_DOWN)) input.panY += 0.5f;
+    if (window.isKeyPressed(GLFW_KEY_Q)) input.zoom /= 1.02f;
+    if (window.isKeyPressed(GLFW_KEY_E)) input.zoom *= 1.02f;
+    return input;
+}
+
+bool InputRecording::load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open input recording: " << path << std::endl;
+        return false;
+    }
+
+    std::string header;
+    std::getline(file, header);
+    if (header != INPUT_HEADER) {
+        std::cerr << "Not an input recording: " << path << std::endl;
+        return false;
+    }
+
+    m_frames.clear();
+    InputFrame input;
+    while (file >> input.panX >> input.panY >> input.zoom) {
+        m_frames.push_back(input);
+    }
+    return true;
+}
+
+bool InputRecording::save(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Failed to write input recording: " << path << std::endl;
+        return false;
+    }
+
+    // Enough digits to read back the exact floats
+    file << INPUT_HEADER << '\n' << std::setprecision(9);
+    for (const auto& input : m_frames) {
+        file << input.panX << ' ' << input.panY << ' ' << input.zoom << '\n';
+    }
+    return true;
+}
+
+InputFrame InputRecording::at(uint32_t frame) const {
+    return frame < m_frames.size() ? m_frames[frame] : InputFrame{};
+}
+
+BenchmarkRunner::BenchmarkRunner(const GameOptions& options)
+    : m_options(options.benchmark), m_seed(options.seed), m_renderScale(options.renderScale),
+      m_capturePath(options.capturePath) {
+    if (m_options.scenes.empty()) {
+        m_options.scenes = getBenchmarkSceneNames();
+    }
+}
+
+int BenchmarkRunner::run(Window& window, VulkanRenderer& renderer) {
+    if (!renderer.getSpriteRenderer().isAvailable()) {
+        std::cerr << "Benchmarks need the sprite renderer, which is unavailable on this device" << std::endl;
+        return 1;
+    }
+
+    // Results are only comparable at a known resolution, so the GPU-time
+    // controller stays off
+    renderer.getDynamicResolution().setFixedScale(m_renderScale > 0.0f ? m_renderScale : 1.0f);
+
+    // Captures are copied back without stalling, but the copies and the
+    // encoding still cost GPU and CPU time, so timings taken while
+    // recording aren't comparable with ones taken without
+    FrameReadback& readback = renderer.getFrameReadback();
+    if ((!m_capturePath.empty() || !m_options.screenshotDir.empty()) && !readback.isAvailable()) {
+        std::cerr << "Frame capture is unavailable on this device" << std::endl;
+        return 1;
+    }
+    if (!m_capturePath.empty() && !readback.startRecording(m_capturePath)) {
+        return 1;
+    }
+
+    // Every scene replays the same input from its first frame
+    uint32_t framesPerScene = m_options.warmupFrames + m_options.measureFrames;
+    InputRecording input;
+    if (!m_options.inputPath.empty()) {
+        if (!input.load(m_options.inputPath)) return 1;
+        if (input.size() < framesPerScene) {
+            std::cout << "Input recording has " << input.size() << " of " << framesPerScene
+                      << " frames; the camera holds still after that" << std::endl;
+        }
+    } else if (!m_options.liveInput) {
+        input = InputRecording::scripted(m_seed, framesPerScene);
+    }
+
+    InputRecording recorded;
+    m_results.clear();
+    for (const auto& name : m_options.scenes) {
+        auto scene = createBenchmarkScene(name);
+        std::cout << "Benchmark " << name << ": " << m_options.warmupFrames << " warmup + "
+                  << m_options.measureFrames << " frames, seed " << m_seed << std::endl;
+        if (!runScene(window, renderer, *scene, input, recorded)) {
+            return 1;
+        }
+    }
+
+    readback.stopRecording();
+
+    if (!m_options.recordPath.empty() && !recorded.save(m_options.recordPath)) {
+        return 1;
+    }
+
+    if (!writeJson(m_options.outputPath, renderer)) {
+        return 1;
+    }
+    std::cout << "Benchmark results written to " << m_options.outputPath << std::endl;
+
+    if (!m_options.baselinePath.empty() && !compareWithBaseline(m_options.baselinePath, std::cout)) {
+        return 2;
+    }
+    return 0;
+}
+
+bool BenchmarkRunner::runScene(Window& window, VulkanRenderer& renderer, BenchmarkScene& scene,
+                               const InputRecording& input, InputRecording& recorded) {
+    using Clock = std::chrono::steady_clock;
+    auto toMs = [](Clock::duration duration) {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    };
+
+    if (!scene.setup(renderer, m_seed)) {
+        std::cerr << "Failed to set up benchmark scene " << scene.getName() << std::endl;
+        renderer.waitIdle();
+        scene.teardown(renderer);
+        return false;
+    }
+
+    SpriteRenderer& sprites = renderer.getSpriteRenderer();
+    vk::Extent2D extent = renderer.getSwapchainExtent();
+    glm::vec2 world = scene.getWorldSize();
+    glm::vec2 camera = world * 0.5f;
+    float zoom = extent.width / (world.x * 0.5f);   // Half the world across the screen
+
+    std::vector<double> frameMs, cpuMs, gpuMs, visible, batches, allocations;
+    for (auto* samples : { &frameMs, &cpuMs, &gpuMs, &visible, &batches, &allocations }) {
+        samples->reserve(m_options.measureFrames);
+    }
+    uint32_t checksum = 2166136261u;
+
+    uint32_t totalFrames = m_options.warmupFrames + m_options.measureFrames;
+    Clock::time_point previousStart = Clock::now();
+    bool aborted = false;
+
+    for (uint32_t frame = 0; frame < totalFrames; frame++) {
+        if (window.shouldClose()) {
+            aborted = true;
+            break;
+        }
+        window.pollEvents();
+
+        InputFrame step = m_options.liveInput ? InputRecording::sample(window) : input.at(frame);
+        if (!m_options.recordPath.empty() && recorded.size() < totalFrames) {
+            recorded.push(step);
+        }
+        camera += glm::vec2(step.panX, step.panY) * (extent.width / zoom) * BENCHMARK_TIMESTEP;
+        zoom = std::clamp(zoom * step.zoom, MIN_CAMERA_ZOOM, MAX_CAMERA_ZOOM);
+        sprites.setCamera(camera, zoom);
+
+        if (window.takeFramebufferResized()) {
+            renderer.onFramebufferResized();
+        }
+
+        // Nothing can be rendered while minimized. Waiting keeps every
+        // scene's frame count, though the stalled frame's time counts
+        Clock::time_point frameStart = Clock::now();
+        while (!renderer.beginFrame() && !window.shouldClose()) {
+            if (window.isIconified() || !window.hasFramebufferArea()) {
+                window.waitEvents(FrameGovernor::PAUSED_WAIT_SECONDS);
+            }
+            if (window.takeFramebufferResized()) {
+                renderer.onFramebufferResized();
+            }
+        }
+        renderer.setHudVisible(window.isHudVisible());
+
+        Clock::time_point workStart = Clock::now();
+        scene.update(renderer, frame);
+        if (frame + 1 == totalFrames && !m_options.screenshotDir.empty()) {
+            renderer.getFrameReadback().saveScreenshot(m_options.screenshotDir + "/" + scene.getName() + ".png");
+        }
+        renderer.drawFrame();
+        Clock::time_point workEnd = Clock::now();
+
+        renderer.endFrame();
+
+        if (frame >= m_options.warmupFrames) {
+            frameMs.push_back(toMs(frameStart - previousStart));
+            cpuMs.push_back(toMs(workEnd - workStart));
+            gpuMs.push_back(renderer.getGpuProfiler().getFrameMs());
+            visible.push_back(sprites.getVisibleCount());
+            batches.push_back(sprites.getBatchCount());
+            // Counts lag a frame: they are closed by the next beginFrame()
+            allocations.push_back(static_cast<double>(AllocationTracker::getLastFrameStats().totalAllocations()));
+            checksum = fnv1a(checksum, sprites.getVisibleCount());
+            checksum = fnv1a(checksum, sprites.getBatchCount());
+        }
+        previousStart = frameStart;
+    }
+
+    renderer.waitIdle();
+    // The scene's screenshot is written before the next scene starts
+    renderer.getFrameReadback().flush();
+    scene.teardown(renderer);
+
+    if (aborted) {
+        std::cerr << "Benchmark aborted: window closed" << std::endl;
+        return false;
+    }
+
+    BenchmarkResult result;
+    result.scene = scene.getName();
+    result.metrics = {
+        { "frames", static_cast<double>(frameMs.size()), MetricKind::Exact },
+        { "viewport_width", static_cast<double>(extent.width), MetricKind::Exact },
+        { "viewport_height", static_cast<double>(extent.height), MetricKind::Exact },
+        { "visible_sprites_mean", mean(visible), MetricKind::Exact },
+        { "draw_calls_mean", mean(batches), MetricKind::Exact },
+        { "workload_checksum", static_cast<double>(checksum), MetricKind::Exact },
+        { "frame_ms_mean", mean(frameMs), MetricKind::Timing },
+        { "frame_ms_p50", percentile(frameMs, 0.50), MetricKind::Timing },
+        { "frame_ms_p95", percentile(frameMs, 0.95), MetricKind::Timing },
+        { "frame_ms_p99", percentile(frameMs, 0.99), MetricKind::Info },
+        { "frame_ms_max", percentile(frameMs, 1.0), MetricKind::Info },
+        { "frame_ms_stddev", standardDeviation(frameMs), MetricKind::Info },
+        { "cpu_ms_mean", mean(cpuMs), MetricKind::Timing },
+        { "cpu_ms_p95", percentile(cpuMs, 0.95), MetricKind::Timing },
+        { "gpu_ms_mean", mean(gpuMs), MetricKind::Timing },
+        { "gpu_ms_p95", percentile(gpuMs, 0.95), MetricKind::Timing },
+        { "heap_allocs_per_frame_mean", mean(allocations), MetricKind::Info },
+        { "heap_allocs_per_frame_max", percentile(allocations, 1.0), MetricKind::Info },
+        { "render_scale", renderer.getDynamicResolution().getScale(), MetricKind::Info }
+    };
+    m_results.push_back(std::move(result));
+
+    std::cout << std::fixed << std::setprecision(3)
+              << "  frame " << mean(frameMs) << " ms (p95 " << percentile(frameMs, 0.95) << ")"
+              << ", cpu " << mean(cpuMs) << " ms, gpu " << mean(gpuMs) << " ms"
+              << ", " << mean(visible) << " sprites in " << mean(batches) << " draws"
+              << std::defaultfloat << std::endl;
+    return true;
+}
+
+bool BenchmarkRunner::writeJson(const std::string& path, const VulkanRenderer& renderer) const {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Failed to write benchmark results: " << path << std::endl;
+        return false;
+    }
+
+    auto properties = renderer.getPhysicalDevice().getProperties();
+    file << "{\n"
+         << "  \"device\": \"" << escapeJson(properties.deviceName.data()) << "\",\n"
+         << "  \"seed\": " << m_seed << ",\n"
+         << "  \"warmup_frames\": " << m_options.warmupFrames << ",\n"
+         << "  \"measured_frames\": " << m_options.measureFrames << ",\n"
+         << "  \"scenes\": [\n";
+
+    file << std::setprecision(10);
+    for (size_t i = 0; i < m_results.size(); i++) {
+        const BenchmarkResult& result = m_results[i];
+        file << "    {\n"
+             << "      \"name\": \"" << escapeJson(result.scene) << "\",\n"
+             << "      \"metrics\": {\n";
+        for (size_t j = 0; j < result.metrics.size(); j++) {
+            file << "        \"" << result.metrics[j].name << "\": " << result.metrics[j].value
+                 << (j + 1 < result.metrics.size() ? ",\n" : "\n");
+        }
+        file << "      }\n"
+             << "    }" << (i + 1 < m_results.size() ? ",\n" : "\n");
+    }
+    file << "  ]\n"
+         << "}\n";
+    return true;
+}
+
+bool BenchmarkRunner::compareWithBaseline(const std::string& path, std::ostream& out) const {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open baseline: " << path << std::endl;
+        return false;
+    }
+    std::stringstream contents;
+    contents << file.rdbuf();
+
+    JsonValue baseline;
+    JsonParser parser(contents.str());
+    const JsonValue* scenes = nullptr;
+    if (!parser.parse(baseline) || !(scenes = baseline.find("scenes")) ||
+        scenes->type != JsonValue::Type::Array) {
+        std::cerr << "Baseline is not a benchmark results file: " << path << std::endl;
+        return false;
+    }
+
+    bool passed = true;
+    out << "Comparison with " << path << " (tolerance " << m_options.tolerance * 100.0 << "%)" << std::endl;
+    out << std::fixed << std::setprecision(3);
+
+    for (const BenchmarkResult& result : m_results) {
+        const JsonValue* baselineMetrics = nullptr;
+        for (const JsonValue& entry : scenes->items) {
+            const JsonValue* name = entry.find("name");
+            if (name && name->string == result.scene) {
+                baselineMetrics = entry.find("metrics");
+                break;
+            }
+        }
+        if (!baselineMetrics) {
+            out << "  " << result.scene << ": not in baseline, skipped" << std::endl;
+            continue;
+        }
+
+        for (const BenchmarkMetric& metric : result.metrics) {
+            const JsonValue* stored = baselineMetrics->find(metric.name);
+            if (!stored || stored->type != JsonValue::Type::Number || metric.kind == MetricKind::Info) continue;
+
+            double expected = stored->number;
+            const char* status = nullptr;
+            if (metric.kind == MetricKind::Exact) {
+                if (std::fabs(metric.value - expected) > 1e-6 * std::max(1.0, std::fabs(expected))) {
+                    status = "WORKLOAD DIFFERS";
+                }
+            } else if (metric.value > expected * (1.0 + m_options.tolerance) &&
+                       metric.value - expected > TIMING_NOISE_MS) {
+                status = "REGRESSION";
+            } else if (metric.value < expected * (1.0 - m_options.tolerance) &&
+                       expected - metric.value > TIMING_NOISE_MS) {
+                status = "improved";
+            }
+
+            if (status) {
+                double change = expected != 0.0 ? (metric.value - expected) / expected * 100.0 : 0.0;
+                out << "  " << std::left << std::setw(16) << result.scene << ' ' << std::setw(22) << metric.name
+                    << std::right << ' ' << std::setw(12) << expected << " -> " << std::setw(12) << metric.value
+                    << " (" << std::showpos << change << std::noshowpos << "%)  " << status << std::endl;
+                if (metric.kind != MetricKind::Timing || std::strcmp(status, "REGRESSION") == 0) {
+                    passed = false;
+                }
+            }
+        }
+    }
+
+    out << std::defaultfloat;
+    out << (passed ? "Benchmark comparison passed" : "Benchmark comparison FAILED") << std::endl;
+    return passed;
+}
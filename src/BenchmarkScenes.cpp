@@ -0,0 +1,728 @@
+#include "Benchmark.h"
+#include "PhysicsWorld.h"
+#include "Random.h"
+#include "TransformHierarchy.h"
+#include "VulkanRenderer.h"
+#include "WorldFile.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+
+namespace {
+
+constexpr float TWO_PI = 6.28318530718f;
+
+uint32_t randomColor(Random& random, uint32_t alpha = 255) {
+    uint32_t r = 64 + random.below(192);
+    uint32_t g = 64 + random.below(192);
+    uint32_t b = 64 + random.below(192);
+    return r | (g << 8) | (b << 16) | (alpha << 24);
+}
+
+// Flat-coloured cells with a darker border, so chunk seams would show
+Texture createTileset(VulkanRenderer& renderer, Random& random, uint32_t cells, uint32_t cellPixels) {
+    uint32_t atlasSize = cells * cellPixels;
+    std::vector<uint32_t> pixels(atlasSize * atlasSize);
+    for (uint32_t cell = 0; cell < cells * cells; cell++) {
+        uint32_t color = randomColor(random);
+        uint32_t border = (color >> 1) & 0x7F7F7F7Fu;
+        uint32_t x0 = (cell % cells) * cellPixels;
+        uint32_t y0 = (cell / cells) * cellPixels;
+        for (uint32_t y = 0; y < cellPixels; y++) {
+            for (uint32_t x = 0; x < cellPixels; x++) {
+                bool edge = x == 0 || y == 0 || x == cellPixels - 1 || y == cellPixels - 1;
+                pixels[(y0 + y) * atlasSize + x0 + x] = edge ? (border | 0xFF000000u) : color;
+            }
+        }
+    }
+    return renderer.createTexture(atlasSize, atlasSize, vk::Format::eR8G8B8A8Unorm, pixels.data(),
+                                  pixels.size() * sizeof(uint32_t), SamplerType::Nearest, "tileset");
+}
+
+// Shared by the scenes: seeded procedural textures and a sprite array
+class SpriteScene : public BenchmarkScene {
+public:
+    void teardown(VulkanRenderer& renderer) override {
+        for (auto& texture : m_textures) {
+            renderer.destroyTexture(texture);
+        }
+        m_textures.clear();
+        m_sprites.clear();
+    }
+
+protected:
+    std::vector<Texture> m_textures;
+    std::vector<SpriteInstance> m_sprites;
+
+    // Checker and stripe patterns in random colours, so textures differ in
+    // content and the GPU cannot share cache lines between them
+    void createTextures(VulkanRenderer& renderer, Random& random, uint32_t count, uint32_t size) {
+        std::vector<uint32_t> pixels(size * size);
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t colorA = randomColor(random);
+            uint32_t colorB = randomColor(random);
+            uint32_t cell = 4u << random.below(3);
+            bool stripes = random.below(2) == 0;
+            for (uint32_t y = 0; y < size; y++) {
+                for (uint32_t x = 0; x < size; x++) {
+                    bool odd = stripes ? ((x + y) / cell) & 1 : ((x / cell) ^ (y / cell)) & 1;
+                    pixels[y * size + x] = odd ? colorA : colorB;
+                }
+            }
+            m_textures.push_back(renderer.createTexture(size, size, vk::Format::eR8G8B8A8Unorm,
+                                                        pixels.data(), pixels.size() * sizeof(uint32_t)));
+        }
+    }
+
+    void scatterSprites(Random& random, uint32_t count, glm::vec2 world, float minSize, float maxSize) {
+        m_sprites.resize(count);
+        for (auto& sprite : m_sprites) {
+            sprite.position = glm::vec2(random.range(0.0f, world.x), random.range(0.0f, world.y));
+            float size = random.range(minSize, maxSize);
+            sprite.size = glm::vec2(size, size);
+            sprite.rotation = random.range(0.0f, TWO_PI);
+            sprite.textureIndex = m_textures[random.below(static_cast<uint32_t>(m_textures.size()))].bindlessIndex;
+            sprite.color = randomColor(random);
+        }
+    }
+};
+
+// 20k sprites that never move; measures submission, culling and raster
+// cost as the camera pans over a fixed field
+class StaticSpriteField : public SpriteScene {
+public:
+    const char* getName() const override { return "static_sprites"; }
+    glm::vec2 getWorldSize() const override { return glm::vec2(4000.0f); }
+
+    bool setup(VulkanRenderer& renderer, uint64_t seed) override {
+        Random random(seed, 1);
+        createTextures(renderer, random, 16, 64);
+        scatterSprites(random, 20000, getWorldSize(), 8.0f, 32.0f);
+        return true;
+    }
+
+    void update(VulkanRenderer& renderer, uint32_t frame) override {
+        (void)frame;
+        renderer.getSpriteRenderer().draw(m_sprites.data(), m_sprites.size());
+    }
+};
+
+// 100k sprites moving and spinning every step, bouncing off the world edges
+class DynamicSprites : public SpriteScene {
+public:
+    const char* getName() const override { return "dynamic_sprites"; }
+    glm::vec2 getWorldSize() const override { return glm::vec2(4000.0f); }
+
+    bool setup(VulkanRenderer& renderer, uint64_t seed) override {
+        Random random(seed, 2);
+        createTextures(renderer, random, 16, 64);
+        scatterSprites(random, 100000, getWorldSize(), 4.0f, 16.0f);
+
+        m_velocities.resize(m_sprites.size());
+        m_spins.resize(m_sprites.size());
+        for (size_t i = 0; i < m_sprites.size(); i++) {
+            float angle = random.range(0.0f, TWO_PI);
+            float speed = random.range(20.0f, 200.0f);
+            m_velocities[i] = glm::vec2(std::cos(angle), std::sin(angle)) * speed;
+            m_spins[i] = random.range(-3.0f, 3.0f);
+        }
+        return true;
+    }
+
+    void update(VulkanRenderer& renderer, uint32_t frame) override {
+        (void)frame;
+        glm::vec2 world = getWorldSize();
+        for (size_t i = 0; i < m_sprites.size(); i++) {
+            SpriteInstance& sprite = m_sprites[i];
+            glm::vec2& velocity = m_velocities[i];
+            sprite.position += velocity * BENCHMARK_TIMESTEP;
+            sprite.rotation += m_spins[i] * BENCHMARK_TIMESTEP;
+            if (sprite.position.x < 0.0f || sprite.position.x > world.x) velocity.x = -velocity.x;
+            if (sprite.position.y < 0.0f || sprite.position.y > world.y) velocity.y = -velocity.y;
+            sprite.position = glm::clamp(sprite.position, glm::vec2(0.0f), world);
+        }
+        renderer.getSpriteRenderer().draw(m_sprites.data(), m_sprites.size());
+    }
+
+    void teardown(VulkanRenderer& renderer) override {
+        SpriteScene::teardown(renderer);
+        m_velocities.clear();
+        m_spins.clear();
+    }
+
+private:
+    std::vector<glm::vec2> m_velocities;
+    std::vector<float> m_spins;
+};
+
+// 48 materials (3 blend modes x 16 shader variants), each its own pipeline,
+// with sprites submitted in shuffled material order every frame
+class ManyPipelines : public SpriteScene {
+public:
+    static constexpr uint32_t VARIANTS = 16;
+
+    const char* getName() const override { return "many_pipelines"; }
+    glm::vec2 getWorldSize() const override { return glm::vec2(2000.0f); }
+
+    bool setup(VulkanRenderer& renderer, uint64_t seed) override {
+        m_random = Random(seed, 3);
+        createTextures(renderer, m_random, 8, 64);
+        scatterSprites(m_random, 30000, getWorldSize(), 8.0f, 24.0f);
+
+        SpriteRenderer& sprites = renderer.getSpriteRenderer();
+        for (BlendMode blend : { BlendMode::Opaque, BlendMode::Alpha, BlendMode::Additive }) {
+            for (uint32_t variant = 0; variant < VARIANTS; variant++) {
+                m_materials.push_back(sprites.createMaterial(blend, variant));
+            }
+        }
+        m_spriteMaterials.resize(m_sprites.size());
+        for (auto& material : m_spriteMaterials) {
+            material = m_materials[m_random.below(static_cast<uint32_t>(m_materials.size()))];
+        }
+        return true;
+    }
+
+    void update(VulkanRenderer& renderer, uint32_t frame) override {
+        (void)frame;
+        // Reassign a slice of sprites each frame so batches keep changing
+        for (uint32_t i = 0; i < 500; i++) {
+            uint32_t sprite = m_random.below(static_cast<uint32_t>(m_sprites.size()));
+            m_spriteMaterials[sprite] = m_materials[m_random.below(static_cast<uint32_t>(m_materials.size()))];
+        }
+
+        SpriteRenderer& sprites = renderer.getSpriteRenderer();
+        for (size_t i = 0; i < m_sprites.size(); i++) {
+            m_sprites[i].rotation += BENCHMARK_TIMESTEP;
+            sprites.draw(m_sprites[i], m_spriteMaterials[i]);
+        }
+    }
+
+    void teardown(VulkanRenderer& renderer) override {
+        SpriteScene::teardown(renderer);
+        m_materials.clear();
+        m_spriteMaterials.clear();
+    }
+
+private:
+    Random m_random;
+    std::vector<SpriteMaterial> m_materials;
+    std::vector<SpriteMaterial> m_spriteMaterials;
+};
+
+// 256 distinct 256x256 textures (64 MB) with every sprite switching to a
+// random one each frame, defeating texture cache locality
+class TextureThrash : public SpriteScene {
+public:
+    const char* getName() const override { return "texture_thrash"; }
+    glm::vec2 getWorldSize() const override { return glm::vec2(3000.0f); }
+
+    bool setup(VulkanRenderer& renderer, uint64_t seed) override {
+        m_random = Random(seed, 4);
+        createTextures(renderer, m_random, 256, 256);
+        scatterSprites(m_random, 20000, getWorldSize(), 24.0f, 64.0f);
+        return true;
+    }
+
+    void update(VulkanRenderer& renderer, uint32_t frame) override {
+        (void)frame;
+        uint32_t textureCount = static_cast<uint32_t>(m_textures.size());
+        for (auto& sprite : m_sprites) {
+            sprite.textureIndex = m_textures[m_random.below(textureCount)].bindlessIndex;
+        }
+        renderer.getSpriteRenderer().draw(m_sprites.data(), m_sprites.size());
+    }
+
+private:
+    Random m_random;
+};
+
+// A fountain of 1M particles bouncing inside a box, simulated either by
+// particles.comp or by the SIMD CPU path; the workload is the same so the
+// two results compare directly
+class ParticleFountain : public BenchmarkScene {
+public:
+    ParticleFountain(const char* name, ParticleSimulation simulation)
+        : m_name(name), m_simulation(simulation) {}
+
+    const char* getName() const override { return m_name; }
+    glm::vec2 getWorldSize() const override { return glm::vec2(2000.0f); }
+
+    bool setup(VulkanRenderer& renderer, uint64_t seed) override {
+        // Particles are emitted from a hash of their index and step, so the
+        // seed does not change the workload
+        (void)seed;
+        ParticleSystem& particles = renderer.getParticleSystem();
+        if (!particles.isAvailable() || !particles.start(1000000, m_simulation)) {
+            return false;
+        }
+
+        glm::vec2 world = getWorldSize();
+        ParticleSettings settings;
+        settings.position = glm::vec2(world.x * 0.5f, 100.0f);
+        settings.direction = TWO_PI * 0.25f;
+        settings.spread = 1.2f;
+        settings.speedMin = 200.0f;
+        settings.speedMax = 600.0f;
+        settings.lifetimeMin = 3.0f;
+        settings.lifetimeMax = 5.0f;
+        settings.size = 3.0f;
+        settings.color = 0x8040A0FF;
+        settings.rate = 250000.0f;
+        settings.gravity = glm::vec2(0.0f, -300.0f);
+        settings.restitution = 0.6f;
+        settings.planes[0] = { glm::vec2(0.0f, 1.0f), 0.0f };       // Floor
+        settings.planes[1] = { glm::vec2(1.0f, 0.0f), 0.0f };       // Left wall
+        settings.planes[2] = { glm::vec2(-1.0f, 0.0f), -world.x };  // Right wall
+        settings.planeCount = 3;
+        particles.setSettings(settings);
+        return true;
+    }
+
+    void update(VulkanRenderer& renderer, uint32_t frame) override {
+        (void)frame;
+        renderer.getParticleSystem().simulate(BENCHMARK_TIMESTEP);
+    }
+
+    void teardown(VulkanRenderer& renderer) override {
+        renderer.getParticleSystem().stop();
+    }
+
+private:
+    const char* m_name;
+    ParticleSimulation m_simulation;
+};
+
+// A 4096x4096 tile map (16k chunks) streamed in at setup, with 256 tiles
+// around the camera changed every frame so a few chunks are rebuilt and
+// re-uploaded continuously
+class TilemapEdits : public BenchmarkScene {
+public:
+    static constexpr uint32_t MAP_SIZE = 4096;
+    static constexpr uint32_t ATLAS_CELLS = 8;      // Per side
+    static constexpr uint32_t CELL_PIXELS = 16;
+    static constexpr float TILE_SIZE = 16.0f;
+
+    const char* getName() const override { return "tilemap"; }
+    glm::vec2 getWorldSize() const override { return glm::vec2(MAP_SIZE * TILE_SIZE); }
+
+    bool setup(VulkanRenderer& renderer, uint64_t seed) override {
+        TilemapRenderer& tilemap = renderer.getTilemapRenderer();
+        if (!tilemap.isAvailable()) return false;
+        m_random = Random(seed, 5);
+
+        m_atlas = createTileset(renderer, m_random, ATLAS_CELLS, CELL_PIXELS);
+
+        // Runs of the same tile with scattered holes, like terrain
+        std::vector<TileId> tiles(static_cast<size_t>(MAP_SIZE) * MAP_SIZE);
+        TileId current = 1;
+        for (auto& tile : tiles) {
+            if (m_random.below(16) == 0) {
+                current = static_cast<TileId>(1 + m_random.below(ATLAS_CELLS * ATLAS_CELLS));
+            }
+            tile = m_random.below(32) == 0 ? EMPTY_TILE : current;
+        }
+
+        TilemapDesc desc;
+        desc.width = MAP_SIZE;
+        desc.height = MAP_SIZE;
+        desc.tileSize = TILE_SIZE;
+        desc.tilesetTexture = m_atlas.bindlessIndex;
+        desc.tilesetColumns = ATLAS_CELLS;
+        desc.tilesetRows = ATLAS_CELLS;
+        return tilemap.createMap(desc, tiles.data());
+    }
+
+    void update(VulkanRenderer& renderer, uint32_t frame) override {
+        (void)frame;
+        TilemapRenderer& tilemap = renderer.getTilemapRenderer();
+        SpriteBounds view = renderer.getSpriteRenderer().getViewBounds(renderer.getSwapchainExtent());
+        float minX = std::max(view.minX / TILE_SIZE, 0.0f);
+        float minY = std::max(view.minY / TILE_SIZE, 0.0f);
+        float maxX = std::min(view.maxX / TILE_SIZE, static_cast<float>(MAP_SIZE - 1));
+        float maxY = std::min(view.maxY / TILE_SIZE, static_cast<float>(MAP_SIZE - 1));
+        if (maxX < minX || maxY < minY) return;
+
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t x = static_cast<uint32_t>(m_random.range(minX, maxX));
+            uint32_t y = static_cast<uint32_t>(m_random.range(minY, maxY));
+            tilemap.setTile(x, y, static_cast<TileId>(m_random.below(ATLAS_CELLS * ATLAS_CELLS + 1)));
+        }
+    }
+
+    void teardown(VulkanRenderer& renderer) override {
+        renderer.getTilemapRenderer().destroyMap();
+        renderer.destroyTexture(m_atlas);
+    }
+
+private:
+    Random m_random;
+    Texture m_atlas;
+};
+
+// Streams a generated world through a device budget far smaller than the
+// area the scripted camera covers, so chunks are paged in, evicted and paged
+// in again throughout
+class WorldStreaming : public BenchmarkScene {
+public:
+    static constexpr uint32_t WORLD_TILES = 4096;
+    static constexpr uint32_t ATLAS_CELLS = 8;
+    static constexpr uint32_t CELL_PIXELS = 16;
+    // Room for 64 chunks: a few views' worth
+    static constexpr vk::DeviceSize DEVICE_BUDGET = 64ull * TilemapRenderer::CHUNK_TILES * sizeof(uint32_t);
+
+    const char* getName() const override { return "world_streaming"; }
+    glm::vec2 getWorldSize() const override { return glm::vec2(WORLD_TILES * WorldFileHeader().tileSize); }
+
+    bool setup(VulkanRenderer& renderer, uint64_t seed) override {
+        WorldStreamer& world = renderer.getWorldStreamer();
+        if (!world.isAvailable()) return false;
+
+        std::error_code error;
+        std::filesystem::path directory = std::filesystem::temp_directory_path(error);
+        if (error) return false;
+        m_path = (directory / ("cgame_world_" + std::to_string(seed) + ".cgw")).string();
+        if (!writeProceduralWorld(m_path, WORLD_TILES, seed)) return false;
+
+        Random random(seed, 6);
+        m_atlas = createTileset(renderer, random, ATLAS_CELLS, CELL_PIXELS);
+
+        WorldStreamingBudget budget;
+        budget.deviceBytes = DEVICE_BUDGET;
+        return world.open(m_path, m_atlas.bindlessIndex, budget);
+    }
+
+    void update(VulkanRenderer& renderer, uint32_t frame) override {
+        // The runner has already moved the camera for this frame
+        const SpriteRenderer& sprites = renderer.getSpriteRenderer();
+        glm::vec2 camera = sprites.getCameraCenter();
+        if (frame == 0) m_previousCamera = camera;
+        glm::vec2 velocity = (camera - m_previousCamera) / BENCHMARK_TIMESTEP;
+        m_previousCamera = camera;
+        renderer.getWorldStreamer().update(sprites.getViewBounds(renderer.getSwapchainExtent()), velocity);
+    }
+
+    void teardown(VulkanRenderer& renderer) override {
+        renderer.getWorldStreamer().close();
+        renderer.destroyTexture(m_atlas);
+        std::remove(m_path.c_str());
+    }
+
+private:
+    std::string m_path;
+    Texture m_atlas;
+    glm::vec2 m_previousCamera{ 0.0f };
+};
+
+// 4096 star systems of a sun, four planets and two moons per planet, all
+// sprites parented through a transform hierarchy. Every frame an eighth of
+// the systems turn, so their whole subtrees move while the rest stay clean
+class TransformSystems : public SpriteScene {
+public:
+    static constexpr uint32_t SYSTEMS = 4096;
+    static constexpr uint32_t PLANETS = 4;
+    static constexpr uint32_t MOONS = 2;
+    static constexpr uint32_t TURNING_SHARE = 8;    // One system in this many turns per frame
+
+    const char* getName() const override { return "transform_hierarchy"; }
+    glm::vec2 getWorldSize() const override { return glm::vec2(16000.0f); }
+
+    bool setup(VulkanRenderer& renderer, uint64_t seed) override {
+        Random random(seed, 7);
+        createTextures(renderer, random, 8, 64);
+        glm::vec2 world = getWorldSize();
+
+        auto makeSprite = [&](float size) {
+            SpriteInstance sprite;
+            sprite.size = glm::vec2(size);
+            sprite.textureIndex = m_textures[random.below(static_cast<uint32_t>(m_textures.size()))].bindlessIndex;
+            sprite.color = randomColor(random);
+            return sprite;
+        };
+
+        m_suns.resize(SYSTEMS);
+        m_spins.resize(SYSTEMS);
+        for (uint32_t system = 0; system < SYSTEMS; system++) {
+            Transform2D sun;
+            sun.position = glm::vec2(random.range(0.0f, world.x), random.range(0.0f, world.y));
+            sun.rotation = random.range(0.0f, TWO_PI);
+            SpriteInstance sunSprite = makeSprite(24.0f);
+            m_suns[system] = m_hierarchy.create(INVALID_TRANSFORM, sun, &sunSprite);
+            m_spins[system] = random.range(-2.0f, 2.0f);
+
+            for (uint32_t planet = 0; planet < PLANETS; planet++) {
+                Transform2D orbit;
+                orbit.position = glm::vec2(40.0f + 30.0f * planet, 0.0f);
+                orbit.rotation = random.range(0.0f, TWO_PI);
+                SpriteInstance planetSprite = makeSprite(12.0f);
+                TransformId planetId = m_hierarchy.create(m_suns[system], orbit, &planetSprite);
+
+                for (uint32_t moon = 0; moon < MOONS; moon++) {
+                    Transform2D moonOrbit;
+                    moonOrbit.position = glm::vec2(10.0f + 5.0f * moon, 0.0f);
+                    moonOrbit.rotation = random.range(0.0f, TWO_PI);
+                    moonOrbit.scale = glm::vec2(0.5f);
+                    SpriteInstance moonSprite = makeSprite(8.0f);
+                    m_hierarchy.create(planetId, moonOrbit, &moonSprite);
+                }
+            }
+        }
+        return true;
+    }
+
+    void update(VulkanRenderer& renderer, uint32_t frame) override {
+        // Each system turns every TURNING_SHARE frames, by that many steps
+        for (uint32_t system = frame % TURNING_SHARE; system < SYSTEMS; system += TURNING_SHARE) {
+            Transform2D sun = m_hierarchy.getLocal(m_suns[system]);
+            sun.rotation += m_spins[system] * BENCHMARK_TIMESTEP * TURNING_SHARE;
+            m_hierarchy.setLocal(m_suns[system], sun);
+        }
+        m_hierarchy.update();
+        renderer.getSpriteRenderer().draw(m_hierarchy.getSprites(), m_hierarchy.getSpriteCount());
+    }
+
+    void teardown(VulkanRenderer& renderer) override {
+        SpriteScene::teardown(renderer);
+        m_hierarchy.clear();
+        m_suns.clear();
+        m_spins.clear();
+    }
+
+private:
+    TransformHierarchy m_hierarchy;
+    std::vector<TransformId> m_suns;
+    std::vector<float> m_spins;
+};
+
+// 20k circles and boxes falling into a box under gravity, with a few
+// static pegs, drawn as sprites. Starts with the broadphase re-sorting a
+// shuffled order and ends with piles full of resting contacts
+class PhysicsPile : public SpriteScene {
+public:
+    static constexpr uint32_t BODIES = 20000;
+    static constexpr uint32_t PEG_SHARE = 50;       // One body in this many is a static peg
+
+    const char* getName() const override { return "physics"; }
+    glm::vec2 getWorldSize() const override { return glm::vec2(4000.0f); }
+
+    bool setup(VulkanRenderer& renderer, uint64_t seed) override {
+        Random random(seed, 8);
+        createTextures(renderer, random, 8, 32);
+        glm::vec2 world = getWorldSize();
+
+        PhysicsSettings settings;
+        settings.gravity = glm::vec2(0.0f, -300.0f);
+        settings.bounded = true;
+        settings.boundsMax = world;
+        m_physics.setSettings(settings);
+
+        m_bodies.resize(BODIES);
+        m_sprites.resize(BODIES);
+        for (uint32_t i = 0; i < BODIES; i++) {
+            BodyDesc desc;
+            desc.shape = random.below(3) == 0 ? BodyShape::Box : BodyShape::Circle;
+            desc.position = glm::vec2(random.range(0.0f, world.x), random.range(0.0f, world.y));
+            desc.velocity = glm::vec2(random.range(-100.0f, 100.0f), random.range(-100.0f, 100.0f));
+            desc.radius = random.range(4.0f, 12.0f);
+            desc.halfExtents = glm::vec2(random.range(4.0f, 12.0f), random.range(4.0f, 12.0f));
+            desc.mass = i % PEG_SHARE == 0 ? 0.0f : 1.0f;
+            desc.restitution = random.range(0.2f, 0.8f);
+            m_bodies[i] = m_physics.createBody(desc);
+
+            SpriteInstance& sprite = m_sprites[i];
+            sprite.size = desc.shape == BodyShape::Box ? desc.halfExtents * 2.0f : glm::vec2(desc.radius * 2.0f);
+            sprite.textureIndex = m_textures[random.below(static_cast<uint32_t>(m_textures.size()))].bindlessIndex;
+            sprite.color = randomColor(random);
+        }
+        return true;
+    }
+
+    void update(VulkanRenderer& renderer, uint32_t frame) override {
+        (void)frame;
+        m_physics.step(BENCHMARK_TIMESTEP);
+        for (uint32_t i = 0; i < BODIES; i++) {
+            m_sprites[i].position = m_physics.getPosition(m_bodies[i]);
+        }
+        renderer.getSpriteRenderer().draw(m_sprites.data(), m_sprites.size());
+    }
+
+    void teardown(VulkanRenderer& renderer) override {
+        SpriteScene::teardown(renderer);
+        m_physics.clear();
+        m_bodies.clear();
+    }
+
+private:
+    PhysicsWorld m_physics;
+    std::vector<BodyId> m_bodies;
+};
+
+// A dense sprite field at night, lit by 2k point lights circling over it:
+// light packing, tile binning and shading with dozens of lights per tile
+class NightLights : public SpriteScene {
+public:
+    static constexpr uint32_t LIGHTS = 2000;
+
+    const char* getName() const override { return "lights"; }
+    glm::vec2 getWorldSize() const override { return glm::vec2(4000.0f); }
+
+    bool setup(VulkanRenderer& renderer, uint64_t seed) override {
+        LightingSystem& lighting = renderer.getLightingSystem();
+        if (!lighting.isAvailable()) {
+            return false;
+        }
+
+        Random random(seed, 9);
+        createTextures(renderer, random, 16, 64);
+        glm::vec2 world = getWorldSize();
+        scatterSprites(random, 40000, world, 16.0f, 48.0f);
+
+        m_orbits.resize(LIGHTS);
+        m_lights.resize(LIGHTS);
+        for (uint32_t i = 0; i < LIGHTS; i++) {
+            Orbit& orbit = m_orbits[i];
+            orbit.center = glm::vec2(random.range(0.0f, world.x), random.range(0.0f, world.y));
+            orbit.radius = random.range(20.0f, 200.0f);
+            orbit.phase = random.range(0.0f, TWO_PI);
+            orbit.speed = random.range(-2.0f, 2.0f);
+
+            PointLight& light = m_lights[i];
+            light.radius = random.range(40.0f, 160.0f);
+            light.color = glm::vec3(random.range(0.3f, 1.0f), random.range(0.3f, 1.0f), random.range(0.3f, 1.0f));
+            light.intensity = random.range(0.5f, 1.5f);
+        }
+
+        lighting.setAmbient(glm::vec3(0.05f));
+        lighting.setEnabled(true);
+        return true;
+    }
+
+    void update(VulkanRenderer& renderer, uint32_t frame) override {
+        (void)frame;
+        for (uint32_t i = 0; i < LIGHTS; i++) {
+            Orbit& orbit = m_orbits[i];
+            orbit.phase += orbit.speed * BENCHMARK_TIMESTEP;
+            m_lights[i].position = orbit.center + glm::vec2(std::cos(orbit.phase), std::sin(orbit.phase)) * orbit.radius;
+        }
+        renderer.getLightingSystem().addLights(m_lights.data(), m_lights.size());
+        renderer.getSpriteRenderer().draw(m_sprites.data(), m_sprites.size());
+    }
+
+    void teardown(VulkanRenderer& renderer) override {
+        SpriteScene::teardown(renderer);
+        renderer.getLightingSystem().setEnabled(false);
+        m_orbits.clear();
+        m_lights.clear();
+    }
+
+private:
+    struct Orbit {
+        glm::vec2 center;
+        float radius;
+        float phase;
+        float speed;
+    };
+
+    std::vector<Orbit> m_orbits;
+    std::vector<PointLight> m_lights;
+};
+
+// 8k colored polygons drawn as indexed meshes through the render queue,
+// each with its own push constants: the per-draw cost of submitMesh and of
+// the queue's sorting and bind elision. The meshes are built as unindexed
+// triangle fans, so import deduplicates the shared centers and rims
+class MeshField : public BenchmarkScene {
+public:
+    static constexpr uint32_t SHAPES = 4;
+    static constexpr uint32_t INSTANCES = 8000;
+
+    const char* getName() const override { return "meshes"; }
+    glm::vec2 getWorldSize() const override { return glm::vec2(4000.0f); }
+
+    bool setup(VulkanRenderer& renderer, uint64_t seed) override {
+        Random random(seed, 10);
+        for (uint32_t shape = 0; shape < SHAPES; shape++) {
+            uint32_t sides = 3u << shape;
+            glm::vec3 inner(random.range(0.2f, 1.0f), random.range(0.2f, 1.0f), random.range(0.2f, 1.0f));
+            glm::vec3 outer = inner * 0.4f;
+            std::vector<Vertex> vertices;
+            for (uint32_t side = 0; side < sides; side++) {
+                float a0 = TWO_PI * side / sides;
+                float a1 = TWO_PI * (side + 1) / sides;
+                vertices.push_back({ glm::vec2(0.0f), inner });
+                vertices.push_back({ glm::vec2(std::cos(a0), std::sin(a0)), outer });
+                vertices.push_back({ glm::vec2(std::cos(a1), std::sin(a1)), outer });
+            }
+            MeshData data;
+            if (!optimizeMesh(vertices.data(), vertices.size(), sizeof(Vertex), nullptr, 0, data)) {
+                return false;
+            }
+            m_meshes.push_back(renderer.createMesh(data, "benchmark mesh"));
+        }
+
+        glm::vec2 world = getWorldSize();
+        m_instances.resize(INSTANCES);
+        for (auto& instance : m_instances) {
+            instance.shape = random.below(SHAPES);
+            instance.center = glm::vec2(random.range(0.0f, world.x), random.range(0.0f, world.y));
+            instance.scale = random.range(8.0f, 32.0f);
+            instance.phase = random.range(0.0f, TWO_PI);
+            instance.depth = random.range(0.0f, 1.0f);
+        }
+        return true;
+    }
+
+    void update(VulkanRenderer& renderer, uint32_t frame) override {
+        float time = frame * BENCHMARK_TIMESTEP;
+        for (const auto& instance : m_instances) {
+            float angle = instance.phase + time;
+            glm::vec2 offset = glm::vec2(std::cos(angle), std::sin(angle)) * instance.scale;
+            renderer.submitMesh(m_meshes[instance.shape], instance.center + offset, instance.scale,
+                                RENDER_LAYER_DEFAULT, instance.depth);
+        }
+    }
+
+    void teardown(VulkanRenderer& renderer) override {
+        for (auto& mesh : m_meshes) {
+            renderer.destroyMesh(mesh);
+        }
+        m_meshes.clear();
+        m_instances.clear();
+    }
+
+private:
+    struct Instance {
+        uint32_t shape;
+        glm::vec2 center;
+        float scale;
+        float phase;
+        float depth;
+    };
+
+    std::vector<Mesh> m_meshes;
+    std::vector<Instance> m_instances;
+};
+
+} // namespace
+
+std::vector<std::string> getBenchmarkSceneNames() {
+    return { "static_sprites", "dynamic_sprites", "many_pipelines", "texture_thrash",
+             "particles_gpu", "particles_cpu", "tilemap", "world_streaming", "transform_hierarchy",
+             "physics", "lights", "meshes" };
+}
+
+std::unique_ptr<BenchmarkScene> createBenchmarkScene(const std::string& name) {
+    if (name == "static_sprites") return std::make_unique<StaticSpriteField>();
+    if (name == "dynamic_sprites") return std::make_unique<DynamicSprites>();
+    if (name == "many_pipelines") return std::make_unique<ManyPipelines>();
+    if (name == "texture_thrash") return std::make_unique<TextureThrash>();
+    if (name == "particles_gpu") return std::make_unique<ParticleFountain>("particles_gpu", ParticleSimulation::Gpu);
+    if (name == "particles_cpu") return std::make_unique<ParticleFountain>("particles_cpu", ParticleSimulation::Cpu);
+    if (name == "tilemap") return std::make_unique<TilemapEdits>();
+    if (name == "world_streaming") return std::make_unique<WorldStreaming>();
+    if (name == "transform_hierarchy") return std::make_unique<TransformSystems>();
+    if (name == "physics") return std::make_unique<PhysicsPile>();
+    if (name == "lights") return std::make_unique<NightLights>();
+    if (name == "meshes") return std::make_unique<MeshField>();
+    return nullptr;
+}
@@ -0,0 +1,77 @@
+#include "CpuFeatures.h"
+#include <cctype>
+#include <cstdlib>
+#include <iostream>
+
+#if CGAME_SIMD_X64 && defined(_MSC_VER)
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+namespace {
+
+SimdLevel detectSimdLevel() {
+#if CGAME_SIMD_X64 && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    // AVX registers are only usable once the OS saves them on context
+    // switches (OSXSAVE, then the XMM and YMM bits of XCR0)
+    bool osSavesYmm = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 0x6) == 0x6;
+    if (osSavesYmm && maxLeaf >= 7) {
+        __cpuidex(info, 7, 0);
+        if (info[1] & (1 << 5)) return SimdLevel::AVX2;
+    }
+    return SimdLevel::SSE2;
+#elif CGAME_SIMD_X64
+    // Also checks that the OS saves the AVX registers
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? SimdLevel::AVX2 : SimdLevel::SSE2;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+bool equalsIgnoringCase(const char* a, const char* b) {
+    for (; *a && *b; a++, b++) {
+        if (std::tolower(static_cast<unsigned char>(*a)) != std::tolower(static_cast<unsigned char>(*b))) {
+            return false;
+        }
+    }
+    return *a == *b;
+}
+
+SimdLevel selectSimdLevel() {
+    SimdLevel supported = detectSimdLevel();
+    const char* requested = std::getenv("CGAME_SIMD");
+    if (!requested || !*requested) return supported;
+
+    for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2 }) {
+        if (!equalsIgnoringCase(requested, getSimdLevelName(level))) continue;
+        if (level > supported) {
+            std::cerr << "CGAME_SIMD=" << requested << " isn't supported here; using "
+                      << getSimdLevelName(supported) << std::endl;
+            return supported;
+        }
+        return level;
+    }
+    std::cerr << "Ignoring CGAME_SIMD=" << requested << "; expected scalar, sse2 or avx2" << std::endl;
+    return supported;
+}
+
+} // namespace
+
+SimdLevel getSimdLevel() {
+    static const SimdLevel level = selectSimdLevel();
+    return level;
+}
+
+const char* getSimdLevelName(SimdLevel level) {
+    switch (level) {
+    case SimdLevel::Scalar: return "scalar";
+    case SimdLevel::SSE2: return "SSE2";
+    case SimdLevel::AVX2: return "AVX2";
+    }
+    return "unknown";
+}
@@ -0,0 +1,227 @@
+#include "DescriptorManager.h"
+#include "TaskGraph.h"
+#include <algorithm>
+#include <array>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+constexpr vk::ShaderStageFlags ALL_STAGES =
+    vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment | vk::ShaderStageFlagBits::eCompute;
+
+} // namespace
+
+DescriptorManager::DescriptorManager() {
+}
+
+DescriptorManager::~DescriptorManager() {
+    cleanup();
+}
+
+bool DescriptorManager::initialize(vk::Device device, vk::PhysicalDevice physicalDevice, uint32_t framesInFlight) {
+    m_device = device;
+    m_framesInFlight = framesInFlight;
+
+    if (!createSamplers()) return false;
+    if (!createBindlessSet(physicalDevice)) return false;
+
+    TaskGraph::note("Descriptors: " + std::to_string(m_textureCapacity) + " texture / " +
+                    std::to_string(m_bufferCapacity) + " buffer bindless slots");
+
+    m_initialized = true;
+    return true;
+}
+
+void DescriptorManager::cleanup() {
+    if (!m_initialized) return;
+
+    m_device.destroyDescriptorPool(m_bindlessPool);
+    m_device.destroyDescriptorSetLayout(m_bindlessLayout);
+    for (auto sampler : m_samplers) {
+        m_device.destroySampler(sampler);
+    }
+
+    m_freeTextures.clear();
+    m_freeBuffers.clear();
+    m_pendingReleases.clear();
+    m_nextTexture = 0;
+    m_nextBuffer = 0;
+
+    m_initialized = false;
+}
+
+void DescriptorManager::beginFrame(uint64_t frameNumber) {
+    m_frameNumber = frameNumber;
+
+    std::lock_guard<std::mutex> lock(m_slotMutex);
+    auto ready = std::partition(m_pendingReleases.begin(), m_pendingReleases.end(),
+        [this](const PendingRelease& release) {
+            return release.frameNumber + m_framesInFlight > m_frameNumber;
+        });
+    for (auto it = ready; it != m_pendingReleases.end(); ++it) {
+        (it->isTexture ? m_freeTextures : m_freeBuffers).push_back(it->index);
+    }
+    m_pendingReleases.erase(ready, m_pendingReleases.end());
+}
+
+uint32_t DescriptorManager::registerTexture(vk::ImageView view, SamplerType sampler) {
+    // Slots are registered from loading threads as well as the render thread;
+    // the lock also covers the write to the shared set
+    std::lock_guard<std::mutex> lock(m_slotMutex);
+    uint32_t index;
+    if (!m_freeTextures.empty()) {
+        index = m_freeTextures.back();
+        m_freeTextures.pop_back();
+    } else if (m_nextTexture < m_textureCapacity) {
+        index = m_nextTexture++;
+    } else {
+        throw std::runtime_error("Out of bindless texture slots");
+    }
+
+    vk::DescriptorImageInfo imageInfo{};
+    imageInfo.sampler = getSampler(sampler);
+    imageInfo.imageView = view;
+    imageInfo.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+
+    vk::WriteDescriptorSet write{};
+    write.dstSet = m_bindlessSet;
+    write.dstBinding = 0;
+    write.dstArrayElement = index;
+    write.descriptorCount = 1;
+    write.descriptorType = vk::DescriptorType::eCombinedImageSampler;
+    write.pImageInfo = &imageInfo;
+    m_device.updateDescriptorSets(1, &write, 0, nullptr);
+
+    return index;
+}
+
+uint32_t DescriptorManager::registerBuffer(vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize range) {
+    // Slots are registered from loading threads as well as the render thread;
+    // the lock also covers the write to the shared set
+    std::lock_guard<std::mutex> lock(m_slotMutex);
+    uint32_t index;
+    if (!m_freeBuffers.empty()) {
+        index = m_freeBuffers.back();
+        m_freeBuffers.pop_back();
+    } else if (m_nextBuffer < m_bufferCapacity) {
+        index = m_nextBuffer++;
+    } else {
+        throw std::runtime_error("Out of bindless buffer slots");
+    }
+
+    vk::DescriptorBufferInfo bufferInfo{};
+    bufferInfo.buffer = buffer;
+    bufferInfo.offset = offset;
+    bufferInfo.range = range;
+
+    vk::WriteDescriptorSet write{};
+    write.dstSet = m_bindlessSet;
+    write.dstBinding = 1;
+    write.dstArrayElement = index;
+    write.descriptorCount = 1;
+    write.descriptorType = vk::DescriptorType::eStorageBuffer;
+    write.pBufferInfo = &bufferInfo;
+    m_device.updateDescriptorSets(1, &write, 0, nullptr);
+
+    return index;
+}
+
+void DescriptorManager::releaseTexture(uint32_t index) {
+    if (index == INVALID_BINDLESS_INDEX) return;
+    std::lock_guard<std::mutex> lock(m_slotMutex);
+    m_pendingReleases.push_back({ index, true, m_frameNumber });
+}
+
+void DescriptorManager::releaseBuffer(uint32_t index) {
+    if (index == INVALID_BINDLESS_INDEX) return;
+    std::lock_guard<std::mutex> lock(m_slotMutex);
+    m_pendingReleases.push_back({ index, false, m_frameNumber });
+}
+
+void DescriptorManager::bindGlobalSets(vk::CommandBuffer commandBuffer, vk::PipelineBindPoint bindPoint,
+                                       vk::PipelineLayout layout) const {
+    commandBuffer.bindDescriptorSets(bindPoint, layout, 0, 1, &m_bindlessSet, 0, nullptr);
+}
+
+bool DescriptorManager::createSamplers() {
+    vk::SamplerCreateInfo samplerInfo{};
+    samplerInfo.addressModeU = vk::SamplerAddressMode::eClampToEdge;
+    samplerInfo.addressModeV = vk::SamplerAddressMode::eClampToEdge;
+    samplerInfo.addressModeW = vk::SamplerAddressMode::eClampToEdge;
+    samplerInfo.mipmapMode = vk::SamplerMipmapMode::eLinear;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+    samplerInfo.magFilter = vk::Filter::eLinear;
+    samplerInfo.minFilter = vk::Filter::eLinear;
+    m_samplers[static_cast<size_t>(SamplerType::Linear)] = m_device.createSampler(samplerInfo);
+
+    samplerInfo.magFilter = vk::Filter::eNearest;
+    samplerInfo.minFilter = vk::Filter::eNearest;
+    samplerInfo.mipmapMode = vk::SamplerMipmapMode::eNearest;
+    m_samplers[static_cast<size_t>(SamplerType::Nearest)] = m_device.createSampler(samplerInfo);
+
+    return true;
+}
+
+bool DescriptorManager::createBindlessSet(vk::PhysicalDevice physicalDevice) {
+    auto properties = physicalDevice.getProperties2<vk::PhysicalDeviceProperties2,
+                                                    vk::PhysicalDeviceDescriptorIndexingProperties>();
+    const auto& indexing = properties.get<vk::PhysicalDeviceDescriptorIndexingProperties>();
+    m_textureCapacity = std::min(MAX_BINDLESS_TEXTURES, std::min(
+        indexing.maxDescriptorSetUpdateAfterBindSampledImages,
+        indexing.maxPerStageDescriptorUpdateAfterBindSampledImages));
+    m_bufferCapacity = std::min(MAX_BINDLESS_BUFFERS, std::min(
+        indexing.maxDescriptorSetUpdateAfterBindStorageBuffers,
+        indexing.maxPerStageDescriptorUpdateAfterBindStorageBuffers));
+
+    std::array<vk::DescriptorSetLayoutBinding, 2> bindings{};
+    bindings[0].binding = 0;
+    bindings[0].descriptorType = vk::DescriptorType::eCombinedImageSampler;
+    bindings[0].descriptorCount = m_textureCapacity;
+    bindings[0].stageFlags = ALL_STAGES;
+    bindings[1].binding = 1;
+    bindings[1].descriptorType = vk::DescriptorType::eStorageBuffer;
+    bindings[1].descriptorCount = m_bufferCapacity;
+    bindings[1].stageFlags = ALL_STAGES;
+
+    // Slots are written while other frames are in flight and unused slots
+    // are never initialized
+    vk::DescriptorBindingFlags bindingFlag = vk::DescriptorBindingFlagBits::ePartiallyBound |
+                                             vk::DescriptorBindingFlagBits::eUpdateAfterBind |
+                                             vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending;
+    std::array<vk::DescriptorBindingFlags, 2> bindingFlags = { bindingFlag, bindingFlag };
+
+    vk::DescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+    bindingFlagsInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+    bindingFlagsInfo.pBindingFlags = bindingFlags.data();
+
+    vk::DescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.pNext = &bindingFlagsInfo;
+    layoutInfo.flags = vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+    m_bindlessLayout = m_device.createDescriptorSetLayout(layoutInfo);
+
+    std::array<vk::DescriptorPoolSize, 2> poolSizes{};
+    poolSizes[0].type = vk::DescriptorType::eCombinedImageSampler;
+    poolSizes[0].descriptorCount = m_textureCapacity;
+    poolSizes[1].type = vk::DescriptorType::eStorageBuffer;
+    poolSizes[1].descriptorCount = m_bufferCapacity;
+
+    vk::DescriptorPoolCreateInfo poolInfo{};
+    poolInfo.flags = vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    m_bindlessPool = m_device.createDescriptorPool(poolInfo);
+
+    vk::DescriptorSetAllocateInfo allocInfo{};
+    allocInfo.descriptorPool = m_bindlessPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &m_bindlessLayout;
+    m_bindlessSet = m_device.allocateDescriptorSets(allocInfo)[0];
+
+    return true;
+}
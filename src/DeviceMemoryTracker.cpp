@@ -0,0 +1,360 @@
+#include "DeviceMemoryTracker.h"
+#include "AllocationTracker.h"
+#include <algorithm>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+    constexpr double MEGABYTE = 1024.0 * 1024.0;
+
+    int countBits(vk::MemoryPropertyFlags flags) {
+        int count = 0;
+        for (auto bits = static_cast<VkMemoryPropertyFlags>(flags); bits != 0; bits &= bits - 1) {
+            count++;
+        }
+        return count;
+    }
+
+    // Preferred flags count for more than extra flags count against, so a
+    // preferred type always wins over a plain one. Extra flags are penalized
+    // so e.g. staging buffers stay out of the small device-local,
+    // host-visible heap
+    int scoreMemoryType(vk::MemoryPropertyFlags flags, vk::MemoryPropertyFlags required,
+                        vk::MemoryPropertyFlags preferred) {
+        return 4 * countBits(flags & preferred) - countBits(flags & ~(required | preferred));
+    }
+
+    // Qualifying types, best first. Returns how many were written
+    uint32_t rankMemoryTypes(const vk::PhysicalDeviceMemoryProperties& memProperties, uint32_t typeFilter,
+                             vk::MemoryPropertyFlags required, vk::MemoryPropertyFlags preferred,
+                             std::array<uint32_t, VK_MAX_MEMORY_TYPES>& ranked) {
+        uint32_t count = 0;
+        for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+            if ((typeFilter & (1u << i)) && (memProperties.memoryTypes[i].propertyFlags & required) == required) {
+                ranked[count++] = i;
+            }
+        }
+        std::stable_sort(ranked.begin(), ranked.begin() + count, [&](uint32_t a, uint32_t b) {
+            return scoreMemoryType(memProperties.memoryTypes[a].propertyFlags, required, preferred) >
+                   scoreMemoryType(memProperties.memoryTypes[b].propertyFlags, required, preferred);
+        });
+        return count;
+    }
+}
+
+const char* getMemoryCategoryName(MemoryCategory category) {
+    switch (category) {
+        case MemoryCategory::Vertex:        return "vertex";
+        case MemoryCategory::Index:         return "index";
+        case MemoryCategory::Uniform:       return "uniform";
+        case MemoryCategory::Storage:       return "storage";
+        case MemoryCategory::Staging:       return "staging";
+        case MemoryCategory::RenderTarget:  return "render target";
+        case MemoryCategory::Texture:       return "texture";
+        default:                            return "other";
+    }
+}
+
+MemoryCategory getMemoryCategory(vk::BufferUsageFlags usage) {
+    if (usage & vk::BufferUsageFlagBits::eVertexBuffer) return MemoryCategory::Vertex;
+    if (usage & vk::BufferUsageFlagBits::eIndexBuffer) return MemoryCategory::Index;
+    if (usage & vk::BufferUsageFlagBits::eUniformBuffer) return MemoryCategory::Uniform;
+    if (usage & vk::BufferUsageFlagBits::eStorageBuffer) return MemoryCategory::Storage;
+    if (usage & vk::BufferUsageFlagBits::eTransferSrc) return MemoryCategory::Staging;
+    return MemoryCategory::Other;
+}
+
+DeviceMemoryTracker::DeviceMemoryTracker() {
+}
+
+DeviceMemoryTracker::~DeviceMemoryTracker() {
+    cleanup();
+}
+
+bool DeviceMemoryTracker::initialize(vk::Device device, vk::PhysicalDevice physicalDevice, bool budgetExtension) {
+    m_device = device;
+    m_physicalDevice = physicalDevice;
+    m_memoryProperties = physicalDevice.getMemoryProperties();
+    m_budgetExtension = budgetExtension;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_heaps.assign(m_memoryProperties.memoryHeapCount, Heap{});
+    readBudgetLocked();
+    m_initialized = true;
+    return true;
+}
+
+void DeviceMemoryTracker::cleanup() {
+    if (!m_initialized) return;
+
+    if (reportLeaks(std::cerr) == 0) {
+        std::cout << "No device memory leaks" << std::endl;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_allocations.clear();
+    m_heaps.clear();
+    m_categoryBytes.fill(0);
+    m_callbacks.clear();
+    m_initialized = false;
+}
+
+uint32_t DeviceMemoryTracker::findMemoryType(const vk::PhysicalDeviceMemoryProperties& memProperties,
+                                             uint32_t typeFilter, vk::MemoryPropertyFlags required,
+                                             vk::MemoryPropertyFlags preferred) {
+    std::array<uint32_t, VK_MAX_MEMORY_TYPES> ranked;
+    if (rankMemoryTypes(memProperties, typeFilter, required, preferred, ranked) == 0) {
+        throw std::runtime_error("Failed to find suitable memory type");
+    }
+    return ranked[0];
+}
+
+uint32_t DeviceMemoryTracker::findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags required,
+                                             vk::MemoryPropertyFlags preferred) const {
+    return findMemoryType(m_memoryProperties, typeFilter, required, preferred);
+}
+
+vk::DeviceMemory DeviceMemoryTracker::allocate(const vk::MemoryRequirements& requirements,
+                                               vk::MemoryPropertyFlags required, MemoryCategory category,
+                                               const std::string& name, vk::MemoryPropertyFlags preferred) {
+    // Recording the allocation touches the heap; memory changes are expected
+    // to settle before frames count as steady
+    AllocationTracker::markUnsteady();
+
+    std::array<uint32_t, VK_MAX_MEMORY_TYPES> ranked;
+    uint32_t count = rankMemoryTypes(m_memoryProperties, requirements.memoryTypeBits, required, preferred, ranked);
+    if (count == 0) {
+        throw std::runtime_error("Failed to find suitable memory type for " + name);
+    }
+
+    // Try a type whose heap stays within budget first; the driver may still
+    // satisfy the others, so they remain as fallbacks
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (uint32_t i = 0; i < count; i++) {
+            const Heap& heap = m_heaps[m_memoryProperties.memoryTypes[ranked[i]].heapIndex];
+            if (estimatedUsageLocked(heap) + requirements.size <= heap.budget) {
+                std::rotate(ranked.begin(), ranked.begin() + i, ranked.begin() + i + 1);
+                break;
+            }
+        }
+    }
+
+    std::exception_ptr failure;
+    for (uint32_t i = 0; i < count; i++) {
+        vk::MemoryAllocateInfo allocInfo{};
+        allocInfo.allocationSize = requirements.size;
+        allocInfo.memoryTypeIndex = ranked[i];
+
+        vk::DeviceMemory memory;
+        try {
+            memory = m_device.allocateMemory(allocInfo);
+        } catch (const vk::OutOfDeviceMemoryError&) {
+            failure = std::current_exception();
+            continue;
+        } catch (const vk::OutOfHostMemoryError&) {
+            failure = std::current_exception();
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Allocation allocation;
+        allocation.size = requirements.size;
+        allocation.memoryType = ranked[i];
+        allocation.category = category;
+        allocation.name = name;
+        allocation.sequence = m_sequence++;
+        m_allocations.emplace(static_cast<VkDeviceMemory>(memory), allocation);
+
+        Heap& heap = m_heaps[m_memoryProperties.memoryTypes[ranked[i]].heapIndex];
+        heap.tracked += requirements.size;
+        heap.allocationCount++;
+        m_categoryBytes[static_cast<size_t>(category)] += requirements.size;
+        return memory;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::cerr << "Out of memory allocating " << std::fixed << std::setprecision(1)
+                  << requirements.size / MEGABYTE << " MB for " << name
+                  << " (" << getMemoryCategoryName(category) << ")" << std::defaultfloat << std::endl;
+        printReportLocked(std::cerr);
+    }
+    std::rethrow_exception(failure);
+}
+
+void DeviceMemoryTracker::free(vk::DeviceMemory memory) {
+    if (!memory) return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_allocations.find(static_cast<VkDeviceMemory>(memory));
+        if (it != m_allocations.end()) {
+            const Allocation& allocation = it->second;
+            Heap& heap = m_heaps[m_memoryProperties.memoryTypes[allocation.memoryType].heapIndex];
+            heap.tracked -= allocation.size;
+            heap.allocationCount--;
+            m_categoryBytes[static_cast<size_t>(allocation.category)] -= allocation.size;
+            m_allocations.erase(it);
+        }
+    }
+    m_device.freeMemory(memory);
+}
+
+void DeviceMemoryTracker::updateBudget() {
+    std::vector<MemoryBudgetEvent> events;
+    std::vector<BudgetCallback> callbacks;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_initialized) return;
+        readBudgetLocked();
+
+        for (uint32_t i = 0; i < m_heaps.size(); i++) {
+            Heap& heap = m_heaps[i];
+            if (heap.budget == 0) continue;
+
+            vk::DeviceSize usage = estimatedUsageLocked(heap);
+            double fraction = static_cast<double>(usage) / static_cast<double>(heap.budget);
+            bool crossedUp = !heap.nearBudget && fraction >= BUDGET_WARNING_FRACTION;
+            bool crossedDown = heap.nearBudget && fraction < BUDGET_WARNING_FRACTION - BUDGET_HYSTERESIS;
+            if (crossedUp || crossedDown) {
+                heap.nearBudget = crossedUp;
+                events.push_back({ i, usage, heap.budget, crossedUp });
+            }
+        }
+        if (!events.empty()) {
+            AllocationTracker::markUnsteady();
+            callbacks = m_callbacks;
+        }
+    }
+
+    for (const auto& event : events) {
+        for (const auto& callback : callbacks) {
+            callback(event);
+        }
+    }
+}
+
+void DeviceMemoryTracker::addBudgetCallback(BudgetCallback callback) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_callbacks.push_back(std::move(callback));
+}
+
+vk::DeviceSize DeviceMemoryTracker::getCategoryBytes(MemoryCategory category) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_categoryBytes[static_cast<size_t>(category)];
+}
+
+vk::DeviceSize DeviceMemoryTracker::getTotalBytes() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    vk::DeviceSize total = 0;
+    for (vk::DeviceSize bytes : m_categoryBytes) {
+        total += bytes;
+    }
+    return total;
+}
+
+uint32_t DeviceMemoryTracker::getHeapCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return static_cast<uint32_t>(m_heaps.size());
+}
+
+MemoryHeapStats DeviceMemoryTracker::getHeapStats(uint32_t heapIndex) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    MemoryHeapStats stats;
+    if (heapIndex >= m_heaps.size()) return stats;
+
+    const Heap& heap = m_heaps[heapIndex];
+    stats.size = m_memoryProperties.memoryHeaps[heapIndex].size;
+    stats.budget = heap.budget;
+    stats.usage = estimatedUsageLocked(heap);
+    stats.tracked = heap.tracked;
+    stats.allocationCount = heap.allocationCount;
+    stats.deviceLocal = static_cast<bool>(m_memoryProperties.memoryHeaps[heapIndex].flags &
+                                          vk::MemoryHeapFlagBits::eDeviceLocal);
+    return stats;
+}
+
+void DeviceMemoryTracker::printReport(std::ostream& out) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    printReportLocked(out);
+}
+
+size_t DeviceMemoryTracker::reportLeaks(std::ostream& out) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_allocations.empty()) return 0;
+
+    std::vector<const Allocation*> leaks;
+    vk::DeviceSize total = 0;
+    for (const auto& entry : m_allocations) {
+        leaks.push_back(&entry.second);
+        total += entry.second.size;
+    }
+    std::sort(leaks.begin(), leaks.end(), [](const Allocation* a, const Allocation* b) {
+        return a->sequence < b->sequence;
+    });
+
+    out << "Device memory leaks: " << leaks.size() << " allocations, " << std::fixed << std::setprecision(2)
+        << total / MEGABYTE << " MB" << std::endl;
+    for (const Allocation* leak : leaks) {
+        out << "  #" << leak->sequence << " " << std::left << std::setw(14) << getMemoryCategoryName(leak->category)
+            << std::right << std::setw(10) << leak->size / MEGABYTE << " MB  type " << leak->memoryType
+            << "  " << leak->name << std::endl;
+    }
+    out << std::defaultfloat;
+    return leaks.size();
+}
+
+vk::DeviceSize DeviceMemoryTracker::estimatedUsageLocked(const Heap& heap) const {
+    if (!m_budgetExtension) return heap.tracked;
+
+    // The driver's figure is only refreshed once a frame; allocations since
+    // then are added on top
+    if (heap.tracked >= heap.trackedAtUpdate) {
+        return heap.driverUsage + (heap.tracked - heap.trackedAtUpdate);
+    }
+    vk::DeviceSize freed = heap.trackedAtUpdate - heap.tracked;
+    return heap.driverUsage > freed ? heap.driverUsage - freed : 0;
+}
+
+void DeviceMemoryTracker::readBudgetLocked() {
+    if (!m_budgetExtension) {
+        for (size_t i = 0; i < m_heaps.size(); i++) {
+            m_heaps[i].budget = m_memoryProperties.memoryHeaps[i].size;
+        }
+        return;
+    }
+
+    auto properties = m_physicalDevice.getMemoryProperties2<vk::PhysicalDeviceMemoryProperties2,
+                                                            vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+    const auto& budget = properties.get<vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+    for (size_t i = 0; i < m_heaps.size(); i++) {
+        Heap& heap = m_heaps[i];
+        heap.budget = budget.heapBudget[i] != 0 ? budget.heapBudget[i] : m_memoryProperties.memoryHeaps[i].size;
+        heap.driverUsage = budget.heapUsage[i];
+        heap.trackedAtUpdate = heap.tracked;
+    }
+}
+
+void DeviceMemoryTracker::printReportLocked(std::ostream& out) const {
+    out << "Device memory (" << (m_budgetExtension ? "driver budget" : "heap size as budget") << "):" << std::endl;
+    out << std::fixed << std::setprecision(1);
+    for (size_t i = 0; i < m_heaps.size(); i++) {
+        const Heap& heap = m_heaps[i];
+        bool deviceLocal = static_cast<bool>(m_memoryProperties.memoryHeaps[i].flags &
+                                             vk::MemoryHeapFlagBits::eDeviceLocal);
+        out << "  heap " << i << (deviceLocal ? " device " : " host   ")
+            << std::setw(9) << estimatedUsageLocked(heap) / MEGABYTE << " / "
+            << std::setw(9) << heap.budget / MEGABYTE << " MB used, "
+            << std::setw(9) << heap.tracked / MEGABYTE << " MB in "
+            << heap.allocationCount << " tracked allocations" << std::endl;
+    }
+    for (size_t i = 0; i < m_categoryBytes.size(); i++) {
+        if (m_categoryBytes[i] == 0) continue;
+        out << "  " << std::left << std::setw(14) << getMemoryCategoryName(static_cast<MemoryCategory>(i))
+            << std::right << std::setw(9) << m_categoryBytes[i] / MEGABYTE << " MB" << std::endl;
+    }
+    out << std::defaultfloat;
+}
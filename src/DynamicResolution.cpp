@@ -0,0 +1,74 @@
+#include "DynamicResolution.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+float quantizeScale(float scale) {
+    return std::round(scale / DynamicResolution::SCALE_STEP) * DynamicResolution::SCALE_STEP;
+}
+
+} // namespace
+
+void DynamicResolution::setSettings(const DynamicResolutionSettings& settings) {
+    m_settings = settings;
+    m_settings.maxScale = std::max(m_settings.maxScale, m_settings.minScale);
+    m_settings.interval = std::max(m_settings.interval, 1u);
+    if (!isFixed()) {
+        m_scale = std::clamp(m_scale, m_settings.minScale, m_settings.maxScale);
+    }
+    restart();
+}
+
+void DynamicResolution::setFixedScale(float scale) {
+    m_fixedScale = scale > 0.0f ? std::clamp(scale, SCALE_STEP, 1.0f) : 0.0f;
+    m_scale = isFixed() ? m_fixedScale : m_settings.maxScale;
+    restart();
+}
+
+bool DynamicResolution::addFrame(float gpuMs) {
+    if (isFixed() || gpuMs <= 0.0f) return false;
+    if (m_settleFrames > 0) {
+        m_settleFrames--;
+        return false;
+    }
+
+    m_sumMs += gpuMs;
+    if (++m_samples < m_settings.interval) return false;
+    float averageMs = m_sumMs / m_samples;
+    m_sumMs = 0.0f;
+    m_samples = 0;
+
+    // Aim between the headroom line and the target, so the new scale lands
+    // inside the band where nothing changes
+    float target = m_settings.targetGpuMs;
+    float goal = target * (1.0f + HEADROOM) * 0.5f;
+    float ideal = m_scale * std::sqrt(goal / averageMs);
+    float next = m_scale;
+    if (averageMs > target) {
+        // At least one step, even if rounding would undo a small change
+        next = std::min(quantizeScale(std::max(ideal, m_scale - MAX_STEP_DOWN)), m_scale - SCALE_STEP);
+    } else if (averageMs < target * HEADROOM) {
+        next = std::max(quantizeScale(std::min(ideal, m_scale + MAX_STEP_UP)), m_scale + SCALE_STEP);
+    }
+    next = std::clamp(next, m_settings.minScale, m_settings.maxScale);
+    if (next == m_scale) return false;
+
+    m_scale = next;
+    m_settleFrames = SETTLE_FRAMES;
+    return true;
+}
+
+vk::Extent2D DynamicResolution::getRenderExtent(vk::Extent2D output) const {
+    auto scaled = [this](uint32_t size) {
+        return std::max(1u, static_cast<uint32_t>(std::lround(size * m_scale)));
+    };
+    return vk::Extent2D{ std::min(scaled(output.width), output.width),
+                         std::min(scaled(output.height), output.height) };
+}
+
+void DynamicResolution::restart() {
+    m_sumMs = 0.0f;
+    m_samples = 0;
+    m_settleFrames = SETTLE_FRAMES;
+}
@@ -0,0 +1,66 @@
+#include "FrameArena.h"
+#include "AllocationTracker.h"
+#include <algorithm>
+#include <cstdint>
+
+FrameArena::FrameArena(size_t capacity)
+    : m_block(new unsigned char[capacity]), m_capacity(capacity) {
+}
+
+FrameArena::~FrameArena() {
+}
+
+void* FrameArena::bump(unsigned char* base, size_t capacity, size_t& offset, size_t size, size_t alignment) {
+    uintptr_t address = reinterpret_cast<uintptr_t>(base) + offset;
+    uintptr_t aligned = (address + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+    size_t start = offset + static_cast<size_t>(aligned - address);
+    if (start > capacity || size > capacity - start) return nullptr;
+
+    offset = start + size;
+    return base + start;
+}
+
+void* FrameArena::allocate(size_t size, size_t alignment) {
+    if (void* memory = bump(m_block.get(), m_capacity, m_offset, size, alignment)) {
+        return memory;
+    }
+
+    if (!m_overflow.empty()) {
+        Block& block = m_overflow.back();
+        size_t before = block.offset;
+        if (void* memory = bump(block.data.get(), block.capacity, block.offset, size, alignment)) {
+            m_overflowBytes += block.offset - before;
+            return memory;
+        }
+    }
+
+    // Spilling means this frame allocates from the heap; reset() sizes the
+    // block so the next frame doesn't
+    AllocationTracker::markUnsteady();
+    Block block;
+    block.capacity = std::max(size + alignment, m_capacity / 2);
+    block.data.reset(new unsigned char[block.capacity]);
+    void* memory = bump(block.data.get(), block.capacity, block.offset, size, alignment);
+    m_overflowBytes += block.offset;
+    m_overflowCount++;
+    m_overflow.push_back(std::move(block));
+    return memory;
+}
+
+void FrameArena::reset() {
+    size_t used = getUsedBytes();
+    m_peakBytes = std::max(m_peakBytes, used);
+
+    if (!m_overflow.empty()) {
+        // Headroom so a slowly growing workload doesn't spill every frame
+        size_t capacity = m_capacity;
+        while (capacity < used + used / 4) {
+            capacity *= 2;
+        }
+        m_block.reset(new unsigned char[capacity]);
+        m_capacity = capacity;
+        m_overflow.clear();
+        m_overflowBytes = 0;
+    }
+    m_offset = 0;
+}
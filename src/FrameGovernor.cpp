@@ -0,0 +1,53 @@
+#include "FrameGovernor.h"
+#include "Window.h"
+#include <iostream>
+
+const char* getPowerStateName(PowerState state) {
+    switch (state) {
+        case PowerState::Active:        return "active";
+        case PowerState::Background:    return "background";
+        case PowerState::Paused:        return "paused";
+        default:                        return "unknown";
+    }
+}
+
+bool FrameGovernor::waitForFrame(Window& window) {
+    while (true) {
+        if (window.shouldClose()) return false;
+
+        PowerState state = classify(window);
+        if (state != m_state) {
+            std::cout << "Rendering " << getPowerStateName(state) << std::endl;
+            m_state = state;
+        }
+
+        if (state == PowerState::Paused) {
+            window.waitEvents(PAUSED_WAIT_SECONDS);
+            continue;
+        }
+
+        float fps = state == PowerState::Active ? m_settings.activeFps : m_settings.backgroundFps;
+        Clock::time_point now = Clock::now();
+        if (fps > 0.0f) {
+            auto due = m_lastFrame + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / fps));
+            if (now < due) {
+                // An event may change the state, e.g. focus coming back, so
+                // the wait is re-evaluated rather than finished
+                window.waitEvents(std::chrono::duration<double>(due - now).count());
+                continue;
+            }
+        }
+
+        window.pollEvents();
+        m_lastFrame = now;
+        return !window.shouldClose();
+    }
+}
+
+PowerState FrameGovernor::classify(const Window& window) const {
+    if (window.isIconified() || !window.hasFramebufferArea()) return PowerState::Paused;
+    if (window.isFocused()) return PowerState::Active;
+    // Only asked when unfocused; a hidden window is never focused
+    if (!window.isVisible() || m_settings.backgroundFps <= 0.0f) return PowerState::Paused;
+    return PowerState::Background;
+}
@@ -0,0 +1,311 @@
+#include "FrameReadback.h"
+#include "VulkanRenderer.h"
+#include "AllocationTracker.h"
+#include "ImageWriter.h"
+#include "TaskGraph.h"
+#include <iostream>
+#include <utility>
+
+namespace {
+
+// Most callbacks per frame: the stream plus a few one-shot requests. More
+// still work; the slot's list just grows
+constexpr size_t EXPECTED_CALLBACKS = 4;
+
+} // namespace
+
+FrameReadback::FrameReadback() {
+}
+
+FrameReadback::~FrameReadback() {
+    cleanup();
+}
+
+bool FrameReadback::initialize(VulkanRenderer& renderer, vk::Format format) {
+    switch (format) {
+        case vk::Format::eR8G8B8A8Unorm:
+        case vk::Format::eR8G8B8A8Srgb:
+            m_swapRedBlue = false;
+            break;
+        case vk::Format::eB8G8R8A8Unorm:
+        case vk::Format::eB8G8R8A8Srgb:
+            m_swapRedBlue = true;
+            break;
+        default:
+            TaskGraph::note("Frame readback needs an 8-bit RGBA or BGRA swap chain");
+            return false;
+    }
+
+    m_renderer = &renderer;
+    m_device = renderer.getDevice();
+
+    // Buffers are allocated on first use, at the size of the image copied
+    m_slots.resize(RING_SIZE);
+    for (auto& slot : m_slots) {
+        slot.callbacks.reserve(EXPECTED_CALLBACKS);
+    }
+    m_requests.reserve(EXPECTED_CALLBACKS);
+    m_queue.reserve(RING_SIZE);
+
+    m_stopping = false;
+    m_thread = std::thread(&FrameReadback::threadMain, this);
+    m_initialized = true;
+    return true;
+}
+
+void FrameReadback::cleanup() {
+    if (!m_initialized) return;
+
+    // The renderer waits for the GPU first, so every copy can be delivered
+    m_requests.clear();
+    m_stream.reset();
+    flush();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_workAvailable.notify_all();
+    m_thread.join();
+
+    for (auto& slot : m_slots) {
+        releaseBuffer(slot);
+    }
+    m_slots.clear();
+    m_initialized = false;
+}
+
+void FrameReadback::capture(ReadbackCallback callback) {
+    if (!m_initialized || !callback) return;
+    AllocationTracker::markUnsteady();
+    m_requests.push_back(std::make_shared<ReadbackCallback>(std::move(callback)));
+}
+
+void FrameReadback::setStream(ReadbackCallback callback) {
+    AllocationTracker::markUnsteady();
+    m_stream = callback && m_initialized ? std::make_shared<ReadbackCallback>(std::move(callback)) : nullptr;
+}
+
+void FrameReadback::saveScreenshot(const std::string& path) {
+    capture([path](const ReadbackImage& image) {
+        if (writePng(path, image.pixels, image.width, image.height)) {
+            std::cout << "Saved screenshot " << path << " (frame " << image.frameNumber << ")" << std::endl;
+        }
+    });
+}
+
+bool FrameReadback::startRecording(const std::string& path) {
+    if (!m_initialized) {
+        std::cerr << "Can't record frames: frame readback is unavailable" << std::endl;
+        return false;
+    }
+    stopRecording();
+
+    // The writer lives as long as a copy still refers to the callback, so
+    // it closes after the last frame recorded is written
+    auto writer = std::make_shared<RawFrameWriter>();
+    if (!writer->open(path)) return false;
+    setStream([writer](const ReadbackImage& image) {
+        writer->write(image.pixels, image.width, image.height);
+    });
+    m_droppedAtRecordStart = getStats().dropped;
+    std::cout << "Recording frames to " << path << std::endl;
+    return true;
+}
+
+void FrameReadback::stopRecording() {
+    if (!m_stream) return;
+    setStream(nullptr);
+    uint64_t dropped = getStats().dropped - m_droppedAtRecordStart;
+    if (dropped > 0) {
+        std::cout << "Recording dropped " << dropped << " frames while every readback slot was busy" << std::endl;
+    }
+}
+
+void FrameReadback::beginFrame(uint32_t frameIndex) {
+    if (!m_initialized) return;
+
+    bool queued = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (uint32_t i = 0; i < m_slots.size(); i++) {
+            Slot& slot = m_slots[i];
+            if (slot.state == SlotState::Copying && slot.frameIndex == frameIndex) {
+                slot.state = SlotState::Queued;
+                m_queue.push_back(i);
+                queued = true;
+            }
+        }
+    }
+    if (queued) m_workAvailable.notify_one();
+}
+
+void FrameReadback::declareCopy(RenderGraph& graph, RGResource image, vk::Extent2D extent,
+                                uint32_t frameIndex, uint64_t frameNumber) {
+    if (!m_initialized || (m_requests.empty() && !m_stream)) return;
+
+    uint32_t index = RING_SIZE;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (uint32_t i = 0; i < m_slots.size(); i++) {
+            if (m_slots[i].state == SlotState::Free) {
+                index = i;
+                m_slots[i].state = SlotState::Copying;
+                break;
+            }
+        }
+        if (index == RING_SIZE) {
+            // One-shot requests wait for the next frame; streamed frames
+            // are lost
+            m_stats.dropped++;
+            return;
+        }
+    }
+
+    // Free slots belong to this thread, and the GPU is done with them
+    Slot& slot = m_slots[index];
+    vk::DeviceSize size = static_cast<vk::DeviceSize>(extent.width) * extent.height * 4;
+    if (!ensureCapacity(slot, size)) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        slot.state = SlotState::Free;
+        m_stats.dropped++;
+        return;
+    }
+    slot.frameIndex = frameIndex;
+    slot.frameNumber = frameNumber;
+    slot.extent = extent;
+    for (auto& request : m_requests) {
+        slot.callbacks.push_back(std::move(request));
+    }
+    m_requests.clear();
+    if (m_stream) slot.callbacks.push_back(m_stream);
+
+    RGResource target = graph.importBuffer("readback", slot.buffer, size, true);
+    graph.addPass("readback", RGPassType::Transfer)
+        .read(image, RGAccess::TransferRead)
+        .write(target, RGAccess::TransferWrite)
+        .execute([image, target, extent](const RGPassContext& context) {
+            vk::BufferImageCopy region{};
+            region.imageSubresource = vk::ImageSubresourceLayers{ vk::ImageAspectFlagBits::eColor, 0, 0, 1 };
+            region.imageExtent = vk::Extent3D{ extent.width, extent.height, 1 };
+            vk::Buffer buffer = context.getBuffer(target);
+            context.commandBuffer.copyImageToBuffer(context.getImage(image), vk::ImageLayout::eTransferSrcOptimal,
+                                                    buffer, 1, &region);
+
+            // The graph only orders device work; the host reads the buffer
+            // after the frame's fence
+            vk::BufferMemoryBarrier barrier{ vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eHostRead,
+                                             VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, buffer, 0, VK_WHOLE_SIZE };
+            context.commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost,
+                                                  {}, 0, nullptr, 1, &barrier, 0, nullptr);
+        });
+}
+
+void FrameReadback::flush() {
+    if (!m_initialized) return;
+
+    // Requests still waiting for a free slot would otherwise catch some
+    // unrelated later frame
+    if (!m_requests.empty()) {
+        std::cout << "Dropped " << m_requests.size() << " capture requests made while every readback slot was busy"
+                  << std::endl;
+        m_requests.clear();
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (uint32_t i = 0; i < m_slots.size(); i++) {
+        if (m_slots[i].state == SlotState::Copying) {
+            m_slots[i].state = SlotState::Queued;
+            m_queue.push_back(i);
+        }
+    }
+    m_workAvailable.notify_one();
+    m_slotFreed.wait(lock, [this] {
+        for (const auto& slot : m_slots) {
+            if (slot.state != SlotState::Free) return false;
+        }
+        return true;
+    });
+}
+
+ReadbackStats FrameReadback::getStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+bool FrameReadback::ensureCapacity(Slot& slot, vk::DeviceSize size) {
+    if (slot.size >= size) return true;
+    releaseBuffer(slot);
+
+    try {
+        vk::BufferCreateInfo bufferInfo{};
+        bufferInfo.size = size;
+        bufferInfo.usage = vk::BufferUsageFlagBits::eTransferDst;
+        bufferInfo.sharingMode = vk::SharingMode::eExclusive;
+        slot.buffer = m_device.createBuffer(bufferInfo);
+
+        // Cached memory makes reading the pixels back fast; without it the
+        // reads go uncached over the bus
+        vk::MemoryRequirements requirements = m_device.getBufferMemoryRequirements(slot.buffer);
+        slot.memory = m_renderer->getMemoryTracker().allocate(requirements, vk::MemoryPropertyFlagBits::eHostVisible,
+                                                              MemoryCategory::Other, "frame readback",
+                                                              vk::MemoryPropertyFlagBits::eHostCached);
+        m_device.bindBufferMemory(slot.buffer, slot.memory, 0);
+        slot.mapped = static_cast<uint8_t*>(m_device.mapMemory(slot.memory, 0, size));
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to allocate a frame readback buffer: " << e.what() << std::endl;
+        releaseBuffer(slot);
+        return false;
+    }
+    slot.size = size;
+    return true;
+}
+
+void FrameReadback::releaseBuffer(Slot& slot) {
+    if (slot.mapped) m_device.unmapMemory(slot.memory);
+    if (slot.buffer) m_device.destroyBuffer(slot.buffer);
+    if (slot.memory) m_renderer->getMemoryTracker().free(slot.memory);
+    slot.mapped = nullptr;
+    slot.buffer = VK_NULL_HANDLE;
+    slot.memory = VK_NULL_HANDLE;
+    slot.size = 0;
+}
+
+void FrameReadback::threadMain() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_workAvailable.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+        if (m_queue.empty()) return;
+        uint32_t index = m_queue.front();
+        m_queue.erase(m_queue.begin());
+        lock.unlock();
+
+        // Queued slots belong to this thread until they are freed
+        Slot& slot = m_slots[index];
+        vk::MappedMemoryRange range{ slot.memory, 0, VK_WHOLE_SIZE };
+        (void)m_device.invalidateMappedMemoryRanges(1, &range);
+
+        size_t pixelCount = static_cast<size_t>(slot.extent.width) * slot.extent.height;
+        if (m_swapRedBlue) {
+            uint8_t* pixel = slot.mapped;
+            for (size_t i = 0; i < pixelCount; i++, pixel += 4) {
+                std::swap(pixel[0], pixel[2]);
+            }
+        }
+
+        ReadbackImage image;
+        image.pixels = slot.mapped;
+        image.width = slot.extent.width;
+        image.height = slot.extent.height;
+        image.frameNumber = slot.frameNumber;
+        for (const auto& callback : slot.callbacks) {
+            (*callback)(image);
+        }
+        // May drop the last reference to a callback, e.g. closing a recording
+        slot.callbacks.clear();
+
+        lock.lock();
+        slot.state = SlotState::Free;
+        m_stats.captured++;
+        m_slotFreed.notify_all();
+    }
+}
@@ -0,0 +1,162 @@
+#include "GameOptions.h"
+#include <cstdlib>
+#include <sstream>
+
+namespace {
+
+bool parseUnsigned(const char* text, uint64_t& value) {
+    char* end = nullptr;
+    unsigned long long parsed = std::strtoull(text, &end, 10);
+    if (end == text || *end != '\0') return false;
+    value = parsed;
+    return true;
+}
+
+} // namespace
+
+bool GameOptions::parse(int argc, char** argv, std::string& error) {
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        auto value = [&](const char*& out) {
+            if (i + 1 >= argc) {
+                error = argument + " needs a value";
+                return false;
+            }
+            out = argv[++i];
+            return true;
+        };
+
+        const char* text = nullptr;
+        uint64_t number = 0;
+        if (argument == "--help" || argument == "-h") {
+            showHelp = true;
+        } else if (argument == "--benchmark") {
+            benchmark.enabled = true;
+            // Optional comma-separated scene list
+            if (i + 1 < argc && argv[i + 1][0] != '-') {
+                std::stringstream list(argv[++i]);
+                std::string name;
+                while (std::getline(list, name, ',')) {
+                    if (name == "all") continue;
+                    if (!createBenchmarkScene(name)) {
+                        error = "Unknown benchmark scene: " + name;
+                        return false;
+                    }
+                    benchmark.scenes.push_back(name);
+                }
+            }
+        } else if (argument == "--seed") {
+            if (!value(text) || !parseUnsigned(text, seed)) {
+                if (error.empty()) error = "--seed needs a number";
+                return false;
+            }
+        } else if (argument == "--warmup" || argument == "--frames") {
+            if (!value(text) || !parseUnsigned(text, number) || number > UINT32_MAX) {
+                if (error.empty()) error = argument + " needs a frame count";
+                return false;
+            }
+            (argument == "--warmup" ? benchmark.warmupFrames : benchmark.measureFrames) = static_cast<uint32_t>(number);
+        } else if (argument == "--input") {
+            if (!value(text)) return false;
+            benchmark.inputPath = text;
+        } else if (argument == "--record-input") {
+            if (!value(text)) return false;
+            benchmark.recordPath = text;
+        } else if (argument == "--live-input") {
+            benchmark.liveInput = true;
+        } else if (argument == "--output") {
+            if (!value(text)) return false;
+            benchmark.outputPath = text;
+        } else if (argument == "--baseline") {
+            if (!value(text)) return false;
+            benchmark.baselinePath = text;
+        } else if (argument == "--tolerance") {
+            if (!value(text)) return false;
+            char* end = nullptr;
+            benchmark.tolerance = std::strtod(text, &end);
+            if (end == text || *end != '\0' || benchmark.tolerance < 0.0) {
+                error = "--tolerance needs a non-negative fraction, e.g. 0.05";
+                return false;
+            }
+        } else if (argument == "--world") {
+            if (!value(text)) return false;
+            worldPath = text;
+        } else if (argument == "--generate-world") {
+            if (!value(text) || !parseUnsigned(text, number) || number == 0 || number > UINT32_MAX) {
+                if (error.empty()) error = "--generate-world needs a size in tiles";
+                return false;
+            }
+            generateWorldSize = static_cast<uint32_t>(number);
+        } else if (argument == "--render-scale") {
+            if (!value(text)) return false;
+            char* end = nullptr;
+            double scale = std::strtod(text, &end);
+            if (end == text || *end != '\0' || scale <= 0.0 || scale > 1.0) {
+                error = "--render-scale needs a fraction of the window resolution in (0, 1]";
+                return false;
+            }
+            renderScale = static_cast<float>(scale);
+        } else if (argument == "--max-fps" || argument == "--background-fps") {
+            if (!value(text)) return false;
+            char* end = nullptr;
+            double fps = std::strtod(text, &end);
+            if (end == text || *end != '\0' || fps < 0.0) {
+                error = argument + " needs a frame rate (0 for none)";
+                return false;
+            }
+            (argument == "--max-fps" ? maxFps : backgroundFps) = static_cast<float>(fps);
+        } else if (argument == "--capture") {
+            if (!value(text)) return false;
+            capturePath = text;
+        } else if (argument == "--screenshots") {
+            if (!value(text)) return false;
+            benchmark.screenshotDir = text;
+        } else {
+            error = "Unknown argument: " + argument;
+            return false;
+        }
+    }
+
+    if (generateWorldSize > 0 && worldPath.empty()) {
+        error = "--generate-world needs --world FILE to write to";
+        return false;
+    }
+    if (!benchmark.screenshotDir.empty() && !benchmark.enabled) {
+        error = "--screenshots needs --benchmark; press F12 for one in the game";
+        return false;
+    }
+    if (benchmark.measureFrames == 0) {
+        error = "--frames must be at least 1";
+        return false;
+    }
+    return true;
+}
+
+void GameOptions::printUsage(std::ostream& out) {
+    out << "Usage: cGame [--world FILE [--generate-world N]] [--benchmark [scene,...]] [options]\n"
+        << "  --world FILE           Explore a world chunk file with the arrow keys and Q/E\n"
+        << "  --generate-world N     Write a procedural world N tiles square to the --world FILE first\n"
+        << "  --benchmark [scenes]   Run benchmark scenes (default: all) instead of the game\n"
+        << "  --seed N               Seed for scene content, the scripted camera and generated\n"
+        << "                         worlds (default 1)\n"
+        << "  --warmup N             Frames run before measuring (default 120)\n"
+        << "  --frames N             Frames measured per scene (default 600)\n"
+        << "  --input FILE           Replay camera input from FILE\n"
+        << "  --record-input FILE    Save the camera input used to FILE\n"
+        << "  --live-input           Take camera input from the keyboard (arrows, Q/E)\n"
+        << "  --output FILE          Results JSON (default benchmark_results.json)\n"
+        << "  --baseline FILE        Compare against an earlier results file\n"
+        << "  --tolerance F          Allowed slowdown before failing (default 0.05 = 5%)\n"
+        << "  --render-scale F       Render the scene at F x the window resolution instead of\n"
+        << "                         adapting it to GPU time (benchmarks default to 1)\n"
+        << "  --max-fps N            Cap the game's frame rate (default 0: the display's)\n"
+        << "  --background-fps N     Frame rate while unfocused (default 10; 0 pauses)\n"
+        << "  --capture FILE         Record every frame to FILE as raw RGBA video\n"
+        << "  --screenshots DIR      Save each benchmark scene's last frame to DIR/<scene>.png\n"
+        << "                         (the directory must exist); F12 saves one in the game\n"
+        << "Scenes:";
+    for (const auto& name : getBenchmarkSceneNames()) {
+        out << ' ' << name;
+    }
+    out << std::endl;
+}
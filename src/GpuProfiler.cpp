@@ -0,0 +1,127 @@
+#include "GpuProfiler.h"
+#include "TaskGraph.h"
+#include <algorithm>
+
+GpuProfiler::GpuProfiler() {
+}
+
+GpuProfiler::~GpuProfiler() {
+    cleanup();
+}
+
+bool GpuProfiler::initialize(vk::Device device, vk::PhysicalDevice physicalDevice,
+                             uint32_t queueFamilyIndex, uint32_t framesInFlight) {
+    m_device = device;
+
+    auto properties = physicalDevice.getProperties();
+    auto queueFamilies = physicalDevice.getQueueFamilyProperties();
+    uint32_t validBits = queueFamilyIndex < queueFamilies.size()
+        ? queueFamilies[queueFamilyIndex].timestampValidBits : 0;
+
+    // Not fatal: the HUD shows CPU timings only
+    m_supported = validBits > 0 && properties.limits.timestampPeriod > 0.0f;
+    if (!m_supported) {
+        TaskGraph::note("GPU timestamps not supported on the graphics queue");
+        m_initialized = true;
+        return true;
+    }
+
+    m_nanosecondsPerTick = properties.limits.timestampPeriod;
+    m_timestampMask = validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+
+    vk::QueryPoolCreateInfo poolInfo{};
+    poolInfo.queryType = vk::QueryType::eTimestamp;
+    poolInfo.queryCount = MAX_SCOPES * 2;
+
+    m_frames.resize(framesInFlight);
+    for (auto& frame : m_frames) {
+        frame.pool = m_device.createQueryPool(poolInfo);
+        frame.scopes.reserve(MAX_SCOPES);
+    }
+    m_openScopes.reserve(MAX_SCOPES);
+    m_results.resize(MAX_SCOPES * 2);
+    m_timings.reserve(MAX_SCOPES);
+
+    m_initialized = true;
+    return true;
+}
+
+void GpuProfiler::cleanup() {
+    if (!m_initialized) return;
+
+    for (auto& frame : m_frames) {
+        m_device.destroyQueryPool(frame.pool);
+    }
+    m_frames.clear();
+    m_initialized = false;
+}
+
+void GpuProfiler::beginFrame(vk::CommandBuffer commandBuffer, uint32_t frameIndex) {
+    if (!m_supported) return;
+
+    m_frameIndex = frameIndex;
+    FrameQueries& frame = m_frames[frameIndex];
+    collect(frame);
+
+    commandBuffer.resetQueryPool(frame.pool, 0, MAX_SCOPES * 2);
+    frame.scopes.clear();
+    frame.queryCount = 0;
+    m_openScopes.clear();
+}
+
+void GpuProfiler::beginScope(vk::CommandBuffer commandBuffer, const char* name) {
+    if (!m_supported) return;
+
+    FrameQueries& frame = m_frames[m_frameIndex];
+    if (frame.scopes.size() >= MAX_SCOPES) {
+        // Keep begin/end balanced; the scope is simply not measured
+        m_openScopes.push_back(UINT32_MAX);
+        return;
+    }
+
+    Scope scope{ name, frame.queryCount++, UINT32_MAX };
+    commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, frame.pool, scope.beginQuery);
+    m_openScopes.push_back(static_cast<uint32_t>(frame.scopes.size()));
+    frame.scopes.push_back(scope);
+}
+
+void GpuProfiler::endScope(vk::CommandBuffer commandBuffer) {
+    if (!m_supported || m_openScopes.empty()) return;
+
+    uint32_t index = m_openScopes.back();
+    m_openScopes.pop_back();
+    if (index == UINT32_MAX) return;
+
+    FrameQueries& frame = m_frames[m_frameIndex];
+    Scope& scope = frame.scopes[index];
+    scope.endQuery = frame.queryCount++;
+    commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, frame.pool, scope.endQuery);
+}
+
+void GpuProfiler::collect(FrameQueries& frame) {
+    if (frame.queryCount == 0) return;
+
+    // The fence for this slot has signaled, so every written query is available
+    vk::Result result = m_device.getQueryPoolResults(frame.pool, 0, frame.queryCount,
+        frame.queryCount * sizeof(uint64_t), m_results.data(), sizeof(uint64_t),
+        vk::QueryResultFlagBits::e64);
+    if (result != vk::Result::eSuccess) return;
+
+    float msPerTick = m_nanosecondsPerTick * 1e-6f;
+    uint64_t first = UINT64_MAX;
+    uint64_t last = 0;
+
+    m_timings.clear();
+    for (const Scope& scope : frame.scopes) {
+        if (scope.endQuery == UINT32_MAX) continue;
+
+        uint64_t begin = m_results[scope.beginQuery] & m_timestampMask;
+        uint64_t end = m_results[scope.endQuery] & m_timestampMask;
+        uint64_t ticks = (end - begin) & m_timestampMask;
+        m_timings.push_back({ scope.name, static_cast<float>(ticks) * msPerTick });
+
+        first = std::min(first, begin);
+        last = std::max(last, end);
+    }
+    m_frameMs = last > first ? static_cast<float>(last - first) * msPerTick : 0.0f;
+}
@@ -0,0 +1,237 @@
+#include "ImageWriter.h"
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t MAX_STORED_BLOCK = 65535;
+
+std::array<uint32_t, 256> makeCrcTable() {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 1) ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+        }
+        table[i] = crc;
+    }
+    return table;
+}
+
+const std::array<uint32_t, 256> CRC_TABLE = makeCrcTable();
+
+// Writes one PNG chunk's bytes while keeping its CRC, which covers the type
+// and the data
+class ChunkWriter {
+public:
+    ChunkWriter(std::ofstream& file, const char type[4], uint32_t length) : m_file(file) {
+        writeBigEndian(length);
+        m_crc = 0xFFFFFFFFu;
+        write(reinterpret_cast<const uint8_t*>(type), 4);
+    }
+
+    void write(const uint8_t* data, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            m_crc = CRC_TABLE[(m_crc ^ data[i]) & 0xFF] ^ (m_crc >> 8);
+        }
+        m_file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+    }
+
+    void writeByte(uint8_t value) { write(&value, 1); }
+
+    void writeU32(uint32_t value) {
+        uint8_t bytes[4] = { static_cast<uint8_t>(value >> 24), static_cast<uint8_t>(value >> 16),
+                             static_cast<uint8_t>(value >> 8), static_cast<uint8_t>(value) };
+        write(bytes, 4);
+    }
+
+    void finish() { writeBigEndian(m_crc ^ 0xFFFFFFFFu); }
+
+private:
+    std::ofstream& m_file;
+    uint32_t m_crc = 0;
+
+    void writeBigEndian(uint32_t value) {
+        char bytes[4] = { static_cast<char>(value >> 24), static_cast<char>(value >> 16),
+                          static_cast<char>(value >> 8), static_cast<char>(value) };
+        m_file.write(bytes, 4);
+    }
+};
+
+// A zlib stream of stored deflate blocks, fed a scanline at a time. The
+// total size is known up front so each block header can be written as its
+// block starts
+class StoredDeflate {
+public:
+    StoredDeflate(ChunkWriter& chunk, uint64_t totalBytes) : m_chunk(chunk), m_remaining(totalBytes) {
+        m_chunk.writeByte(0x78);    // Deflate, 32K window
+        m_chunk.writeByte(0x01);    // No preset dictionary, fastest; 0x7801 is a multiple of 31
+    }
+
+    static uint64_t encodedSize(uint64_t totalBytes) {
+        uint64_t blocks = totalBytes == 0 ? 1 : (totalBytes + MAX_STORED_BLOCK - 1) / MAX_STORED_BLOCK;
+        return 2 + blocks * 5 + totalBytes + 4;
+    }
+
+    void write(const uint8_t* data, size_t size) {
+        while (size > 0) {
+            if (m_blockLeft == 0) startBlock();
+            size_t count = std::min<size_t>(size, m_blockLeft);
+            m_chunk.write(data, count);
+            updateAdler(data, count);
+            data += count;
+            size -= count;
+            m_blockLeft -= static_cast<uint32_t>(count);
+            m_remaining -= count;
+        }
+    }
+
+    void finish() {
+        if (m_remaining == 0 && !m_started) startBlock();   // Empty stream: one empty final block
+        m_chunk.writeU32((m_adlerB << 16) | m_adlerA);
+    }
+
+private:
+    ChunkWriter& m_chunk;
+    uint64_t m_remaining;
+    uint32_t m_blockLeft = 0;
+    uint32_t m_adlerA = 1;
+    uint32_t m_adlerB = 0;
+    bool m_started = false;
+
+    void updateAdler(const uint8_t* data, size_t size) {
+        // The sums can't overflow 32 bits within ADLER_RUN bytes, so the
+        // modulo is taken once per run
+        constexpr size_t ADLER_RUN = 5552;
+        while (size > 0) {
+            size_t run = std::min(size, ADLER_RUN);
+            for (size_t i = 0; i < run; i++) {
+                m_adlerA += data[i];
+                m_adlerB += m_adlerA;
+            }
+            m_adlerA %= 65521;
+            m_adlerB %= 65521;
+            data += run;
+            size -= run;
+        }
+    }
+
+    void startBlock() {
+        uint32_t length = static_cast<uint32_t>(std::min<uint64_t>(m_remaining, MAX_STORED_BLOCK));
+        bool final = length == m_remaining;
+        uint8_t header[5] = { static_cast<uint8_t>(final ? 1 : 0),
+                              static_cast<uint8_t>(length), static_cast<uint8_t>(length >> 8),
+                              static_cast<uint8_t>(~length), static_cast<uint8_t>(~length >> 8) };
+        m_chunk.write(header, sizeof(header));
+        m_blockLeft = length;
+        m_started = true;
+    }
+};
+
+} // namespace
+
+bool writePng(const std::string& path, const uint8_t* rgba, uint32_t width, uint32_t height) {
+    // Each scanline is a filter type byte (none) and the RGB pixels
+    uint64_t rowBytes = 1 + static_cast<uint64_t>(width) * 3;
+    uint64_t imageBytes = rowBytes * height;
+    uint64_t idatBytes = StoredDeflate::encodedSize(imageBytes);
+    if (width == 0 || height == 0 || idatBytes > 0x7FFFFFFFu) {
+        std::cerr << "Can't write a " << width << "x" << height << " PNG: " << path << std::endl;
+        return false;
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Failed to create image: " << path << std::endl;
+        return false;
+    }
+
+    const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    file.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+    ChunkWriter header(file, "IHDR", 13);
+    header.writeU32(width);
+    header.writeU32(height);
+    const uint8_t format[5] = { 8, 2, 0, 0, 0 };    // 8 bits, truecolor, deflate, no filter, no interlace
+    header.write(format, sizeof(format));
+    header.finish();
+
+    ChunkWriter data(file, "IDAT", static_cast<uint32_t>(idatBytes));
+    StoredDeflate deflate(data, imageBytes);
+    std::vector<uint8_t> row(rowBytes);
+    for (uint32_t y = 0; y < height; y++) {
+        const uint8_t* source = rgba + static_cast<size_t>(y) * width * 4;
+        uint8_t* out = row.data();
+        *out++ = 0;
+        for (uint32_t x = 0; x < width; x++, source += 4) {
+            *out++ = source[0];
+            *out++ = source[1];
+            *out++ = source[2];
+        }
+        deflate.write(row.data(), row.size());
+    }
+    deflate.finish();
+    data.finish();
+
+    ChunkWriter end(file, "IEND", 0);
+    end.finish();
+
+    if (!file.good()) {
+        std::cerr << "Failed to write image: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+RawFrameWriter::~RawFrameWriter() {
+    close();
+}
+
+bool RawFrameWriter::open(const std::string& path) {
+    close();
+    m_file.open(path, std::ios::binary | std::ios::trunc);
+    if (!m_file.is_open()) {
+        std::cerr << "Failed to create frame stream: " << path << std::endl;
+        return false;
+    }
+    m_path = path;
+    m_width = 0;
+    m_height = 0;
+    m_frames = 0;
+    m_skipped = 0;
+    return true;
+}
+
+void RawFrameWriter::close() {
+    if (!m_file.is_open()) return;
+    m_file.close();
+    std::cout << "Wrote " << m_frames << " frames to " << m_path;
+    if (m_skipped > 0) std::cout << " (" << m_skipped << " of another size skipped)";
+    std::cout << std::endl;
+    if (m_frames > 0) {
+        std::cout << "  ffmpeg -f rawvideo -pixel_format rgba -video_size " << m_width << "x" << m_height
+                  << " -framerate 60 -i " << m_path << " capture.mp4" << std::endl;
+    }
+}
+
+bool RawFrameWriter::write(const uint8_t* rgba, uint32_t width, uint32_t height) {
+    if (!m_file.is_open()) return false;
+    if (m_frames == 0) {
+        m_width = width;
+        m_height = height;
+    } else if (width != m_width || height != m_height) {
+        m_skipped++;
+        return false;
+    }
+
+    m_file.write(reinterpret_cast<const char*>(rgba), static_cast<std::streamsize>(static_cast<size_t>(width) * height * 4));
+    if (!m_file.good()) {
+        std::cerr << "Failed to write frame stream: " << m_path << std::endl;
+        m_file.close();
+        return false;
+    }
+    m_frames++;
+    return true;
+}
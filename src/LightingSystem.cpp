@@ -0,0 +1,231 @@
+#include "LightingSystem.h"
+#include "TaskGraph.h"
+#include "VulkanRenderer.h"
+#include <algorithm>
+#include <iostream>
+
+namespace {
+
+// Matches the push constants of lights.comp
+struct BinningPushConstants {
+    uint32_t lightBuffer;
+    uint32_t tileBuffer;
+    uint32_t lightCount;
+    uint32_t tilesX;
+};
+
+} // namespace
+
+size_t packLights(const PointLight* lights, size_t count, const LightView& view, GpuLight* out, size_t capacity) {
+    // The render extent keeps the output's aspect, so one scale serves for
+    // the radius
+    float radiusScale = view.worldToPixel.x;
+    glm::vec2 origin = view.renderSize * 0.5f;
+
+    size_t written = 0;
+    for (size_t i = 0; i < count && written < capacity; i++) {
+        const PointLight& light = lights[i];
+        float radius = light.radius * radiusScale;
+        if (!(radius > 0.0f) || !(light.intensity > 0.0f)) continue;
+
+        glm::vec2 position = (light.position - view.cameraCenter) * view.worldToPixel + origin;
+        if (position.x + radius < 0.0f || position.y + radius < 0.0f ||
+            position.x - radius > view.renderSize.x || position.y - radius > view.renderSize.y) {
+            continue;
+        }
+
+        GpuLight& packed = out[written++];
+        packed.position = position;
+        packed.radius = radius;
+        packed.invRadiusSq = 1.0f / (radius * radius);
+        packed.color = glm::vec4(light.color * light.intensity, 0.0f);
+    }
+    return written;
+}
+
+LightingSystem::LightingSystem() {
+}
+
+LightingSystem::~LightingSystem() {
+    cleanup();
+}
+
+bool LightingSystem::initialize(VulkanRenderer& renderer, uint32_t framesInFlight) {
+    m_renderer = &renderer;
+    m_device = renderer.getDevice();
+    m_pipelineLayout = renderer.getPipelineLayout();
+
+    // Binning is recorded into the frame's command buffer, like the
+    // particle step
+    auto families = renderer.getPhysicalDevice().getQueueFamilyProperties();
+    if (!(families[renderer.getGraphicsQueueFamily()].queueFlags & vk::QueueFlagBits::eCompute)) {
+        TaskGraph::note("Lighting disabled: the graphics queue has no compute");
+        return false;
+    }
+
+    DescriptorManager& descriptors = renderer.getDescriptorManager();
+    vk::DeviceSize lightSize = sizeof(GpuLight) * static_cast<vk::DeviceSize>(MAX_LIGHTS);
+    try {
+        ComputePipelineDesc desc;
+        desc.shader = "lights.comp";
+        desc.layout = m_pipelineLayout;
+        m_binningPipeline = PipelineFactory::createComputePipeline(m_device, desc);
+
+        // Tile lists depend on the extent and are created on first use
+        m_frames.resize(framesInFlight);
+        for (auto& frame : m_frames) {
+            renderer.createBuffer(lightSize, vk::BufferUsageFlagBits::eStorageBuffer,
+                vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+                frame.lights, frame.lightMemory, "lights");
+            frame.mappedLights = static_cast<GpuLight*>(m_device.mapMemory(frame.lightMemory, 0, lightSize));
+            frame.lightIndex = descriptors.registerBuffer(frame.lights);
+        }
+    } catch (const std::exception& e) {
+        TaskGraph::note(std::string("Failed to create lighting resources: ") + e.what());
+        releaseResources();
+        return false;
+    }
+
+    m_lights.reserve(MAX_LIGHTS);
+    m_initialized = true;
+    return true;
+}
+
+void LightingSystem::cleanup() {
+    if (!m_initialized) return;
+
+    releaseResources();
+    m_lights.clear();
+    m_enabled = false;
+    m_initialized = false;
+}
+
+void LightingSystem::releaseResources() {
+    DescriptorManager& descriptors = m_renderer->getDescriptorManager();
+    for (auto& frame : m_frames) {
+        releaseTiles(frame);
+        descriptors.releaseBuffer(frame.lightIndex);
+        if (frame.mappedLights) m_device.unmapMemory(frame.lightMemory);
+        m_renderer->destroyBuffer(frame.lights, frame.lightMemory);
+    }
+    m_frames.clear();
+
+    m_device.destroyPipeline(m_binningPipeline);
+    m_binningPipeline = VK_NULL_HANDLE;
+}
+
+void LightingSystem::addLight(const PointLight& light) {
+    if (!m_enabled || m_lights.size() >= MAX_LIGHTS) return;
+    m_lights.push_back(light);
+}
+
+void LightingSystem::addLights(const PointLight* lights, size_t count) {
+    if (!m_enabled) return;
+    count = std::min(count, MAX_LIGHTS - m_lights.size());
+    m_lights.insert(m_lights.end(), lights, lights + count);
+}
+
+void LightingSystem::prepare(RenderGraph& graph, uint32_t frameIndex, vk::Extent2D output, vk::Extent2D render) {
+    if (!m_initialized) return;
+
+    FrameBuffers& frame = m_frames[frameIndex];
+    frame.active = false;
+    m_submittedCount = static_cast<uint32_t>(m_lights.size());
+    m_visibleCount = 0;
+    if (!m_enabled) {
+        m_lights.clear();
+        return;
+    }
+
+    // Sized for the output so dynamic resolution never reallocates; this
+    // slot's fence has signaled, so its buffers are free
+    uint32_t tilesX = (render.width + TILE_SIZE - 1) / TILE_SIZE;
+    uint32_t tilesY = (render.height + TILE_SIZE - 1) / TILE_SIZE;
+    uint32_t outputTiles = ((output.width + TILE_SIZE - 1) / TILE_SIZE) * ((output.height + TILE_SIZE - 1) / TILE_SIZE);
+    if (!ensureTileCapacity(frame, std::max(outputTiles, tilesX * tilesY))) {
+        m_lights.clear();
+        return;
+    }
+
+    const SpriteRenderer& sprites = m_renderer->getSpriteRenderer();
+    LightView view;
+    view.cameraCenter = sprites.getCameraCenter();
+    view.worldToPixel = glm::vec2(sprites.getZoom() * render.width / output.width,
+                                  sprites.getZoom() * render.height / output.height);
+    view.renderSize = glm::vec2(static_cast<float>(render.width), static_cast<float>(render.height));
+    frame.lightCount = static_cast<uint32_t>(packLights(m_lights.data(), m_lights.size(), view,
+                                                        frame.mappedLights, MAX_LIGHTS));
+    frame.tilesX = tilesX;
+    frame.active = true;
+    m_visibleCount = frame.lightCount;
+    m_lights.clear();
+
+    // With nothing to bin, sprite.frag applies the ambient alone and never
+    // reads the tile lists
+    frame.tileResource = INVALID_RG_RESOURCE;
+    if (frame.lightCount == 0) return;
+
+    vk::DeviceSize tileBytes = sizeof(uint32_t) * static_cast<vk::DeviceSize>(TILE_STRIDE) * tilesX * tilesY;
+    frame.tileResource = graph.importBuffer("light tiles", frame.tiles, tileBytes);
+    graph.addPass("light binning", RGPassType::Compute)
+        .write(frame.tileResource, RGAccess::ComputeStorageWrite)
+        .execute([this, frameIndex, tilesY](const RGPassContext& context) {
+            const FrameBuffers& frame = m_frames[frameIndex];
+            vk::CommandBuffer commandBuffer = context.commandBuffer;
+            commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, m_binningPipeline);
+            m_renderer->getDescriptorManager().bindGlobalSets(commandBuffer, vk::PipelineBindPoint::eCompute,
+                                                              m_pipelineLayout);
+            BinningPushConstants constants{ frame.lightIndex, frame.tileIndex, frame.lightCount, frame.tilesX };
+            commandBuffer.pushConstants(m_pipelineLayout, DescriptorManager::PUSH_CONSTANT_STAGES, 0,
+                                        sizeof(constants), &constants);
+            commandBuffer.dispatch(frame.tilesX, tilesY, 1);
+        });
+}
+
+void LightingSystem::declareSceneReads(RGPassBuilder& scene, uint32_t frameIndex) const {
+    if (!m_initialized || m_frames[frameIndex].tileResource == INVALID_RG_RESOURCE) return;
+
+    // The light buffer is written by the host before submission and needs
+    // no barrier
+    scene.read(m_frames[frameIndex].tileResource, RGAccess::FragmentStorageRead);
+}
+
+LightingPushConstants LightingSystem::getSceneConstants(uint32_t frameIndex) const {
+    LightingPushConstants constants{};
+    constants.tileBuffer = INVALID_BINDLESS_INDEX;
+    if (!m_initialized || !m_frames[frameIndex].active) return constants;
+
+    const FrameBuffers& frame = m_frames[frameIndex];
+    constants.lightBuffer = frame.lightIndex;
+    constants.tileBuffer = frame.tileIndex;
+    constants.tilesX = frame.tilesX;
+    constants.lightCount = frame.lightCount;
+    constants.ambient = glm::vec4(m_ambient, 1.0f);
+    return constants;
+}
+
+bool LightingSystem::ensureTileCapacity(FrameBuffers& frame, uint32_t tileCount) {
+    if (frame.tileCapacity >= tileCount) return true;
+    releaseTiles(frame);
+
+    vk::DeviceSize size = sizeof(uint32_t) * static_cast<vk::DeviceSize>(TILE_STRIDE) * tileCount;
+    try {
+        m_renderer->createBuffer(size, vk::BufferUsageFlagBits::eStorageBuffer,
+                                 vk::MemoryPropertyFlagBits::eDeviceLocal, frame.tiles, frame.tileMemory,
+                                 "light tiles");
+        frame.tileIndex = m_renderer->getDescriptorManager().registerBuffer(frame.tiles);
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to create light tile lists: " << e.what() << std::endl;
+        releaseTiles(frame);
+        return false;
+    }
+    frame.tileCapacity = tileCount;
+    return true;
+}
+
+void LightingSystem::releaseTiles(FrameBuffers& frame) {
+    m_renderer->getDescriptorManager().releaseBuffer(frame.tileIndex);
+    m_renderer->destroyBuffer(frame.tiles, frame.tileMemory);
+    frame.tileIndex = INVALID_BINDLESS_INDEX;
+    frame.tileCapacity = 0;
+}
@@ -0,0 +1,285 @@
+#include "MeshOptimizer.h"
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+constexpr uint32_t NO_VERTEX = UINT32_MAX;
+
+// MurmurHash2 mixing a word at a time; vertices are mostly 4-byte fields
+uint32_t hashVertex(const uint8_t* data, size_t size) {
+    constexpr uint32_t M = 0x5bd1e995u;
+    uint32_t hash = static_cast<uint32_t>(size);
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        uint32_t word;
+        std::memcpy(&word, data + i, 4);
+        word *= M;
+        word ^= word >> 24;
+        word *= M;
+        hash = (hash * M) ^ word;
+    }
+    for (; i < size; i++) {
+        hash = (hash ^ data[i]) * M;
+    }
+    hash ^= hash >> 13;
+    hash *= M;
+    hash ^= hash >> 15;
+    return hash;
+}
+
+} // namespace
+
+uint32_t MeshData::getIndex(size_t i) const {
+    if (indexFormat == IndexFormat::Uint16) {
+        uint16_t index;
+        std::memcpy(&index, indices.data() + i * sizeof(uint16_t), sizeof(index));
+        return index;
+    }
+    uint32_t index;
+    std::memcpy(&index, indices.data() + i * sizeof(uint32_t), sizeof(index));
+    return index;
+}
+
+bool optimizeMesh(const void* vertices, size_t vertexCount, size_t stride,
+                  const uint32_t* indices, size_t indexCount, MeshData& out,
+                  MeshOptimizeStats* stats) {
+    if (!indices) indexCount = vertexCount;
+    if (stride == 0 || stride > UINT32_MAX || vertexCount >= NO_VERTEX || indexCount > UINT32_MAX ||
+        indexCount % 3 != 0) {
+        std::cerr << "Can't optimize a mesh of " << vertexCount << " vertices of " << stride << " bytes and "
+                  << indexCount << " indices" << std::endl;
+        return false;
+    }
+    for (size_t i = 0; indices && i < indexCount; i++) {
+        if (indices[i] >= vertexCount) {
+            std::cerr << "Mesh index " << indices[i] << " is past its " << vertexCount << " vertices" << std::endl;
+            return false;
+        }
+    }
+
+    // Unindexed input is its own index buffer
+    std::vector<uint32_t> identity;
+    if (!indices) {
+        identity.resize(vertexCount);
+        for (size_t i = 0; i < vertexCount; i++) {
+            identity[i] = static_cast<uint32_t>(i);
+        }
+        indices = identity.data();
+    }
+
+    std::vector<uint32_t> remap(vertexCount);
+    size_t uniqueCount = deduplicateVertices(vertices, vertexCount, stride, remap.data());
+    std::vector<uint8_t> unique(uniqueCount * stride);
+    const uint8_t* source = static_cast<const uint8_t*>(vertices);
+    for (size_t i = 0, written = 0; i < vertexCount; i++) {
+        // Ids are handed out in order, so a vertex is first of its kind
+        // exactly when its id is the next one
+        if (remap[i] == written) {
+            std::memcpy(unique.data() + written * stride, source + i * stride, stride);
+            written++;
+        }
+    }
+
+    std::vector<uint32_t> triangles;
+    triangles.reserve(indexCount);
+    for (size_t i = 0; i < indexCount; i += 3) {
+        uint32_t a = remap[indices[i]];
+        uint32_t b = remap[indices[i + 1]];
+        uint32_t c = remap[indices[i + 2]];
+        if (a == b || b == c || c == a) continue;
+        triangles.push_back(a);
+        triangles.push_back(b);
+        triangles.push_back(c);
+    }
+
+    optimizeVertexCache(triangles.data(), triangles.size(), uniqueCount);
+
+    out.vertexStride = static_cast<uint32_t>(stride);
+    out.vertices.resize(uniqueCount * stride);
+    out.vertexCount = static_cast<uint32_t>(optimizeVertexFetch(out.vertices.data(), triangles.data(),
+                                                                triangles.size(), unique.data(), uniqueCount,
+                                                                stride));
+    out.vertices.resize(static_cast<size_t>(out.vertexCount) * stride);
+
+    // Index 0xFFFF is an ordinary index without primitive restart, so 16
+    // bits address all 65536
+    out.indexCount = static_cast<uint32_t>(triangles.size());
+    out.indexFormat = out.vertexCount <= 65536 ? IndexFormat::Uint16 : IndexFormat::Uint32;
+    if (out.indexFormat == IndexFormat::Uint16) {
+        out.indices.resize(triangles.size() * sizeof(uint16_t));
+        uint16_t* packed = reinterpret_cast<uint16_t*>(out.indices.data());
+        for (size_t i = 0; i < triangles.size(); i++) {
+            packed[i] = static_cast<uint16_t>(triangles[i]);
+        }
+    } else {
+        out.indices.resize(triangles.size() * sizeof(uint32_t));
+        std::memcpy(out.indices.data(), triangles.data(), out.indices.size());
+    }
+
+    if (stats) {
+        stats->inputVertices = static_cast<uint32_t>(vertexCount);
+        stats->outputVertices = out.vertexCount;
+        stats->triangles = out.indexCount / 3;
+        stats->acmrBefore = computeAcmr(indices, indexCount, vertexCount);
+        stats->acmrAfter = computeAcmr(triangles.data(), triangles.size(), out.vertexCount);
+    }
+    return true;
+}
+
+size_t deduplicateVertices(const void* vertices, size_t vertexCount, size_t stride, uint32_t* remap) {
+    // Open addressing, at most half full, holding the first vertex of each
+    // distinct value
+    size_t tableSize = 16;
+    while (tableSize < vertexCount * 2) {
+        tableSize <<= 1;
+    }
+    size_t mask = tableSize - 1;
+    std::vector<uint32_t> table(tableSize, NO_VERTEX);
+
+    const uint8_t* data = static_cast<const uint8_t*>(vertices);
+    uint32_t uniqueCount = 0;
+    for (size_t i = 0; i < vertexCount; i++) {
+        const uint8_t* vertex = data + i * stride;
+        size_t slot = hashVertex(vertex, stride) & mask;
+        while (true) {
+            uint32_t existing = table[slot];
+            if (existing == NO_VERTEX) {
+                table[slot] = static_cast<uint32_t>(i);
+                remap[i] = uniqueCount++;
+                break;
+            }
+            if (std::memcmp(data + static_cast<size_t>(existing) * stride, vertex, stride) == 0) {
+                remap[i] = remap[existing];
+                break;
+            }
+            slot = (slot + 1) & mask;
+        }
+    }
+    return uniqueCount;
+}
+
+void optimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize) {
+    size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0) return;
+    indexCount = triangleCount * 3;
+
+    // Triangles around each vertex, as ranges of one array. live counts
+    // those not yet emitted
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+    for (size_t i = 0; i < indexCount; i++) {
+        offsets[indices[i] + 1]++;
+    }
+    std::vector<uint32_t> live(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) {
+        live[v] = offsets[v + 1];
+        offsets[v + 1] += offsets[v];
+    }
+    std::vector<uint32_t> adjacency(indexCount);
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < indexCount; i++) {
+        adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    std::vector<uint32_t> source(indices, indices + indexCount);
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    std::vector<uint32_t> deadEnd;
+    std::vector<uint32_t> candidates;
+    deadEnd.reserve(indexCount);
+    candidates.reserve(64);
+
+    // A vertex is in the cache while fewer than cacheSize misses have
+    // happened since its own
+    uint32_t time = cacheSize + 1;
+    size_t written = 0;
+    size_t cursor = 0;
+    uint32_t fan = source[0];
+    while (true) {
+        // Emit every remaining triangle around the fanning vertex
+        candidates.clear();
+        for (uint32_t k = offsets[fan]; k < offsets[fan + 1]; k++) {
+            uint32_t triangle = adjacency[k];
+            if (emitted[triangle]) continue;
+            emitted[triangle] = 1;
+            for (uint32_t corner = 0; corner < 3; corner++) {
+                uint32_t v = source[triangle * 3 + corner];
+                indices[written++] = v;
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (time - cacheTime[v] > cacheSize) {
+                    cacheTime[v] = time++;
+                }
+            }
+        }
+
+        // Next, the candidate that stays in the cache while its remaining
+        // triangles are emitted, preferring the oldest entry
+        uint32_t next = NO_VERTEX;
+        int64_t bestPriority = -1;
+        for (uint32_t v : candidates) {
+            if (live[v] == 0) continue;
+            int64_t priority = 0;
+            if (time - cacheTime[v] + 2 * live[v] <= cacheSize) {
+                priority = time - cacheTime[v];
+            }
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                next = v;
+            }
+        }
+
+        // Stuck: go back to the most recent vertex with triangles left,
+        // else to the first one in input order
+        while (next == NO_VERTEX && !deadEnd.empty()) {
+            uint32_t v = deadEnd.back();
+            deadEnd.pop_back();
+            if (live[v] > 0) next = v;
+        }
+        if (next == NO_VERTEX) {
+            while (cursor < vertexCount && live[cursor] == 0) {
+                cursor++;
+            }
+            if (cursor == vertexCount) break;
+            next = static_cast<uint32_t>(cursor);
+        }
+        fan = next;
+    }
+}
+
+size_t optimizeVertexFetch(void* destination, uint32_t* indices, size_t indexCount,
+                           const void* vertices, size_t vertexCount, size_t stride) {
+    std::vector<uint32_t> remap(vertexCount, NO_VERTEX);
+    const uint8_t* source = static_cast<const uint8_t*>(vertices);
+    uint8_t* target = static_cast<uint8_t*>(destination);
+    uint32_t written = 0;
+    for (size_t i = 0; i < indexCount; i++) {
+        uint32_t& mapped = remap[indices[i]];
+        if (mapped == NO_VERTEX) {
+            std::memcpy(target + static_cast<size_t>(written) * stride,
+                        source + static_cast<size_t>(indices[i]) * stride, stride);
+            mapped = written++;
+        }
+        indices[i] = mapped;
+    }
+    return written;
+}
+
+float computeAcmr(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize) {
+    if (indexCount < 3) return 0.0f;
+
+    // Same timestamp scheme as the optimizer: a vertex is cached while
+    // fewer than cacheSize misses have happened since it was loaded
+    std::vector<uint32_t> loadTime(vertexCount, 0);
+    uint32_t time = cacheSize + 1;
+    size_t misses = 0;
+    for (size_t i = 0; i < indexCount; i++) {
+        uint32_t v = indices[i];
+        if (time - loadTime[v] > cacheSize) {
+            loadTime[v] = time++;
+            misses++;
+        }
+    }
+    return static_cast<float>(misses) / static_cast<float>(indexCount / 3);
+}
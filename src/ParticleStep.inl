@@ -0,0 +1,68 @@
+// Steps every particle of a ParticleCpuState, SIMD_WIDTH lanes at a time.
+// Included once per SimdLevel by ParticleSystem.cpp, inside a namespace that
+// defines FloatVec, SIMD_WIDTH and the vector operations
+
+static_assert(PARTICLE_CPU_LANES % SIMD_WIDTH == 0, "CPU particle arrays must pad to whole vectors");
+
+size_t stepParticles(ParticleCpuState& state, const ParticleStep& step, SpriteInstance* instances) {
+    const FloatVec dt = splat(step.dt);
+    const FloatVec gravityX = mul(splat(step.gravity.x), dt);
+    const FloatVec gravityY = mul(splat(step.gravity.y), dt);
+    const FloatVec zero = splat(0.0f);
+    const FloatVec bounce = splat(1.0f + step.restitution);
+    uint32_t planeCount = std::min(step.planeCount, ParticleSettings::MAX_PLANES);
+
+    size_t written = 0;
+    size_t padded = state.age.size();
+    for (size_t base = 0; base < padded; base += SIMD_WIDTH) {
+        FloatVec age = load(&state.age[base]);
+        FloatVec lifetime = load(&state.lifetime[base]);
+        FloatVec alive = lessThan(age, lifetime);
+        // Pools are mostly dead between bursts; skip whole vectors of them
+        if (maskBits(alive) == 0) continue;
+
+        FloatVec positionX = load(&state.positionX[base]);
+        FloatVec positionY = load(&state.positionY[base]);
+        FloatVec velocityX = add(load(&state.velocityX[base]), gravityX);
+        FloatVec velocityY = add(load(&state.velocityY[base]), gravityY);
+        positionX = add(positionX, mul(velocityX, dt));
+        positionY = add(positionY, mul(velocityY, dt));
+
+        for (uint32_t p = 0; p < planeCount; p++) {
+            FloatVec normalX = splat(step.planes[p].x);
+            FloatVec normalY = splat(step.planes[p].y);
+            FloatVec distance = sub(add(mul(normalX, positionX), mul(normalY, positionY)), splat(step.planes[p].z));
+            FloatVec inside = lessThan(distance, zero);
+            positionX = select(inside, sub(positionX, mul(normalX, distance)), positionX);
+            positionY = select(inside, sub(positionY, mul(normalY, distance)), positionY);
+
+            FloatVec normalSpeed = add(mul(velocityX, normalX), mul(velocityY, normalY));
+            FloatVec approaching = both(inside, lessThan(normalSpeed, zero));
+            FloatVec reflect = mul(bounce, normalSpeed);
+            velocityX = select(approaching, sub(velocityX, mul(reflect, normalX)), velocityX);
+            velocityY = select(approaching, sub(velocityY, mul(reflect, normalY)), velocityY);
+        }
+
+        // Dead lanes keep their state, as they do in the compute shader
+        FloatVec newAge = add(age, dt);
+        store(&state.positionX[base], select(alive, positionX, load(&state.positionX[base])));
+        store(&state.positionY[base], select(alive, positionY, load(&state.positionY[base])));
+        store(&state.velocityX[base], select(alive, velocityX, load(&state.velocityX[base])));
+        store(&state.velocityY[base], select(alive, velocityY, load(&state.velocityY[base])));
+        store(&state.age[base], select(alive, newAge, age));
+
+        uint32_t live = maskBits(both(alive, lessThan(newAge, lifetime)));
+        for (uint32_t lane = 0; live != 0; lane++, live >>= 1) {
+            if ((live & 1) == 0) continue;
+            size_t i = base + lane;
+            SpriteInstance& instance = instances[written++];
+            instance.position = glm::vec2(state.positionX[i], state.positionY[i]);
+            instance.size = glm::vec2(state.size[i]);
+            instance.rotation = 0.0f;
+            instance.textureIndex = step.textureIndex;
+            instance.color = fadeColor(state.color[i], state.age[i], state.lifetime[i]);
+            instance.sortOrder = 0;
+        }
+    }
+    return written;
+}
@@ -0,0 +1,444 @@
+#include "ParticleSystem.h"
+#include "CpuFeatures.h"
+#include "TaskGraph.h"
+#include "VulkanRenderer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+
+#if CGAME_SIMD_X64
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Layout of a particle in the GPU pool; matches Particle in particles.comp
+struct GpuParticle {
+    glm::vec2 position;
+    glm::vec2 velocity;
+    float age;
+    float lifetime;
+    float size;
+    uint32_t color;
+};
+
+struct ParticlePushConstants {
+    uint32_t stateBuffer;
+    uint32_t instanceBuffer;
+    uint32_t controlBuffer;
+};
+
+// Same block as sprite.vert
+struct DrawPushConstants {
+    float cameraCenter[2];
+    float worldToClip[2];
+};
+
+// Integer hash for per-particle randomness; particles.comp has the same one
+uint32_t hashParticle(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+float unitFloat(uint32_t x) {
+    return static_cast<float>(x >> 8) * (1.0f / 16777216.0f);
+}
+
+void emitParticle(ParticleCpuState& state, uint32_t index, const ParticleStep& step) {
+    uint32_t h = hashParticle(index ^ hashParticle(step.seed));
+    float angle = step.direction + (unitFloat(h) - 0.5f) * step.spread;
+    h = hashParticle(h);
+    float speed = step.speedMin + (step.speedMax - step.speedMin) * unitFloat(h);
+    h = hashParticle(h);
+
+    state.positionX[index] = step.position.x;
+    state.positionY[index] = step.position.y;
+    state.velocityX[index] = std::cos(angle) * speed;
+    state.velocityY[index] = std::sin(angle) * speed;
+    state.age[index] = 0.0f;
+    state.lifetime[index] = step.lifetimeMin + (step.lifetimeMax - step.lifetimeMin) * unitFloat(h);
+    state.size[index] = step.size;
+    state.color[index] = step.color;
+}
+
+// Alpha fades linearly to zero over the lifetime
+uint32_t fadeColor(uint32_t color, float age, float lifetime) {
+    float fade = 1.0f - age / lifetime;
+    uint32_t alpha = static_cast<uint32_t>(static_cast<float>(color >> 24) * fade);
+    return (color & 0x00FFFFFFu) | (alpha << 24);
+}
+
+// The few vector operations the step needs, at each width there is a path
+// for. Masks are all-ones lanes, as SSE and AVX compares produce. Each
+// namespace compiles ParticleStep.inl with its own operations
+namespace scalar {
+constexpr uint32_t SIMD_WIDTH = 1;
+using FloatVec = float;
+inline FloatVec load(const float* p) { return *p; }
+inline void store(float* p, FloatVec v) { *p = v; }
+inline FloatVec splat(float v) { return v; }
+inline FloatVec add(FloatVec a, FloatVec b) { return a + b; }
+inline FloatVec sub(FloatVec a, FloatVec b) { return a - b; }
+inline FloatVec mul(FloatVec a, FloatVec b) { return a * b; }
+inline FloatVec lessThan(FloatVec a, FloatVec b) { return a < b ? 1.0f : 0.0f; }
+inline FloatVec both(FloatVec a, FloatVec b) { return a * b; }
+inline FloatVec select(FloatVec mask, FloatVec a, FloatVec b) { return mask != 0.0f ? a : b; }
+inline uint32_t maskBits(FloatVec mask) { return mask != 0.0f ? 1u : 0u; }
+#include "ParticleStep.inl"
+} // namespace scalar
+
+#if CGAME_SIMD_X64
+namespace sse2 {
+constexpr uint32_t SIMD_WIDTH = 4;
+using FloatVec = __m128;
+inline FloatVec load(const float* p) { return _mm_loadu_ps(p); }
+inline void store(float* p, FloatVec v) { _mm_storeu_ps(p, v); }
+inline FloatVec splat(float v) { return _mm_set1_ps(v); }
+inline FloatVec add(FloatVec a, FloatVec b) { return _mm_add_ps(a, b); }
+inline FloatVec sub(FloatVec a, FloatVec b) { return _mm_sub_ps(a, b); }
+inline FloatVec mul(FloatVec a, FloatVec b) { return _mm_mul_ps(a, b); }
+inline FloatVec lessThan(FloatVec a, FloatVec b) { return _mm_cmplt_ps(a, b); }
+inline FloatVec both(FloatVec a, FloatVec b) { return _mm_and_ps(a, b); }
+inline FloatVec select(FloatVec mask, FloatVec a, FloatVec b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+inline uint32_t maskBits(FloatVec mask) { return static_cast<uint32_t>(_mm_movemask_ps(mask)); }
+#include "ParticleStep.inl"
+} // namespace sse2
+
+CGAME_AVX2_BEGIN
+namespace avx2 {
+constexpr uint32_t SIMD_WIDTH = 8;
+using FloatVec = __m256;
+inline FloatVec load(const float* p) { return _mm256_loadu_ps(p); }
+inline void store(float* p, FloatVec v) { _mm256_storeu_ps(p, v); }
+inline FloatVec splat(float v) { return _mm256_set1_ps(v); }
+inline FloatVec add(FloatVec a, FloatVec b) { return _mm256_add_ps(a, b); }
+inline FloatVec sub(FloatVec a, FloatVec b) { return _mm256_sub_ps(a, b); }
+inline FloatVec mul(FloatVec a, FloatVec b) { return _mm256_mul_ps(a, b); }
+inline FloatVec lessThan(FloatVec a, FloatVec b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+inline FloatVec both(FloatVec a, FloatVec b) { return _mm256_and_ps(a, b); }
+inline FloatVec select(FloatVec mask, FloatVec a, FloatVec b) { return _mm256_blendv_ps(b, a, mask); }
+inline uint32_t maskBits(FloatVec mask) { return static_cast<uint32_t>(_mm256_movemask_ps(mask)); }
+#include "ParticleStep.inl"
+} // namespace avx2
+CGAME_AVX2_END
+#endif
+
+} // namespace
+
+void ParticleCpuState::resize(uint32_t particleCapacity) {
+    size_t padded = (static_cast<size_t>(particleCapacity) + PARTICLE_CPU_LANES - 1) / PARTICLE_CPU_LANES *
+                    PARTICLE_CPU_LANES;
+    for (auto* field : { &positionX, &positionY, &velocityX, &velocityY, &age, &lifetime, &size }) {
+        field->assign(padded, 0.0f);
+    }
+    color.assign(padded, 0);
+    capacity = particleCapacity;
+}
+
+size_t simulateParticlesCpu(ParticleCpuState& state, const ParticleStep& step, SpriteInstance* instances) {
+    if (state.capacity == 0) return 0;
+
+    uint32_t spawnCount = std::min(step.spawnCount, state.capacity);
+    for (uint32_t i = 0; i < spawnCount; i++) {
+        emitParticle(state, (step.spawnStart + i) % state.capacity, step);
+    }
+
+    switch (getSimdLevel()) {
+#if CGAME_SIMD_X64
+    case SimdLevel::AVX2: return avx2::stepParticles(state, step, instances);
+    case SimdLevel::SSE2: return sse2::stepParticles(state, step, instances);
+#endif
+    default: return scalar::stepParticles(state, step, instances);
+    }
+}
+
+const char* getParticleCpuPath() {
+    return getSimdLevelName(getSimdLevel());
+}
+
+ParticleSystem::ParticleSystem() {
+}
+
+ParticleSystem::~ParticleSystem() {
+    cleanup();
+}
+
+bool ParticleSystem::initialize(VulkanRenderer& renderer, uint32_t framesInFlight) {
+    m_renderer = &renderer;
+    m_device = renderer.getDevice();
+    m_pipelineLayout = renderer.getPipelineLayout();
+    m_framesInFlight = framesInFlight;
+
+    m_drawPipeline = PipelineFactory::createGraphicsPipeline(
+        m_device, SpriteRenderer::getPipelineDesc(renderer, BlendMode::Additive));
+
+    // The compute pass is recorded into the frame's command buffer, so the
+    // graphics queue itself has to run compute
+    auto families = renderer.getPhysicalDevice().getQueueFamilyProperties();
+    bool queueHasCompute = static_cast<bool>(families[renderer.getGraphicsQueueFamily()].queueFlags &
+                                             vk::QueueFlagBits::eCompute);
+    if (queueHasCompute) {
+        try {
+            ComputePipelineDesc desc;
+            desc.shader = "particles.comp";
+            desc.layout = m_pipelineLayout;
+            m_computePipeline = PipelineFactory::createComputePipeline(m_device, desc);
+            m_gpuSupported = true;
+        } catch (const std::exception& e) {
+            TaskGraph::note(std::string("Particle compute unavailable (") + e.what() + "); particles run on the CPU");
+        }
+    } else {
+        TaskGraph::note("Graphics queue has no compute; particles run on the CPU");
+    }
+
+    m_initialized = true;
+    return true;
+}
+
+void ParticleSystem::cleanup() {
+    if (!m_initialized) return;
+
+    stop();
+    m_device.destroyPipeline(m_computePipeline);
+    m_device.destroyPipeline(m_drawPipeline);
+    m_computePipeline = VK_NULL_HANDLE;
+    m_drawPipeline = VK_NULL_HANDLE;
+    m_gpuSupported = false;
+    m_initialized = false;
+}
+
+bool ParticleSystem::start(uint32_t capacity, ParticleSimulation simulation) {
+    if (!m_initialized) return false;
+    stop();
+
+    if (capacity == 0 || capacity > MAX_CAPACITY) {
+        std::cerr << "Particle capacity must be between 1 and " << MAX_CAPACITY << std::endl;
+        return false;
+    }
+    if (simulation == ParticleSimulation::Gpu && !m_gpuSupported) {
+        std::cerr << "GPU particle simulation is not supported on this device" << std::endl;
+        return false;
+    }
+    m_simulation = simulation == ParticleSimulation::Cpu || !m_gpuSupported ? ParticleSimulation::Cpu
+                                                                           : ParticleSimulation::Gpu;
+    bool gpu = m_simulation == ParticleSimulation::Gpu;
+
+    DescriptorManager& descriptors = m_renderer->getDescriptorManager();
+    vk::DeviceSize instanceSize = sizeof(SpriteInstance) * static_cast<vk::DeviceSize>(capacity);
+    try {
+        if (gpu) {
+            vk::DeviceSize stateSize = sizeof(GpuParticle) * static_cast<vk::DeviceSize>(capacity);
+            m_renderer->createBuffer(stateSize,
+                vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+                vk::MemoryPropertyFlagBits::eDeviceLocal, m_stateBuffer, m_stateMemory, "particle state");
+            // Zero age and lifetime: every particle starts dead
+            vk::Buffer stateBuffer = m_stateBuffer;
+            m_renderer->submitImmediate([stateBuffer](vk::CommandBuffer commandBuffer) {
+                commandBuffer.fillBuffer(stateBuffer, 0, VK_WHOLE_SIZE, 0);
+            });
+            m_stateIndex = descriptors.registerBuffer(m_stateBuffer);
+        } else {
+            m_cpuState.resize(capacity);
+        }
+
+        m_frames.resize(m_framesInFlight);
+        for (auto& frame : m_frames) {
+            if (gpu) {
+                m_renderer->createBuffer(instanceSize,
+                    vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eVertexBuffer,
+                    vk::MemoryPropertyFlagBits::eDeviceLocal, frame.instances, frame.instanceMemory,
+                    "particle instances");
+                frame.instanceIndex = descriptors.registerBuffer(frame.instances);
+
+                m_renderer->createBuffer(sizeof(Control),
+                    vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer,
+                    vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+                    frame.control, frame.controlMemory, "particle control");
+                frame.mappedControl = static_cast<Control*>(m_device.mapMemory(frame.controlMemory, 0, sizeof(Control)));
+                *frame.mappedControl = Control{};
+                frame.controlIndex = descriptors.registerBuffer(frame.control);
+            } else {
+                m_renderer->createBuffer(instanceSize, vk::BufferUsageFlagBits::eVertexBuffer,
+                    vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+                    frame.instances, frame.instanceMemory, "particle instances");
+                frame.mappedInstances = static_cast<SpriteInstance*>(
+                    m_device.mapMemory(frame.instanceMemory, 0, instanceSize));
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to create particle buffers: " << e.what() << std::endl;
+        stop();
+        return false;
+    }
+
+    m_capacity = capacity;
+    m_pendingDt = 0.0f;
+    m_spawnCarry = 0.0f;
+    m_spawnCursor = 0;
+    m_stepCount = 0;
+    m_liveCount = 0;
+    std::cout << "Particle pool of " << capacity << " simulated on the "
+              << (gpu ? "GPU" : "CPU") << (gpu ? "" : std::string(" (") + getParticleCpuPath() + ")") << std::endl;
+    return true;
+}
+
+void ParticleSystem::stop() {
+    DescriptorManager& descriptors = m_renderer->getDescriptorManager();
+    for (auto& frame : m_frames) {
+        descriptors.releaseBuffer(frame.instanceIndex);
+        descriptors.releaseBuffer(frame.controlIndex);
+        if (frame.mappedInstances) m_device.unmapMemory(frame.instanceMemory);
+        if (frame.mappedControl) m_device.unmapMemory(frame.controlMemory);
+        m_renderer->destroyBuffer(frame.instances, frame.instanceMemory);
+        m_renderer->destroyBuffer(frame.control, frame.controlMemory);
+    }
+    m_frames.clear();
+
+    descriptors.releaseBuffer(m_stateIndex);
+    m_stateIndex = INVALID_BINDLESS_INDEX;
+    m_renderer->destroyBuffer(m_stateBuffer, m_stateMemory);
+    m_cpuState = ParticleCpuState{};
+    m_capacity = 0;
+    m_liveCount = 0;
+}
+
+void ParticleSystem::simulate(float dt) {
+    m_pendingDt += std::max(dt, 0.0f);
+}
+
+ParticleStep ParticleSystem::buildStep() {
+    float dt = m_pendingDt;
+    m_pendingDt = 0.0f;
+
+    // Whole particles only; the remainder carries over to the next step
+    m_spawnCarry += m_settings.rate * dt;
+    uint32_t spawnCount = static_cast<uint32_t>(std::min(m_spawnCarry, static_cast<float>(m_capacity)));
+    m_spawnCarry = spawnCount == m_capacity ? 0.0f : m_spawnCarry - static_cast<float>(spawnCount);
+
+    ParticleStep step{};
+    step.position = m_settings.position;
+    step.gravity = m_settings.gravity;
+    step.direction = m_settings.direction;
+    step.spread = m_settings.spread;
+    step.speedMin = m_settings.speedMin;
+    step.speedMax = m_settings.speedMax;
+    step.lifetimeMin = m_settings.lifetimeMin;
+    step.lifetimeMax = m_settings.lifetimeMax;
+    step.size = m_settings.size;
+    step.restitution = m_settings.restitution;
+    step.dt = dt;
+    step.color = m_settings.color;
+    step.spawnStart = m_spawnCursor;
+    step.spawnCount = spawnCount;
+    step.capacity = m_capacity;
+    step.seed = m_stepCount++;
+    step.planeCount = std::min(m_settings.planeCount, ParticleSettings::MAX_PLANES);
+    step.textureIndex = m_renderer->getSpriteRenderer().getWhiteTexture();
+    for (uint32_t i = 0; i < step.planeCount; i++) {
+        const ParticlePlane& plane = m_settings.planes[i];
+        step.planes[i] = glm::vec4(plane.normal, plane.distance, 0.0f);
+    }
+
+    m_spawnCursor = (m_spawnCursor + spawnCount) % m_capacity;
+    return step;
+}
+
+void ParticleSystem::prepare(RenderGraph& graph, uint32_t frameIndex) {
+    if (!isRunning()) return;
+
+    FrameBuffers& frame = m_frames[frameIndex];
+    ParticleStep step = buildStep();
+
+    if (m_simulation == ParticleSimulation::Cpu) {
+        // This slot's fence has signaled, so its instance buffer is free
+        frame.instanceCount = static_cast<uint32_t>(simulateParticlesCpu(m_cpuState, step, frame.mappedInstances));
+        m_liveCount = frame.instanceCount;
+        return;
+    }
+
+    // What the shader counted when this slot last ran
+    m_liveCount = frame.mappedControl->draw.instanceCount;
+    frame.mappedControl->draw = vk::DrawIndirectCommand{ 6, 0, 0, 0 };
+    frame.mappedControl->step = step;
+
+    RGResource state = graph.importBuffer("particle state", m_stateBuffer,
+                                          sizeof(GpuParticle) * static_cast<vk::DeviceSize>(m_capacity));
+    frame.instanceResource = graph.importBuffer("particle instances", frame.instances,
+                                                sizeof(SpriteInstance) * static_cast<vk::DeviceSize>(m_capacity));
+    frame.controlResource = graph.importBuffer("particle control", frame.control, sizeof(Control));
+
+    // The pool has to advance even on frames that draw nothing
+    graph.addPass("particles", RGPassType::Compute)
+        .write(state, RGAccess::ComputeStorageWrite)
+        .write(frame.instanceResource, RGAccess::ComputeStorageWrite)
+        .write(frame.controlResource, RGAccess::ComputeStorageWrite)
+        .sideEffect()
+        .execute([this, frameIndex](const RGPassContext& context) {
+            const FrameBuffers& frame = m_frames[frameIndex];
+            vk::CommandBuffer commandBuffer = context.commandBuffer;
+
+            // The pool was last written by the previous frame's submission,
+            // which the graph doesn't see
+            vk::MemoryBarrier poolBarrier{ vk::AccessFlagBits::eShaderWrite,
+                                           vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite };
+            commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                                          vk::PipelineStageFlagBits::eComputeShader, {},
+                                          1, &poolBarrier, 0, nullptr, 0, nullptr);
+
+            commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, m_computePipeline);
+            m_renderer->getDescriptorManager().bindGlobalSets(commandBuffer, vk::PipelineBindPoint::eCompute,
+                                                              m_pipelineLayout);
+            ParticlePushConstants constants{ m_stateIndex, frame.instanceIndex, frame.controlIndex };
+            commandBuffer.pushConstants(m_pipelineLayout, DescriptorManager::PUSH_CONSTANT_STAGES, 0,
+                                        sizeof(constants), &constants);
+            commandBuffer.dispatch((m_capacity + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+        });
+}
+
+void ParticleSystem::declareSceneReads(RGPassBuilder& scene, uint32_t frameIndex) const {
+    if (!isRunning() || m_simulation != ParticleSimulation::Gpu) return;
+
+    // Host writes to the CPU path's buffers need no barrier
+    const FrameBuffers& frame = m_frames[frameIndex];
+    scene.read(frame.instanceResource, RGAccess::VertexAttributeRead)
+         .read(frame.controlResource, RGAccess::IndirectCommandRead);
+}
+
+void ParticleSystem::record(vk::CommandBuffer commandBuffer, vk::Extent2D extent, uint32_t frameIndex) {
+    if (!isRunning()) return;
+
+    const FrameBuffers& frame = m_frames[frameIndex];
+    bool gpu = m_simulation == ParticleSimulation::Gpu;
+    if (!gpu && frame.instanceCount == 0) return;
+
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, m_drawPipeline);
+    m_renderer->getDescriptorManager().bindGlobalSets(commandBuffer, vk::PipelineBindPoint::eGraphics,
+                                                      m_pipelineLayout);
+
+    // Same camera as the sprites
+    const SpriteRenderer& sprites = m_renderer->getSpriteRenderer();
+    DrawPushConstants constants{};
+    constants.cameraCenter[0] = sprites.getCameraCenter().x;
+    constants.cameraCenter[1] = sprites.getCameraCenter().y;
+    constants.worldToClip[0] = 2.0f * sprites.getZoom() / extent.width;
+    constants.worldToClip[1] = 2.0f * sprites.getZoom() / extent.height;
+    commandBuffer.pushConstants(m_pipelineLayout, DescriptorManager::PUSH_CONSTANT_STAGES, 0,
+                                sizeof(constants), &constants);
+
+    vk::DeviceSize offset = 0;
+    commandBuffer.bindVertexBuffers(0, 1, &frame.instances, &offset);
+    if (gpu) {
+        commandBuffer.drawIndirect(frame.control, offsetof(Control, draw), 1, sizeof(vk::DrawIndirectCommand));
+        m_renderer->countDraw(6, m_liveCount);
+    } else {
+        commandBuffer.draw(6, frame.instanceCount, 0, 0);
+        m_renderer->countDraw(6, frame.instanceCount);
+    }
+}
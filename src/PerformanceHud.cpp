@@ -0,0 +1,421 @@
+#include "PerformanceHud.h"
+#include "VulkanRenderer.h"
+#include "AllocationTracker.h"
+#include "PipelineFactory.h"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+// 5x7 bitmap font, one byte per row with bit 4 as the leftmost pixel.
+// Lowercase letters are drawn with the uppercase glyphs
+struct Glyph {
+    char character;
+    uint8_t rows[7];
+};
+
+const Glyph FONT_5X7[] = {
+    { '0', { 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E } },
+    { '1', { 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E } },
+    { '2', { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F } },
+    { '3', { 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E } },
+    { '4', { 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 } },
+    { '5', { 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E } },
+    { '6', { 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E } },
+    { '7', { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 } },
+    { '8', { 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E } },
+    { '9', { 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C } },
+    { 'A', { 0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 } },
+    { 'B', { 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E } },
+    { 'C', { 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E } },
+    { 'D', { 0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C } },
+    { 'E', { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F } },
+    { 'F', { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10 } },
+    { 'G', { 0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F } },
+    { 'H', { 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 } },
+    { 'I', { 0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E } },
+    { 'J', { 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C } },
+    { 'K', { 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 } },
+    { 'L', { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F } },
+    { 'M', { 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11 } },
+    { 'N', { 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 } },
+    { 'O', { 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E } },
+    { 'P', { 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10 } },
+    { 'Q', { 0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D } },
+    { 'R', { 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11 } },
+    { 'S', { 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E } },
+    { 'T', { 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 } },
+    { 'U', { 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E } },
+    { 'V', { 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04 } },
+    { 'W', { 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A } },
+    { 'X', { 0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11 } },
+    { 'Y', { 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04, 0x04 } },
+    { 'Z', { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F } },
+    { '.', { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C } },
+    { ',', { 0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08 } },
+    { ':', { 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00 } },
+    { '%', { 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03 } },
+    { '/', { 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00 } },
+    { '-', { 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00 } },
+    { '+', { 0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00 } },
+    { '=', { 0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00 } },
+    { '(', { 0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02 } },
+    { ')', { 0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08 } },
+    { '[', { 0x0E, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0E } },
+    { ']', { 0x0E, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0E } },
+    { '_', { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F } },
+    { '!', { 0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04 } },
+    { '?', { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04 } },
+    { '<', { 0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02 } },
+    { '>', { 0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08 } },
+};
+
+// Atlas of 8x8 cells covering ASCII 32..127; the last cell is solid and is
+// used for panels and graph bars
+constexpr uint32_t CELL_SIZE = 8;
+constexpr uint32_t ATLAS_COLUMNS = 16;
+constexpr uint32_t ATLAS_ROWS = 6;
+constexpr uint32_t ATLAS_WIDTH = CELL_SIZE * ATLAS_COLUMNS;
+constexpr uint32_t ATLAS_HEIGHT = CELL_SIZE * ATLAS_ROWS;
+constexpr char FIRST_CHAR = 32;
+constexpr char SOLID_CHAR = 127;
+
+constexpr float SCALE = 2.0f;
+constexpr float GLYPH_WIDTH = 5.0f * SCALE;
+constexpr float GLYPH_HEIGHT = 7.0f * SCALE;
+constexpr float ADVANCE = 6.0f * SCALE;
+constexpr float LINE_HEIGHT = 9.0f * SCALE;
+constexpr float MARGIN = 8.0f;
+constexpr float PADDING = 8.0f;
+
+constexpr float GRAPH_HEIGHT = 64.0f;
+constexpr float GRAPH_BAR_WIDTH = 2.0f;
+constexpr float GRAPH_RANGE_MS = 100.0f / 3.0f;    // Full height at 30 FPS
+
+constexpr double TEXT_REFRESH_SECONDS = 0.25;
+
+constexpr uint32_t rgba(uint32_t r, uint32_t g, uint32_t b, uint32_t a) {
+    return r | (g << 8) | (b << 16) | (a << 24);
+}
+
+constexpr uint32_t PANEL_COLOR = rgba(0, 0, 0, 176);
+constexpr uint32_t TEXT_COLOR = rgba(255, 255, 255, 255);
+constexpr uint32_t HEADER_COLOR = rgba(255, 210, 80, 255);
+constexpr uint32_t GOOD_COLOR = rgba(80, 220, 100, 255);
+constexpr uint32_t SLOW_COLOR = rgba(240, 200, 60, 255);
+constexpr uint32_t BAD_COLOR = rgba(240, 70, 60, 255);
+constexpr uint32_t TARGET_LINE_COLOR = rgba(255, 255, 255, 96);
+
+struct HudPushConstants {
+    float pixelToClip[2];
+    uint32_t atlasIndex;
+};
+
+double nowSeconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+float elapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+float megabytes(uint64_t bytes) {
+    return static_cast<float>(bytes) / (1024.0f * 1024.0f);
+}
+
+} // namespace
+
+PerformanceHud::PerformanceHud() {
+}
+
+PerformanceHud::~PerformanceHud() {
+    cleanup();
+}
+
+bool PerformanceHud::initialize(VulkanRenderer& renderer, uint32_t framesInFlight) {
+    m_renderer = &renderer;
+    m_device = renderer.getDevice();
+    m_pipelineLayout = renderer.getPipelineLayout();
+
+    try {
+        if (!createAtlas() || !createPipeline() || !createVertexBuffers(framesInFlight)) {
+            m_initialized = true;
+            cleanup();
+            return false;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Performance HUD disabled: " << e.what() << std::endl;
+        m_initialized = true;
+        cleanup();
+        return false;
+    }
+
+    m_initialized = true;
+    return true;
+}
+
+void PerformanceHud::cleanup() {
+    if (!m_initialized) return;
+
+    for (auto& frame : m_frames) {
+        if (frame.mapped) m_device.unmapMemory(frame.memory);
+        m_renderer->destroyBuffer(frame.buffer, frame.memory);
+    }
+    m_frames.clear();
+
+    m_device.destroyPipeline(m_pipeline);
+    m_pipeline = VK_NULL_HANDLE;
+    m_renderer->destroyTexture(m_atlas);
+
+    m_initialized = false;
+}
+
+bool PerformanceHud::createAtlas() {
+    std::vector<uint8_t> pixels(ATLAS_WIDTH * ATLAS_HEIGHT, 0);
+
+    auto cellOrigin = [](char character, uint32_t& x, uint32_t& y) {
+        uint32_t cell = static_cast<uint32_t>(character - FIRST_CHAR);
+        x = (cell % ATLAS_COLUMNS) * CELL_SIZE;
+        y = (cell / ATLAS_COLUMNS) * CELL_SIZE;
+    };
+
+    for (const Glyph& glyph : FONT_5X7) {
+        uint32_t originX, originY;
+        cellOrigin(glyph.character, originX, originY);
+        for (uint32_t row = 0; row < 7; row++) {
+            for (uint32_t column = 0; column < 5; column++) {
+                if (glyph.rows[row] & (0x10 >> column)) {
+                    pixels[(originY + row) * ATLAS_WIDTH + originX + column] = 255;
+                }
+            }
+        }
+    }
+
+    uint32_t solidX, solidY;
+    cellOrigin(SOLID_CHAR, solidX, solidY);
+    for (uint32_t row = 0; row < CELL_SIZE; row++) {
+        memset(&pixels[(solidY + row) * ATLAS_WIDTH + solidX], 255, CELL_SIZE);
+    }
+
+    m_atlas = m_renderer->createTexture(ATLAS_WIDTH, ATLAS_HEIGHT, vk::Format::eR8Unorm,
+                                        pixels.data(), pixels.size(), SamplerType::Nearest);
+    return m_atlas.bindlessIndex != INVALID_BINDLESS_INDEX;
+}
+
+bool PerformanceHud::createPipeline() {
+    GraphicsPipelineDesc desc;
+    desc.vertexShader = "hud.vert";
+    desc.fragmentShader = "hud.frag";
+    desc.bindings = { { 0, sizeof(HudVertex), vk::VertexInputRate::eVertex } };
+    desc.attributes = {
+        { 0, 0, vk::Format::eR32G32Sfloat, offsetof(HudVertex, x) },
+        { 1, 0, vk::Format::eR32G32Sfloat, offsetof(HudVertex, u) },
+        { 2, 0, vk::Format::eR8G8B8A8Unorm, offsetof(HudVertex, color) }
+    };
+    desc.blend = BlendMode::Alpha;
+    desc.layout = m_pipelineLayout;
+    desc.renderPass = m_renderer->getRenderPass();
+
+    m_pipeline = PipelineFactory::createGraphicsPipeline(m_device, desc);
+    return true;
+}
+
+bool PerformanceHud::createVertexBuffers(uint32_t framesInFlight) {
+    // One buffer per frame in flight so this frame's writes never touch
+    // vertices the GPU may still be reading
+    vk::DeviceSize size = sizeof(HudVertex) * 6 * MAX_QUADS;
+
+    m_frames.resize(framesInFlight);
+    for (auto& frame : m_frames) {
+        m_renderer->createBuffer(size, vk::BufferUsageFlagBits::eVertexBuffer,
+            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+            frame.buffer, frame.memory, "hud vertices");
+        frame.mapped = static_cast<HudVertex*>(m_device.mapMemory(frame.memory, 0, size));
+    }
+    return true;
+}
+
+void PerformanceHud::addFrameTime(float cpuFrameMs) {
+    m_frameTimes[m_frameTimeHead] = cpuFrameMs;
+    m_frameTimeHead = (m_frameTimeHead + 1) % GRAPH_SAMPLES;
+    m_accumulatedMs += cpuFrameMs;
+    m_accumulatedFrames++;
+}
+
+void PerformanceHud::update(uint32_t frameIndex, vk::Extent2D extent) {
+    m_vertexCount = 0;
+    if (!isVisible()) {
+        m_overheadMs = 0.0f;
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    double now = nowSeconds();
+    if (now - m_lastTextUpdate >= TEXT_REFRESH_SECONDS || m_lineCount == 0) {
+        formatText();
+        m_lastTextUpdate = now;
+    }
+
+    m_frameIndex = frameIndex;
+    FrameVertices& frame = m_frames[frameIndex];
+    m_cursor = frame.mapped;
+    m_end = frame.mapped + 6 * MAX_QUADS;
+
+    // Panel sized to the longest line and the graph
+    size_t longest = 0;
+    for (size_t i = 0; i < m_lineCount; i++) {
+        longest = std::max(longest, strlen(m_lines[i]));
+    }
+    float contentWidth = std::max(longest * ADVANCE, GRAPH_SAMPLES * GRAPH_BAR_WIDTH);
+    float contentHeight = m_lineCount * LINE_HEIGHT + PADDING + GRAPH_HEIGHT;
+    float panelRight = std::min(MARGIN + contentWidth + 2 * PADDING, static_cast<float>(extent.width));
+    pushRect(MARGIN, MARGIN, panelRight, MARGIN + contentHeight + 2 * PADDING, PANEL_COLOR);
+
+    float x = MARGIN + PADDING;
+    float y = MARGIN + PADDING;
+    for (size_t i = 0; i < m_lineCount; i++) {
+        // Indented lines are details under the header above them
+        pushText(x, y, m_lines[i], m_lines[i][0] == ' ' ? TEXT_COLOR : HEADER_COLOR);
+        y += LINE_HEIGHT;
+    }
+
+    // Frame time graph, oldest sample on the left
+    float graphTop = y + PADDING;
+    float graphBottom = graphTop + GRAPH_HEIGHT;
+    for (uint32_t i = 0; i < GRAPH_SAMPLES; i++) {
+        float ms = m_frameTimes[(m_frameTimeHead + i) % GRAPH_SAMPLES];
+        if (ms <= 0.0f) continue;
+        float height = std::min(ms / GRAPH_RANGE_MS, 1.0f) * GRAPH_HEIGHT;
+        uint32_t color = ms <= 1000.0f / 60.0f ? GOOD_COLOR : (ms <= 1000.0f / 30.0f ? SLOW_COLOR : BAD_COLOR);
+        float barX = x + i * GRAPH_BAR_WIDTH;
+        pushRect(barX, graphBottom - height, barX + GRAPH_BAR_WIDTH, graphBottom, color);
+    }
+    float targetY = graphBottom - (1000.0f / 60.0f) / GRAPH_RANGE_MS * GRAPH_HEIGHT;
+    pushRect(x, targetY, x + GRAPH_SAMPLES * GRAPH_BAR_WIDTH, targetY + 1.0f, TARGET_LINE_COLOR);
+
+    m_vertexCount = static_cast<uint32_t>(m_cursor - frame.mapped);
+    m_updateMs = elapsedMs(start);
+}
+
+void PerformanceHud::record(vk::CommandBuffer commandBuffer, vk::Extent2D extent) {
+    if (!isVisible() || m_vertexCount == 0) return;
+
+    auto start = std::chrono::steady_clock::now();
+
+    vk::Viewport viewport{ 0.0f, 0.0f, static_cast<float>(extent.width), static_cast<float>(extent.height),
+                           0.0f, 1.0f };
+    vk::Rect2D scissor{ { 0, 0 }, extent };
+    commandBuffer.setViewport(0, 1, &viewport);
+    commandBuffer.setScissor(0, 1, &scissor);
+
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, m_pipeline);
+    m_renderer->getDescriptorManager().bindGlobalSets(commandBuffer, vk::PipelineBindPoint::eGraphics,
+                                                      m_pipelineLayout);
+
+    HudPushConstants constants{};
+    constants.pixelToClip[0] = 2.0f / extent.width;
+    constants.pixelToClip[1] = 2.0f / extent.height;
+    constants.atlasIndex = m_atlas.bindlessIndex;
+    commandBuffer.pushConstants(m_pipelineLayout, DescriptorManager::PUSH_CONSTANT_STAGES, 0,
+                                sizeof(constants), &constants);
+
+    vk::DeviceSize offset = 0;
+    commandBuffer.bindVertexBuffers(0, 1, &m_frames[m_frameIndex].buffer, &offset);
+    commandBuffer.draw(m_vertexCount, 1, 0, 0);
+
+    m_overheadMs = m_updateMs + elapsedMs(start);
+}
+
+void PerformanceHud::formatText() {
+    float averageMs = m_accumulatedFrames > 0 ? m_accumulatedMs / m_accumulatedFrames : 0.0f;
+    m_accumulatedMs = 0.0f;
+    m_accumulatedFrames = 0;
+
+    const GpuProfiler& profiler = m_renderer->getGpuProfiler();
+    const FrameStats& draws = m_renderer->getLastFrameStats();
+    AssetStats assets = m_renderer->getAssetStreamer().getStats();
+
+    m_lineCount = 0;
+    auto line = [this](const char* format, auto... args) {
+        if (m_lineCount < MAX_LINES) {
+            snprintf(m_lines[m_lineCount++], LINE_LENGTH, format, args...);
+        }
+    };
+
+    line("FPS %.1f  CPU %.2f MS  GPU %.2f MS", averageMs > 0.0f ? 1000.0f / averageMs : 0.0f,
+         averageMs, profiler.getFrameMs());
+    vk::Extent2D render = m_renderer->getRenderExtent();
+    line("RENDER %u X %u  %.0f%% OF OUTPUT", render.width, render.height,
+         100.0f * render.width / std::max(m_renderer->getSwapchainExtent().width, 1u));
+    line("%s", "DRAWS");
+    line("  %u CALLS  %llu TRIANGLES", draws.drawCalls, static_cast<unsigned long long>(draws.triangles));
+    line("  %llu HEAP ALLOCS", static_cast<unsigned long long>(
+         AllocationTracker::getLastFrameStats().totalAllocations()));
+    line("%s", "MEMORY");
+    line("  STREAMED HOST %.1f MB  DEVICE %.1f MB", megabytes(assets.hostBytes), megabytes(assets.deviceBytes));
+    const DeviceMemoryTracker& memory = m_renderer->getMemoryTracker();
+    for (uint32_t i = 0; i < memory.getHeapCount() && i < 3; i++) {
+        MemoryHeapStats heap = memory.getHeapStats(i);
+        line("  HEAP %u %s %.1f / %.1f MB%s", i, heap.deviceLocal ? "DEVICE" : "HOST",
+             megabytes(heap.usage), megabytes(heap.budget),
+             heap.usage >= heap.budget * DeviceMemoryTracker::BUDGET_WARNING_FRACTION ? " !" : "");
+    }
+    line("  VERTEX %.1f  TEXTURE %.1f  TARGET %.1f MB", megabytes(memory.getCategoryBytes(MemoryCategory::Vertex)),
+         megabytes(memory.getCategoryBytes(MemoryCategory::Texture)),
+         megabytes(memory.getCategoryBytes(MemoryCategory::RenderTarget)));
+
+    if (profiler.isSupported()) {
+        line("%s", "GPU PASSES");
+        for (const GpuPassTiming& pass : profiler.getPassTimings()) {
+            if (m_lineCount >= MAX_LINES - 1) break;
+            line("  %-16.16s %.3f MS", pass.name, pass.milliseconds);
+        }
+    }
+    line("HUD %.3f MS", m_overheadMs);
+}
+
+void PerformanceHud::pushQuad(float x0, float y0, float x1, float y1,
+                              float u0, float v0, float u1, float v1, uint32_t color) {
+    if (m_end - m_cursor < 6) return;
+
+    HudVertex* v = m_cursor;
+    v[0] = { x0, y0, u0, v0, color };
+    v[1] = { x1, y0, u1, v0, color };
+    v[2] = { x1, y1, u1, v1, color };
+    v[3] = { x0, y0, u0, v0, color };
+    v[4] = { x1, y1, u1, v1, color };
+    v[5] = { x0, y1, u0, v1, color };
+    m_cursor += 6;
+}
+
+void PerformanceHud::pushRect(float x0, float y0, float x1, float y1, uint32_t color) {
+    // Sample the centre of the solid cell so every fragment has full coverage
+    uint32_t cell = static_cast<uint32_t>(SOLID_CHAR - FIRST_CHAR);
+    float u = ((cell % ATLAS_COLUMNS) * CELL_SIZE + CELL_SIZE * 0.5f) / ATLAS_WIDTH;
+    float v = ((cell / ATLAS_COLUMNS) * CELL_SIZE + CELL_SIZE * 0.5f) / ATLAS_HEIGHT;
+    pushQuad(x0, y0, x1, y1, u, v, u, v, color);
+}
+
+float PerformanceHud::pushText(float x, float y, const char* text, uint32_t color) {
+    for (const char* c = text; *c; c++) {
+        char character = *c;
+        if (character >= 'a' && character <= 'z') character = static_cast<char>(character - 'a' + 'A');
+        if (character < FIRST_CHAR || character >= SOLID_CHAR) character = '?';
+
+        if (character != ' ') {
+            uint32_t cell = static_cast<uint32_t>(character - FIRST_CHAR);
+            float u0 = static_cast<float>((cell % ATLAS_COLUMNS) * CELL_SIZE) / ATLAS_WIDTH;
+            float v0 = static_cast<float>((cell / ATLAS_COLUMNS) * CELL_SIZE) / ATLAS_HEIGHT;
+            float u1 = u0 + 5.0f / ATLAS_WIDTH;
+            float v1 = v0 + 7.0f / ATLAS_HEIGHT;
+            pushQuad(x, y, x + GLYPH_WIDTH, y + GLYPH_HEIGHT, u0, v0, u1, v1, color);
+        }
+        x += ADVANCE;
+    }
+    return x;
+}
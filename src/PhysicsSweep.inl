@@ -0,0 +1,31 @@
+// The sweep over bounds sorted by their left edge, SIMD_WIDTH bodies at a
+// time. Included once per SimdLevel by PhysicsWorld.cpp, inside a namespace
+// that defines FloatVec, SIMD_WIDTH and the vector operations
+
+static_assert(SIMD_WIDTH <= MAX_SIMD_WIDTH, "The sweep would read past the bounds' padding");
+
+constexpr uint32_t ALL_LANES = (1u << SIMD_WIDTH) - 1;
+
+// Calls addPair(i, j), i < j, for each pair of sweep positions whose bounds
+// overlap, in order of i and then j. The padding past the live bounds starts
+// at infinity
+template <typename AddPair>
+void sweepPairs(const SweepBounds& bounds, AddPair&& addPair) {
+    for (size_t i = 0; i < bounds.count; i++) {
+        FloatVec right = splat(bounds.maxX[i]);
+        FloatVec bottom = splat(bounds.minY[i]);
+        FloatVec top = splat(bounds.maxY[i]);
+
+        // Bodies after i in the order start at or after its left edge; they
+        // overlap it on x until one starts past its right edge
+        for (size_t j = i + 1;; j += SIMD_WIDTH) {
+            uint32_t inRange = lessEqualMask(load(&bounds.minX[j]), right);
+            uint32_t overlapping = inRange & lessEqualMask(load(&bounds.minY[j]), top) &
+                                   lessEqualMask(bottom, load(&bounds.maxY[j]));
+            for (uint32_t lane = 0; overlapping != 0; lane++, overlapping >>= 1) {
+                if (overlapping & 1) addPair(i, j + lane);
+            }
+            if (inRange != ALL_LANES) break;
+        }
+    }
+}
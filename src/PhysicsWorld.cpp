@@ -0,0 +1,444 @@
+#include "PhysicsWorld.h"
+#include "AllocationTracker.h"
+#include "CpuFeatures.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if CGAME_SIMD_X64
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// The widest path's width; the bounds arrays are padded by this much
+constexpr uint32_t MAX_SIMD_WIDTH = 8;
+
+// Bounds of the live bodies in sweep order, one array per edge
+struct SweepBounds {
+    const float* minX;
+    const float* maxX;
+    const float* minY;
+    const float* maxY;
+    size_t count;
+};
+
+// The vector operations the sweep needs, at each width there is a path for.
+// lessEqualMask has a bit set for each lane where a <= b. Each namespace
+// compiles PhysicsSweep.inl with its own operations
+namespace scalar {
+constexpr uint32_t SIMD_WIDTH = 1;
+using FloatVec = float;
+inline FloatVec load(const float* p) { return *p; }
+inline FloatVec splat(float value) { return value; }
+inline uint32_t lessEqualMask(FloatVec a, FloatVec b) { return a <= b ? 1u : 0u; }
+#include "PhysicsSweep.inl"
+} // namespace scalar
+
+#if CGAME_SIMD_X64
+namespace sse2 {
+constexpr uint32_t SIMD_WIDTH = 4;
+using FloatVec = __m128;
+inline FloatVec load(const float* p) { return _mm_loadu_ps(p); }
+inline FloatVec splat(float value) { return _mm_set1_ps(value); }
+inline uint32_t lessEqualMask(FloatVec a, FloatVec b) {
+    return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(a, b)));
+}
+#include "PhysicsSweep.inl"
+} // namespace sse2
+
+CGAME_AVX2_BEGIN
+namespace avx2 {
+constexpr uint32_t SIMD_WIDTH = 8;
+using FloatVec = __m256;
+inline FloatVec load(const float* p) { return _mm256_loadu_ps(p); }
+inline FloatVec splat(float value) { return _mm256_set1_ps(value); }
+inline uint32_t lessEqualMask(FloatVec a, FloatVec b) {
+    return static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_LE_OQ)));
+}
+#include "PhysicsSweep.inl"
+} // namespace avx2
+CGAME_AVX2_END
+#endif
+
+// An insertion sort making more moves than this per body gives way to a
+// full sort; the order was too far out to be worth repairing
+constexpr uint32_t INCREMENTAL_SORT_BUDGET = 8;
+
+// Overlap left in place, and the share of the rest removed per step, so
+// resting contacts don't jitter
+constexpr float PENETRATION_SLOP = 0.01f;
+constexpr float CORRECTION_PERCENT = 0.8f;
+
+bool collideCircles(glm::vec2 a, float radiusA, glm::vec2 b, float radiusB, glm::vec2& normal, float& depth) {
+    glm::vec2 delta = b - a;
+    float reach = radiusA + radiusB;
+    float distanceSquared = glm::dot(delta, delta);
+    if (distanceSquared >= reach * reach) return false;
+    float distance = std::sqrt(distanceSquared);
+    normal = distance > 0.0f ? delta / distance : glm::vec2(1.0f, 0.0f);
+    depth = reach - distance;
+    return true;
+}
+
+bool collideBoxes(glm::vec2 a, glm::vec2 halfA, glm::vec2 b, glm::vec2 halfB, glm::vec2& normal, float& depth) {
+    glm::vec2 delta = b - a;
+    float overlapX = halfA.x + halfB.x - std::abs(delta.x);
+    float overlapY = halfA.y + halfB.y - std::abs(delta.y);
+    if (overlapX <= 0.0f || overlapY <= 0.0f) return false;
+    // Separate along the axis that needs the smaller push
+    if (overlapX < overlapY) {
+        normal = glm::vec2(delta.x < 0.0f ? -1.0f : 1.0f, 0.0f);
+        depth = overlapX;
+    } else {
+        normal = glm::vec2(0.0f, delta.y < 0.0f ? -1.0f : 1.0f);
+        depth = overlapY;
+    }
+    return true;
+}
+
+bool collideCircleBox(glm::vec2 circle, float radius, glm::vec2 box, glm::vec2 half, glm::vec2& normal,
+                      float& depth) {
+    glm::vec2 offset = circle - box;
+    glm::vec2 clamped = glm::clamp(offset, -half, half);
+    if (clamped == offset) {
+        // Centre inside the box: out through the nearest face
+        float outX = half.x - std::abs(offset.x);
+        float outY = half.y - std::abs(offset.y);
+        if (outX < outY) {
+            normal = glm::vec2(offset.x < 0.0f ? 1.0f : -1.0f, 0.0f);
+            depth = outX + radius;
+        } else {
+            normal = glm::vec2(0.0f, offset.y < 0.0f ? 1.0f : -1.0f);
+            depth = outY + radius;
+        }
+        return true;
+    }
+
+    glm::vec2 toClosest = clamped - offset;
+    float distanceSquared = glm::dot(toClosest, toClosest);
+    if (distanceSquared >= radius * radius) return false;
+    float distance = std::sqrt(distanceSquared);
+    normal = toClosest / distance;
+    depth = radius - distance;
+    return true;
+}
+
+} // namespace
+
+const char* getPhysicsPath() {
+    return getSimdLevelName(getSimdLevel());
+}
+
+PhysicsWorld::PhysicsWorld(uint32_t workerThreads) : m_workerCount(workerThreads) {
+}
+
+PhysicsWorld::~PhysicsWorld() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_workAvailable.notify_all();
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+BodyId PhysicsWorld::createBody(const BodyDesc& desc) {
+    BodyId id;
+    if (!m_freeIds.empty()) {
+        id = m_freeIds.back();
+        m_freeIds.pop_back();
+    } else {
+        id = static_cast<BodyId>(m_bodies.size());
+        m_bodies.emplace_back();
+    }
+
+    Body& body = m_bodies[id];
+    body.position = desc.position;
+    body.velocity = desc.velocity;
+    body.shape = desc.shape;
+    body.radius = desc.radius;
+    body.halfExtents = desc.shape == BodyShape::Circle ? glm::vec2(desc.radius) : desc.halfExtents;
+    body.inverseMass = desc.mass > 0.0f ? 1.0f / desc.mass : 0.0f;
+    body.restitution = desc.restitution;
+    body.alive = true;
+    m_orderDirty = true;
+    return id;
+}
+
+void PhysicsWorld::destroyBody(BodyId body) {
+    if (body >= m_bodies.size() || !m_bodies[body].alive) return;
+    m_bodies[body].alive = false;
+    m_freeIds.push_back(body);
+    m_orderDirty = true;
+}
+
+void PhysicsWorld::clear() {
+    m_bodies.clear();
+    m_freeIds.clear();
+    m_pairs.clear();
+    m_contacts.clear();
+    m_accumulator = 0.0f;
+    m_orderDirty = true;
+}
+
+void PhysicsWorld::setSimdLevel(SimdLevel level) {
+    m_simdLevel = std::min(level, getSimdLevel());
+}
+
+uint32_t PhysicsWorld::advance(float frameTime) {
+    m_accumulator += frameTime;
+    uint32_t steps = 0;
+    while (m_accumulator >= FIXED_TIMESTEP && steps < MAX_STEPS_PER_FRAME) {
+        step(FIXED_TIMESTEP);
+        m_accumulator -= FIXED_TIMESTEP;
+        steps++;
+    }
+    if (m_accumulator >= FIXED_TIMESTEP) {
+        m_accumulator = std::fmod(m_accumulator, FIXED_TIMESTEP);
+    }
+    return steps;
+}
+
+void PhysicsWorld::step(float dt) {
+    m_stats = PhysicsStats{};
+    integrate(dt);
+    sortBounds();
+    findPairs();
+    runNarrowphase();
+    solveContacts();
+    // After solving, so pushing bodies apart can't push one out
+    applyBounds();
+
+    m_stats.bodies = static_cast<uint32_t>(m_order.size());
+    m_stats.pairs = static_cast<uint32_t>(m_pairs.size());
+    m_stats.contacts = static_cast<uint32_t>(m_contacts.size());
+}
+
+void PhysicsWorld::integrate(float dt) {
+    glm::vec2 gravity = m_settings.gravity * dt;
+    for (Body& body : m_bodies) {
+        if (!body.alive || body.inverseMass == 0.0f) continue;
+        body.velocity += gravity;
+        body.position += body.velocity * dt;
+    }
+}
+
+void PhysicsWorld::applyBounds() {
+    if (!m_settings.bounded) return;
+    for (Body& body : m_bodies) {
+        if (!body.alive || body.inverseMass == 0.0f) continue;
+        for (int axis = 0; axis < 2; axis++) {
+            float low = m_settings.boundsMin[axis] + body.halfExtents[axis];
+            float high = m_settings.boundsMax[axis] - body.halfExtents[axis];
+            if (body.position[axis] < low) {
+                body.position[axis] = low;
+                if (body.velocity[axis] < 0.0f) body.velocity[axis] *= -body.restitution;
+            } else if (body.position[axis] > high) {
+                body.position[axis] = high;
+                if (body.velocity[axis] > 0.0f) body.velocity[axis] *= -body.restitution;
+            }
+        }
+    }
+}
+
+void PhysicsWorld::sortBounds() {
+    auto left = [this](BodyId id) { return m_bodies[id].position.x - m_bodies[id].halfExtents.x; };
+    auto fullSort = [&]() {
+        std::sort(m_order.begin(), m_order.end(), [&](BodyId a, BodyId b) { return left(a) < left(b); });
+        for (size_t k = 0; k < m_order.size(); k++) {
+            m_minX[k] = left(m_order[k]);
+        }
+        m_stats.fullSort = true;
+    };
+
+    if (m_orderDirty) {
+        // Bodies came or went; sizing the arrays allocates
+        AllocationTracker::markUnsteady();
+        m_orderDirty = false;
+        m_order.clear();
+        for (BodyId id = 0; id < m_bodies.size(); id++) {
+            if (m_bodies[id].alive) m_order.push_back(id);
+        }
+        size_t padded = m_order.size() + MAX_SIMD_WIDTH;
+        m_minX.resize(padded);
+        m_maxX.resize(padded);
+        m_minY.resize(padded);
+        m_maxY.resize(padded);
+        fullSort();
+    } else {
+        // Last step's order with this step's edges: nearly sorted, so an
+        // insertion sort only moves bodies that overtook a neighbour
+        size_t count = m_order.size();
+        for (size_t k = 0; k < count; k++) {
+            m_minX[k] = left(m_order[k]);
+        }
+        uint64_t budget = static_cast<uint64_t>(count) * INCREMENTAL_SORT_BUDGET;
+        uint64_t swaps = 0;
+        for (size_t i = 1; i < count && swaps <= budget; i++) {
+            float key = m_minX[i];
+            BodyId id = m_order[i];
+            size_t j = i;
+            while (j > 0 && m_minX[j - 1] > key) {
+                m_minX[j] = m_minX[j - 1];
+                m_order[j] = m_order[j - 1];
+                j--;
+            }
+            m_minX[j] = key;
+            m_order[j] = id;
+            swaps += i - j;
+        }
+        m_stats.sortSwaps = static_cast<uint32_t>(std::min<uint64_t>(swaps, UINT32_MAX));
+        if (swaps > budget) fullSort();
+    }
+
+    size_t count = m_order.size();
+    for (size_t k = 0; k < count; k++) {
+        const Body& body = m_bodies[m_order[k]];
+        m_maxX[k] = body.position.x + body.halfExtents.x;
+        m_minY[k] = body.position.y - body.halfExtents.y;
+        m_maxY[k] = body.position.y + body.halfExtents.y;
+    }
+    // Padding starts past every right edge, which ends any sweep reaching it
+    for (size_t k = count; k < count + MAX_SIMD_WIDTH; k++) {
+        m_minX[k] = std::numeric_limits<float>::infinity();
+        m_maxX[k] = m_minY[k] = m_maxY[k] = 0.0f;
+    }
+}
+
+void PhysicsWorld::findPairs() {
+    m_pairs.clear();
+    auto addPair = [this](size_t i, size_t j) {
+        BodyId a = m_order[i];
+        BodyId b = m_order[j];
+        if (m_bodies[a].inverseMass == 0.0f && m_bodies[b].inverseMass == 0.0f) return;
+        if (m_pairs.size() == m_pairs.capacity()) AllocationTracker::markUnsteady();
+        m_pairs.push_back(BodyPair{ a, b });
+    };
+
+    SweepBounds bounds{ m_minX.data(), m_maxX.data(), m_minY.data(), m_maxY.data(), m_order.size() };
+    switch (m_simdLevel) {
+#if CGAME_SIMD_X64
+    case SimdLevel::AVX2: avx2::sweepPairs(bounds, addPair); break;
+    case SimdLevel::SSE2: sse2::sweepPairs(bounds, addPair); break;
+#endif
+    default: scalar::sweepPairs(bounds, addPair); break;
+    }
+}
+
+void PhysicsWorld::collideBatch(size_t batch) {
+    size_t first = batch * NARROWPHASE_BATCH;
+    size_t end = std::min(first + NARROWPHASE_BATCH, m_pairs.size());
+    for (size_t p = first; p < end; p++) {
+        const BodyPair& pair = m_pairs[p];
+        const Body& a = m_bodies[pair.a];
+        const Body& b = m_bodies[pair.b];
+        glm::vec2 normal(0.0f);
+        float depth = 0.0f;
+        bool touching;
+        if (a.shape == BodyShape::Circle && b.shape == BodyShape::Circle) {
+            touching = collideCircles(a.position, a.radius, b.position, b.radius, normal, depth);
+        } else if (a.shape == BodyShape::Box && b.shape == BodyShape::Box) {
+            touching = collideBoxes(a.position, a.halfExtents, b.position, b.halfExtents, normal, depth);
+        } else if (a.shape == BodyShape::Circle) {
+            touching = collideCircleBox(a.position, a.radius, b.position, b.halfExtents, normal, depth);
+        } else {
+            touching = collideCircleBox(b.position, b.radius, a.position, a.halfExtents, normal, depth);
+            normal = -normal;
+        }
+
+        m_pairTouching[p] = touching ? 1 : 0;
+        if (touching) m_pairContacts[p] = Contact{ pair.a, pair.b, normal, depth };
+    }
+}
+
+void PhysicsWorld::runNarrowphase() {
+    size_t pairCount = m_pairs.size();
+    if (m_pairContacts.capacity() < pairCount) AllocationTracker::markUnsteady();
+    m_pairContacts.resize(pairCount);
+    m_pairTouching.resize(pairCount);
+
+    size_t batches = (pairCount + NARROWPHASE_BATCH - 1) / NARROWPHASE_BATCH;
+    if (m_workerCount > 0 && pairCount >= PARALLEL_THRESHOLD && batches > 1) {
+        if (m_workers.empty()) {
+            for (uint32_t i = 0; i < m_workerCount; i++) {
+                m_workers.emplace_back(&PhysicsWorld::workerMain, this, m_generation);
+            }
+        }
+
+        m_nextBatch = 0;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_generation++;
+            m_busyWorkers = m_workerCount;
+        }
+        m_workAvailable.notify_all();
+
+        // The calling thread takes batches too
+        size_t next;
+        while ((next = m_nextBatch.fetch_add(1)) < batches) {
+            collideBatch(next);
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_workDone.wait(lock, [this] { return m_busyWorkers == 0; });
+    } else {
+        for (size_t batch = 0; batch < batches; batch++) {
+            collideBatch(batch);
+        }
+    }
+
+    // Gathered in pair order, so the solver sees the same sequence however
+    // the batches were spread
+    m_contacts.clear();
+    for (size_t p = 0; p < pairCount; p++) {
+        if (!m_pairTouching[p]) continue;
+        if (m_contacts.size() == m_contacts.capacity()) AllocationTracker::markUnsteady();
+        m_contacts.push_back(m_pairContacts[p]);
+    }
+}
+
+void PhysicsWorld::solveContacts() {
+    for (const Contact& contact : m_contacts) {
+        Body& a = m_bodies[contact.a];
+        Body& b = m_bodies[contact.b];
+        float inverseMassSum = a.inverseMass + b.inverseMass;
+        if (inverseMassSum <= 0.0f) continue;
+
+        // Bounce only if they are still moving together
+        float approach = glm::dot(b.velocity - a.velocity, contact.normal);
+        if (approach < 0.0f) {
+            float restitution = std::min(a.restitution, b.restitution);
+            float impulse = -(1.0f + restitution) * approach / inverseMassSum;
+            a.velocity -= contact.normal * (impulse * a.inverseMass);
+            b.velocity += contact.normal * (impulse * b.inverseMass);
+        }
+
+        float correction = std::max(contact.depth - PENETRATION_SLOP, 0.0f) * CORRECTION_PERCENT / inverseMassSum;
+        a.position -= contact.normal * (correction * a.inverseMass);
+        b.position += contact.normal * (correction * b.inverseMass);
+    }
+}
+
+void PhysicsWorld::workerMain(uint64_t generation) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true) {
+        m_workAvailable.wait(lock, [this, generation] { return m_stopping || m_generation != generation; });
+        if (m_stopping) return;
+        generation = m_generation;
+
+        lock.unlock();
+        size_t batches = (m_pairs.size() + NARROWPHASE_BATCH - 1) / NARROWPHASE_BATCH;
+        size_t next;
+        while ((next = m_nextBatch.fetch_add(1)) < batches) {
+            collideBatch(next);
+        }
+        lock.lock();
+
+        if (--m_busyWorkers == 0) {
+            m_workDone.notify_one();
+        }
+    }
+}
@@ -0,0 +1,142 @@
+#include "PipelineFactory.h"
+#include "ShaderLoader.h"
+
+vk::Pipeline PipelineFactory::createGraphicsPipeline(vk::Device device, const GraphicsPipelineDesc& desc) {
+    vk::ShaderModule vertexModule = ShaderLoader::loadShader(device, ShaderLoader::shaderPath(desc.vertexShader));
+    vk::ShaderModule fragmentModule;
+    try {
+        fragmentModule = ShaderLoader::loadShader(device, ShaderLoader::shaderPath(desc.fragmentShader));
+    } catch (...) {
+        device.destroyShaderModule(vertexModule);
+        throw;
+    }
+    
+    vk::PipelineShaderStageCreateInfo stages[2]{};
+    stages[0].stage = vk::ShaderStageFlagBits::eVertex;
+    stages[0].module = vertexModule;
+    stages[0].pName = "main";
+    stages[1].stage = vk::ShaderStageFlagBits::eFragment;
+    stages[1].module = fragmentModule;
+    stages[1].pName = "main";
+    
+    std::vector<vk::SpecializationMapEntry> constantEntries;
+    for (uint32_t i = 0; i < desc.fragmentConstants.size(); i++) {
+        constantEntries.push_back({ i, i * static_cast<uint32_t>(sizeof(uint32_t)), sizeof(uint32_t) });
+    }
+    vk::SpecializationInfo specialization{};
+    specialization.mapEntryCount = static_cast<uint32_t>(constantEntries.size());
+    specialization.pMapEntries = constantEntries.data();
+    specialization.dataSize = desc.fragmentConstants.size() * sizeof(uint32_t);
+    specialization.pData = desc.fragmentConstants.data();
+    if (!constantEntries.empty()) {
+        stages[1].pSpecializationInfo = &specialization;
+    }
+    
+    vk::PipelineVertexInputStateCreateInfo vertexInput{};
+    vertexInput.vertexBindingDescriptionCount = static_cast<uint32_t>(desc.bindings.size());
+    vertexInput.pVertexBindingDescriptions = desc.bindings.data();
+    vertexInput.vertexAttributeDescriptionCount = static_cast<uint32_t>(desc.attributes.size());
+    vertexInput.pVertexAttributeDescriptions = desc.attributes.data();
+    
+    vk::PipelineInputAssemblyStateCreateInfo inputAssembly{};
+    inputAssembly.topology = desc.topology;
+    inputAssembly.primitiveRestartEnable = VK_FALSE;
+    
+    vk::PipelineViewportStateCreateInfo viewportState{};
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+    
+    vk::PipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.polygonMode = vk::PolygonMode::eFill;
+    rasterizer.cullMode = vk::CullModeFlagBits::eNone;
+    rasterizer.frontFace = vk::FrontFace::eCounterClockwise;
+    rasterizer.lineWidth = 1.0f;
+    
+    vk::PipelineMultisampleStateCreateInfo multisampling{};
+    multisampling.rasterizationSamples = vk::SampleCountFlagBits::e1;
+    
+    vk::PipelineColorBlendAttachmentState blendAttachment{};
+    blendAttachment.colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
+                                     vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
+    if (desc.blend != BlendMode::Opaque) {
+        blendAttachment.blendEnable = VK_TRUE;
+        blendAttachment.srcColorBlendFactor = vk::BlendFactor::eSrcAlpha;
+        blendAttachment.dstColorBlendFactor = desc.blend == BlendMode::Alpha ? vk::BlendFactor::eOneMinusSrcAlpha
+                                                                             : vk::BlendFactor::eOne;
+        blendAttachment.colorBlendOp = vk::BlendOp::eAdd;
+        blendAttachment.srcAlphaBlendFactor = vk::BlendFactor::eOne;
+        blendAttachment.dstAlphaBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha;
+        blendAttachment.alphaBlendOp = vk::BlendOp::eAdd;
+    }
+    
+    vk::PipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.attachmentCount = 1;
+    colorBlending.pAttachments = &blendAttachment;
+    
+    vk::DynamicState dynamicStates[] = { vk::DynamicState::eViewport, vk::DynamicState::eScissor };
+    vk::PipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates = dynamicStates;
+    
+    vk::GraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.stageCount = 2;
+    pipelineInfo.pStages = stages;
+    pipelineInfo.pVertexInputState = &vertexInput;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = desc.layout;
+    pipelineInfo.renderPass = desc.renderPass;
+    pipelineInfo.subpass = 0;
+    
+    vk::Pipeline pipeline;
+    try {
+        pipeline = device.createGraphicsPipeline(nullptr, pipelineInfo).value;
+    } catch (...) {
+        device.destroyShaderModule(vertexModule);
+        device.destroyShaderModule(fragmentModule);
+        throw;
+    }
+    
+    // Modules are only needed while the pipeline is being created
+    device.destroyShaderModule(vertexModule);
+    device.destroyShaderModule(fragmentModule);
+    return pipeline;
+}
+
+vk::Pipeline PipelineFactory::createComputePipeline(vk::Device device, const ComputePipelineDesc& desc) {
+    vk::ShaderModule module = ShaderLoader::loadShader(device, ShaderLoader::shaderPath(desc.shader));
+    
+    std::vector<vk::SpecializationMapEntry> constantEntries;
+    for (uint32_t i = 0; i < desc.constants.size(); i++) {
+        constantEntries.push_back({ i, i * static_cast<uint32_t>(sizeof(uint32_t)), sizeof(uint32_t) });
+    }
+    vk::SpecializationInfo specialization{};
+    specialization.mapEntryCount = static_cast<uint32_t>(constantEntries.size());
+    specialization.pMapEntries = constantEntries.data();
+    specialization.dataSize = desc.constants.size() * sizeof(uint32_t);
+    specialization.pData = desc.constants.data();
+    
+    vk::ComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.stage.stage = vk::ShaderStageFlagBits::eCompute;
+    pipelineInfo.stage.module = module;
+    pipelineInfo.stage.pName = "main";
+    if (!constantEntries.empty()) {
+        pipelineInfo.stage.pSpecializationInfo = &specialization;
+    }
+    pipelineInfo.layout = desc.layout;
+    
+    vk::Pipeline pipeline;
+    try {
+        pipeline = device.createComputePipeline(nullptr, pipelineInfo).value;
+    } catch (...) {
+        device.destroyShaderModule(module);
+        throw;
+    }
+    
+    device.destroyShaderModule(module);
+    return pipeline;
+}
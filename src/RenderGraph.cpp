@@ -0,0 +1,841 @@
+#include "RenderGraph.h"
+#include "DeviceMemoryTracker.h"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+struct AccessInfo {
+    vk::PipelineStageFlags stage;
+    vk::AccessFlags access;
+    vk::ImageLayout layout;
+    vk::ImageUsageFlags usage;
+    bool write;
+};
+
+AccessInfo getAccessInfo(RGAccess access) {
+    using Stage = vk::PipelineStageFlagBits;
+    using Access = vk::AccessFlagBits;
+    using Layout = vk::ImageLayout;
+    using Usage = vk::ImageUsageFlagBits;
+
+    switch (access) {
+    case RGAccess::ColorAttachmentWrite:
+        return { Stage::eColorAttachmentOutput, Access::eColorAttachmentRead | Access::eColorAttachmentWrite,
+                 Layout::eColorAttachmentOptimal, Usage::eColorAttachment, true };
+    case RGAccess::DepthAttachmentWrite:
+        return { Stage::eEarlyFragmentTests | Stage::eLateFragmentTests,
+                 Access::eDepthStencilAttachmentRead | Access::eDepthStencilAttachmentWrite,
+                 Layout::eDepthStencilAttachmentOptimal, Usage::eDepthStencilAttachment, true };
+    case RGAccess::FragmentSampled:
+        return { Stage::eFragmentShader, Access::eShaderRead, Layout::eShaderReadOnlyOptimal, Usage::eSampled, false };
+    case RGAccess::FragmentStorageRead:
+        return { Stage::eFragmentShader, Access::eShaderRead, Layout::eGeneral, Usage::eStorage, false };
+    case RGAccess::ComputeSampled:
+        return { Stage::eComputeShader, Access::eShaderRead, Layout::eShaderReadOnlyOptimal, Usage::eSampled, false };
+    case RGAccess::ComputeStorageRead:
+        return { Stage::eComputeShader, Access::eShaderRead, Layout::eGeneral, Usage::eStorage, false };
+    case RGAccess::ComputeStorageWrite:
+        return { Stage::eComputeShader, Access::eShaderWrite, Layout::eGeneral, Usage::eStorage, true };
+    case RGAccess::VertexShaderStorageRead:
+        return { Stage::eVertexShader, Access::eShaderRead, Layout::eGeneral, Usage::eStorage, false };
+    case RGAccess::VertexAttributeRead:
+        return { Stage::eVertexInput, Access::eVertexAttributeRead, Layout::eUndefined, {}, false };
+    case RGAccess::IndirectCommandRead:
+        return { Stage::eDrawIndirect, Access::eIndirectCommandRead, Layout::eUndefined, {}, false };
+    case RGAccess::TransferRead:
+        return { Stage::eTransfer, Access::eTransferRead, Layout::eTransferSrcOptimal, Usage::eTransferSrc, false };
+    case RGAccess::TransferWrite:
+        return { Stage::eTransfer, Access::eTransferWrite, Layout::eTransferDstOptimal, Usage::eTransferDst, true };
+    }
+
+    throw std::runtime_error("Unknown render graph access");
+}
+
+bool isDepthFormat(vk::Format format) {
+    switch (format) {
+    case vk::Format::eD16Unorm:
+    case vk::Format::eX8D24UnormPack32:
+    case vk::Format::eD32Sfloat:
+    case vk::Format::eD16UnormS8Uint:
+    case vk::Format::eD24UnormS8Uint:
+    case vk::Format::eD32SfloatS8Uint:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool hasStencil(vk::Format format) {
+    return format == vk::Format::eD16UnormS8Uint || format == vk::Format::eD24UnormS8Uint ||
+           format == vk::Format::eD32SfloatS8Uint;
+}
+
+// Views see depth only, so they can be sampled as well as attached
+vk::ImageAspectFlags getAspectMask(vk::Format format) {
+    return isDepthFormat(format) ? vk::ImageAspectFlagBits::eDepth : vk::ImageAspectFlagBits::eColor;
+}
+
+// Barriers on a combined depth-stencil image must name both aspects
+vk::ImageAspectFlags getBarrierAspectMask(vk::Format format) {
+    vk::ImageAspectFlags aspects = getAspectMask(format);
+    if (hasStencil(format)) aspects |= vk::ImageAspectFlagBits::eStencil;
+    return aspects;
+}
+
+bool isAttachmentAccess(RGAccess access) {
+    return access == RGAccess::ColorAttachmentWrite || access == RGAccess::DepthAttachmentWrite;
+}
+
+} // namespace
+
+// RGPassContext
+
+vk::Image RGPassContext::getImage(RGResource resource) const {
+    return graph->getImage(resource);
+}
+
+vk::ImageView RGPassContext::getImageView(RGResource resource) const {
+    return graph->getImageView(resource);
+}
+
+vk::Buffer RGPassContext::getBuffer(RGResource resource) const {
+    return graph->getBuffer(resource);
+}
+
+// RGPassBuilder
+
+RGPassBuilder& RGPassBuilder::read(RGResource resource, RGAccess access) {
+    m_graph.m_passes[m_pass].uses.push_back({ resource, access, false, true, vk::ClearValue{} });
+    return *this;
+}
+
+RGPassBuilder& RGPassBuilder::write(RGResource resource, RGAccess access) {
+    m_graph.m_passes[m_pass].uses.push_back({ resource, access, true, true, vk::ClearValue{} });
+    return *this;
+}
+
+RGPassBuilder& RGPassBuilder::writeColor(RGResource resource, const vk::ClearColorValue& clear) {
+    vk::ClearValue value;
+    value.color = clear;
+    m_graph.m_passes[m_pass].uses.push_back({ resource, RGAccess::ColorAttachmentWrite, true, false, value });
+    return *this;
+}
+
+RGPassBuilder& RGPassBuilder::writeColor(RGResource resource) {
+    return write(resource, RGAccess::ColorAttachmentWrite);
+}
+
+RGPassBuilder& RGPassBuilder::writeDepth(RGResource resource, const vk::ClearDepthStencilValue& clear) {
+    vk::ClearValue value;
+    value.depthStencil = clear;
+    m_graph.m_passes[m_pass].uses.push_back({ resource, RGAccess::DepthAttachmentWrite, true, false, value });
+    return *this;
+}
+
+RGPassBuilder& RGPassBuilder::sideEffect() {
+    m_graph.m_passes[m_pass].sideEffect = true;
+    return *this;
+}
+
+RGPassBuilder& RGPassBuilder::execute(RGExecuteCallback callback) {
+    m_graph.m_passes[m_pass].callback = std::move(callback);
+    return *this;
+}
+
+// RenderGraph
+
+RenderGraph::RenderGraph() {
+}
+
+RenderGraph::~RenderGraph() {
+    cleanup();
+}
+
+bool RenderGraph::initialize(vk::Device device, DeviceMemoryTracker& memory) {
+    m_device = device;
+    m_memory = &memory;
+    m_initialized = true;
+    return true;
+}
+
+void RenderGraph::cleanup() {
+    if (!m_initialized) return;
+
+    destroyTransients();
+    clearFramebufferCache();
+    for (auto& entry : m_renderPassCache) {
+        m_device.destroyRenderPass(entry.renderPass);
+    }
+    m_renderPassCache.clear();
+
+    reset();
+    m_initialized = false;
+}
+
+void RenderGraph::reset() {
+    m_resources.clear();
+    m_passCount = 0;
+    m_barriers.clear();
+    m_finalBarriers.clear();
+    m_compiled = false;
+}
+
+RGResource RenderGraph::importImage(const char* name, vk::Image image, vk::ImageView view,
+                                    vk::Format format, vk::Extent2D extent,
+                                    vk::ImageLayout initialLayout, vk::PipelineStageFlags initialStage,
+                                    vk::ImageLayout finalLayout) {
+    Resource resource;
+    resource.name = name;
+    resource.imported = true;
+    resource.isOutput = finalLayout != vk::ImageLayout::eUndefined;
+    resource.desc.format = format;
+    resource.desc.extent = extent;
+    resource.initialLayout = initialLayout;
+    resource.initialStage = initialStage;
+    resource.finalLayout = finalLayout;
+    resource.image = image;
+    resource.view = view;
+
+    m_resources.push_back(resource);
+    return static_cast<RGResource>(m_resources.size() - 1);
+}
+
+RGResource RenderGraph::importBuffer(const char* name, vk::Buffer buffer, vk::DeviceSize size, bool isOutput) {
+    Resource resource;
+    resource.name = name;
+    resource.isImage = false;
+    resource.imported = true;
+    resource.isOutput = isOutput;
+    resource.initialStage = vk::PipelineStageFlags{};
+    resource.buffer = buffer;
+    resource.size = size;
+
+    m_resources.push_back(resource);
+    return static_cast<RGResource>(m_resources.size() - 1);
+}
+
+RGResource RenderGraph::createImage(const char* name, const RGImageDesc& desc) {
+    Resource resource;
+    resource.name = name;
+    resource.desc = desc;
+    resource.initialStage = vk::PipelineStageFlags{};
+
+    m_resources.push_back(resource);
+    return static_cast<RGResource>(m_resources.size() - 1);
+}
+
+RGPassBuilder RenderGraph::addPass(const char* name, RGPassType type) {
+    if (m_passCount == m_passes.size()) {
+        m_passes.emplace_back();
+    }
+
+    Pass& pass = m_passes[m_passCount];
+    pass.name = name;
+    pass.type = type;
+    pass.uses.clear();
+    pass.callback = nullptr;
+    pass.sideEffect = false;
+    pass.alive = false;
+
+    return RGPassBuilder(*this, m_passCount++);
+}
+
+bool RenderGraph::compile() {
+    if (!m_initialized) return false;
+
+    m_compiled = false;
+    m_error.clear();
+    m_stats = {};
+    m_stats.declaredPasses = m_passCount;
+
+    cullPasses();
+    computeLifetimes();
+    if (!allocateTransients()) return false;
+    deriveBarriers();
+    if (!buildRenderPasses()) return false;
+
+    m_compiled = true;
+    return true;
+}
+
+void RenderGraph::execute(vk::CommandBuffer commandBuffer) {
+    if (!m_compiled) {
+        throw std::runtime_error("Render graph executed before compile");
+    }
+
+    for (uint32_t i = 0; i < m_passCount; i++) {
+        Pass& pass = m_passes[i];
+        if (!pass.alive) continue;
+
+        emitBarriers(commandBuffer, m_barriers.data() + pass.firstBarrier, pass.barrierCount,
+                     pass.srcStages, pass.dstStages);
+
+        if (m_passHook) m_passHook(commandBuffer, pass.name, true);
+
+        RGPassContext context;
+        context.commandBuffer = commandBuffer;
+        context.graph = this;
+
+        if (pass.type == RGPassType::Graphics) {
+            m_clearScratch.clear();
+            for (const auto& use : pass.uses) {
+                if (isAttachmentAccess(use.access)) {
+                    m_clearScratch.push_back(use.clear);
+                }
+            }
+
+            vk::RenderPassBeginInfo renderPassInfo{};
+            renderPassInfo.renderPass = pass.renderPass;
+            renderPassInfo.framebuffer = pass.framebuffer;
+            renderPassInfo.renderArea.offset = vk::Offset2D{ 0, 0 };
+            renderPassInfo.renderArea.extent = pass.extent;
+            renderPassInfo.clearValueCount = static_cast<uint32_t>(m_clearScratch.size());
+            renderPassInfo.pClearValues = m_clearScratch.data();
+
+            context.renderPass = pass.renderPass;
+            context.extent = pass.extent;
+
+            commandBuffer.beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
+            if (pass.callback) pass.callback(context);
+            commandBuffer.endRenderPass();
+        } else if (pass.callback) {
+            pass.callback(context);
+        }
+
+        if (m_passHook) m_passHook(commandBuffer, pass.name, false);
+    }
+
+    emitBarriers(commandBuffer, m_finalBarriers.data(), m_finalBarriers.size(),
+                 m_finalSrcStages, vk::PipelineStageFlagBits::eBottomOfPipe);
+}
+
+void RenderGraph::clearFramebufferCache() {
+    for (auto& entry : m_framebufferCache) {
+        m_device.destroyFramebuffer(entry.framebuffer);
+    }
+    m_framebufferCache.clear();
+}
+
+vk::Image RenderGraph::getImage(RGResource resource) const {
+    return m_resources[resource].image;
+}
+
+vk::ImageView RenderGraph::getImageView(RGResource resource) const {
+    return m_resources[resource].view;
+}
+
+vk::Buffer RenderGraph::getBuffer(RGResource resource) const {
+    return m_resources[resource].buffer;
+}
+
+void RenderGraph::cullPasses() {
+    // Walk backwards from the outputs: a pass survives if it has side effects
+    // or writes something a surviving pass (or an output) still needs
+    m_needed.assign(m_resources.size(), 0);
+    for (size_t i = 0; i < m_resources.size(); i++) {
+        if (m_resources[i].isOutput) m_needed[i] = 1;
+    }
+
+    for (uint32_t i = m_passCount; i-- > 0;) {
+        Pass& pass = m_passes[i];
+
+        bool alive = pass.sideEffect;
+        for (const auto& use : pass.uses) {
+            if (use.isWrite && m_needed[use.resource]) alive = true;
+        }
+        pass.alive = alive;
+        if (!alive) {
+            m_stats.culledPasses++;
+            continue;
+        }
+
+        // A full overwrite means earlier contents are no longer needed
+        for (const auto& use : pass.uses) {
+            if (use.isWrite && !use.load) m_needed[use.resource] = 0;
+        }
+        for (const auto& use : pass.uses) {
+            if (!use.isWrite || use.load) m_needed[use.resource] = 1;
+        }
+    }
+}
+
+void RenderGraph::computeLifetimes() {
+    for (auto& resource : m_resources) {
+        resource.firstPass = UINT32_MAX;
+        resource.lastPass = 0;
+        resource.usage = vk::ImageUsageFlags{};
+    }
+
+    for (uint32_t i = 0; i < m_passCount; i++) {
+        const Pass& pass = m_passes[i];
+        if (!pass.alive) continue;
+
+        for (const auto& use : pass.uses) {
+            Resource& resource = m_resources[use.resource];
+            resource.firstPass = std::min(resource.firstPass, i);
+            resource.lastPass = std::max(resource.lastPass, i);
+            resource.usage |= getAccessInfo(use.access).usage;
+        }
+    }
+}
+
+bool RenderGraph::allocateTransients() {
+    // Signature of every live transient; when it matches the previous
+    // compile the existing images and their aliasing are still valid
+    m_signatureScratch.clear();
+    for (const auto& resource : m_resources) {
+        if (resource.imported || !resource.isImage || resource.firstPass == UINT32_MAX) continue;
+        m_signatureScratch.push_back(static_cast<uint64_t>(resource.desc.format));
+        m_signatureScratch.push_back((static_cast<uint64_t>(resource.desc.extent.width) << 32) | resource.desc.extent.height);
+        m_signatureScratch.push_back(static_cast<uint64_t>(static_cast<VkImageUsageFlags>(resource.usage)));
+        m_signatureScratch.push_back((static_cast<uint64_t>(resource.firstPass) << 32) | resource.lastPass);
+    }
+
+    if (m_signatureScratch != m_transientSignature) {
+        // This graph's frame fence has signaled, so nothing still uses them
+        destroyTransients();
+        if (!createTransients()) return false;
+        m_transientSignature = m_signatureScratch;
+    } else {
+        for (const auto& physical : m_physicalImages) {
+            m_stats.transientBytesRequested += physical.size;
+        }
+    }
+
+    for (const auto& block : m_memoryBlocks) {
+        m_stats.transientBytesAllocated += block.size;
+    }
+
+    // Physical images were created in resource order
+    uint32_t next = 0;
+    for (auto& resource : m_resources) {
+        if (resource.imported || !resource.isImage || resource.firstPass == UINT32_MAX) continue;
+        resource.physicalIndex = next;
+        resource.image = m_physicalImages[next].image;
+        resource.view = m_physicalImages[next].view;
+        next++;
+    }
+
+    return true;
+}
+
+bool RenderGraph::createTransients() {
+    // A failure part way leaves null handles behind, which
+    // destroyTransients() skips
+    try {
+        std::vector<vk::MemoryRequirements> requirements;
+        for (const auto& resource : m_resources) {
+            if (resource.imported || !resource.isImage || resource.firstPass == UINT32_MAX) continue;
+
+            PhysicalImage physical;
+            physical.desc = resource.desc;
+            physical.usage = resource.usage;
+            physical.firstPass = resource.firstPass;
+            physical.lastPass = resource.lastPass;
+
+            vk::ImageCreateInfo imageInfo{};
+            imageInfo.imageType = vk::ImageType::e2D;
+            imageInfo.format = resource.desc.format;
+            imageInfo.extent = vk::Extent3D{ resource.desc.extent.width, resource.desc.extent.height, 1 };
+            imageInfo.mipLevels = 1;
+            imageInfo.arrayLayers = 1;
+            imageInfo.samples = vk::SampleCountFlagBits::e1;
+            imageInfo.tiling = vk::ImageTiling::eOptimal;
+            imageInfo.usage = resource.usage;
+            imageInfo.sharingMode = vk::SharingMode::eExclusive;
+            imageInfo.initialLayout = vk::ImageLayout::eUndefined;
+
+            physical.image = m_device.createImage(imageInfo);
+            requirements.push_back(m_device.getImageMemoryRequirements(physical.image));
+            physical.size = requirements.back().size;
+            m_physicalImages.push_back(physical);
+        }
+
+        // Interval partitioning: in order of first use, each image takes the
+        // best fitting block whose previous occupant is already dead
+        std::vector<uint32_t> order(m_physicalImages.size());
+        for (uint32_t i = 0; i < order.size(); i++) order[i] = i;
+        std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+            return m_physicalImages[a].firstPass < m_physicalImages[b].firstPass;
+        });
+
+        for (uint32_t index : order) {
+            PhysicalImage& physical = m_physicalImages[index];
+            const vk::MemoryRequirements& reqs = requirements[index];
+            m_stats.transientBytesRequested += reqs.size;
+
+            uint32_t best = UINT32_MAX;
+            for (uint32_t b = 0; b < m_memoryBlocks.size(); b++) {
+                const MemoryBlock& block = m_memoryBlocks[b];
+                if (block.availableAfterPass >= physical.firstPass) continue;
+                if ((block.memoryTypeBits & reqs.memoryTypeBits) == 0) continue;
+
+                if (best == UINT32_MAX) {
+                    best = b;
+                    continue;
+                }
+
+                // Prefer the smallest block that fits, else the largest to grow
+                const MemoryBlock& current = m_memoryBlocks[best];
+                bool fits = block.size >= reqs.size;
+                bool currentFits = current.size >= reqs.size;
+                if ((fits && (!currentFits || block.size < current.size)) ||
+                    (!fits && !currentFits && block.size > current.size)) {
+                    best = b;
+                }
+            }
+
+            if (best == UINT32_MAX) {
+                m_memoryBlocks.emplace_back();
+                best = static_cast<uint32_t>(m_memoryBlocks.size() - 1);
+            }
+
+            MemoryBlock& block = m_memoryBlocks[best];
+            block.size = std::max(block.size, reqs.size);
+            block.alignment = std::max(block.alignment, reqs.alignment);
+            block.memoryTypeBits &= reqs.memoryTypeBits;
+            block.availableAfterPass = physical.lastPass;
+            physical.block = best;
+        }
+
+        for (auto& block : m_memoryBlocks) {
+            vk::MemoryRequirements requirements{ block.size, block.alignment, block.memoryTypeBits };
+            block.memory = m_memory->allocate(requirements, vk::MemoryPropertyFlagBits::eDeviceLocal,
+                                              MemoryCategory::RenderTarget, "render graph transients");
+        }
+
+        for (auto& physical : m_physicalImages) {
+            m_device.bindImageMemory(physical.image, m_memoryBlocks[physical.block].memory, 0);
+
+            vk::ImageViewCreateInfo viewInfo{};
+            viewInfo.image = physical.image;
+            viewInfo.viewType = vk::ImageViewType::e2D;
+            viewInfo.format = physical.desc.format;
+            viewInfo.subresourceRange.aspectMask = getAspectMask(physical.desc.format);
+            viewInfo.subresourceRange.baseMipLevel = 0;
+            viewInfo.subresourceRange.levelCount = 1;
+            viewInfo.subresourceRange.baseArrayLayer = 0;
+            viewInfo.subresourceRange.layerCount = 1;
+            physical.view = m_device.createImageView(viewInfo);
+        }
+    } catch (const std::exception& e) {
+        m_error = std::string("Couldn't create the transient images: ") + e.what();
+        destroyTransients();
+        return false;
+    }
+
+    return true;
+}
+
+void RenderGraph::destroyTransients() {
+    // Framebuffers may reference the transient views
+    clearFramebufferCache();
+
+    for (auto& physical : m_physicalImages) {
+        m_device.destroyImageView(physical.view);
+        m_device.destroyImage(physical.image);
+    }
+    m_physicalImages.clear();
+
+    for (auto& block : m_memoryBlocks) {
+        m_memory->free(block.memory);
+    }
+    m_memoryBlocks.clear();
+    m_transientSignature.clear();
+}
+
+void RenderGraph::deriveBarriers() {
+    m_states.assign(m_resources.size(), ResourceState{});
+    for (size_t i = 0; i < m_resources.size(); i++) {
+        m_states[i].layout = m_resources[i].initialLayout;
+        m_states[i].writeStages = m_resources[i].initialStage;
+    }
+    m_blockStages.assign(m_memoryBlocks.size(), vk::PipelineStageFlags{});
+    m_blockWriteAccess.assign(m_memoryBlocks.size(), vk::AccessFlags{});
+    m_barriers.clear();
+
+    for (uint32_t i = 0; i < m_passCount; i++) {
+        Pass& pass = m_passes[i];
+        if (!pass.alive) continue;
+
+        pass.firstBarrier = m_barriers.size();
+        pass.srcStages = vk::PipelineStageFlags{};
+        pass.dstStages = vk::PipelineStageFlags{};
+
+        for (const auto& use : pass.uses) {
+            const Resource& resource = m_resources[use.resource];
+            ResourceState& state = m_states[use.resource];
+            AccessInfo info = getAccessInfo(use.access);
+
+            vk::ImageLayout newLayout = resource.isImage ? info.layout : vk::ImageLayout::eUndefined;
+            bool layoutChange = resource.isImage && state.layout != newLayout;
+            bool discard = use.isWrite && !use.load;
+
+            vk::PipelineStageFlags srcStages;
+            vk::AccessFlags srcAccess;
+            bool needsBarrier = false;
+
+            if (info.write || layoutChange) {
+                // Writes and layout transitions wait for the last write and
+                // every read since; reads only need an execution dependency
+                srcStages = state.writeStages | state.readStages;
+                srcAccess = state.writeAccess;
+                needsBarrier = static_cast<bool>(srcStages) || layoutChange;
+            } else if (state.writeStages) {
+                // Reads already made visible to this stage need nothing more
+                bool covered = (state.readStages & info.stage) == info.stage &&
+                               (state.readAccess & info.access) == info.access;
+                if (!covered) {
+                    srcStages = state.writeStages;
+                    srcAccess = state.writeAccess;
+                    needsBarrier = true;
+                }
+            }
+
+            // The first use of an aliased transient waits for the previous
+            // occupant of its memory block, whose writes must also be made
+            // available before this one overwrites the memory
+            if (resource.physicalIndex != UINT32_MAX && resource.firstPass == i) {
+                uint32_t block = m_physicalImages[resource.physicalIndex].block;
+                if (m_blockStages[block]) {
+                    srcStages |= m_blockStages[block];
+                    srcAccess |= m_blockWriteAccess[block];
+                    needsBarrier = true;
+                }
+            }
+
+            if (needsBarrier) {
+                Barrier barrier;
+                barrier.resource = use.resource;
+                barrier.srcAccess = srcAccess;
+                barrier.dstAccess = info.access;
+                barrier.oldLayout = discard ? vk::ImageLayout::eUndefined : state.layout;
+                barrier.newLayout = newLayout;
+                m_barriers.push_back(barrier);
+
+                pass.srcStages |= srcStages;
+                pass.dstStages |= info.stage;
+            }
+
+            if (info.write) {
+                state.writeStages = info.stage;
+                state.writeAccess = info.access;
+                state.readStages = vk::PipelineStageFlags{};
+                state.readAccess = vk::AccessFlags{};
+            } else if (layoutChange) {
+                state.readStages = info.stage;
+                state.readAccess = info.access;
+            } else {
+                state.readStages |= info.stage;
+                state.readAccess |= info.access;
+            }
+            state.layout = newLayout;
+
+            if (resource.physicalIndex != UINT32_MAX) {
+                uint32_t block = m_physicalImages[resource.physicalIndex].block;
+                m_blockStages[block] |= info.stage;
+                if (info.write) m_blockWriteAccess[block] |= info.access;
+            }
+        }
+
+        pass.barrierCount = m_barriers.size() - pass.firstBarrier;
+        m_stats.barriers += static_cast<uint32_t>(pass.barrierCount);
+    }
+
+    // Leave imported images in the layout the caller asked for
+    m_finalBarriers.clear();
+    m_finalSrcStages = vk::PipelineStageFlags{};
+    for (size_t i = 0; i < m_resources.size(); i++) {
+        const Resource& resource = m_resources[i];
+        const ResourceState& state = m_states[i];
+        if (!resource.imported || !resource.isImage || resource.finalLayout == vk::ImageLayout::eUndefined) continue;
+        if (state.layout == resource.finalLayout) continue;
+
+        Barrier barrier;
+        barrier.resource = static_cast<RGResource>(i);
+        barrier.srcAccess = state.writeAccess;
+        barrier.dstAccess = vk::AccessFlags{};
+        barrier.oldLayout = state.layout;
+        barrier.newLayout = resource.finalLayout;
+        m_finalBarriers.push_back(barrier);
+        m_finalSrcStages |= state.writeStages | state.readStages;
+    }
+    m_stats.barriers += static_cast<uint32_t>(m_finalBarriers.size());
+}
+
+bool RenderGraph::buildRenderPasses() {
+    for (uint32_t i = 0; i < m_passCount; i++) {
+        Pass& pass = m_passes[i];
+        if (!pass.alive || pass.type != RGPassType::Graphics) continue;
+
+        m_viewScratch.clear();
+        pass.extent = vk::Extent2D{};
+        for (const auto& use : pass.uses) {
+            if (!isAttachmentAccess(use.access)) continue;
+            const Resource& resource = m_resources[use.resource];
+            m_viewScratch.push_back(resource.view);
+            pass.extent = resource.desc.extent;
+        }
+
+        if (m_viewScratch.empty()) {
+            m_error = std::string("Graphics pass without attachments: ") + pass.name;
+            return false;
+        }
+
+        try {
+            pass.renderPass = getRenderPass(pass);
+            pass.framebuffer = getFramebuffer(pass.renderPass, pass.extent);
+        } catch (const vk::SystemError& e) {
+            m_error = std::string("Couldn't create the render pass for ") + pass.name + ": " + e.what();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+vk::RenderPass RenderGraph::getRenderPass(const Pass& pass) {
+    uint32_t passIndex = static_cast<uint32_t>(&pass - m_passes.data());
+
+    // Layouts are fixed per attachment type, so format and load/store ops
+    // fully describe the render pass
+    m_keyScratch.clear();
+    for (const auto& use : pass.uses) {
+        if (!isAttachmentAccess(use.access)) continue;
+        const Resource& resource = m_resources[use.resource];
+        bool store = resource.isOutput || resource.imported || resource.lastPass > passIndex;
+        m_keyScratch.push_back((static_cast<uint64_t>(resource.desc.format) << 8) |
+                               (static_cast<uint64_t>(use.load) << 1) | static_cast<uint64_t>(store));
+    }
+
+    for (const auto& entry : m_renderPassCache) {
+        if (entry.key == m_keyScratch) return entry.renderPass;
+    }
+
+    std::vector<vk::AttachmentDescription> attachments;
+    std::vector<vk::AttachmentReference> colorRefs;
+    vk::AttachmentReference depthRef{};
+    bool hasDepth = false;
+
+    for (const auto& use : pass.uses) {
+        if (!isAttachmentAccess(use.access)) continue;
+        const Resource& resource = m_resources[use.resource];
+        bool store = resource.isOutput || resource.imported || resource.lastPass > passIndex;
+        vk::ImageLayout layout = getAccessInfo(use.access).layout;
+
+        // Layout transitions happen in the graph's barriers, not here
+        vk::AttachmentDescription attachment{};
+        attachment.format = resource.desc.format;
+        attachment.samples = vk::SampleCountFlagBits::e1;
+        attachment.loadOp = use.load ? vk::AttachmentLoadOp::eLoad : vk::AttachmentLoadOp::eClear;
+        attachment.storeOp = store ? vk::AttachmentStoreOp::eStore : vk::AttachmentStoreOp::eDontCare;
+        attachment.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
+        attachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+        attachment.initialLayout = layout;
+        attachment.finalLayout = layout;
+
+        vk::AttachmentReference reference{};
+        reference.attachment = static_cast<uint32_t>(attachments.size());
+        reference.layout = layout;
+        if (use.access == RGAccess::DepthAttachmentWrite) {
+            depthRef = reference;
+            hasDepth = true;
+        } else {
+            colorRefs.push_back(reference);
+        }
+        attachments.push_back(attachment);
+    }
+
+    vk::SubpassDescription subpass{};
+    subpass.pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
+    subpass.colorAttachmentCount = static_cast<uint32_t>(colorRefs.size());
+    subpass.pColorAttachments = colorRefs.data();
+    subpass.pDepthStencilAttachment = hasDepth ? &depthRef : nullptr;
+
+    vk::RenderPassCreateInfo renderPassInfo{};
+    renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+    renderPassInfo.pAttachments = attachments.data();
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+
+    RenderPassEntry entry;
+    entry.key = m_keyScratch;
+    entry.renderPass = m_device.createRenderPass(renderPassInfo);
+    m_renderPassCache.push_back(entry);
+    return entry.renderPass;
+}
+
+vk::Framebuffer RenderGraph::getFramebuffer(vk::RenderPass renderPass, vk::Extent2D extent) {
+    for (const auto& entry : m_framebufferCache) {
+        if (entry.renderPass == renderPass && entry.views == m_viewScratch &&
+            entry.extent.width == extent.width && entry.extent.height == extent.height) {
+            return entry.framebuffer;
+        }
+    }
+
+    vk::FramebufferCreateInfo framebufferInfo{};
+    framebufferInfo.renderPass = renderPass;
+    framebufferInfo.attachmentCount = static_cast<uint32_t>(m_viewScratch.size());
+    framebufferInfo.pAttachments = m_viewScratch.data();
+    framebufferInfo.width = extent.width;
+    framebufferInfo.height = extent.height;
+    framebufferInfo.layers = 1;
+
+    FramebufferEntry entry;
+    entry.renderPass = renderPass;
+    entry.views = m_viewScratch;
+    entry.extent = extent;
+    entry.framebuffer = m_device.createFramebuffer(framebufferInfo);
+    m_framebufferCache.push_back(entry);
+    return entry.framebuffer;
+}
+
+void RenderGraph::emitBarriers(vk::CommandBuffer commandBuffer, const Barrier* barriers, size_t count,
+                               vk::PipelineStageFlags srcStages, vk::PipelineStageFlags dstStages) {
+    if (count == 0) return;
+
+    m_imageBarrierScratch.clear();
+    m_bufferBarrierScratch.clear();
+
+    for (size_t i = 0; i < count; i++) {
+        const Barrier& barrier = barriers[i];
+        const Resource& resource = m_resources[barrier.resource];
+
+        if (resource.isImage) {
+            vk::ImageMemoryBarrier imageBarrier{};
+            imageBarrier.srcAccessMask = barrier.srcAccess;
+            imageBarrier.dstAccessMask = barrier.dstAccess;
+            imageBarrier.oldLayout = barrier.oldLayout;
+            imageBarrier.newLayout = barrier.newLayout;
+            imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            imageBarrier.image = resource.image;
+            imageBarrier.subresourceRange.aspectMask = getBarrierAspectMask(resource.desc.format);
+            imageBarrier.subresourceRange.baseMipLevel = 0;
+            imageBarrier.subresourceRange.levelCount = 1;
+            imageBarrier.subresourceRange.baseArrayLayer = 0;
+            imageBarrier.subresourceRange.layerCount = 1;
+            m_imageBarrierScratch.push_back(imageBarrier);
+        } else {
+            vk::BufferMemoryBarrier bufferBarrier{};
+            bufferBarrier.srcAccessMask = barrier.srcAccess;
+            bufferBarrier.dstAccessMask = barrier.dstAccess;
+            bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            bufferBarrier.buffer = resource.buffer;
+            bufferBarrier.offset = 0;
+            bufferBarrier.size = VK_WHOLE_SIZE;
+            m_bufferBarrierScratch.push_back(bufferBarrier);
+        }
+    }
+
+    if (!srcStages) srcStages = vk::PipelineStageFlagBits::eTopOfPipe;
+    if (!dstStages) dstStages = vk::PipelineStageFlagBits::eBottomOfPipe;
+
+    commandBuffer.pipelineBarrier(srcStages, dstStages, vk::DependencyFlags{},
+                                  0, nullptr,
+                                  static_cast<uint32_t>(m_bufferBarrierScratch.size()), m_bufferBarrierScratch.data(),
+                                  static_cast<uint32_t>(m_imageBarrierScratch.size()), m_imageBarrierScratch.data());
+}
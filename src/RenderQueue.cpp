@@ -0,0 +1,153 @@
+#include "RenderQueue.h"
+#include "VulkanRenderer.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+void radixSortRenderKeys(RenderSortEntry* entries, RenderSortEntry* scratch, size_t count) {
+    if (count < 2) return;
+
+    // Common when one system submitted everything: nothing to do
+    bool sorted = true;
+    for (size_t i = 1; i < count; i++) {
+        if (entries[i - 1].key > entries[i].key) {
+            sorted = false;
+            break;
+        }
+    }
+    if (sorted) return;
+
+    // All eight histograms in one read of the keys
+    size_t histograms[8][256] = {};
+    for (size_t i = 0; i < count; i++) {
+        uint64_t key = entries[i].key;
+        for (int pass = 0; pass < 8; pass++) {
+            histograms[pass][(key >> (pass * 8)) & 0xFF]++;
+        }
+    }
+
+    RenderSortEntry* source = entries;
+    RenderSortEntry* destination = scratch;
+    for (int pass = 0; pass < 8; pass++) {
+        int shift = pass * 8;
+        size_t* histogram = histograms[pass];
+        // Every key has the same byte here; the pass wouldn't move anything
+        if (histogram[(source[0].key >> shift) & 0xFF] == count) continue;
+
+        size_t offset = 0;
+        for (int digit = 0; digit < 256; digit++) {
+            size_t digitCount = histogram[digit];
+            histogram[digit] = offset;
+            offset += digitCount;
+        }
+        for (size_t i = 0; i < count; i++) {
+            destination[histogram[(source[i].key >> shift) & 0xFF]++] = source[i];
+        }
+        std::swap(source, destination);
+    }
+
+    if (source != entries) {
+        std::memcpy(entries, source, count * sizeof(RenderSortEntry));
+    }
+}
+
+RenderQueue::RenderQueue() {
+}
+
+RenderQueue::~RenderQueue() {
+}
+
+uint32_t RenderQueue::registerPipeline(vk::Pipeline pipeline) {
+    std::lock_guard<std::mutex> lock(m_pipelineMutex);
+    for (size_t i = 0; i < m_pipelines.size(); i++) {
+        if (m_pipelines[i] == pipeline) return static_cast<uint32_t>(i);
+    }
+    if (m_pipelines.size() >= MAX_PIPELINES) {
+        throw std::runtime_error("Too many pipelines registered with the render queue");
+    }
+    m_pipelines.push_back(pipeline);
+    return static_cast<uint32_t>(m_pipelines.size() - 1);
+}
+
+void RenderQueue::submit(uint64_t key, const RenderDraw& draw) {
+    // flush copies pushData into a PUSH_CONSTANT_SIZE shadow at pushOffset;
+    // a range past either would overrun one of them
+    if (draw.pushSize > RenderDraw::MAX_PUSH_BYTES ||
+        draw.pushOffset > DescriptorManager::PUSH_CONSTANT_SIZE - draw.pushSize) {
+        assert(!"Draw push constants outside RenderDraw::pushData or the layout's range");
+        return;
+    }
+    m_entries.push_back(RenderSortEntry{ key, static_cast<uint32_t>(m_draws.size()), 0 });
+    m_draws.push_back(draw);
+}
+
+void RenderQueue::flush(VulkanRenderer& renderer, vk::CommandBuffer commandBuffer) {
+    m_lastStats = RenderQueueStats{};
+    if (m_draws.empty()) return;
+
+    m_scratch.resize(m_entries.size());
+    radixSortRenderKeys(m_entries.data(), m_scratch.data(), m_entries.size());
+
+    vk::PipelineLayout layout = renderer.getPipelineLayout();
+    renderer.getDescriptorManager().bindGlobalSets(commandBuffer, vk::PipelineBindPoint::eGraphics, layout);
+
+    // What the previous draw left bound. Push constants stay valid across
+    // pipeline changes because every pipeline shares the layout; only the
+    // leading pushedBytes of the shadow are known
+    uint32_t boundPipeline = UINT32_MAX;
+    vk::Buffer boundVertexBuffer;
+    uint8_t pushed[DescriptorManager::PUSH_CONSTANT_SIZE];
+    uint32_t pushedBytes = 0;
+
+    for (const RenderSortEntry& entry : m_entries) {
+        const RenderDraw& draw = m_draws[entry.index];
+
+        if (draw.pipeline != boundPipeline) {
+            commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, m_pipelines[draw.pipeline]);
+            boundPipeline = draw.pipeline;
+            m_lastStats.pipelineBinds++;
+        } else {
+            m_lastStats.skippedBinds++;
+        }
+
+        // drawMesh binds its own vertex and index buffers, unless the mesh is empty
+        if (draw.mesh) {
+            if (draw.mesh->indexCount > 0) {
+                boundVertexBuffer = draw.mesh->vertexBuffer;
+                m_lastStats.vertexBufferBinds++;
+            }
+        } else if (draw.vertexBuffer != boundVertexBuffer) {
+            vk::DeviceSize offset = 0;
+            commandBuffer.bindVertexBuffers(0, 1, &draw.vertexBuffer, &offset);
+            boundVertexBuffer = draw.vertexBuffer;
+            m_lastStats.vertexBufferBinds++;
+        } else {
+            m_lastStats.skippedBinds++;
+        }
+
+        if (draw.pushSize > 0) {
+            uint32_t end = draw.pushOffset + draw.pushSize;
+            if (end <= pushedBytes && std::memcmp(pushed + draw.pushOffset, draw.pushData, draw.pushSize) == 0) {
+                m_lastStats.skippedBinds++;
+            } else {
+                commandBuffer.pushConstants(layout, DescriptorManager::PUSH_CONSTANT_STAGES, draw.pushOffset,
+                                            draw.pushSize, draw.pushData);
+                std::memcpy(pushed + draw.pushOffset, draw.pushData, draw.pushSize);
+                if (draw.pushOffset <= pushedBytes) pushedBytes = std::max(pushedBytes, end);
+                m_lastStats.pushes++;
+            }
+        }
+
+        if (draw.mesh) {
+            renderer.drawMesh(commandBuffer, *draw.mesh, draw.instanceCount);
+        } else {
+            commandBuffer.draw(draw.vertexCount, draw.instanceCount, draw.firstVertex, draw.firstInstance);
+            renderer.countDraw(draw.vertexCount, draw.instanceCount);
+        }
+        m_lastStats.draws++;
+    }
+
+    m_draws.clear();
+    m_entries.clear();
+}
@@ -30,4 +30,12 @@ vk::ShaderModule ShaderLoader::createShaderModule(vk::Device device, const std::
 vk::ShaderModule ShaderLoader::loadShader(vk::Device device, const std::string& filename) {
     auto code = readFile(filename);
     return createShaderModule(device, code);
-} 
\ No newline at end of file
+}
+
+std::string ShaderLoader::shaderPath(const std::string& name) {
+#ifdef CGAME_SHADER_DIR
+    return std::string(CGAME_SHADER_DIR) + "/" + name + ".spv";
+#else
+    return "shaders/" + name + ".spv";
+#endif
+}
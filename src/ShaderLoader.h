@@ -11,4 +11,7 @@ public:
     static std::vector<char> readFile(const std::string& filename);
     static vk::ShaderModule createShaderModule(vk::Device device, const std::vector<char>& code);
     static vk::ShaderModule loadShader(vk::Device device, const std::string& filename);
+
+    // Location of a compiled shader, e.g. shaderPath("hud.vert") for hud.vert.spv
+    static std::string shaderPath(const std::string& name);
 }; 
\ No newline at end of file
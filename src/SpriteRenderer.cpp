@@ -0,0 +1,237 @@
+#include "SpriteRenderer.h"
+#include "VulkanRenderer.h"
+#include "AllocationTracker.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+struct SpritePushConstants {
+    float cameraCenter[2];
+    float worldToClip[2];
+};
+
+// Half extent of a rotated sprite's bounding square relative to its largest
+// side (sqrt(2) / 2, rounded up)
+constexpr float ROTATED_HALF_EXTENT = 0.7072f;
+
+// Sorted sprites can share an instanced draw while layer and pipeline match
+bool sameBatch(uint64_t a, uint64_t b) {
+    return (a >> 56) == (b >> 56) && ((a >> 20) & 0xFFF) == ((b >> 20) & 0xFFF);
+}
+
+} // namespace
+
+size_t cullSprites(const SpriteInstance* sprites, size_t count, const SpriteBounds& view,
+                   SpriteInstance* visible) {
+    size_t kept = 0;
+    for (size_t i = 0; i < count; i++) {
+        const SpriteInstance& sprite = sprites[i];
+        float radius = ROTATED_HALF_EXTENT * std::max(sprite.size.x, sprite.size.y);
+        // Non-short-circuit tests so the four compares can be evaluated together
+        bool inside = (sprite.position.x + radius >= view.minX) & (sprite.position.x - radius <= view.maxX) &
+                      (sprite.position.y + radius >= view.minY) & (sprite.position.y - radius <= view.maxY);
+        if (inside) {
+            visible[kept++] = sprite;
+        }
+    }
+    return kept;
+}
+
+SpriteRenderer::SpriteRenderer() {
+}
+
+SpriteRenderer::~SpriteRenderer() {
+    cleanup();
+}
+
+bool SpriteRenderer::initialize(VulkanRenderer& renderer, uint32_t framesInFlight, uint32_t maxSprites) {
+    m_renderer = &renderer;
+    m_device = renderer.getDevice();
+    m_pipelineLayout = renderer.getPipelineLayout();
+    m_maxSprites = maxSprites;
+
+    // Untextured sprites sample this
+    const uint32_t white = 0xFFFFFFFF;
+    m_whiteTexture = renderer.createTexture(1, 1, vk::Format::eR8G8B8A8Unorm, &white, sizeof(white));
+
+    vk::DeviceSize size = sizeof(SpriteInstance) * static_cast<vk::DeviceSize>(maxSprites);
+    m_frames.resize(framesInFlight);
+    for (auto& frame : m_frames) {
+        renderer.createBuffer(size, vk::BufferUsageFlagBits::eVertexBuffer,
+            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+            frame.buffer, frame.memory, "sprite instances");
+        frame.mapped = static_cast<SpriteInstance*>(m_device.mapMemory(frame.memory, 0, size));
+    }
+    m_visible.resize(maxSprites);
+    m_sortEntries.resize(maxSprites);
+    m_sortScratch.resize(maxSprites);
+
+    m_initialized = true;
+    createMaterial(BlendMode::Alpha, 0);
+    return true;
+}
+
+void SpriteRenderer::cleanup() {
+    if (!m_initialized) return;
+
+    for (auto& material : m_materials) {
+        m_device.destroyPipeline(material.pipeline);
+    }
+    m_materials.clear();
+
+    for (auto& frame : m_frames) {
+        if (frame.mapped) m_device.unmapMemory(frame.memory);
+        m_renderer->destroyBuffer(frame.buffer, frame.memory);
+    }
+    m_frames.clear();
+    m_visible = std::vector<SpriteInstance>();
+    m_sortEntries = std::vector<RenderSortEntry>();
+    m_sortScratch = std::vector<RenderSortEntry>();
+
+    m_renderer->destroyTexture(m_whiteTexture);
+    m_initialized = false;
+}
+
+GraphicsPipelineDesc SpriteRenderer::getPipelineDesc(VulkanRenderer& renderer, BlendMode blend,
+                                                     uint32_t shadingVariant) {
+    GraphicsPipelineDesc desc;
+    desc.vertexShader = "sprite.vert";
+    desc.fragmentShader = "sprite.frag";
+    desc.bindings = { { 0, sizeof(SpriteInstance), vk::VertexInputRate::eInstance } };
+    desc.attributes = {
+        { 0, 0, vk::Format::eR32G32Sfloat, offsetof(SpriteInstance, position) },
+        { 1, 0, vk::Format::eR32G32Sfloat, offsetof(SpriteInstance, size) },
+        { 2, 0, vk::Format::eR32Sfloat, offsetof(SpriteInstance, rotation) },
+        { 3, 0, vk::Format::eR32Uint, offsetof(SpriteInstance, textureIndex) },
+        { 4, 0, vk::Format::eR8G8B8A8Unorm, offsetof(SpriteInstance, color) }
+    };
+    desc.blend = blend;
+    // Additive sprites (particles, glows) give off light rather than take it
+    desc.fragmentConstants = { shadingVariant, blend == BlendMode::Additive ? 0u : 1u };
+    desc.layout = renderer.getPipelineLayout();
+    desc.renderPass = renderer.getRenderPass();
+    return desc;
+}
+
+SpriteMaterial SpriteRenderer::createMaterial(BlendMode blend, uint32_t shadingVariant) {
+    for (size_t i = 0; i < m_materials.size(); i++) {
+        if (m_materials[i].blend == blend && m_materials[i].variant == shadingVariant) {
+            return static_cast<SpriteMaterial>(i);
+        }
+    }
+
+    // Pipeline creation allocates; frames after it are not steady yet
+    AllocationTracker::markUnsteady();
+
+    GraphicsPipelineDesc desc = getPipelineDesc(*m_renderer, blend, shadingVariant);
+    Material material(m_renderer->getFrameArena());
+    material.blend = blend;
+    material.variant = shadingVariant;
+    material.pipeline = PipelineFactory::createGraphicsPipeline(m_device, desc);
+    material.pipelineId = m_renderer->getRenderQueue().registerPipeline(material.pipeline);
+    m_materials.push_back(std::move(material));
+    return static_cast<SpriteMaterial>(m_materials.size() - 1);
+}
+
+void SpriteRenderer::setCamera(glm::vec2 center, float zoom) {
+    m_cameraCenter = center;
+    m_zoom = std::max(zoom, 1e-4f);
+}
+
+SpriteBounds SpriteRenderer::getViewBounds(vk::Extent2D extent) const {
+    float halfWidth = extent.width * 0.5f / m_zoom;
+    float halfHeight = extent.height * 0.5f / m_zoom;
+    return SpriteBounds{ m_cameraCenter.x - halfWidth, m_cameraCenter.y - halfHeight,
+                         m_cameraCenter.x + halfWidth, m_cameraCenter.y + halfHeight };
+}
+
+void SpriteRenderer::beginFrame(FrameArena& arena) {
+    for (auto& material : m_materials) {
+        material.pending = ArenaVector<SpriteInstance>(ArenaAllocator<SpriteInstance>(arena));
+        material.pending.reserve(material.lastCount);
+    }
+}
+
+void SpriteRenderer::draw(const SpriteInstance& sprite, SpriteMaterial material, uint8_t layer, float depth) {
+    if (material < m_materials.size()) {
+        auto& pending = m_materials[material].pending;
+        pending.push_back(sprite);
+        pending.back().sortOrder = packRenderOrder(layer, depth);
+    }
+}
+
+void SpriteRenderer::draw(const SpriteInstance* sprites, size_t count, SpriteMaterial material, uint8_t layer,
+                          float depth) {
+    if (material < m_materials.size()) {
+        auto& pending = m_materials[material].pending;
+        size_t first = pending.size();
+        pending.insert(pending.end(), sprites, sprites + count);
+
+        uint32_t order = packRenderOrder(layer, depth);
+        for (size_t i = first; i < pending.size(); i++) {
+            pending[i].sortOrder = order;
+        }
+    }
+}
+
+void SpriteRenderer::submit(RenderQueue& queue, vk::Extent2D extent, uint32_t frameIndex) {
+    m_lastSubmitted = 0;
+    m_lastVisible = 0;
+    m_lastBatches = 0;
+    if (!m_initialized) return;
+
+    SpriteBounds view = getViewBounds(extent);
+    size_t visible = 0;
+
+    for (auto& material : m_materials) {
+        material.lastCount = material.pending.size();
+        if (material.pending.empty()) continue;
+        m_lastSubmitted += static_cast<uint32_t>(material.pending.size());
+
+        // Sprites past the instance buffer's capacity are dropped
+        size_t count = std::min(material.pending.size(), m_maxSprites - visible);
+        size_t kept = cullSprites(material.pending.data(), count, view, m_visible.data() + visible);
+        material.pending.clear();
+
+        for (size_t i = visible; i < visible + kept; i++) {
+            const SpriteInstance& sprite = m_visible[i];
+            m_sortEntries[i] = RenderSortEntry{
+                makeRenderKey(sprite.sortOrder, material.pipelineId, sprite.textureIndex),
+                static_cast<uint32_t>(i), 0 };
+        }
+        visible += kept;
+    }
+    if (visible == 0) return;
+
+    radixSortRenderKeys(m_sortEntries.data(), m_sortScratch.data(), visible);
+
+    SpritePushConstants constants{};
+    constants.cameraCenter[0] = m_cameraCenter.x;
+    constants.cameraCenter[1] = m_cameraCenter.y;
+    constants.worldToClip[0] = 2.0f * m_zoom / extent.width;
+    constants.worldToClip[1] = 2.0f * m_zoom / extent.height;
+
+    RenderDraw draw;
+    draw.vertexBuffer = m_frames[frameIndex].buffer;
+    draw.vertexCount = 6;
+    draw.pushSize = sizeof(constants);
+    std::memcpy(draw.pushData, &constants, sizeof(constants));
+
+    SpriteInstance* mapped = m_frames[frameIndex].mapped;
+    size_t batchStart = 0;
+    for (size_t i = 0; i < visible; i++) {
+        mapped[i] = m_visible[m_sortEntries[i].index];
+
+        uint64_t batchKey = m_sortEntries[batchStart].key;
+        if (i + 1 < visible && sameBatch(m_sortEntries[i + 1].key, batchKey)) continue;
+
+        draw.pipeline = static_cast<uint32_t>((batchKey >> 20) & 0xFFF);
+        draw.instanceCount = static_cast<uint32_t>(i + 1 - batchStart);
+        draw.firstInstance = static_cast<uint32_t>(batchStart);
+        queue.submit(batchKey, draw);
+        m_lastBatches++;
+        batchStart = i + 1;
+    }
+    m_lastVisible = static_cast<uint32_t>(visible);
+}
@@ -0,0 +1,214 @@
+#include "TaskGraph.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+// Notes of the task running on this thread
+thread_local std::vector<std::string>* t_notes = nullptr;
+
+} // namespace
+
+TaskGraph::TaskId TaskGraph::addTask(const std::string& name, TaskFunction function,
+                                     std::initializer_list<TaskId> dependencies) {
+    TaskId id = static_cast<TaskId>(m_tasks.size());
+    for (TaskId dependency : dependencies) {
+        if (dependency >= id) {
+            throw std::runtime_error("Task '" + name + "' depends on a task added after it");
+        }
+        m_tasks[dependency].dependents.push_back(id);
+    }
+
+    Task task;
+    task.function = std::move(function);
+    task.dependencies = dependencies;
+    m_tasks.push_back(std::move(task));
+
+    TaskTiming timing;
+    timing.name = name;
+    m_timings.push_back(timing);
+    return id;
+}
+
+TaskGraph::TaskId TaskGraph::addCallingThreadTask(const std::string& name, TaskFunction function,
+                                                  std::initializer_list<TaskId> dependencies) {
+    TaskId id = addTask(name, std::move(function), dependencies);
+    m_tasks[id].callingThreadOnly = true;
+    return id;
+}
+
+bool TaskGraph::run(uint32_t maxThreads) {
+    using Clock = std::chrono::steady_clock;
+
+    if (maxThreads == 0) {
+        maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<TaskId> ready;
+    std::vector<TaskId> readyCallingThread;
+    std::vector<uint32_t> waitingOn(m_tasks.size());
+    size_t unfinished = m_tasks.size();
+    bool failed = false;
+
+    for (TaskId id = 0; id < m_tasks.size(); id++) {
+        m_timings[id].status = TaskStatus::Pending;
+        waitingOn[id] = static_cast<uint32_t>(m_tasks[id].dependencies.size());
+        if (waitingOn[id] == 0) {
+            (m_tasks[id].callingThreadOnly ? readyCallingThread : ready).push_back(id);
+        }
+    }
+    // Run in declaration order when several tasks are ready
+    std::reverse(ready.begin(), ready.end());
+    std::reverse(readyCallingThread.begin(), readyCallingThread.end());
+
+    const Clock::time_point start = Clock::now();
+    auto elapsedMs = [&start]() {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    };
+
+    auto worker = [&](uint32_t threadIndex) {
+        // Only the calling thread (index 0) takes calling-thread tasks
+        std::vector<TaskId>* own = threadIndex == 0 ? &readyCallingThread : nullptr;
+        auto hasWork = [&] { return !ready.empty() || (own && !own->empty()); };
+
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [&] { return unfinished == 0 || failed || hasWork(); });
+            if (unfinished == 0 || (failed && !hasWork())) return;
+            if (!hasWork()) continue;
+
+            std::vector<TaskId>& queue = (own && !own->empty()) ? *own : ready;
+            TaskId id = queue.back();
+            queue.pop_back();
+
+            if (failed) {
+                m_timings[id].status = TaskStatus::Skipped;
+                unfinished--;
+                continue;
+            }
+
+            lock.unlock();
+            TaskTiming result;
+            result.startMs = elapsedMs();
+            result.thread = threadIndex;
+            bool succeeded = false;
+            t_notes = &result.notes;
+            try {
+                succeeded = m_tasks[id].function();
+            } catch (const std::exception& e) {
+                result.error = e.what();
+            }
+            t_notes = nullptr;
+            result.durationMs = elapsedMs() - result.startMs;
+            lock.lock();
+
+            TaskTiming& timing = m_timings[id];
+            timing.startMs = result.startMs;
+            timing.durationMs = result.durationMs;
+            timing.thread = result.thread;
+            timing.error = std::move(result.error);
+            timing.notes = std::move(result.notes);
+            timing.status = succeeded ? TaskStatus::Succeeded : TaskStatus::Failed;
+            unfinished--;
+
+            if (!succeeded) {
+                failed = true;
+            } else {
+                for (TaskId dependent : m_tasks[id].dependents) {
+                    if (--waitingOn[dependent] == 0) {
+                        (m_tasks[dependent].callingThreadOnly ? readyCallingThread : ready).push_back(dependent);
+                    }
+                }
+            }
+            wake.notify_all();
+        }
+    };
+
+    uint32_t threadCount = static_cast<uint32_t>(std::min<size_t>(maxThreads, std::max<size_t>(m_tasks.size(), 1)));
+    std::vector<std::thread> threads;
+    for (uint32_t i = 1; i < threadCount; i++) {
+        threads.emplace_back(worker, i);
+    }
+    worker(0);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    m_wallTimeMs = elapsedMs();
+
+    for (auto& timing : m_timings) {
+        if (timing.status == TaskStatus::Pending) timing.status = TaskStatus::Skipped;
+    }
+    return !failed;
+}
+
+double TaskGraph::getSerialTimeMs() const {
+    double total = 0.0;
+    for (const auto& timing : m_timings) {
+        total += timing.durationMs;
+    }
+    return total;
+}
+
+double TaskGraph::getCriticalPathMs() const {
+    // Tasks are stored in a valid topological order
+    std::vector<double> finish(m_tasks.size(), 0.0);
+    double longest = 0.0;
+    for (TaskId id = 0; id < m_tasks.size(); id++) {
+        double begin = 0.0;
+        for (TaskId dependency : m_tasks[id].dependencies) {
+            begin = std::max(begin, finish[dependency]);
+        }
+        finish[id] = begin + m_timings[id].durationMs;
+        longest = std::max(longest, finish[id]);
+    }
+    return longest;
+}
+
+void TaskGraph::note(const std::string& message) {
+    if (t_notes) {
+        t_notes->push_back(message);
+    } else {
+        std::cout << message << std::endl;
+    }
+}
+
+void TaskGraph::printReport(std::ostream& out, const std::string& title) const {
+    std::vector<const TaskTiming*> sorted;
+    for (const auto& timing : m_timings) {
+        sorted.push_back(&timing);
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [](const TaskTiming* a, const TaskTiming* b) {
+        return a->startMs < b->startMs;
+    });
+
+    out << title << std::endl;
+    out << std::fixed << std::setprecision(2);
+    for (const TaskTiming* timing : sorted) {
+        out << "  " << std::left << std::setw(24) << timing->name << std::right
+            << " start " << std::setw(8) << timing->startMs << " ms"
+            << "  took " << std::setw(8) << timing->durationMs << " ms"
+            << "  thread " << timing->thread;
+        if (timing->status == TaskStatus::Failed) {
+            out << "  FAILED";
+            if (!timing->error.empty()) out << ": " << timing->error;
+        } else if (timing->status == TaskStatus::Skipped) {
+            out << "  skipped";
+        }
+        out << std::endl;
+        for (const auto& note : timing->notes) {
+            out << "    " << note << std::endl;
+        }
+    }
+    out << "  wall " << m_wallTimeMs << " ms, serial " << getSerialTimeMs()
+        << " ms, critical path " << getCriticalPathMs() << " ms" << std::endl;
+    out << std::defaultfloat;
+}
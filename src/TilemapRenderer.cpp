@@ -0,0 +1,435 @@
+#include "TilemapRenderer.h"
+#include "VulkanRenderer.h"
+#include "AllocationTracker.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+
+uint32_t buildTileChunk(const TileId* tiles, uint32_t* records) {
+    uint32_t count = 0;
+    for (uint32_t y = 0; y < TilemapRenderer::CHUNK_SIZE; y++) {
+        for (uint32_t x = 0; x < TilemapRenderer::CHUNK_SIZE; x++) {
+            TileId tile = tiles[y * TilemapRenderer::CHUNK_SIZE + x];
+            if (tile == EMPTY_TILE) continue;
+            records[count++] = x | (y << 5) | (static_cast<uint32_t>(tile - 1) << 16);
+        }
+    }
+    return count;
+}
+
+TilemapRenderer::TilemapRenderer() {
+}
+
+TilemapRenderer::~TilemapRenderer() {
+    cleanup();
+}
+
+bool TilemapRenderer::initialize(VulkanRenderer& renderer, uint32_t framesInFlight) {
+    m_renderer = &renderer;
+    m_device = renderer.getDevice();
+
+    m_pipeline = PipelineFactory::createGraphicsPipeline(m_device, getPipelineDesc(renderer));
+    m_pipelineId = renderer.getRenderQueue().registerPipeline(m_pipeline);
+
+    // A full chunk is the largest upload
+    size_t regionsPerFrame = UPLOAD_BYTES_PER_FRAME / (CHUNK_TILES * sizeof(uint32_t));
+    m_frames.resize(framesInFlight);
+    for (auto& frame : m_frames) {
+        renderer.createBuffer(UPLOAD_BYTES_PER_FRAME, vk::BufferUsageFlagBits::eTransferSrc,
+            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+            frame.staging, frame.stagingMemory, "tilemap staging");
+        frame.mapped = static_cast<uint32_t*>(m_device.mapMemory(frame.stagingMemory, 0, UPLOAD_BYTES_PER_FRAME));
+        frame.regions.reserve(regionsPerFrame);
+    }
+
+    m_buildStorage.reserve(MAX_PENDING_BUILDS);
+    m_freeBuilds.reserve(MAX_PENDING_BUILDS);
+    for (uint32_t i = 0; i < MAX_PENDING_BUILDS; i++) {
+        m_buildStorage.push_back(std::make_unique<ChunkBuild>());
+        m_freeBuilds.push_back(m_buildStorage.back().get());
+    }
+    m_newBuilds.reserve(MAX_PENDING_BUILDS);
+    m_ready.reserve(MAX_PENDING_BUILDS);
+    m_queued.reserve(MAX_PENDING_BUILDS);
+    m_finished.reserve(MAX_PENDING_BUILDS);
+
+    m_stopping = false;
+    for (uint32_t i = 0; i < BUILDER_THREADS; i++) {
+        m_builders.emplace_back(&TilemapRenderer::builderMain, this);
+    }
+
+    m_initialized = true;
+    return true;
+}
+
+GraphicsPipelineDesc TilemapRenderer::getPipelineDesc(VulkanRenderer& renderer) {
+    GraphicsPipelineDesc desc;
+    desc.vertexShader = "tilemap.vert";
+    desc.fragmentShader = "sprite.frag";
+    desc.bindings = { { 0, sizeof(uint32_t), vk::VertexInputRate::eInstance } };
+    desc.attributes = { { 0, 0, vk::Format::eR32Uint, 0 } };
+    desc.blend = BlendMode::Alpha;
+    desc.fragmentConstants = { 0 };
+    desc.layout = renderer.getPipelineLayout();
+    desc.renderPass = renderer.getRenderPass();
+    return desc;
+}
+
+void TilemapRenderer::cleanup() {
+    if (!m_initialized) return;
+
+    destroyMap();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_buildAvailable.notify_all();
+    for (auto& thread : m_builders) {
+        thread.join();
+    }
+    m_builders.clear();
+
+    for (auto& frame : m_frames) {
+        if (frame.mapped) m_device.unmapMemory(frame.stagingMemory);
+        m_renderer->destroyBuffer(frame.staging, frame.stagingMemory);
+    }
+    m_frames.clear();
+    m_freeBuilds.clear();
+    m_buildStorage.clear();
+
+    m_device.destroyPipeline(m_pipeline);
+    m_pipeline = VK_NULL_HANDLE;
+    m_initialized = false;
+}
+
+bool TilemapRenderer::createMap(const TilemapDesc& desc, const TileId* tiles) {
+    if (!m_initialized) return false;
+    destroyMap();
+
+    if (desc.width == 0 || desc.height == 0 || desc.width > MAX_MAP_SIZE || desc.height > MAX_MAP_SIZE) {
+        std::cerr << "Tilemap sides must be between 1 and " << MAX_MAP_SIZE << " tiles" << std::endl;
+        return false;
+    }
+    if (desc.tilesetColumns == 0 || desc.tilesetRows == 0 || !(desc.tileSize > 0.0f)) {
+        std::cerr << "Tilemap needs a tileset of at least one tile and a positive tile size" << std::endl;
+        return false;
+    }
+
+    // Loading a map allocates; frames after it are not steady yet
+    AllocationTracker::markUnsteady();
+
+    m_chunksX = (desc.width + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    m_chunksY = (desc.height + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    size_t chunkCount = static_cast<size_t>(m_chunksX) * m_chunksY;
+
+    // One fixed slot per chunk, so a rebuild never has to move its neighbours
+    vk::DeviceSize size = chunkCount * CHUNK_TILES * sizeof(uint32_t);
+    try {
+        m_renderer->createBuffer(size, vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst,
+                                 vk::MemoryPropertyFlagBits::eDeviceLocal, m_chunkBuffer, m_chunkMemory,
+                                 "tilemap chunks");
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to create tilemap chunk buffer: " << e.what() << std::endl;
+        return false;
+    }
+
+    m_desc = desc;
+    size_t tileCount = static_cast<size_t>(desc.width) * desc.height;
+    if (tiles) {
+        m_tiles.assign(tiles, tiles + tileCount);
+    } else {
+        m_tiles.assign(tileCount, EMPTY_TILE);
+    }
+
+    // Every chunk slot starts out undefined; chunks with tiles are built
+    // like any other change
+    m_chunks.assign(chunkCount, Chunk{});
+    m_dirty.reserve(chunkCount);
+    if (tiles) {
+        for (uint32_t chunk = 0; chunk < chunkCount; chunk++) {
+            markDirty(chunk);
+        }
+    }
+
+    std::cout << "Tilemap " << desc.width << "x" << desc.height << " in " << chunkCount << " chunks ("
+              << (size >> 20) << " MB)" << std::endl;
+    return true;
+}
+
+void TilemapRenderer::destroyMap() {
+    if (!m_initialized) return;
+
+    waitForBuilders();
+    m_renderer->destroyBuffer(m_chunkBuffer, m_chunkMemory);
+    m_tiles = std::vector<TileId>();
+    m_chunks = std::vector<Chunk>();
+    m_dirty = std::vector<uint32_t>();
+    m_buildingChunks = 0;
+    m_chunksX = 0;
+    m_chunksY = 0;
+    m_chunkResource = INVALID_RG_RESOURCE;
+    m_desc = TilemapDesc{};
+    m_lastDrawnChunks = 0;
+    m_lastUploadedChunks = 0;
+}
+
+void TilemapRenderer::setTile(uint32_t x, uint32_t y, TileId tile) {
+    if (x >= m_desc.width || y >= m_desc.height) return;
+
+    TileId& current = m_tiles[static_cast<size_t>(y) * m_desc.width + x];
+    if (current == tile) return;
+    current = tile;
+
+    uint32_t chunk = (y / CHUNK_SIZE) * m_chunksX + x / CHUNK_SIZE;
+    m_chunks[chunk].version++;
+    // A chunk being built goes back on the dirty list when its stale result
+    // comes back
+    if (!m_chunks[chunk].building) {
+        markDirty(chunk);
+    }
+}
+
+TileId TilemapRenderer::getTile(uint32_t x, uint32_t y) const {
+    if (x >= m_desc.width || y >= m_desc.height) return EMPTY_TILE;
+    return m_tiles[static_cast<size_t>(y) * m_desc.width + x];
+}
+
+void TilemapRenderer::markDirty(uint32_t chunk) {
+    if (m_chunks[chunk].dirty) return;
+    m_chunks[chunk].dirty = true;
+    m_dirty.push_back(chunk);
+}
+
+void TilemapRenderer::prepare(RenderGraph& graph, uint32_t frameIndex, vk::Extent2D extent) {
+    m_lastUploadedChunks = 0;
+    if (!hasMap()) return;
+
+    dispatchDirty(extent);
+
+    // Finished chunks go out in the order they were queued, which puts
+    // visible ones first
+    FrameUpload& upload = m_frames[frameIndex];
+    upload.regions.clear();
+    m_ready.clear();
+    {
+        size_t maxChunks = UPLOAD_BYTES_PER_FRAME / (CHUNK_TILES * sizeof(uint32_t));
+        std::lock_guard<std::mutex> lock(m_mutex);
+        size_t take = std::min(m_finished.size(), maxChunks);
+        m_ready.insert(m_ready.end(), m_finished.begin(), m_finished.begin() + take);
+        m_finished.erase(m_finished.begin(), m_finished.begin() + take);
+    }
+
+    vk::DeviceSize stagingOffset = 0;
+    for (ChunkBuild* build : m_ready) {
+        Chunk& chunk = m_chunks[build->chunk];
+        chunk.building = false;
+        m_buildingChunks--;
+
+        if (build->version != chunk.version) {
+            // Edited while it was being built
+            markDirty(build->chunk);
+        } else {
+            vk::DeviceSize bytes = build->recordCount * sizeof(uint32_t);
+            if (bytes > 0) {
+                std::memcpy(reinterpret_cast<char*>(upload.mapped) + stagingOffset, build->records, bytes);
+                vk::DeviceSize slotOffset = static_cast<vk::DeviceSize>(build->chunk) * CHUNK_TILES * sizeof(uint32_t);
+                upload.regions.push_back(vk::BufferCopy{ stagingOffset, slotOffset, bytes });
+                stagingOffset += bytes;
+            }
+            // The copy lands before this frame's scene pass draws the chunk
+            chunk.tileCount = build->recordCount;
+            m_lastUploadedChunks++;
+        }
+        m_freeBuilds.push_back(build);
+    }
+
+    m_chunkResource = graph.importBuffer("tilemap chunks", m_chunkBuffer,
+                                         static_cast<vk::DeviceSize>(m_chunks.size()) * CHUNK_TILES * sizeof(uint32_t));
+    if (upload.regions.empty()) return;
+
+    graph.addPass("tilemap upload", RGPassType::Transfer)
+        .write(m_chunkResource, RGAccess::TransferWrite)
+        .sideEffect()
+        .execute([this, frameIndex](const RGPassContext& context) {
+            const FrameUpload& upload = m_frames[frameIndex];
+            vk::CommandBuffer commandBuffer = context.commandBuffer;
+
+            // The previous frame may still be drawing from the slots being
+            // replaced, which the graph doesn't see
+            commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eVertexInput,
+                                          vk::PipelineStageFlagBits::eTransfer, {},
+                                          0, nullptr, 0, nullptr, 0, nullptr);
+            commandBuffer.copyBuffer(upload.staging, m_chunkBuffer,
+                                     static_cast<uint32_t>(upload.regions.size()), upload.regions.data());
+        });
+}
+
+void TilemapRenderer::dispatchDirty(vk::Extent2D extent) {
+    if (m_dirty.empty() || m_freeBuilds.empty()) return;
+
+    uint32_t minX = 1, minY = 1, maxX = 0, maxY = 0;
+    getVisibleChunks(extent, minX, minY, maxX, maxY);
+
+    // Visible chunks first, then the rest in the order they changed
+    m_newBuilds.clear();
+    for (int pass = 0; pass < 2 && !m_freeBuilds.empty(); pass++) {
+        for (uint32_t chunkIndex : m_dirty) {
+            if (m_freeBuilds.empty()) break;
+            Chunk& chunk = m_chunks[chunkIndex];
+            if (!chunk.dirty) continue;
+
+            uint32_t cx = chunkIndex % m_chunksX;
+            uint32_t cy = chunkIndex / m_chunksX;
+            bool visible = cx >= minX && cx <= maxX && cy >= minY && cy <= maxY;
+            if (pass == 0 && !visible) continue;
+
+            ChunkBuild* build = m_freeBuilds.back();
+            m_freeBuilds.pop_back();
+            build->chunk = chunkIndex;
+            build->version = chunk.version;
+
+            // Edge chunks are padded with empty tiles
+            uint32_t x0 = cx * CHUNK_SIZE;
+            uint32_t y0 = cy * CHUNK_SIZE;
+            uint32_t width = std::min(CHUNK_SIZE, m_desc.width - x0);
+            uint32_t height = std::min(CHUNK_SIZE, m_desc.height - y0);
+            for (uint32_t y = 0; y < CHUNK_SIZE; y++) {
+                TileId* row = build->tiles + y * CHUNK_SIZE;
+                if (y < height) {
+                    std::memcpy(row, &m_tiles[static_cast<size_t>(y0 + y) * m_desc.width + x0], width * sizeof(TileId));
+                    std::fill(row + width, row + CHUNK_SIZE, EMPTY_TILE);
+                } else {
+                    std::fill(row, row + CHUNK_SIZE, EMPTY_TILE);
+                }
+            }
+
+            chunk.dirty = false;
+            chunk.building = true;
+            m_buildingChunks++;
+            m_newBuilds.push_back(build);
+        }
+    }
+    if (m_newBuilds.empty()) return;
+
+    m_dirty.erase(std::remove_if(m_dirty.begin(), m_dirty.end(),
+                                 [this](uint32_t chunk) { return !m_chunks[chunk].dirty; }),
+                  m_dirty.end());
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queued.insert(m_queued.end(), m_newBuilds.begin(), m_newBuilds.end());
+    }
+    m_buildAvailable.notify_all();
+}
+
+void TilemapRenderer::waitForBuilders() {
+    // Drops queued builds, lets running ones finish and discards the results
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_queued.clear();
+    m_queueHead = 0;
+    m_buildersIdle.wait(lock, [this] { return m_activeBuilds == 0; });
+    m_finished.clear();
+
+    m_freeBuilds.clear();
+    for (auto& build : m_buildStorage) {
+        m_freeBuilds.push_back(build.get());
+    }
+}
+
+void TilemapRenderer::builderMain() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true) {
+        m_buildAvailable.wait(lock, [this] { return m_stopping || m_queueHead < m_queued.size(); });
+        if (m_stopping) return;
+
+        ChunkBuild* build = m_queued[m_queueHead++];
+        if (m_queueHead == m_queued.size()) {
+            m_queued.clear();
+            m_queueHead = 0;
+        }
+        m_activeBuilds++;
+
+        lock.unlock();
+        build->recordCount = buildTileChunk(build->tiles, build->records);
+        lock.lock();
+
+        m_finished.push_back(build);
+        if (--m_activeBuilds == 0) {
+            m_buildersIdle.notify_all();
+        }
+    }
+}
+
+bool TilemapRenderer::getVisibleChunks(vk::Extent2D extent, uint32_t& minX, uint32_t& minY,
+                                       uint32_t& maxX, uint32_t& maxY) const {
+    SpriteBounds view = m_renderer->getSpriteRenderer().getViewBounds(extent);
+    float chunkSize = m_desc.tileSize * CHUNK_SIZE;
+    float x0 = std::floor((view.minX - m_desc.origin.x) / chunkSize);
+    float y0 = std::floor((view.minY - m_desc.origin.y) / chunkSize);
+    float x1 = std::floor((view.maxX - m_desc.origin.x) / chunkSize);
+    float y1 = std::floor((view.maxY - m_desc.origin.y) / chunkSize);
+    if (x1 < 0.0f || y1 < 0.0f || x0 >= static_cast<float>(m_chunksX) || y0 >= static_cast<float>(m_chunksY)) {
+        return false;
+    }
+
+    minX = static_cast<uint32_t>(std::max(x0, 0.0f));
+    minY = static_cast<uint32_t>(std::max(y0, 0.0f));
+    maxX = static_cast<uint32_t>(std::min(x1, static_cast<float>(m_chunksX - 1)));
+    maxY = static_cast<uint32_t>(std::min(y1, static_cast<float>(m_chunksY - 1)));
+    return true;
+}
+
+void TilemapRenderer::declareSceneReads(RGPassBuilder& scene) const {
+    if (!hasMap()) return;
+    scene.read(m_chunkResource, RGAccess::VertexAttributeRead);
+}
+
+void TilemapRenderer::submit(RenderQueue& queue, vk::Extent2D extent) {
+    m_lastDrawnChunks = 0;
+    if (!hasMap()) return;
+
+    uint32_t minX, minY, maxX, maxY;
+    if (!getVisibleChunks(extent, minX, minY, maxX, maxY)) return;
+
+    const SpriteRenderer& sprites = m_renderer->getSpriteRenderer();
+    float chunkSize = m_desc.tileSize * CHUNK_SIZE;
+
+    // Only chunkOrigin differs between chunks; the queue skips re-pushing
+    // the rest
+    TilemapPushConstants constants{};
+    constants.cameraCenter[0] = sprites.getCameraCenter().x;
+    constants.cameraCenter[1] = sprites.getCameraCenter().y;
+    constants.worldToClip[0] = 2.0f * sprites.getZoom() / extent.width;
+    constants.worldToClip[1] = 2.0f * sprites.getZoom() / extent.height;
+    constants.tileSize = m_desc.tileSize;
+    constants.tilesetTexture = m_desc.tilesetTexture;
+    constants.tilesetColumns = m_desc.tilesetColumns;
+    constants.tilesetRows = m_desc.tilesetRows;
+
+    uint64_t key = makeRenderKey(packRenderOrder(RENDER_LAYER_BACKGROUND, 0.0f), m_pipelineId, m_desc.tilesetTexture);
+    RenderDraw draw;
+    draw.pipeline = m_pipelineId;
+    draw.vertexBuffer = m_chunkBuffer;
+    draw.vertexCount = 6;
+    draw.pushSize = sizeof(constants);
+
+    for (uint32_t cy = minY; cy <= maxY; cy++) {
+        for (uint32_t cx = minX; cx <= maxX; cx++) {
+            uint32_t chunkIndex = cy * m_chunksX + cx;
+            uint32_t tileCount = m_chunks[chunkIndex].tileCount;
+            if (tileCount == 0) continue;
+
+            constants.chunkOrigin[0] = m_desc.origin.x + cx * chunkSize;
+            constants.chunkOrigin[1] = m_desc.origin.y + cy * chunkSize;
+            std::memcpy(draw.pushData, &constants, sizeof(constants));
+            draw.instanceCount = tileCount;
+            draw.firstInstance = chunkIndex * CHUNK_TILES;
+            queue.submit(key, draw);
+            m_lastDrawnChunks++;
+        }
+    }
+}
@@ -0,0 +1,46 @@
+// Composes nodes [first, end) of a block, SIMD_WIDTH at a time wherever all
+// their parents are final. Included once per SimdLevel by
+// TransformHierarchy.cpp, inside a namespace that defines FloatVec,
+// SIMD_WIDTH and the vector operations
+
+void composeRange(const TransformMatrices& local, TransformMatrices& world, const uint32_t* parents,
+                  uint8_t* dirty, uint32_t first, uint32_t end) {
+    uint32_t i = first;
+    while (i < end) {
+        // Breadth-first parents never decrease, so if the last lane's parent
+        // comes before the group, every lane's parent is already final
+        if (i + SIMD_WIDTH <= end && parents[i + SIMD_WIDTH - 1] < i) {
+            uint8_t anyDirty = 0;
+            for (uint32_t lane = 0; lane < SIMD_WIDTH; lane++) {
+                dirty[i + lane] |= dirty[parents[i + lane]];
+                anyDirty |= dirty[i + lane];
+            }
+            if (anyDirty) {
+                // Clean lanes are recomputed too; they come out unchanged
+                const uint32_t* p = parents + i;
+                FloatVec pa = gather(world.a.data(), p);
+                FloatVec pb = gather(world.b.data(), p);
+                FloatVec pc = gather(world.c.data(), p);
+                FloatVec pd = gather(world.d.data(), p);
+                FloatVec la = load(&local.a[i]);
+                FloatVec lb = load(&local.b[i]);
+                FloatVec lc = load(&local.c[i]);
+                FloatVec ld = load(&local.d[i]);
+                FloatVec ltx = load(&local.tx[i]);
+                FloatVec lty = load(&local.ty[i]);
+                store(&world.a[i], add(mul(pa, la), mul(pc, lb)));
+                store(&world.b[i], add(mul(pb, la), mul(pd, lb)));
+                store(&world.c[i], add(mul(pa, lc), mul(pc, ld)));
+                store(&world.d[i], add(mul(pb, lc), mul(pd, ld)));
+                store(&world.tx[i], add(add(mul(pa, ltx), mul(pc, lty)), gather(world.tx.data(), p)));
+                store(&world.ty[i], add(add(mul(pb, ltx), mul(pd, lty)), gather(world.ty.data(), p)));
+            }
+            i += SIMD_WIDTH;
+        } else {
+            // A level boundary falls inside the group
+            dirty[i] |= dirty[parents[i]];
+            if (dirty[i]) composeOne(local, world, parents[i], i);
+            i++;
+        }
+    }
+}
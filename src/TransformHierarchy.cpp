@@ -0,0 +1,371 @@
+#include "TransformHierarchy.h"
+#include "AllocationTracker.h"
+#include "CpuFeatures.h"
+#include <algorithm>
+#include <cmath>
+
+#if CGAME_SIMD_X64
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// composeRange's fallback for one node; every path shares it
+void composeOne(const TransformMatrices& local, TransformMatrices& world, uint32_t parent, uint32_t i) {
+    float pa = world.a[parent], pb = world.b[parent], pc = world.c[parent], pd = world.d[parent];
+    float la = local.a[i], lb = local.b[i], lc = local.c[i], ld = local.d[i];
+    float ltx = local.tx[i], lty = local.ty[i];
+    world.a[i] = pa * la + pc * lb;
+    world.b[i] = pb * la + pd * lb;
+    world.c[i] = pa * lc + pc * ld;
+    world.d[i] = pb * lc + pd * ld;
+    world.tx[i] = pa * ltx + pc * lty + world.tx[parent];
+    world.ty[i] = pb * ltx + pd * lty + world.ty[parent];
+}
+
+// The vector operations composing needs, at each width there is a path for.
+// Parents are gathered: they are scattered over earlier levels. Each
+// namespace compiles TransformCompose.inl with its own operations
+namespace scalar {
+constexpr uint32_t SIMD_WIDTH = 1;
+using FloatVec = float;
+inline FloatVec load(const float* p) { return *p; }
+inline void store(float* p, FloatVec v) { *p = v; }
+inline FloatVec add(FloatVec a, FloatVec b) { return a + b; }
+inline FloatVec mul(FloatVec a, FloatVec b) { return a * b; }
+inline FloatVec gather(const float* base, const uint32_t* indices) { return base[indices[0]]; }
+#include "TransformCompose.inl"
+} // namespace scalar
+
+#if CGAME_SIMD_X64
+namespace sse2 {
+constexpr uint32_t SIMD_WIDTH = 4;
+using FloatVec = __m128;
+inline FloatVec load(const float* p) { return _mm_loadu_ps(p); }
+inline void store(float* p, FloatVec v) { _mm_storeu_ps(p, v); }
+inline FloatVec add(FloatVec a, FloatVec b) { return _mm_add_ps(a, b); }
+inline FloatVec mul(FloatVec a, FloatVec b) { return _mm_mul_ps(a, b); }
+inline FloatVec gather(const float* base, const uint32_t* indices) {
+    return _mm_set_ps(base[indices[3]], base[indices[2]], base[indices[1]], base[indices[0]]);
+}
+#include "TransformCompose.inl"
+} // namespace sse2
+
+CGAME_AVX2_BEGIN
+namespace avx2 {
+constexpr uint32_t SIMD_WIDTH = 8;
+using FloatVec = __m256;
+inline FloatVec load(const float* p) { return _mm256_loadu_ps(p); }
+inline void store(float* p, FloatVec v) { _mm256_storeu_ps(p, v); }
+inline FloatVec add(FloatVec a, FloatVec b) { return _mm256_add_ps(a, b); }
+inline FloatVec mul(FloatVec a, FloatVec b) { return _mm256_mul_ps(a, b); }
+inline FloatVec gather(const float* base, const uint32_t* indices) {
+    return _mm256_i32gather_ps(base, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(indices)), 4);
+}
+#include "TransformCompose.inl"
+} // namespace avx2
+CGAME_AVX2_END
+#endif
+
+} // namespace
+
+void TransformMatrices::resize(size_t count) {
+    for (auto* element : { &a, &b, &c, &d, &tx, &ty }) {
+        element->resize(count);
+    }
+}
+
+void composeTransforms(const TransformMatrices& local, TransformMatrices& world, const uint32_t* parents,
+                       uint8_t* dirty, uint32_t first, uint32_t end) {
+    switch (getSimdLevel()) {
+#if CGAME_SIMD_X64
+    case SimdLevel::AVX2: avx2::composeRange(local, world, parents, dirty, first, end); break;
+    case SimdLevel::SSE2: sse2::composeRange(local, world, parents, dirty, first, end); break;
+#endif
+    default: scalar::composeRange(local, world, parents, dirty, first, end); break;
+    }
+}
+
+const char* getTransformPath() {
+    return getSimdLevelName(getSimdLevel());
+}
+
+TransformHierarchy::TransformHierarchy(uint32_t workerThreads) : m_workerCount(workerThreads) {
+}
+
+TransformHierarchy::~TransformHierarchy() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_workAvailable.notify_all();
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+TransformId TransformHierarchy::create(TransformId parent, const Transform2D& local, const SpriteInstance* sprite) {
+    if (parent != INVALID_TRANSFORM && (parent >= m_nodes.size() || !m_nodes[parent].alive)) {
+        return INVALID_TRANSFORM;
+    }
+
+    TransformId id;
+    if (!m_freeIds.empty()) {
+        id = m_freeIds.back();
+        m_freeIds.pop_back();
+    } else {
+        id = static_cast<TransformId>(m_nodes.size());
+        m_nodes.emplace_back();
+    }
+
+    Node& node = m_nodes[id];
+    node = Node{};
+    node.parent = parent;
+    node.local = local;
+    node.alive = true;
+    if (sprite) {
+        node.sprite = *sprite;
+        node.hasSprite = true;
+    }
+    m_layoutDirty = true;
+    return id;
+}
+
+void TransformHierarchy::destroy(TransformId node) {
+    if (node >= m_nodes.size() || !m_nodes[node].alive) return;
+    // The id is freed by the rebuild, with its descendants', so none of
+    // them can be handed out while children still point at it
+    m_nodes[node].alive = false;
+    m_layoutDirty = true;
+}
+
+void TransformHierarchy::clear() {
+    m_nodes.clear();
+    m_freeIds.clear();
+    m_layoutDirty = true;
+}
+
+void TransformHierarchy::setLocal(TransformId node, const Transform2D& local) {
+    if (node >= m_nodes.size() || !m_nodes[node].alive) return;
+    m_nodes[node].local = local;
+    if (m_layoutDirty) return;
+
+    uint32_t index = m_nodes[node].index;
+    writeLocal(index, local);
+    m_dirty[index] = 1;
+    m_blocks[m_blockOf[index]].dirty = true;
+}
+
+void TransformHierarchy::setSprite(TransformId node, const SpriteInstance& sprite) {
+    if (node >= m_nodes.size() || !m_nodes[node].alive) return;
+    Node& entry = m_nodes[node];
+    entry.sprite = sprite;
+    if (!entry.hasSprite) {
+        // Needs a slot in the sprite array
+        entry.hasSprite = true;
+        m_layoutDirty = true;
+    }
+    if (m_layoutDirty) return;
+
+    m_dirty[entry.index] = 1;
+    m_blocks[m_blockOf[entry.index]].dirty = true;
+}
+
+glm::vec2 TransformHierarchy::getWorldPosition(TransformId node) const {
+    uint32_t index = m_nodes[node].index;
+    return glm::vec2(m_world.tx[index], m_world.ty[index]);
+}
+
+float TransformHierarchy::getWorldRotation(TransformId node) const {
+    uint32_t index = m_nodes[node].index;
+    return std::atan2(m_world.b[index], m_world.a[index]);
+}
+
+void TransformHierarchy::writeLocal(uint32_t index, const Transform2D& local) {
+    float cosine = std::cos(local.rotation);
+    float sine = std::sin(local.rotation);
+    m_local.a[index] = cosine * local.scale.x;
+    m_local.b[index] = sine * local.scale.x;
+    m_local.c[index] = -sine * local.scale.y;
+    m_local.d[index] = cosine * local.scale.y;
+    m_local.tx[index] = local.position.x;
+    m_local.ty[index] = local.position.y;
+}
+
+void TransformHierarchy::rebuildLayout() {
+    // Rebuilding allocates; frames after it are not steady yet
+    AllocationTracker::markUnsteady();
+    m_layoutDirty = false;
+
+    // Children of each live node, grouped by parent
+    size_t idCount = m_nodes.size();
+    std::vector<uint32_t> childStart(idCount + 1, 0);
+    for (const Node& node : m_nodes) {
+        if (node.alive && node.parent != INVALID_TRANSFORM) childStart[node.parent + 1]++;
+    }
+    for (size_t id = 0; id < idCount; id++) {
+        childStart[id + 1] += childStart[id];
+    }
+    std::vector<TransformId> children(childStart[idCount]);
+    std::vector<uint32_t> fill(childStart.begin(), childStart.end() - 1);
+    for (TransformId id = 0; id < idCount; id++) {
+        const Node& node = m_nodes[id];
+        if (node.alive && node.parent != INVALID_TRANSFORM) children[fill[node.parent]++] = id;
+    }
+
+    m_parents.clear();
+    m_ids.clear();
+    m_blockOf.clear();
+    m_blocks.clear();
+    std::vector<uint8_t> reached(idCount, 0);
+    auto place = [&](TransformId id, uint32_t parentIndex) {
+        m_nodes[id].index = static_cast<uint32_t>(m_ids.size());
+        m_ids.push_back(id);
+        m_parents.push_back(parentIndex);
+        m_blockOf.push_back(static_cast<uint32_t>(m_blocks.size()));
+        reached[id] = 1;
+    };
+
+    // One breadth-first block per root; the arrays themselves are the queue
+    for (TransformId root = 0; root < idCount; root++) {
+        const Node& node = m_nodes[root];
+        if (!node.alive || node.parent != INVALID_TRANSFORM) continue;
+
+        uint32_t first = static_cast<uint32_t>(m_ids.size());
+        place(root, first);
+        for (uint32_t head = first; head < m_ids.size(); head++) {
+            TransformId id = m_ids[head];
+            for (uint32_t c = childStart[id]; c < childStart[id + 1]; c++) {
+                if (m_nodes[children[c]].alive) place(children[c], head);
+            }
+        }
+        m_blocks.push_back(Block{ first, static_cast<uint32_t>(m_ids.size()), true });
+    }
+
+    // Destroyed nodes and everything that was under them
+    m_freeIds.clear();
+    for (TransformId id = 0; id < idCount; id++) {
+        if (!reached[id]) {
+            m_nodes[id].alive = false;
+            m_freeIds.push_back(id);
+        }
+    }
+
+    size_t count = m_ids.size();
+    m_local.resize(count);
+    m_world.resize(count);
+    m_dirty.assign(count, 1);
+    m_spriteSlots.assign(count, NO_SLOT);
+    m_sprites.clear();
+    for (uint32_t index = 0; index < count; index++) {
+        const Node& node = m_nodes[m_ids[index]];
+        writeLocal(index, node.local);
+        if (node.hasSprite) {
+            m_spriteSlots[index] = static_cast<uint32_t>(m_sprites.size());
+            m_sprites.push_back(node.sprite);
+        }
+    }
+    m_dirtyBlocks.reserve(m_blocks.size());
+}
+
+void TransformHierarchy::update() {
+    if (m_layoutDirty) rebuildLayout();
+
+    m_dirtyBlocks.clear();
+    uint32_t dirtyNodes = 0;
+    for (uint32_t block = 0; block < m_blocks.size(); block++) {
+        if (!m_blocks[block].dirty) continue;
+        m_blocks[block].dirty = false;
+        m_dirtyBlocks.push_back(block);
+        dirtyNodes += m_blocks[block].end - m_blocks[block].first;
+    }
+
+    m_updatedNodes = 0;
+    if (m_workerCount > 0 && dirtyNodes >= PARALLEL_THRESHOLD && m_dirtyBlocks.size() > 1) {
+        runBlocks();
+    } else {
+        for (uint32_t block : m_dirtyBlocks) {
+            updateBlock(block);
+        }
+    }
+    m_lastUpdated = m_updatedNodes;
+}
+
+void TransformHierarchy::updateBlock(uint32_t block) {
+    const Block& range = m_blocks[block];
+    uint32_t root = range.first;
+    if (m_dirty[root]) {
+        m_world.a[root] = m_local.a[root];
+        m_world.b[root] = m_local.b[root];
+        m_world.c[root] = m_local.c[root];
+        m_world.d[root] = m_local.d[root];
+        m_world.tx[root] = m_local.tx[root];
+        m_world.ty[root] = m_local.ty[root];
+    }
+    composeTransforms(m_local, m_world, m_parents.data(), m_dirty.data(), root + 1, range.end);
+
+    // Sprites of the nodes that moved; the flags are spent
+    uint32_t updated = 0;
+    for (uint32_t i = range.first; i < range.end; i++) {
+        if (!m_dirty[i]) continue;
+        m_dirty[i] = 0;
+        updated++;
+
+        uint32_t slot = m_spriteSlots[i];
+        if (slot == NO_SLOT) continue;
+        float a = m_world.a[i], b = m_world.b[i], c = m_world.c[i], d = m_world.d[i];
+        const SpriteInstance& source = m_nodes[m_ids[i]].sprite;
+        SpriteInstance& sprite = m_sprites[slot];
+        sprite = source;
+        sprite.position = glm::vec2(m_world.tx[i], m_world.ty[i]);
+        sprite.rotation = std::atan2(b, a);
+        sprite.size = source.size * glm::vec2(std::sqrt(a * a + b * b), std::sqrt(c * c + d * d));
+    }
+    m_updatedNodes += updated;
+}
+
+void TransformHierarchy::runBlocks() {
+    if (m_workers.empty()) {
+        for (uint32_t i = 0; i < m_workerCount; i++) {
+            m_workers.emplace_back(&TransformHierarchy::workerMain, this, m_generation);
+        }
+    }
+
+    m_nextBlock = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_generation++;
+        m_busyWorkers = m_workerCount;
+    }
+    m_workAvailable.notify_all();
+
+    // The calling thread takes blocks too
+    size_t next;
+    while ((next = m_nextBlock.fetch_add(1)) < m_dirtyBlocks.size()) {
+        updateBlock(m_dirtyBlocks[next]);
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_workDone.wait(lock, [this] { return m_busyWorkers == 0; });
+}
+
+void TransformHierarchy::workerMain(uint64_t generation) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true) {
+        m_workAvailable.wait(lock, [this, generation] { return m_stopping || m_generation != generation; });
+        if (m_stopping) return;
+        generation = m_generation;
+
+        lock.unlock();
+        size_t next;
+        while ((next = m_nextBlock.fetch_add(1)) < m_dirtyBlocks.size()) {
+            updateBlock(m_dirtyBlocks[next]);
+        }
+        lock.lock();
+
+        if (--m_busyWorkers == 0) {
+            m_workDone.notify_one();
+        }
+    }
+}
@@ -1,9 +1,17 @@
 #include "VulkanRenderer.h"
+#include "PipelineFactory.h"
 #include "ShaderLoader.h"
+#include "TaskGraph.h"
+#include "AllocationTracker.h"
 #include <iostream>
 #include <stdexcept>
 #include <vector>
 #include <set>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <thread>
+#include <chrono>
 
 // Validation layers
 const std::vector<const char*> validationLayers = {
@@ -21,6 +29,16 @@ const bool enableValidationLayers = false;
 const bool enableValidationLayers = true;
 #endif
 
+// Matches mesh.vert
+struct MeshPushConstants {
+    float cameraCenter[2];
+    float worldToClip[2];
+    float position[2];
+    float scale;
+    float padding;
+};
+static_assert(sizeof(MeshPushConstants) <= RenderDraw::MAX_PUSH_BYTES, "Mesh push constants don't fit a draw");
+
 VulkanRenderer::VulkanRenderer() : m_window(nullptr), m_initialized(false) {
 }
 
@@ -30,51 +48,57 @@ VulkanRenderer::~VulkanRenderer() {
 
 bool VulkanRenderer::initialize(GLFWwindow* window) {
     m_window = window;
+    m_initStart = std::chrono::steady_clock::now();
+    
+    // Creation steps and what they need. Independent branches (surface vs.
+    // device, swap chain vs. pipeline and buffers) run concurrently
+    TaskGraph steps;
+    auto instance = steps.addTask("instance", [this] { return createInstance(); });
+    auto physicalDevice = steps.addTask("physical device", [this] { return pickPhysicalDevice(); }, { instance });
+    auto surface = steps.addCallingThreadTask("surface", [this] { return createSurface(); }, { instance });
+    auto device = steps.addTask("logical device", [this] { return createLogicalDevice(); }, { physicalDevice });
+    auto swapchainSupport = steps.addTask("swap chain support", [this] { return checkSwapChainSupport(); },
+                                          { physicalDevice, surface });
+    auto swapchain = steps.addTask("swap chain", [this] { return createSwapChain(); }, { device, swapchainSupport });
+    steps.addTask("image views", [this] { return createImageViews(); }, { swapchain });
+    auto renderPass = steps.addTask("render pass", [this] { return createRenderPass(); }, { swapchain });
+    steps.addTask("asset streamer", [this] { return createAssetStreamer(); }, { device });
+    auto descriptors = steps.addTask("descriptor manager", [this] { return createDescriptorManager(); }, { device });
+    auto pipeline = steps.addTask("graphics pipeline", [this] { return createGraphicsPipeline(); },
+                                  { renderPass, descriptors });
+    auto profiler = steps.addTask("gpu profiler", [this] { return createGpuProfiler(); }, { device });
+    steps.addTask("render graphs", [this] { return createRenderGraphs(); }, { profiler });
+    steps.addTask("performance hud", [this] { return createPerformanceHud(); }, { pipeline });
+    steps.addTask("sprite renderer", [this] { return createSpriteRenderer(); }, { pipeline });
+    steps.addTask("particle system", [this] { return createParticleSystem(); }, { pipeline });
+    steps.addTask("lighting system", [this] { return createLightingSystem(); }, { pipeline });
+    steps.addTask("tilemap renderer", [this] { return createTilemapRenderer(); }, { pipeline });
+    steps.addTask("world streamer", [this] { return createWorldStreamer(); }, { pipeline });
+    steps.addTask("frame readback", [this] { return createFrameReadback(); }, { swapchain });
+    auto commandPool = steps.addTask("command pool", [this] { return createCommandPool(); }, { device });
+    steps.addTask("command buffers", [this] { return createCommandBuffers(); }, { commandPool, swapchain });
+    steps.addTask("sync objects", [this] { return createSyncObjects(); }, { device });
     
     try {
-        std::cout << "Creating Vulkan instance..." << std::endl;
-        if (!createInstance()) return false;
-        
-        std::cout << "Picking physical device..." << std::endl;
-        if (!pickPhysicalDevice()) return false;
-        
-        std::cout << "Creating logical device..." << std::endl;
-        if (!createLogicalDevice()) return false;
-        
-        std::cout << "Creating surface..." << std::endl;
-        if (!createSurface()) return false;
-        
-        std::cout << "Checking swap chain support..." << std::endl;
-        if (!checkSwapChainSupport()) return false;
-        
-        std::cout << "Creating swap chain..." << std::endl;
-        if (!createSwapChain()) return false;
-        
-        std::cout << "Creating image views..." << std::endl;
-        if (!createImageViews()) return false;
-        
-        std::cout << "Creating render pass..." << std::endl;
-        if (!createRenderPass()) return false;
-        
-        std::cout << "Creating vertex buffer..." << std::endl;
-        if (!createVertexBuffer()) return false;
-        
-        std::cout << "Creating graphics pipeline..." << std::endl;
-        if (!createGraphicsPipeline()) return false;
-        
-        std::cout << "Creating framebuffers..." << std::endl;
-        if (!createFramebuffers()) return false;
-        
-        std::cout << "Creating command pool..." << std::endl;
-        if (!createCommandPool()) return false;
-        
-        std::cout << "Creating command buffers..." << std::endl;
-        if (!createCommandBuffers()) return false;
-        
-        std::cout << "Creating sync objects..." << std::endl;
-        if (!createSyncObjects()) return false;
+        bool succeeded = steps.run(4);
+        steps.printReport(std::cout, "Vulkan startup:");
+        m_startupTimings = steps.getTimings();
+        if (!succeeded) {
+            std::cerr << "Vulkan initialization failed" << std::endl;
+            return false;
+        }
         
         std::cout << "Vulkan initialization completed successfully!" << std::endl;
+        
+#ifndef NDEBUG
+        // Opt-in: validation layers allocate on the threads that call them
+        const char* allocationCheck = std::getenv("CGAME_ALLOCATION_CHECK");
+        if (allocationCheck && std::strcmp(allocationCheck, "1") == 0) {
+            AllocationTracker::setSteadyStateCheck(true);
+            std::cout << "Asserting on heap allocations after " << AllocationTracker::STEADY_STATE_WARMUP_FRAMES
+                      << " steady frames" << std::endl;
+        }
+#endif
         m_initialized = true;
         return true;
     } catch (const std::exception& e) {
@@ -86,8 +110,24 @@ bool VulkanRenderer::initialize(GLFWwindow* window) {
 void VulkanRenderer::cleanup() {
     if (!m_initialized) return;
     
+    // Teardown frees and allocates freely
+    AllocationTracker::setPhase(AllocationPhase::Untracked);
+    
     m_device.waitIdle();
     
+    // Deliver frames still being read back before their buffers go
+    m_readback.cleanup();
+    
+    // Cleanup the streamed world, the tile map, particles, lights, sprite
+    // batches, the overlay and profiler queries
+    m_world.cleanup();
+    m_tilemap.cleanup();
+    m_particles.cleanup();
+    m_lighting.cleanup();
+    m_sprites.cleanup();
+    m_hud.cleanup();
+    m_gpuProfiler.cleanup();
+    
     // Cleanup synchronization objects
     for (size_t i = 0; i < m_inFlightFences.size(); i++) {
         m_device.destroySemaphore(m_imageAvailableSemaphores[i]);
@@ -98,23 +138,22 @@ void VulkanRenderer::cleanup() {
     // Cleanup command pool
     m_device.destroyCommandPool(m_commandPool);
     
-    // Cleanup vertex buffer
-    cleanupVertexBuffer();
-    
-    // Cleanup shaders
-    m_device.destroyShaderModule(m_vertexShaderModule);
-    m_device.destroyShaderModule(m_fragmentShaderModule);
+    // Cleanup streamed assets
+    m_assetStreamer.cleanup();
     
     // Cleanup pipeline
-    m_device.destroyPipeline(m_graphicsPipeline);
+    m_device.destroyPipeline(m_meshPipeline);
     m_device.destroyPipelineLayout(m_pipelineLayout);
     
+    // Cleanup descriptor pools, layouts and samplers
+    m_descriptors.cleanup();
+    
     // Cleanup render pass
     m_device.destroyRenderPass(m_renderPass);
     
-    // Cleanup framebuffers
-    for (auto framebuffer : m_swapchainFramebuffers) {
-        m_device.destroyFramebuffer(framebuffer);
+    // Cleanup render graphs and their cached framebuffers
+    for (auto& graph : m_renderGraphs) {
+        graph.cleanup();
     }
     
     // Cleanup image views
@@ -128,6 +167,9 @@ void VulkanRenderer::cleanup() {
     // Cleanup surface
     m_instance.destroySurfaceKHR(m_surface);
     
+    // Everything allocated through the tracker should be freed by now
+    m_memory.cleanup();
+    
     // Cleanup device
     m_device.destroy();
     
@@ -137,20 +179,52 @@ void VulkanRenderer::cleanup() {
     m_initialized = false;
 }
 
-void VulkanRenderer::beginFrame() {
+bool VulkanRenderer::beginFrame() {
+    // Closes the previous frame's allocation counts
+    AllocationTracker::beginFrame(m_frameNumber);
+    AllocationTracker::setPhase(AllocationPhase::BeginFrame);
+    m_frameActive = false;
+    
+    // Frame-to-frame CPU time, fed to the HUD graph
+    auto frameStart = std::chrono::steady_clock::now();
+    if (m_frameNumber > 0) {
+        m_hud.addFrameTime(std::chrono::duration<float, std::milli>(frameStart - m_lastFrameStart).count());
+    }
+    m_lastFrameStart = frameStart;
+    
     // Wait for the previous frame to finish
     vk::Result result = m_device.waitForFences(1, &m_inFlightFences[m_currentFrame], VK_TRUE, UINT64_MAX);
     if (result != vk::Result::eSuccess) {
         throw std::runtime_error("Failed to wait for fences");
     }
     
+    // Frames copied back the last time this slot was used are complete
+    m_readback.beginFrame(static_cast<uint32_t>(m_currentFrame));
+    
+    // Nothing in flight reads this slot's scratch any more. Sprites submitted
+    // from here on go into it
+    FrameArena& arena = m_frameArenas[m_currentFrame];
+    arena.reset();
+    m_sprites.beginFrame(arena);
+    m_meshDraws.clear();
+    
+    // A resized window needs a new swap chain first; a minimized one has
+    // nothing to render to until it is restored
+    if (m_swapchainDirty && !recreateSwapChain()) {
+        AllocationTracker::setPhase(AllocationPhase::Game);
+        return false;
+    }
+    
     // Acquire the next image from the swap chain
     result = m_device.acquireNextImageKHR(m_swapchain, UINT64_MAX, 
         m_imageAvailableSemaphores[m_currentFrame], VK_NULL_HANDLE, &m_currentImageIndex);
     
     if (result == vk::Result::eErrorOutOfDateKHR) {
-        // TODO: Handle swap chain recreation
-        return;
+        // Nothing was signaled or reset; the frame is skipped and the swap
+        // chain rebuilt for the next one
+        m_swapchainDirty = true;
+        AllocationTracker::setPhase(AllocationPhase::Game);
+        return false;
     } else if (result != vk::Result::eSuccess && result != vk::Result::eSuboptimalKHR) {
         throw std::runtime_error("Failed to acquire swap chain image");
     }
@@ -160,9 +234,28 @@ void VulkanRenderer::beginFrame() {
     if (result != vk::Result::eSuccess) {
         throw std::runtime_error("Failed to reset fences");
     }
+    
+    // Budget callbacks run before the streamer so a tightened asset budget
+    // takes effect in this frame's evictions
+    m_memory.updateBudget();
+    
+    // Frames older than the fence we just waited on no longer reference
+    // evictable assets
+    m_assetStreamer.update(m_frameNumber);
+    
+    // This frame slot's transient descriptor sets are free again
+    m_descriptors.beginFrame(m_frameNumber);
+    
+    m_frameActive = true;
+    AllocationTracker::setPhase(AllocationPhase::Game);
+    return true;
 }
 
 void VulkanRenderer::endFrame() {
+    if (!m_frameActive) return;
+    m_frameActive = false;
+    AllocationTracker::setPhase(AllocationPhase::Submit);
+    
     // Submit the command buffer
     vk::SubmitInfo submitInfo{};
     vk::Result result;
@@ -176,6 +269,7 @@ void VulkanRenderer::endFrame() {
     submitInfo.signalSemaphoreCount = 1;
     submitInfo.pSignalSemaphores = &m_renderFinishedSemaphores[m_currentFrame];
     
+    std::unique_lock<std::mutex> queueLock(m_queueMutex);
     result = m_graphicsQueue.submit(1, &submitInfo, m_inFlightFences[m_currentFrame]);
     if (result != vk::Result::eSuccess) {
         throw std::runtime_error("Failed to submit command buffer");
@@ -190,53 +284,186 @@ void VulkanRenderer::endFrame() {
     presentInfo.pImageIndices = &m_currentImageIndex;
     
     result = m_presentQueue.presentKHR(&presentInfo);
+    queueLock.unlock();
     
     if (result == vk::Result::eErrorOutOfDateKHR || result == vk::Result::eSuboptimalKHR) {
-        // TODO: Handle swap chain recreation
+        m_swapchainDirty = true;
     } else if (result != vk::Result::eSuccess) {
         throw std::runtime_error("Failed to present swap chain image");
     }
     
+    if (m_frameNumber == 0) {
+        double firstFrameMs = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - m_initStart).count();
+        std::cout << "First frame submitted " << firstFrameMs << " ms after initialization started" << std::endl;
+    }
+    
     m_currentFrame = (m_currentFrame + 1) % m_inFlightFences.size();
+    m_frameNumber++;
+    
+    AllocationTracker::setPhase(AllocationPhase::Game);
 }
 
 void VulkanRenderer::drawFrame() {
     // Safety check
-    if (!m_initialized || m_currentImageIndex >= m_commandBuffers.size()) {
+    if (!m_initialized || !m_frameActive || m_currentImageIndex >= m_commandBuffers.size()) {
         return;
     }
+    AllocationPhaseScope phase(AllocationPhase::Record);
+    
+    // Declare this frame's passes; barriers, render passes and framebuffers
+    // are derived from what each pass reads and writes
+    RenderGraph& graph = m_renderGraphs[m_currentFrame];
+    graph.reset();
+    
+    m_lastFrameStats = m_frameStats;
+    m_frameStats = FrameStats{};
+    m_hud.update(static_cast<uint32_t>(m_currentFrame), m_swapchainExtent);
+    
+    RGResource backbuffer = graph.importImage("backbuffer",
+        m_swapchainImages[m_currentImageIndex], m_swapchainImageViews[m_currentImageIndex],
+        m_swapchainImageFormat, m_swapchainExtent,
+        vk::ImageLayout::eUndefined, vk::PipelineStageFlagBits::eColorAttachmentOutput,
+        vk::ImageLayout::ePresentSrcKHR);
+    
+    uint32_t frame = static_cast<uint32_t>(m_currentFrame);
+    m_assetStreamer.prepare(graph, frame);
+    m_tilemap.prepare(graph, frame, m_swapchainExtent);
+    m_world.prepare(graph, frame);
+    m_particles.prepare(graph, frame);
+    
+    // Pick this frame's scene resolution from the GPU time of the frame the
+    // profiler last collected
+    if (m_upscaleSupported && m_gpuProfiler.isSupported()) {
+        m_resolution.addFrame(m_gpuProfiler.getFrameMs());
+    }
+    m_renderExtent = m_upscaleSupported ? m_resolution.getRenderExtent(m_swapchainExtent) : m_swapchainExtent;
+    bool scaled = m_renderExtent.width != m_swapchainExtent.width || m_renderExtent.height != m_swapchainExtent.height;
     
-    // Record command buffer
-    vk::CommandBufferBeginInfo beginInfo{};
-    beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+    // Lights are binned in the pixels the scene is rasterized at
+    m_lighting.prepare(graph, frame, m_swapchainExtent, m_renderExtent);
     
-    m_commandBuffers[m_currentImageIndex].begin(beginInfo);
+    // A scaled scene goes to the corner of a swap chain sized target, so
+    // changing the scale never reallocates it
+    RGResource sceneTarget = backbuffer;
+    if (scaled) {
+        sceneTarget = graph.createImage("scene color", RGImageDesc{ m_swapchainImageFormat, m_swapchainExtent });
+    }
     
-    // Begin render pass
-    vk::RenderPassBeginInfo renderPassInfo{};
-    renderPassInfo.renderPass = m_renderPass;
-    renderPassInfo.framebuffer = m_swapchainFramebuffers[m_currentImageIndex];
-    renderPassInfo.renderArea.offset = vk::Offset2D{ 0, 0 };
-    renderPassInfo.renderArea.extent = m_swapchainExtent;
+    // Shows wherever no tile, sprite or world chunk covers the scene
+    vk::ClearColorValue clearColor{ 0.0f, 0.5f, 1.0f, 1.0f };
+    RGPassBuilder scene = graph.addPass("scene", RGPassType::Graphics);
+    scene.writeColor(sceneTarget, clearColor);
+    m_tilemap.declareSceneReads(scene);
+    m_world.declareSceneReads(scene);
+    m_particles.declareSceneReads(scene, frame);
+    m_lighting.declareSceneReads(scene, frame);
+    scene.execute([this, frame, scaled](const RGPassContext& context) {
+        // Systems frame the camera for the swap chain extent; the viewport
+        // squeezes that into the render extent
+        vk::Viewport viewport{ 0.0f, 0.0f, static_cast<float>(m_renderExtent.width),
+                               static_cast<float>(m_renderExtent.height), 0.0f, 1.0f };
+        vk::Rect2D scissor{ { 0, 0 }, m_renderExtent };
+        context.commandBuffer.setViewport(0, 1, &viewport);
+        context.commandBuffer.setScissor(0, 1, &scissor);
+        
+        // Past the bytes draws push, so it holds for the whole pass; the
+        // sprite shader reads it even with lighting off
+        LightingPushConstants lighting = m_lighting.getSceneConstants(frame);
+        context.commandBuffer.pushConstants(m_pipelineLayout, DescriptorManager::PUSH_CONSTANT_STAGES,
+                                            LightingSystem::PUSH_OFFSET, sizeof(lighting), &lighting);
+        
+        m_tilemap.submit(m_renderQueue, m_swapchainExtent);
+        m_world.submit(m_renderQueue, m_swapchainExtent);
+        m_sprites.submit(m_renderQueue, m_swapchainExtent, frame);
+        submitMeshDraws();
+        m_renderQueue.flush(*this, context.commandBuffer);
+        m_particles.record(context.commandBuffer, m_swapchainExtent, frame);
+        
+        // The overlay is always drawn last, at native resolution
+        if (!scaled) m_hud.record(context.commandBuffer, context.extent);
+    });
+    
+    if (scaled) {
+        graph.addPass("upscale", RGPassType::Transfer)
+            .read(sceneTarget, RGAccess::TransferRead)
+            .write(backbuffer, RGAccess::TransferWrite)
+            .execute([this, sceneTarget, backbuffer](const RGPassContext& context) {
+                vk::ImageBlit region{};
+                region.srcSubresource = vk::ImageSubresourceLayers{ vk::ImageAspectFlagBits::eColor, 0, 0, 1 };
+                region.srcOffsets[1] = vk::Offset3D{ static_cast<int32_t>(m_renderExtent.width),
+                                                     static_cast<int32_t>(m_renderExtent.height), 1 };
+                region.dstSubresource = region.srcSubresource;
+                region.dstOffsets[1] = vk::Offset3D{ static_cast<int32_t>(m_swapchainExtent.width),
+                                                     static_cast<int32_t>(m_swapchainExtent.height), 1 };
+                context.commandBuffer.blitImage(context.getImage(sceneTarget), vk::ImageLayout::eTransferSrcOptimal,
+                                                context.getImage(backbuffer), vk::ImageLayout::eTransferDstOptimal,
+                                                1, &region, vk::Filter::eLinear);
+            });
+        
+        graph.addPass("hud", RGPassType::Graphics)
+            .writeColor(backbuffer)
+            .execute([this](const RGPassContext& context) {
+                m_hud.record(context.commandBuffer, context.extent);
+            });
+    }
     
-    vk::ClearValue clearColor;
-    clearColor.color = vk::ClearColorValue{ 0.0f, 0.5f, 1.0f, 1.0f }; // Bright blue for Hello World
-    renderPassInfo.clearValueCount = 1;
-    renderPassInfo.pClearValues = &clearColor;
+    // Copies the finished image back for screenshots and recordings, when
+    // asked for
+    m_readback.declareCopy(graph, backbuffer, m_swapchainExtent, frame, m_frameNumber);
     
-    m_commandBuffers[m_currentImageIndex].beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
+    bool compiled = graph.compile();
+    if (!compiled && !m_graphFailed) {
+        std::cerr << "Render graph for frame " << m_frameNumber << " failed to compile ("
+                  << graph.getError() << "); skipping frames until it does" << std::endl;
+    }
+    m_graphFailed = !compiled;
     
-    // For now, just clear the screen with a "Hello World" color (bright blue)
-    // We'll add actual rendering later
-    std::cout << "Rendering Hello World (blue background)..." << std::endl;
+    // Record command buffer
+    vk::CommandBufferBeginInfo beginInfo{};
+    beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
     
-    // End render pass
-    m_commandBuffers[m_currentImageIndex].endRenderPass();
+    m_commandBuffers[m_currentImageIndex].begin(beginInfo);
+    if (compiled) {
+        m_gpuProfiler.beginFrame(m_commandBuffers[m_currentImageIndex], static_cast<uint32_t>(m_currentFrame));
+        graph.execute(m_commandBuffers[m_currentImageIndex]);
+    } else {
+        recordSkippedFrame(m_commandBuffers[m_currentImageIndex]);
+    }
     
     // End command buffer
     m_commandBuffers[m_currentImageIndex].end();
 }
 
+void VulkanRenderer::recordSkippedFrame(vk::CommandBuffer commandBuffer) {
+    // The acquired image still has to be submitted and presented. It is
+    // cleared to black when the swap chain allows transfers into it
+    vk::ImageMemoryBarrier barrier{};
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = m_swapchainImages[m_currentImageIndex];
+    barrier.subresourceRange = vk::ImageSubresourceRange{ vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 };
+    barrier.oldLayout = vk::ImageLayout::eUndefined;
+    vk::PipelineStageFlags srcStage = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+    
+    if (m_upscaleSupported) {
+        barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+        barrier.newLayout = vk::ImageLayout::eTransferDstOptimal;
+        commandBuffer.pipelineBarrier(srcStage, vk::PipelineStageFlagBits::eTransfer, {}, nullptr, nullptr, barrier);
+        
+        vk::ClearColorValue black(std::array<float, 4>{ 0.0f, 0.0f, 0.0f, 1.0f });
+        commandBuffer.clearColorImage(barrier.image, vk::ImageLayout::eTransferDstOptimal, black,
+                                      barrier.subresourceRange);
+        
+        barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+        barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+        srcStage = vk::PipelineStageFlagBits::eTransfer;
+    }
+    barrier.dstAccessMask = vk::AccessFlags{};
+    barrier.newLayout = vk::ImageLayout::ePresentSrcKHR;
+    commandBuffer.pipelineBarrier(srcStage, vk::PipelineStageFlagBits::eBottomOfPipe, {}, nullptr, nullptr, barrier);
+}
+
 bool VulkanRenderer::createInstance() {
     // Check validation layer support
     if (enableValidationLayers && !checkValidationLayerSupport()) {
@@ -249,7 +476,7 @@ bool VulkanRenderer::createInstance() {
     appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     appInfo.pEngineName = "No Engine";
     appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    appInfo.apiVersion = VK_API_VERSION_1_0;
+    appInfo.apiVersion = VK_API_VERSION_1_2;
     
     // Instance create info
     vk::InstanceCreateInfo createInfo{};
@@ -274,43 +501,42 @@ bool VulkanRenderer::createInstance() {
 }
 
 bool VulkanRenderer::pickPhysicalDevice() {
-    std::cout << "Enumerating physical devices..." << std::endl;
     auto devices = m_instance.enumeratePhysicalDevices();
-    std::cout << "Found " << devices.size() << " physical devices" << std::endl;
     
+    // Why each device was passed over ends up in the startup report
+    std::string rejected;
     for (const auto& device : devices) {
-        std::cout << "Checking device..." << std::endl;
-        if (isDeviceSuitable(device)) {
-            std::cout << "Selected device" << std::endl;
+        std::string reason;
+        if (isDeviceSuitable(device, reason)) {
+            auto properties = device.getProperties();
+            TaskGraph::note("Using " + vk::to_string(properties.deviceType) + " device " +
+                            std::string(properties.deviceName));
             m_physicalDevice = device;
             return true;
         }
+        if (!rejected.empty()) rejected += "; ";
+        rejected += std::string(device.getProperties().deviceName) + ": " + reason;
     }
     
-    throw std::runtime_error("Failed to find a suitable GPU");
+    throw std::runtime_error("Failed to find a suitable GPU" + (rejected.empty() ? std::string() : " (" + rejected + ")"));
 }
 
 bool VulkanRenderer::createLogicalDevice() {
-    std::cout << "Getting queue family properties..." << std::endl;
     // Queue families
     auto queueFamilies = m_physicalDevice.getQueueFamilyProperties();
-    std::cout << "Found " << queueFamilies.size() << " queue families" << std::endl;
     
     std::optional<uint32_t> graphicsFamily;
     std::optional<uint32_t> presentFamily;
     
     for (uint32_t i = 0; i < queueFamilies.size(); i++) {
-        std::cout << "Checking queue family " << i << std::endl;
         if (queueFamilies[i].queueFlags & vk::QueueFlagBits::eGraphics) {
             graphicsFamily = i;
-            std::cout << "Found graphics queue family: " << i << std::endl;
         }
         
         // We'll check surface support after creating the surface
         // For now, just assume the graphics queue can also present
         if (queueFamilies[i].queueFlags & vk::QueueFlagBits::eGraphics) {
             presentFamily = i;
-            std::cout << "Using graphics queue for present: " << i << std::endl;
         }
         
         if (graphicsFamily.has_value() && presentFamily.has_value()) {
@@ -323,7 +549,6 @@ bool VulkanRenderer::createLogicalDevice() {
     }
     
     // Create queues
-    std::cout << "Creating queue create infos..." << std::endl;
     std::set<uint32_t> uniqueQueueFamilies = { graphicsFamily.value(), presentFamily.value() };
     std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos;
     
@@ -337,17 +562,23 @@ bool VulkanRenderer::createLogicalDevice() {
     }
     
     // Device features
-    std::cout << "Setting up device features..." << std::endl;
-    vk::PhysicalDeviceFeatures deviceFeatures{};
+    std::vector<const char*> enabledExtensions(deviceExtensions.begin(), deviceExtensions.end());
+    vk::PhysicalDeviceDescriptorIndexingFeatures indexingFeatures{};
+    queryDescriptorIndexingSupport(m_physicalDevice, indexingFeatures);
+    
+    bool memoryBudgetSupported = queryMemoryBudgetSupport(enabledExtensions);
+    
+    vk::PhysicalDeviceFeatures2 deviceFeatures{};
+    deviceFeatures.pNext = &indexingFeatures;
     
     // Device create info
-    std::cout << "Creating device create info..." << std::endl;
     vk::DeviceCreateInfo createInfo{};
+    createInfo.pNext = &deviceFeatures;
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
-    createInfo.pEnabledFeatures = &deviceFeatures;
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    createInfo.pEnabledFeatures = nullptr;
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+    createInfo.ppEnabledExtensionNames = enabledExtensions.data();
     
     if (enableValidationLayers) {
         createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
@@ -357,13 +588,23 @@ bool VulkanRenderer::createLogicalDevice() {
     }
     
     // Create device
-    std::cout << "Creating logical device..." << std::endl;
     m_device = m_physicalDevice.createDevice(createInfo);
-    std::cout << "Getting queues..." << std::endl;
+    m_graphicsQueueFamily = graphicsFamily.value();
     m_graphicsQueue = m_device.getQueue(graphicsFamily.value(), 0);
     m_presentQueue = m_device.getQueue(presentFamily.value(), 0);
     
-    std::cout << "Logical device created successfully" << std::endl;
+    // Every later allocation goes through the tracker, so it exists as soon
+    // as the device does
+    m_memory.initialize(m_device, m_physicalDevice, memoryBudgetSupported);
+    m_memory.addBudgetCallback([this](const MemoryBudgetEvent& event) {
+        if (event.nearBudget) {
+            std::cerr << "Memory heap " << event.heap << " is near its budget: "
+                      << event.usage / (1024 * 1024) << " of " << event.budget / (1024 * 1024) << " MB" << std::endl;
+            m_memory.printReport(std::cerr);
+        } else {
+            std::cout << "Memory heap " << event.heap << " is back under budget" << std::endl;
+        }
+    });
     return true;
 }
 
@@ -405,6 +646,26 @@ bool VulkanRenderer::createSwapChain() {
     createInfo.imageArrayLayers = 1;
     createInfo.imageUsage = vk::ImageUsageFlagBits::eColorAttachment;
     
+    // Scaled frames are blitted into the swap chain image with filtering,
+    // from an offscreen image of the same format
+    vk::FormatFeatureFlags blitFeatures = vk::FormatFeatureFlagBits::eBlitSrc | vk::FormatFeatureFlagBits::eBlitDst |
+                                          vk::FormatFeatureFlagBits::eSampledImageFilterLinear;
+    vk::FormatProperties formatProperties = m_physicalDevice.getFormatProperties(m_swapchainImageFormat);
+    m_upscaleSupported = (capabilities.supportedUsageFlags & vk::ImageUsageFlagBits::eTransferDst) &&
+                         (formatProperties.optimalTilingFeatures & blitFeatures) == blitFeatures;
+    if (m_upscaleSupported) {
+        createInfo.imageUsage |= vk::ImageUsageFlagBits::eTransferDst;
+    } else {
+        TaskGraph::note("Swap chain can't be blitted to; rendering at native resolution only");
+    }
+    m_renderExtent = m_swapchainExtent;
+    
+    // Frames are read back by copying from the swap chain image
+    m_readbackSupported = static_cast<bool>(capabilities.supportedUsageFlags & vk::ImageUsageFlagBits::eTransferSrc);
+    if (m_readbackSupported) {
+        createInfo.imageUsage |= vk::ImageUsageFlagBits::eTransferSrc;
+    }
+    
     // Queue family indices
     auto queueFamilies = m_physicalDevice.getQueueFamilyProperties();
     std::optional<uint32_t> graphicsFamily;
@@ -432,7 +693,7 @@ bool VulkanRenderer::createSwapChain() {
     createInfo.compositeAlpha = vk::CompositeAlphaFlagBitsKHR::eOpaque;
     createInfo.presentMode = presentMode;
     createInfo.clipped = VK_TRUE;
-    createInfo.oldSwapchain = VK_NULL_HANDLE;
+    createInfo.oldSwapchain = m_swapchain;     // Set when recreating
     
     m_swapchain = m_device.createSwapchainKHR(createInfo);
     m_swapchainImages = m_device.getSwapchainImagesKHR(m_swapchain);
@@ -440,6 +701,43 @@ bool VulkanRenderer::createSwapChain() {
     return true;
 }
 
+bool VulkanRenderer::recreateSwapChain() {
+    // Zero-sized while minimized; the surface can't have a swap chain then
+    int width = 0, height = 0;
+    glfwGetFramebufferSize(m_window, &width, &height);
+    if (width == 0 || height == 0) return false;
+    auto capabilities = m_physicalDevice.getSurfaceCapabilitiesKHR(m_surface);
+    if (capabilities.currentExtent.width == 0 || capabilities.currentExtent.height == 0) return false;
+    
+    // Resizing allocates; frames after it aren't steady state yet
+    AllocationTracker::markUnsteady();
+    m_device.waitIdle();
+    
+    // Framebuffers cached by the render graphs refer to the old views
+    for (auto& graph : m_renderGraphs) {
+        graph.clearFramebufferCache();
+    }
+    for (auto imageView : m_swapchainImageViews) {
+        m_device.destroyImageView(imageView);
+    }
+    m_swapchainImageViews.clear();
+    
+    vk::SwapchainKHR oldSwapchain = m_swapchain;
+    createSwapChain();
+    m_device.destroySwapchainKHR(oldSwapchain);
+    createImageViews();
+    
+    // Command buffers are per swap chain image
+    if (m_commandBuffers.size() != m_swapchainImages.size()) {
+        m_device.freeCommandBuffers(m_commandPool, m_commandBuffers);
+        createCommandBuffers();
+    }
+    
+    m_swapchainDirty = false;
+    std::cout << "Swap chain recreated at " << m_swapchainExtent.width << "x" << m_swapchainExtent.height << std::endl;
+    return true;
+}
+
 bool VulkanRenderer::createImageViews() {
     m_swapchainImageViews.resize(m_swapchainImages.size());
     
@@ -465,6 +763,8 @@ bool VulkanRenderer::createImageViews() {
 }
 
 bool VulkanRenderer::createRenderPass() {
+    // Pipelines are created against this render pass. Frames render through
+    // the render graph, whose single color attachment passes are compatible
     vk::AttachmentDescription colorAttachment{};
     colorAttachment.format = m_swapchainImageFormat;
     colorAttachment.samples = vk::SampleCountFlagBits::e1;
@@ -505,32 +805,51 @@ bool VulkanRenderer::createRenderPass() {
 }
 
 bool VulkanRenderer::createGraphicsPipeline() {
-    // For now, create a simple pipeline without shaders to test rendering
-    // We'll just clear the screen with a color
+    // The shared layout, and the pipeline for submitMesh. Each system
+    // builds its own pipelines against the layout through PipelineFactory
+    
+    // Pipeline layout: the bindless set and push constants selecting
+    // bindless indices. Every pipeline built with this layout can share the
+    // same bound descriptor set
+    vk::DescriptorSetLayout bindlessLayout = m_descriptors.getBindlessLayout();
+    
+    vk::PushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = DescriptorManager::PUSH_CONSTANT_STAGES;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = DescriptorManager::PUSH_CONSTANT_SIZE;
     
-    // Pipeline layout
     vk::PipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &bindlessLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
     m_pipelineLayout = m_device.createPipelineLayout(pipelineLayoutInfo);
     
-    std::cout << "Graphics pipeline creation (simplified) completed" << std::endl;
+    GraphicsPipelineDesc meshDesc;
+    meshDesc.vertexShader = "mesh.vert";
+    meshDesc.fragmentShader = "mesh.frag";
+    meshDesc.bindings = { Vertex::getBindingDescription() };
+    auto attributes = Vertex::getAttributeDescriptions();
+    meshDesc.attributes.assign(attributes.begin(), attributes.end());
+    meshDesc.layout = m_pipelineLayout;
+    meshDesc.renderPass = m_renderPass;
+    m_meshPipeline = PipelineFactory::createGraphicsPipeline(m_device, meshDesc);
+    m_meshPipelineId = m_renderQueue.registerPipeline(m_meshPipeline);
     return true;
 }
 
-bool VulkanRenderer::createFramebuffers() {
-    m_swapchainFramebuffers.resize(m_swapchainImageViews.size());
-    
-    for (size_t i = 0; i < m_swapchainImageViews.size(); i++) {
-        vk::ImageView attachments[] = { m_swapchainImageViews[i] };
+bool VulkanRenderer::createRenderGraphs() {
+    for (auto& graph : m_renderGraphs) {
+        if (!graph.initialize(m_device, m_memory)) return false;
         
-        vk::FramebufferCreateInfo framebufferInfo{};
-        framebufferInfo.renderPass = m_renderPass;
-        framebufferInfo.attachmentCount = 1;
-        framebufferInfo.pAttachments = attachments;
-        framebufferInfo.width = m_swapchainExtent.width;
-        framebufferInfo.height = m_swapchainExtent.height;
-        framebufferInfo.layers = 1;
-        
-        m_swapchainFramebuffers[i] = m_device.createFramebuffer(framebufferInfo);
+        // Every pass is timed for the HUD
+        graph.setPassHook([this](vk::CommandBuffer commandBuffer, const char* passName, bool begin) {
+            if (begin) {
+                m_gpuProfiler.beginScope(commandBuffer, passName);
+            } else {
+                m_gpuProfiler.endScope(commandBuffer);
+            }
+        });
     }
     
     return true;
@@ -556,7 +875,7 @@ bool VulkanRenderer::createCommandPool() {
 }
 
 bool VulkanRenderer::createCommandBuffers() {
-    m_commandBuffers.resize(m_swapchainFramebuffers.size());
+    m_commandBuffers.resize(m_swapchainImages.size());
     
     vk::CommandBufferAllocateInfo allocInfo{};
     allocInfo.commandPool = m_commandPool;
@@ -568,15 +887,15 @@ bool VulkanRenderer::createCommandBuffers() {
 }
 
 bool VulkanRenderer::createSyncObjects() {
-    m_imageAvailableSemaphores.resize(2);
-    m_renderFinishedSemaphores.resize(2);
-    m_inFlightFences.resize(2);
+    m_imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
+    m_renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
+    m_inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
     
     vk::SemaphoreCreateInfo semaphoreInfo{};
     vk::FenceCreateInfo fenceInfo{};
     fenceInfo.flags = vk::FenceCreateFlagBits::eSignaled;
     
-    for (size_t i = 0; i < 2; i++) {
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
         m_imageAvailableSemaphores[i] = m_device.createSemaphore(semaphoreInfo);
         m_renderFinishedSemaphores[i] = m_device.createSemaphore(semaphoreInfo);
         m_inFlightFences[i] = m_device.createFence(fenceInfo);
@@ -586,33 +905,28 @@ bool VulkanRenderer::createSyncObjects() {
 }
 
 // Utility functions
-bool VulkanRenderer::isDeviceSuitable(vk::PhysicalDevice device) {
-    auto properties = device.getProperties();
-    auto features = device.getFeatures();
-    
+bool VulkanRenderer::isDeviceSuitable(vk::PhysicalDevice device, std::string& reason) {
     // Accept any GPU type (including software renderers)
-    // Prefer discrete GPU, then integrated, then CPU
-    if (properties.deviceType == vk::PhysicalDeviceType::eDiscreteGpu) {
-        std::cout << "Found discrete GPU: " << properties.deviceName << std::endl;
-    } else if (properties.deviceType == vk::PhysicalDeviceType::eIntegratedGpu) {
-        std::cout << "Found integrated GPU: " << properties.deviceName << std::endl;
-    } else if (properties.deviceType == vk::PhysicalDeviceType::eCpu) {
-        std::cout << "Found CPU renderer: " << properties.deviceName << std::endl;
-    } else {
-        std::cout << "Found other device: " << properties.deviceName << std::endl;
-    }
-    
-    // Check for required extensions
-    std::cout << "Checking device extensions..." << std::endl;
     if (!checkDeviceExtensionSupport(device)) {
-        std::cout << "Device doesn't support required extensions" << std::endl;
+        reason = "missing required extensions";
         return false;
     }
-    std::cout << "Device supports required extensions" << std::endl;
     
     // Note: We'll check swap chain support after creating the surface
     // This is done in a separate function
     
+    // Every renderer draws through the bindless set, which needs descriptor
+    // indexing. It is core from 1.2, the version the shaders target
+    if (device.getProperties().apiVersion < VK_API_VERSION_1_2) {
+        reason = "no Vulkan 1.2";
+        return false;
+    }
+    vk::PhysicalDeviceDescriptorIndexingFeatures indexingFeatures{};
+    if (!queryDescriptorIndexingSupport(device, indexingFeatures)) {
+        reason = "missing descriptor indexing features";
+        return false;
+    }
+    
     return true;
 }
 
@@ -627,6 +941,47 @@ bool VulkanRenderer::checkDeviceExtensionSupport(vk::PhysicalDevice device) {
     return requiredExtensions.empty();
 }
 
+bool VulkanRenderer::queryDescriptorIndexingSupport(vk::PhysicalDevice device,
+                                                    vk::PhysicalDeviceDescriptorIndexingFeatures& features) {
+    auto supported = device.getFeatures2<vk::PhysicalDeviceFeatures2,
+                                         vk::PhysicalDeviceDescriptorIndexingFeatures>();
+    const auto& available = supported.get<vk::PhysicalDeviceDescriptorIndexingFeatures>();
+    
+    if (!available.runtimeDescriptorArray ||
+        !available.descriptorBindingPartiallyBound ||
+        !available.descriptorBindingUpdateUnusedWhilePending ||
+        !available.descriptorBindingSampledImageUpdateAfterBind ||
+        !available.descriptorBindingStorageBufferUpdateAfterBind ||
+        !available.shaderSampledImageArrayNonUniformIndexing) {
+        return false;
+    }
+    
+    features = vk::PhysicalDeviceDescriptorIndexingFeatures{};
+    features.runtimeDescriptorArray = VK_TRUE;
+    features.descriptorBindingPartiallyBound = VK_TRUE;
+    features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+    features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+    features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+    features.shaderStorageBufferArrayNonUniformIndexing = available.shaderStorageBufferArrayNonUniformIndexing;
+    return true;
+}
+
+bool VulkanRenderer::queryMemoryBudgetSupport(std::vector<const char*>& extensions) {
+    // Reading the budget goes through vkGetPhysicalDeviceMemoryProperties2,
+    // core in 1.1
+    if (m_physicalDevice.getProperties().apiVersion < VK_API_VERSION_1_1) return false;
+    
+    for (const auto& extension : m_physicalDevice.enumerateDeviceExtensionProperties()) {
+        if (strcmp(extension.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0) {
+            extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+            return true;
+        }
+    }
+    TaskGraph::note("Device doesn't report memory budgets; using heap sizes");
+    return false;
+}
+
 std::vector<const char*> VulkanRenderer::getRequiredExtensions() {
     uint32_t glfwExtensionCount = 0;
     const char** glfwExtensions;
@@ -667,10 +1022,9 @@ bool VulkanRenderer::checkSwapChainSupport() {
     auto presentModes = m_physicalDevice.getSurfacePresentModesKHR(m_surface);
     
     if (formats.empty() || presentModes.empty()) {
-        std::cout << "Device doesn't support swap chain" << std::endl;
+        TaskGraph::note("Device doesn't support swap chain");
         return false;
     }
-    std::cout << "Device supports swap chain" << std::endl;
     
     return true;
 }
@@ -711,64 +1065,340 @@ vk::Extent2D VulkanRenderer::chooseSwapExtent(const vk::SurfaceCapabilitiesKHR&
     }
 }
 
-bool VulkanRenderer::createVertexBuffer() {
-    // Create triangle vertices
-    std::vector<Vertex> vertices = {
-        {{ 0.0f, -0.5f}, {1.0f, 0.0f, 0.0f}},  // Red
-        {{ 0.5f,  0.5f}, {0.0f, 1.0f, 0.0f}},  // Green
-        {{-0.5f,  0.5f}, {0.0f, 0.0f, 1.0f}}   // Blue
-    };
-    
-    vk::DeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
+bool VulkanRenderer::createAssetStreamer() {
+    // Nothing is loaded up front; assets are requested as the game needs
+    // them and become resident a few frames later
+    AssetBudget budget{};
+    uint32_t ioThreads = std::max(2u, std::thread::hardware_concurrency() / 4);
+    
+    // Streamed assets are the one use of memory that can be given back:
+    // near a heap's budget the streamer is held below what it has resident,
+    // so eviction frees some, until the heap recovers
+    m_memory.addBudgetCallback([this, budget](const MemoryBudgetEvent& event) {
+        AssetBudget adjusted = budget;
+        if (event.nearBudget) {
+            vk::DeviceSize resident = m_assetStreamer.getStats().deviceBytes;
+            adjusted.deviceBytes = std::min(budget.deviceBytes, resident - resident / 4);
+        }
+        m_assetStreamer.setBudget(adjusted);
+    });
     
-    // Create buffer
+    return m_assetStreamer.initialize(m_device, m_memory, budget, ioThreads,
+                                      static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT));
+}
+
+bool VulkanRenderer::createDescriptorManager() {
+    return m_descriptors.initialize(m_device, m_physicalDevice, static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT));
+}
+
+bool VulkanRenderer::createGpuProfiler() {
+    return m_gpuProfiler.initialize(m_device, m_physicalDevice, m_graphicsQueueFamily,
+                                    static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT));
+}
+
+bool VulkanRenderer::createPerformanceHud() {
+    // The overlay is optional; the game runs without it
+    if (!m_hud.initialize(*this, static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT))) {
+        TaskGraph::note("Continuing without the performance HUD");
+    }
+    return true;
+}
+
+bool VulkanRenderer::createSpriteRenderer() {
+    // The game runs without sprites if they fail to initialize
+    if (!m_sprites.initialize(*this, static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT), MAX_SPRITES)) {
+        TaskGraph::note("Continuing without sprite rendering");
+    }
+    return true;
+}
+
+bool VulkanRenderer::createTilemapRenderer() {
+    // Maps are optional; without the renderer none can be created
+    if (!m_tilemap.initialize(*this, static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT))) {
+        TaskGraph::note("Continuing without tile maps");
+    }
+    return true;
+}
+
+bool VulkanRenderer::createWorldStreamer() {
+    // Worlds are optional like maps, whose shaders they are drawn with
+    if (!m_world.initialize(*this, static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT))) {
+        TaskGraph::note("Continuing without world streaming");
+    }
+    return true;
+}
+
+bool VulkanRenderer::createParticleSystem() {
+    // Particles are optional like the sprites they are drawn with
+    if (!m_particles.initialize(*this, static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT))) {
+        TaskGraph::note("Continuing without particles");
+    }
+    return true;
+}
+
+bool VulkanRenderer::createLightingSystem() {
+    // Without lights the scene is drawn with the colors it was given
+    if (!m_lighting.initialize(*this, static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT))) {
+        TaskGraph::note("Continuing without lighting");
+    }
+    return true;
+}
+
+bool VulkanRenderer::createFrameReadback() {
+    // Screenshots and recordings are optional; the game runs without them
+    if (!m_readbackSupported || !m_readback.initialize(*this, m_swapchainImageFormat)) {
+        TaskGraph::note("Continuing without frame capture");
+    }
+    return true;
+}
+
+void VulkanRenderer::createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties,
+                                  vk::Buffer& buffer, vk::DeviceMemory& memory, const char* name) {
     vk::BufferCreateInfo bufferInfo{};
-    bufferInfo.size = bufferSize;
-    bufferInfo.usage = vk::BufferUsageFlagBits::eVertexBuffer;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
     bufferInfo.sharingMode = vk::SharingMode::eExclusive;
+    buffer = m_device.createBuffer(bufferInfo);
     
-    m_vertexBuffer = m_device.createBuffer(bufferInfo);
-    
-    // Allocate memory
-    vk::MemoryRequirements memRequirements = m_device.getBufferMemoryRequirements(m_vertexBuffer);
-    
-    vk::MemoryAllocateInfo allocInfo{};
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
-    
-    m_vertexBufferMemory = m_device.allocateMemory(allocInfo);
-    
-    // Bind memory
-    m_device.bindBufferMemory(m_vertexBuffer, m_vertexBufferMemory, 0);
-    
-    // Copy data
-    void* data = m_device.mapMemory(m_vertexBufferMemory, 0, bufferSize);
-    memcpy(data, vertices.data(), bufferSize);
-    m_device.unmapMemory(m_vertexBufferMemory);
-    
-    std::cout << "Vertex buffer created successfully" << std::endl;
-    return true;
+    vk::MemoryRequirements memRequirements = m_device.getBufferMemoryRequirements(buffer);
+    try {
+        memory = m_memory.allocate(memRequirements, properties, getMemoryCategory(usage), name);
+    } catch (...) {
+        m_device.destroyBuffer(buffer);
+        buffer = VK_NULL_HANDLE;
+        throw;
+    }
+    m_device.bindBufferMemory(buffer, memory, 0);
 }
 
-void VulkanRenderer::cleanupVertexBuffer() {
-    if (m_vertexBuffer) {
-        m_device.destroyBuffer(m_vertexBuffer);
-        m_vertexBuffer = VK_NULL_HANDLE;
+void VulkanRenderer::destroyBuffer(vk::Buffer& buffer, vk::DeviceMemory& memory) {
+    if (buffer) {
+        m_device.destroyBuffer(buffer);
+        buffer = VK_NULL_HANDLE;
     }
-    if (m_vertexBufferMemory) {
-        m_device.freeMemory(m_vertexBufferMemory);
-        m_vertexBufferMemory = VK_NULL_HANDLE;
+    if (memory) {
+        m_memory.free(memory);
+        memory = VK_NULL_HANDLE;
     }
 }
 
-uint32_t VulkanRenderer::findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) {
-    vk::PhysicalDeviceMemoryProperties memProperties = m_physicalDevice.getMemoryProperties();
+Texture VulkanRenderer::createTexture(uint32_t width, uint32_t height, vk::Format format,
+                                      const void* pixels, size_t size, SamplerType sampler, const char* name) {
+    Texture texture;
+    texture.width = width;
+    texture.height = height;
+    
+    vk::ImageCreateInfo imageInfo{};
+    imageInfo.imageType = vk::ImageType::e2D;
+    imageInfo.format = format;
+    imageInfo.extent = vk::Extent3D{ width, height, 1 };
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = vk::SampleCountFlagBits::e1;
+    imageInfo.tiling = vk::ImageTiling::eOptimal;
+    imageInfo.usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled;
+    imageInfo.sharingMode = vk::SharingMode::eExclusive;
+    imageInfo.initialLayout = vk::ImageLayout::eUndefined;
+    texture.image = m_device.createImage(imageInfo);
+    
+    vk::MemoryRequirements memRequirements = m_device.getImageMemoryRequirements(texture.image);
+    texture.memory = m_memory.allocate(memRequirements, vk::MemoryPropertyFlagBits::eDeviceLocal,
+                                       MemoryCategory::Texture, name);
+    m_device.bindImageMemory(texture.image, texture.memory, 0);
+    
+    // Upload through a staging buffer, leaving the image ready for sampling
+    vk::Buffer staging;
+    vk::DeviceMemory stagingMemory;
+    createBuffer(size, vk::BufferUsageFlagBits::eTransferSrc,
+                 vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+                 staging, stagingMemory, "texture staging");
+    void* data = m_device.mapMemory(stagingMemory, 0, size);
+    memcpy(data, pixels, size);
+    m_device.unmapMemory(stagingMemory);
+    
+    submitImmediate([&](vk::CommandBuffer commandBuffer) {
+        vk::ImageMemoryBarrier barrier{};
+        barrier.oldLayout = vk::ImageLayout::eUndefined;
+        barrier.newLayout = vk::ImageLayout::eTransferDstOptimal;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = texture.image;
+        barrier.subresourceRange = vk::ImageSubresourceRange{ vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 };
+        barrier.srcAccessMask = vk::AccessFlagBits::eNone;
+        barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer,
+                                      {}, 0, nullptr, 0, nullptr, 1, &barrier);
+        
+        vk::BufferImageCopy region{};
+        region.imageSubresource = vk::ImageSubresourceLayers{ vk::ImageAspectFlagBits::eColor, 0, 0, 1 };
+        region.imageExtent = vk::Extent3D{ width, height, 1 };
+        commandBuffer.copyBufferToImage(staging, texture.image, vk::ImageLayout::eTransferDstOptimal, 1, &region);
+        
+        barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+        barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+        barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+        barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                      vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eComputeShader,
+                                      {}, 0, nullptr, 0, nullptr, 1, &barrier);
+    });
+    destroyBuffer(staging, stagingMemory);
+    
+    vk::ImageViewCreateInfo viewInfo{};
+    viewInfo.image = texture.image;
+    viewInfo.viewType = vk::ImageViewType::e2D;
+    viewInfo.format = format;
+    viewInfo.subresourceRange = vk::ImageSubresourceRange{ vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 };
+    texture.view = m_device.createImageView(viewInfo);
+    
+    texture.bindlessIndex = m_descriptors.registerTexture(texture.view, sampler);
+    return texture;
+}
+
+void VulkanRenderer::destroyTexture(Texture& texture) {
+    m_descriptors.releaseTexture(texture.bindlessIndex);
+    if (texture.view) {
+        m_device.destroyImageView(texture.view);
+    }
+    if (texture.image) {
+        m_device.destroyImage(texture.image);
+    }
+    m_memory.free(texture.memory);
+    texture = Texture{};
+}
+
+Mesh VulkanRenderer::createMesh(const MeshData& data, const char* name) {
+    Mesh mesh;
+    mesh.indexType = data.indexFormat == IndexFormat::Uint16 ? vk::IndexType::eUint16 : vk::IndexType::eUint32;
+    mesh.indexCount = data.indexCount;
+    mesh.vertexCount = data.vertexCount;
+    if (data.indexCount == 0) return mesh;
+    
+    vk::DeviceSize vertexSize = data.vertices.size();
+    vk::DeviceSize indexSize = data.indices.size();
+    createBuffer(vertexSize, vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst,
+                 vk::MemoryPropertyFlagBits::eDeviceLocal, mesh.vertexBuffer, mesh.vertexMemory, name);
+    createBuffer(indexSize, vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst,
+                 vk::MemoryPropertyFlagBits::eDeviceLocal, mesh.indexBuffer, mesh.indexMemory, name);
+    
+    // Vertices and indices share one staging buffer and one submission
+    vk::Buffer staging;
+    vk::DeviceMemory stagingMemory;
+    createBuffer(vertexSize + indexSize, vk::BufferUsageFlagBits::eTransferSrc,
+                 vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+                 staging, stagingMemory, "mesh staging");
+    uint8_t* mapped = static_cast<uint8_t*>(m_device.mapMemory(stagingMemory, 0, vertexSize + indexSize));
+    memcpy(mapped, data.vertices.data(), vertexSize);
+    memcpy(mapped + vertexSize, data.indices.data(), indexSize);
+    m_device.unmapMemory(stagingMemory);
+    
+    submitImmediate([&](vk::CommandBuffer commandBuffer) {
+        vk::BufferCopy vertexCopy{ 0, 0, vertexSize };
+        commandBuffer.copyBuffer(staging, mesh.vertexBuffer, 1, &vertexCopy);
+        vk::BufferCopy indexCopy{ vertexSize, 0, indexSize };
+        commandBuffer.copyBuffer(staging, mesh.indexBuffer, 1, &indexCopy);
+        
+        vk::MemoryBarrier barrier{ vk::AccessFlagBits::eTransferWrite,
+                                   vk::AccessFlagBits::eVertexAttributeRead | vk::AccessFlagBits::eIndexRead };
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eVertexInput,
+                                      {}, 1, &barrier, 0, nullptr, 0, nullptr);
+    });
+    destroyBuffer(staging, stagingMemory);
+    return mesh;
+}
+
+void VulkanRenderer::destroyMesh(Mesh& mesh) {
+    destroyBuffer(mesh.vertexBuffer, mesh.vertexMemory);
+    destroyBuffer(mesh.indexBuffer, mesh.indexMemory);
+    mesh = Mesh{};
+}
+
+void VulkanRenderer::drawMesh(vk::CommandBuffer commandBuffer, const Mesh& mesh, uint32_t instanceCount) {
+    if (mesh.indexCount == 0) return;
+    
+    vk::DeviceSize offset = 0;
+    commandBuffer.bindVertexBuffers(0, 1, &mesh.vertexBuffer, &offset);
+    commandBuffer.bindIndexBuffer(mesh.indexBuffer, 0, mesh.indexType);
+    commandBuffer.drawIndexed(mesh.indexCount, instanceCount, 0, 0, 0);
+    countDraw(mesh.indexCount, instanceCount);
+}
+
+void VulkanRenderer::submitMesh(const Mesh& mesh, glm::vec2 position, float scale, uint8_t layer, float depth) {
+    m_meshDraws.push_back(MeshDraw{ &mesh, position, scale, packRenderOrder(layer, depth) });
+}
+
+void VulkanRenderer::submitMeshDraws() {
+    if (m_meshDraws.empty()) return;
+    
+    // Same camera as the sprites
+    glm::vec2 cameraCenter = m_sprites.getCameraCenter();
+    float zoom = m_sprites.getZoom();
+    MeshPushConstants constants{};
+    constants.cameraCenter[0] = cameraCenter.x;
+    constants.cameraCenter[1] = cameraCenter.y;
+    constants.worldToClip[0] = 2.0f * zoom / m_swapchainExtent.width;
+    constants.worldToClip[1] = 2.0f * zoom / m_swapchainExtent.height;
+    
+    RenderDraw draw;
+    draw.pipeline = m_meshPipelineId;
+    draw.pushSize = sizeof(MeshPushConstants);
+    for (const MeshDraw& meshDraw : m_meshDraws) {
+        draw.mesh = meshDraw.mesh;
+        constants.position[0] = meshDraw.position.x;
+        constants.position[1] = meshDraw.position.y;
+        constants.scale = meshDraw.scale;
+        std::memcpy(draw.pushData, &constants, sizeof(constants));
+        m_renderQueue.submit(makeRenderKey(meshDraw.order, m_meshPipelineId, 0), draw);
+    }
+}
+
+void VulkanRenderer::submitImmediate(const std::function<void(vk::CommandBuffer)>& record) {
+    // A pool of its own, since the frame command pool may be in use on
+    // another thread while initialization tasks run
+    vk::CommandPoolCreateInfo poolInfo{};
+    poolInfo.flags = vk::CommandPoolCreateFlagBits::eTransient;
+    poolInfo.queueFamilyIndex = m_graphicsQueueFamily;
+    vk::CommandPool pool = m_device.createCommandPool(poolInfo);
+    vk::Fence fence;
     
-    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-        if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-            return i;
+    try {
+        vk::CommandBufferAllocateInfo allocInfo{};
+        allocInfo.commandPool = pool;
+        allocInfo.level = vk::CommandBufferLevel::ePrimary;
+        allocInfo.commandBufferCount = 1;
+        vk::CommandBuffer commandBuffer = m_device.allocateCommandBuffers(allocInfo)[0];
+        
+        vk::CommandBufferBeginInfo beginInfo{};
+        beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+        commandBuffer.begin(beginInfo);
+        record(commandBuffer);
+        commandBuffer.end();
+        
+        fence = m_device.createFence(vk::FenceCreateInfo{});
+        vk::SubmitInfo submitInfo{};
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &commandBuffer;
+        {
+            std::lock_guard<std::mutex> lock(m_queueMutex);
+            if (m_graphicsQueue.submit(1, &submitInfo, fence) != vk::Result::eSuccess) {
+                throw std::runtime_error("Failed to submit upload command buffer");
+            }
+        }
+        if (m_device.waitForFences(1, &fence, VK_TRUE, UINT64_MAX) != vk::Result::eSuccess) {
+            throw std::runtime_error("Failed to wait for upload");
         }
+    } catch (...) {
+        m_device.destroyFence(fence);
+        m_device.destroyCommandPool(pool);
+        throw;
     }
     
-    throw std::runtime_error("Failed to find suitable memory type");
-} 
\ No newline at end of file
+    m_device.destroyFence(fence);
+    m_device.destroyCommandPool(pool);
+}
+
+void VulkanRenderer::countDraw(uint32_t vertexCount, uint32_t instanceCount) {
+    m_frameStats.drawCalls++;
+    m_frameStats.triangles += static_cast<uint64_t>(vertexCount / 3) * instanceCount;
+}
+ 
\ No newline at end of file
@@ -24,9 +24,16 @@ bool Window::initialize(int width, int height, const std::string& title) {
         return false;
     }
 
+    // The framebuffer may be larger than the window on high-DPI displays
+    glfwGetFramebufferSize(m_window, &m_width, &m_height);
+    m_focused = glfwGetWindowAttrib(m_window, GLFW_FOCUSED) == GLFW_TRUE;
+    m_iconified = glfwGetWindowAttrib(m_window, GLFW_ICONIFIED) == GLFW_TRUE;
+
     // Set callbacks
     glfwSetWindowUserPointer(m_window, this);
     glfwSetFramebufferSizeCallback(m_window, framebufferSizeCallback);
+    glfwSetWindowFocusCallback(m_window, focusCallback);
+    glfwSetWindowIconifyCallback(m_window, iconifyCallback);
     glfwSetKeyCallback(m_window, keyCallback);
     glfwSetMouseButtonCallback(m_window, mouseButtonCallback);
     glfwSetCursorPosCallback(m_window, cursorPosCallback);
@@ -51,10 +58,30 @@ void Window::pollEvents() {
     glfwPollEvents();
 }
 
+void Window::waitEvents(double timeoutSeconds) {
+    glfwWaitEventsTimeout(timeoutSeconds);
+}
+
 void Window::swapBuffers() {
     glfwSwapBuffers(m_window);
 }
 
+bool Window::takeScreenshotRequest() {
+    bool requested = m_screenshotRequested;
+    m_screenshotRequested = false;
+    return requested;
+}
+
+bool Window::takeFramebufferResized() {
+    bool resized = m_framebufferResized;
+    m_framebufferResized = false;
+    return resized;
+}
+
+bool Window::isVisible() const {
+    return glfwGetWindowAttrib(m_window, GLFW_VISIBLE) == GLFW_TRUE;
+}
+
 bool Window::isKeyPressed(int key) const {
     return glfwGetKey(m_window, key) == GLFW_PRESS;
 }
@@ -73,7 +100,21 @@ void Window::framebufferSizeCallback(GLFWwindow* window, int width, int height)
     if (win) {
         win->m_width = width;
         win->m_height = height;
-        // TODO: Handle resize in renderer
+        win->m_framebufferResized = true;
+    }
+}
+
+void Window::focusCallback(GLFWwindow* window, int focused) {
+    Window* win = static_cast<Window*>(glfwGetWindowUserPointer(window));
+    if (win) {
+        win->m_focused = focused == GLFW_TRUE;
+    }
+}
+
+void Window::iconifyCallback(GLFWwindow* window, int iconified) {
+    Window* win = static_cast<Window*>(glfwGetWindowUserPointer(window));
+    if (win) {
+        win->m_iconified = iconified == GLFW_TRUE;
     }
 }
 
@@ -84,6 +125,20 @@ void Window::keyCallback(GLFWwindow* window, int key, int scancode, int action,
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
         glfwSetWindowShouldClose(window, GLFW_TRUE);
     }
+    
+    if (key == GLFW_KEY_F3 && action == GLFW_PRESS) {
+        Window* win = static_cast<Window*>(glfwGetWindowUserPointer(window));
+        if (win) {
+            win->m_hudVisible = !win->m_hudVisible;
+        }
+    }
+    
+    if (key == GLFW_KEY_F12 && action == GLFW_PRESS) {
+        Window* win = static_cast<Window*>(glfwGetWindowUserPointer(window));
+        if (win) {
+            win->m_screenshotRequested = true;
+        }
+    }
     // TODO: Add more key handling
 }
 
@@ -0,0 +1,216 @@
+#include "WorldFile.h"
+#include "Random.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() {
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::string& path) {
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        CloseHandle(file);
+        return false;
+    }
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    m_file = file;
+    m_mapping = mapping;
+    m_data = static_cast<const uint8_t*>(view);
+    m_size = static_cast<size_t>(size.QuadPart);
+#else
+    int file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0) return false;
+
+    struct stat info;
+    if (fstat(file, &info) != 0 || info.st_size == 0) {
+        ::close(file);
+        return false;
+    }
+    void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+    // The mapping keeps the file alive
+    ::close(file);
+    if (view == MAP_FAILED) return false;
+
+    // Chunks are read in camera order, not file order: readahead would
+    // mostly fetch pages nobody asked for
+    madvise(view, static_cast<size_t>(info.st_size), MADV_RANDOM);
+    m_data = static_cast<const uint8_t*>(view);
+    m_size = static_cast<size_t>(info.st_size);
+#endif
+    return true;
+}
+
+void MappedFile::close() {
+    if (!m_data) return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(m_data);
+    CloseHandle(m_mapping);
+    CloseHandle(m_file);
+    m_mapping = nullptr;
+    m_file = nullptr;
+#else
+    munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif
+    m_data = nullptr;
+    m_size = 0;
+}
+
+bool writeWorldFile(const std::string& path, const WorldFileHeader& header, const WorldChunkGenerator& generate) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Failed to create world file: " << path << std::endl;
+        return false;
+    }
+
+    size_t chunkCount = static_cast<size_t>(header.chunksX) * header.chunksY;
+    std::vector<uint64_t> offsets(chunkCount, 0);
+    auto alignUp = [](uint64_t value) {
+        return (value + WorldFile::CHUNK_BYTES - 1) / WorldFile::CHUNK_BYTES * WorldFile::CHUNK_BYTES;
+    };
+
+    // The offset table is written last, once it is known
+    uint64_t position = alignUp(sizeof(WorldFileHeader) + chunkCount * sizeof(uint64_t));
+    file.seekp(static_cast<std::streamoff>(position));
+
+    std::vector<TileId> tiles(TilemapRenderer::CHUNK_TILES);
+    for (uint32_t y = 0; y < header.chunksY; y++) {
+        for (uint32_t x = 0; x < header.chunksX; x++) {
+            std::fill(tiles.begin(), tiles.end(), EMPTY_TILE);
+            if (!generate(x, y, tiles.data())) continue;
+
+            offsets[static_cast<size_t>(y) * header.chunksX + x] = position;
+            file.write(reinterpret_cast<const char*>(tiles.data()), WorldFile::CHUNK_BYTES);
+            position += WorldFile::CHUNK_BYTES;
+        }
+    }
+
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(offsets.data()), static_cast<std::streamsize>(offsets.size() * sizeof(uint64_t)));
+    if (!file.good()) {
+        std::cerr << "Failed to write world file: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool writeProceduralWorld(const std::string& path, uint32_t tilesPerSide, uint64_t seed) {
+    constexpr uint32_t ATLAS_CELLS = 8;
+    constexpr uint32_t CHUNK_SIZE = TilemapRenderer::CHUNK_SIZE;
+    uint32_t chunksPerSide = (tilesPerSide + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    if (tilesPerSide == 0 || chunksPerSide > WorldFile::MAX_CHUNKS_PER_SIDE) {
+        std::cerr << "World size must be between 1 and " << WorldFile::MAX_CHUNKS_PER_SIDE * CHUNK_SIZE
+                  << " tiles" << std::endl;
+        return false;
+    }
+
+    WorldFileHeader header;
+    header.chunksX = chunksPerSide;
+    header.chunksY = chunksPerSide;
+    header.tilesetColumns = ATLAS_CELLS;
+    header.tilesetRows = ATLAS_CELLS;
+
+    return writeWorldFile(path, header, [&](uint32_t chunkX, uint32_t chunkY, TileId* tiles) {
+        Random random(seed, static_cast<uint64_t>(chunkY) * chunksPerSide + chunkX + 1);
+        if (random.below(8) == 0) return false;
+
+        TileId current = static_cast<TileId>(1 + random.below(ATLAS_CELLS * ATLAS_CELLS));
+        uint32_t width = std::min(CHUNK_SIZE, tilesPerSide - chunkX * CHUNK_SIZE);
+        uint32_t height = std::min(CHUNK_SIZE, tilesPerSide - chunkY * CHUNK_SIZE);
+        for (uint32_t y = 0; y < height; y++) {
+            for (uint32_t x = 0; x < width; x++) {
+                if (random.below(16) == 0) {
+                    current = static_cast<TileId>(1 + random.below(ATLAS_CELLS * ATLAS_CELLS));
+                }
+                tiles[y * CHUNK_SIZE + x] = random.below(32) == 0 ? EMPTY_TILE : current;
+            }
+        }
+        return true;
+    });
+}
+
+bool WorldFile::open(const std::string& path) {
+    close();
+    if (!m_file.open(path)) {
+        std::cerr << "Failed to map world file: " << path << std::endl;
+        return false;
+    }
+
+    // Only the header and the offset table are checked here; chunk offsets
+    // are checked when they are looked up
+    WorldFileHeader expected;
+    if (m_file.size() < sizeof(WorldFileHeader)) {
+        std::cerr << "Not a world file: " << path << std::endl;
+        close();
+        return false;
+    }
+    std::memcpy(&m_header, m_file.data(), sizeof(WorldFileHeader));
+    size_t chunkCount = static_cast<size_t>(m_header.chunksX) * m_header.chunksY;
+    if (std::memcmp(m_header.magic, expected.magic, sizeof(expected.magic)) != 0 ||
+        m_header.version != WORLD_FILE_VERSION) {
+        std::cerr << "Not a version " << WORLD_FILE_VERSION << " world file: " << path << std::endl;
+        close();
+        return false;
+    }
+    if (m_header.chunkSize != TilemapRenderer::CHUNK_SIZE || chunkCount == 0 ||
+        m_header.chunksX > MAX_CHUNKS_PER_SIDE || m_header.chunksY > MAX_CHUNKS_PER_SIDE ||
+        m_file.size() < sizeof(WorldFileHeader) + chunkCount * sizeof(uint64_t) ||
+        m_header.tilesetColumns == 0 || m_header.tilesetRows == 0 || !(m_header.tileSize > 0.0f)) {
+        std::cerr << "Malformed world file: " << path << std::endl;
+        close();
+        return false;
+    }
+
+    m_offsets = reinterpret_cast<const uint64_t*>(m_file.data() + sizeof(WorldFileHeader));
+    return true;
+}
+
+void WorldFile::close() {
+    m_file.close();
+    m_header = WorldFileHeader{};
+    m_offsets = nullptr;
+}
+
+const TileId* WorldFile::getChunk(uint32_t chunk) const {
+    if (!m_offsets || chunk >= getChunkCount()) return nullptr;
+
+    uint64_t offset = m_offsets[chunk];
+    if (offset == 0 || offset % CHUNK_BYTES != 0 || offset + CHUNK_BYTES > m_file.size()) return nullptr;
+    return reinterpret_cast<const TileId*>(m_file.data() + offset);
+}
@@ -0,0 +1,571 @@
+#include "WorldStreamer.h"
+#include "VulkanRenderer.h"
+#include "AllocationTracker.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+constexpr vk::DeviceSize SLOT_BYTES = TilemapRenderer::CHUNK_TILES * sizeof(uint32_t);
+constexpr vk::DeviceSize UPLOAD_BYTES_PER_FRAME = TilemapRenderer::UPLOAD_BYTES_PER_FRAME;
+
+} // namespace
+
+WorldStreamer::WorldStreamer() {
+}
+
+WorldStreamer::~WorldStreamer() {
+    cleanup();
+}
+
+bool WorldStreamer::initialize(VulkanRenderer& renderer, uint32_t framesInFlight) {
+    m_renderer = &renderer;
+    m_device = renderer.getDevice();
+
+    m_pipeline = PipelineFactory::createGraphicsPipeline(m_device, TilemapRenderer::getPipelineDesc(renderer));
+    m_pipelineId = renderer.getRenderQueue().registerPipeline(m_pipeline);
+
+    m_frames.resize(framesInFlight);
+    for (auto& frame : m_frames) {
+        renderer.createBuffer(UPLOAD_BYTES_PER_FRAME, vk::BufferUsageFlagBits::eTransferSrc,
+            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+            frame.staging, frame.stagingMemory, "world staging");
+        frame.mapped = static_cast<uint32_t*>(m_device.mapMemory(frame.stagingMemory, 0, UPLOAD_BYTES_PER_FRAME));
+        frame.regions.reserve(UPLOAD_BYTES_PER_FRAME / SLOT_BYTES);
+    }
+
+    m_loadStorage.reserve(MAX_PENDING_LOADS);
+    m_freeLoads.reserve(MAX_PENDING_LOADS);
+    for (uint32_t i = 0; i < MAX_PENDING_LOADS; i++) {
+        m_loadStorage.push_back(std::make_unique<ChunkLoad>());
+        m_freeLoads.push_back(m_loadStorage.back().get());
+    }
+    m_ready.reserve(MAX_PENDING_LOADS);
+    m_queue.reserve(MAX_PENDING_LOADS);
+    m_finished.reserve(MAX_PENDING_LOADS);
+
+    m_stopping = false;
+    for (uint32_t i = 0; i < IO_THREADS; i++) {
+        m_ioThreads.emplace_back(&WorldStreamer::ioThreadMain, this);
+    }
+
+    m_initialized = true;
+    return true;
+}
+
+void WorldStreamer::cleanup() {
+    if (!m_initialized) return;
+
+    close();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_loadAvailable.notify_all();
+    for (auto& thread : m_ioThreads) {
+        thread.join();
+    }
+    m_ioThreads.clear();
+
+    for (auto& frame : m_frames) {
+        if (frame.mapped) m_device.unmapMemory(frame.stagingMemory);
+        m_renderer->destroyBuffer(frame.staging, frame.stagingMemory);
+    }
+    m_frames.clear();
+    m_freeLoads.clear();
+    m_loadStorage.clear();
+
+    m_device.destroyPipeline(m_pipeline);
+    m_pipeline = VK_NULL_HANDLE;
+    m_initialized = false;
+}
+
+bool WorldStreamer::open(const std::string& path, uint32_t tilesetTexture, const WorldStreamingBudget& budget) {
+    if (!m_initialized) return false;
+    close();
+
+    uint32_t slotCount = static_cast<uint32_t>(std::min<vk::DeviceSize>(budget.deviceBytes / SLOT_BYTES, UINT32_MAX / TilemapRenderer::CHUNK_TILES));
+    if (slotCount == 0) {
+        std::cerr << "World streaming budget is smaller than one chunk (" << SLOT_BYTES << " bytes)" << std::endl;
+        return false;
+    }
+
+    // Opening allocates; frames after it are not steady yet
+    AllocationTracker::markUnsteady();
+
+    if (!m_file.open(path)) return false;
+
+    try {
+        m_renderer->createBuffer(slotCount * SLOT_BYTES,
+                                 vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst,
+                                 vk::MemoryPropertyFlagBits::eDeviceLocal, m_slotBuffer, m_slotMemory,
+                                 "world chunks");
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to create world chunk buffer: " << e.what() << std::endl;
+        m_file.close();
+        return false;
+    }
+
+    m_budget = budget;
+    m_tilesetTexture = tilesetTexture;
+    m_slotCount = slotCount;
+    // Handed out from the back, lowest slot first
+    m_freeSlots.resize(slotCount);
+    for (uint32_t i = 0; i < slotCount; i++) {
+        m_freeSlots[i] = slotCount - 1 - i;
+    }
+
+    // Resident chunks are trimmed back to two per slot, since empty chunks
+    // take none, and loads in flight need an entry each
+    uint32_t entryCount = slotCount * 2 + MAX_PENDING_LOADS;
+    m_entries.assign(entryCount, ChunkEntry());
+    m_freeEntries.resize(entryCount);
+    for (uint32_t i = 0; i < entryCount; i++) {
+        m_freeEntries[i] = entryCount - 1 - i;
+    }
+    uint32_t tableBits = 1;
+    while ((1ull << tableBits) < static_cast<uint64_t>(entryCount) * 2) tableBits++;
+    m_chunkTable.assign(size_t(1) << tableBits, NO_ENTRY);
+    m_chunkTableShift = 64 - tableBits;
+
+    const WorldFileHeader& header = m_file.getHeader();
+    std::cout << "World " << header.chunksX << "x" << header.chunksY << " chunks streaming from " << path
+              << " into " << slotCount << " chunk slots (" << ((slotCount * SLOT_BYTES) >> 20) << " MB)" << std::endl;
+    return true;
+}
+
+void WorldStreamer::close() {
+    if (!m_initialized) return;
+
+    waitForIo();
+    m_file.close();
+    m_renderer->destroyBuffer(m_slotBuffer, m_slotMemory);
+    m_slotCount = 0;
+    m_slotResource = INVALID_RG_RESOURCE;
+    m_freeSlots = std::vector<uint32_t>();
+    m_entries = std::vector<ChunkEntry>();
+    m_freeEntries = std::vector<uint32_t>();
+    m_chunkTable = std::vector<uint32_t>();
+    m_resident = EntryList();
+    m_deferred = EntryList();
+    m_wantedRange = ChunkRange();
+    m_evictionCount = 0;
+    m_lastDrawnChunks = 0;
+}
+
+glm::vec2 WorldStreamer::getWorldSize() const {
+    const WorldFileHeader& header = m_file.getHeader();
+    float chunkSize = header.tileSize * TilemapRenderer::CHUNK_SIZE;
+    return glm::vec2(header.chunksX * chunkSize, header.chunksY * chunkSize);
+}
+
+WorldStreamingStats WorldStreamer::getStats() const {
+    WorldStreamingStats stats;
+    stats.residentChunks = m_resident.count;
+    stats.slotCount = m_slotCount;
+    stats.usedSlots = m_slotCount - static_cast<uint32_t>(m_freeSlots.size());
+    stats.pendingChunks = static_cast<uint32_t>(m_entries.size() - m_freeEntries.size()) - m_resident.count - m_deferred.count;
+    stats.evictionCount = m_evictionCount;
+    return stats;
+}
+
+void WorldStreamer::update(const SpriteBounds& view, glm::vec2 velocity) {
+    if (!isOpen()) return;
+    m_frameNumber++;
+
+    const WorldFileHeader& header = m_file.getHeader();
+    float chunkSize = header.tileSize * TilemapRenderer::CHUNK_SIZE;
+    float margin = m_budget.marginChunks * chunkSize;
+    SpriteBounds nearArea{ view.minX - margin, view.minY - margin, view.maxX + margin, view.maxY + margin };
+
+    // The near area swept along the velocity: the faster the camera moves,
+    // the further ahead chunks are requested
+    glm::vec2 ahead = velocity * m_budget.prefetchSeconds;
+    SpriteBounds prefetchArea{ nearArea.minX + std::min(ahead.x, 0.0f), nearArea.minY + std::min(ahead.y, 0.0f),
+                               nearArea.maxX + std::max(ahead.x, 0.0f), nearArea.maxY + std::max(ahead.y, 0.0f) };
+
+    // Put back the loads no I/O thread has started, so the queue is ranked
+    // afresh for where the camera is now
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (size_t i = m_queueHead; i < m_queue.size(); i++) {
+            releaseEntry(findEntry(m_queue[i]->chunk));
+            m_freeLoads.push_back(m_queue[i]);
+        }
+        m_queue.clear();
+        m_queueHead = 0;
+    }
+
+    m_wanted.clear();
+    collectWanted(prefetchArea, nearArea, glm::vec2((view.minX + view.maxX) * 0.5f, (view.minY + view.maxY) * 0.5f));
+    // Each request takes an entry; with none free, the slots are full of
+    // wanted chunks and loading more would only defer them
+    size_t count = std::min({ m_wanted.size(), m_freeLoads.size(), m_freeEntries.size() });
+    if (count == 0) return;
+
+    // Under the view first, then the nearest
+    std::partial_sort(m_wanted.begin(), m_wanted.begin() + count, m_wanted.end(),
+                      [](const WantedChunk& a, const WantedChunk& b) {
+                          if (a.priority != b.priority) return a.priority < b.priority;
+                          return a.distance < b.distance;
+                      });
+
+    m_ready.clear();
+    for (size_t i = 0; i < count; i++) {
+        ChunkLoad* load = m_freeLoads.back();
+        m_freeLoads.pop_back();
+        load->chunk = m_wanted[i].chunk;
+        allocateEntry(load->chunk);
+        m_ready.push_back(load);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.insert(m_queue.end(), m_ready.begin(), m_ready.end());
+    }
+    m_loadAvailable.notify_all();
+}
+
+void WorldStreamer::collectWanted(const SpriteBounds& area, const SpriteBounds& nearArea, glm::vec2 center) {
+    const WorldFileHeader& header = m_file.getHeader();
+    float chunkSize = header.tileSize * TilemapRenderer::CHUNK_SIZE;
+    auto chunkRange = [&](float minWorld, float maxWorld, uint32_t chunks, uint32_t& first, uint32_t& last) {
+        float lo = std::floor(minWorld / chunkSize);
+        float hi = std::floor(maxWorld / chunkSize);
+        if (hi < 0.0f || lo >= static_cast<float>(chunks)) return false;
+        first = static_cast<uint32_t>(std::max(lo, 0.0f));
+        last = static_cast<uint32_t>(std::min(hi, static_cast<float>(chunks - 1)));
+        return true;
+    };
+
+    uint32_t minX, minY, maxX, maxY;
+    if (!chunkRange(area.minX, area.maxX, header.chunksX, minX, maxX) ||
+        !chunkRange(area.minY, area.maxY, header.chunksY, minY, maxY)) {
+        minX = minY = 1;
+        maxX = maxY = 0;
+    }
+
+    ChunkRange range{ minX, minY, maxX, maxY };
+    if (!(range == m_wantedRange)) {
+        // Chunks have left the area, so their slots can go to the deferred
+        // ones, and deferred chunks may have left it themselves
+        releaseDeferred();
+        m_wantedRange = range;
+    }
+    if (minX > maxX) return;
+
+    for (uint32_t cy = minY; cy <= maxY; cy++) {
+        for (uint32_t cx = minX; cx <= maxX; cx++) {
+            uint32_t chunk = cy * header.chunksX + cx;
+            uint32_t existing = findEntry(chunk);
+            if (existing != NO_ENTRY) {
+                touch(existing);
+                continue;
+            }
+
+            glm::vec2 chunkCenter((cx + 0.5f) * chunkSize, (cy + 0.5f) * chunkSize);
+            bool isNear = chunkCenter.x >= nearArea.minX - chunkSize * 0.5f &&
+                          chunkCenter.x <= nearArea.maxX + chunkSize * 0.5f &&
+                          chunkCenter.y >= nearArea.minY - chunkSize * 0.5f &&
+                          chunkCenter.y <= nearArea.maxY + chunkSize * 0.5f;
+            float distance = glm::length(chunkCenter - center) / chunkSize;
+            m_wanted.push_back(WantedChunk{ chunk, isNear ? 0u : 1u, distance });
+        }
+    }
+}
+
+void WorldStreamer::touch(uint32_t index) {
+    ChunkEntry& entry = m_entries[index];
+    entry.lastWantedFrame = m_frameNumber;
+    if (entry.state == ChunkState::Resident) {
+        unlink(m_resident, index);
+        pushFront(m_resident, index);
+    }
+}
+
+void WorldStreamer::evict(uint32_t index) {
+    if (m_entries[index].slot != NO_SLOT) {
+        // An earlier frame may still draw from the slot; the next upload's
+        // barrier waits for it before the slot is overwritten
+        m_freeSlots.push_back(m_entries[index].slot);
+    }
+    releaseEntry(index);
+    m_evictionCount++;
+}
+
+uint32_t WorldStreamer::acquireSlot() {
+    // Evict from the cold end until a slot frees up; chunks wanted this
+    // frame are never evicted
+    while (m_freeSlots.empty() && m_resident.tail != NO_ENTRY) {
+        uint32_t coldest = m_resident.tail;
+        if (m_entries[coldest].lastWantedFrame == m_frameNumber) return NO_SLOT;
+        evict(coldest);
+    }
+    if (m_freeSlots.empty()) return NO_SLOT;
+
+    uint32_t slot = m_freeSlots.back();
+    m_freeSlots.pop_back();
+    return slot;
+}
+
+uint32_t WorldStreamer::findTablePosition(uint32_t chunk) const {
+    // Linear probing from a Fibonacci hash; the table is never more than
+    // half full, so an empty position always ends the probe
+    uint32_t mask = static_cast<uint32_t>(m_chunkTable.size() - 1);
+    uint32_t position = static_cast<uint32_t>((chunk * 0x9E3779B97F4A7C15ull) >> m_chunkTableShift);
+    while (m_chunkTable[position] != NO_ENTRY && m_entries[m_chunkTable[position]].chunk != chunk) {
+        position = (position + 1) & mask;
+    }
+    return position;
+}
+
+uint32_t WorldStreamer::allocateEntry(uint32_t chunk) {
+    if (m_freeEntries.empty()) return NO_ENTRY;
+    uint32_t index = m_freeEntries.back();
+    m_freeEntries.pop_back();
+
+    ChunkEntry& entry = m_entries[index];
+    entry = ChunkEntry();
+    entry.chunk = chunk;
+    entry.lastWantedFrame = m_frameNumber;
+    m_chunkTable[findTablePosition(chunk)] = index;
+    return index;
+}
+
+void WorldStreamer::releaseEntry(uint32_t index) {
+    ChunkEntry& entry = m_entries[index];
+    if (entry.state == ChunkState::Resident) {
+        unlink(m_resident, index);
+    } else if (entry.state == ChunkState::Deferred) {
+        unlink(m_deferred, index);
+    }
+
+    // Backward-shift deletion: move later entries of the probe run into the
+    // hole unless that would put them before their hashed position
+    uint32_t mask = static_cast<uint32_t>(m_chunkTable.size() - 1);
+    uint32_t hole = findTablePosition(entry.chunk);
+    for (uint32_t position = (hole + 1) & mask; m_chunkTable[position] != NO_ENTRY; position = (position + 1) & mask) {
+        uint32_t chunk = m_entries[m_chunkTable[position]].chunk;
+        uint32_t home = static_cast<uint32_t>((chunk * 0x9E3779B97F4A7C15ull) >> m_chunkTableShift);
+        if (((position - home) & mask) >= ((position - hole) & mask)) {
+            m_chunkTable[hole] = m_chunkTable[position];
+            hole = position;
+        }
+    }
+    m_chunkTable[hole] = NO_ENTRY;
+    m_freeEntries.push_back(index);
+}
+
+void WorldStreamer::releaseDeferred() {
+    while (m_deferred.head != NO_ENTRY) {
+        releaseEntry(m_deferred.head);
+    }
+}
+
+void WorldStreamer::pushFront(EntryList& list, uint32_t index) {
+    ChunkEntry& entry = m_entries[index];
+    entry.prev = NO_ENTRY;
+    entry.next = list.head;
+    if (list.head != NO_ENTRY) {
+        m_entries[list.head].prev = index;
+    } else {
+        list.tail = index;
+    }
+    list.head = index;
+    list.count++;
+}
+
+void WorldStreamer::unlink(EntryList& list, uint32_t index) {
+    ChunkEntry& entry = m_entries[index];
+    if (entry.prev != NO_ENTRY) {
+        m_entries[entry.prev].next = entry.next;
+    } else {
+        list.head = entry.next;
+    }
+    if (entry.next != NO_ENTRY) {
+        m_entries[entry.next].prev = entry.prev;
+    } else {
+        list.tail = entry.prev;
+    }
+    entry.prev = entry.next = NO_ENTRY;
+    list.count--;
+}
+
+void WorldStreamer::prepare(RenderGraph& graph, uint32_t frameIndex) {
+    if (!isOpen()) return;
+
+    FrameUpload& upload = m_frames[frameIndex];
+    upload.regions.clear();
+    m_ready.clear();
+    {
+        size_t maxChunks = UPLOAD_BYTES_PER_FRAME / SLOT_BYTES;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        size_t take = std::min(m_finished.size(), maxChunks);
+        m_ready.insert(m_ready.end(), m_finished.begin(), m_finished.begin() + take);
+        m_finished.erase(m_finished.begin(), m_finished.begin() + take);
+    }
+
+    vk::DeviceSize stagingOffset = 0;
+    for (ChunkLoad* load : m_ready) {
+        // update() only drops entries of loads that haven't started, so
+        // every finished load still has its entry
+        uint32_t index = findEntry(load->chunk);
+        ChunkEntry& entry = m_entries[index];
+        m_freeLoads.push_back(load);
+
+        if (load->recordCount > 0) {
+            uint32_t slot = acquireSlot();
+            if (slot == NO_SLOT) {
+                // Everything resident is still wanted. Keeping the entry
+                // stops the chunk from being read again every frame; it is
+                // requested afresh once the view moves
+                entry.state = ChunkState::Deferred;
+                pushFront(m_deferred, index);
+                continue;
+            }
+
+            vk::DeviceSize bytes = load->recordCount * sizeof(uint32_t);
+            std::memcpy(reinterpret_cast<char*>(upload.mapped) + stagingOffset, load->records, bytes);
+            upload.regions.push_back(vk::BufferCopy{ stagingOffset, slot * SLOT_BYTES, bytes });
+            stagingOffset += bytes;
+            entry.slot = slot;
+        }
+
+        entry.state = ChunkState::Resident;
+        entry.tileCount = load->recordCount;
+        pushFront(m_resident, index);
+    }
+
+    // Empty chunks take no slot but still hold an entry; trim them so
+    // requests have entries to use
+    uint32_t maxResident = m_slotCount * 2;
+    while (m_resident.count > maxResident && m_entries[m_resident.tail].lastWantedFrame != m_frameNumber) {
+        evict(m_resident.tail);
+    }
+
+    m_slotResource = graph.importBuffer("world chunks", m_slotBuffer, m_slotCount * SLOT_BYTES);
+    if (upload.regions.empty()) return;
+
+    graph.addPass("world upload", RGPassType::Transfer)
+        .write(m_slotResource, RGAccess::TransferWrite)
+        .sideEffect()
+        .execute([this, frameIndex](const RGPassContext& context) {
+            const FrameUpload& upload = m_frames[frameIndex];
+            vk::CommandBuffer commandBuffer = context.commandBuffer;
+
+            // Slots of evicted chunks may still be drawn from by the
+            // previous frame, which the graph doesn't see
+            commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eVertexInput,
+                                          vk::PipelineStageFlagBits::eTransfer, {},
+                                          0, nullptr, 0, nullptr, 0, nullptr);
+            commandBuffer.copyBuffer(upload.staging, m_slotBuffer,
+                                     static_cast<uint32_t>(upload.regions.size()), upload.regions.data());
+        });
+}
+
+void WorldStreamer::declareSceneReads(RGPassBuilder& scene) const {
+    if (!isOpen()) return;
+    scene.read(m_slotResource, RGAccess::VertexAttributeRead);
+}
+
+void WorldStreamer::submit(RenderQueue& queue, vk::Extent2D extent) {
+    m_lastDrawnChunks = 0;
+    if (!isOpen()) return;
+
+    const SpriteRenderer& sprites = m_renderer->getSpriteRenderer();
+    const WorldFileHeader& header = m_file.getHeader();
+    float chunkSize = header.tileSize * TilemapRenderer::CHUNK_SIZE;
+    SpriteBounds view = sprites.getViewBounds(extent);
+
+    float x0 = std::floor(view.minX / chunkSize);
+    float y0 = std::floor(view.minY / chunkSize);
+    float x1 = std::floor(view.maxX / chunkSize);
+    float y1 = std::floor(view.maxY / chunkSize);
+    if (x1 < 0.0f || y1 < 0.0f || x0 >= static_cast<float>(header.chunksX) ||
+        y0 >= static_cast<float>(header.chunksY)) {
+        return;
+    }
+    uint32_t minX = static_cast<uint32_t>(std::max(x0, 0.0f));
+    uint32_t minY = static_cast<uint32_t>(std::max(y0, 0.0f));
+    uint32_t maxX = static_cast<uint32_t>(std::min(x1, static_cast<float>(header.chunksX - 1)));
+    uint32_t maxY = static_cast<uint32_t>(std::min(y1, static_cast<float>(header.chunksY - 1)));
+
+    TilemapPushConstants constants{};
+    constants.cameraCenter[0] = sprites.getCameraCenter().x;
+    constants.cameraCenter[1] = sprites.getCameraCenter().y;
+    constants.worldToClip[0] = 2.0f * sprites.getZoom() / extent.width;
+    constants.worldToClip[1] = 2.0f * sprites.getZoom() / extent.height;
+    constants.tileSize = header.tileSize;
+    constants.tilesetTexture = m_tilesetTexture;
+    constants.tilesetColumns = header.tilesetColumns;
+    constants.tilesetRows = header.tilesetRows;
+
+    uint64_t key = makeRenderKey(packRenderOrder(RENDER_LAYER_BACKGROUND, 0.0f), m_pipelineId, m_tilesetTexture);
+    RenderDraw draw;
+    draw.pipeline = m_pipelineId;
+    draw.vertexBuffer = m_slotBuffer;
+    draw.vertexCount = 6;
+    draw.pushSize = sizeof(constants);
+
+    for (uint32_t cy = minY; cy <= maxY; cy++) {
+        for (uint32_t cx = minX; cx <= maxX; cx++) {
+            uint32_t index = findEntry(cy * header.chunksX + cx);
+            if (index == NO_ENTRY) continue;
+            const ChunkEntry& entry = m_entries[index];
+            if (entry.state != ChunkState::Resident || entry.tileCount == 0) continue;
+
+            constants.chunkOrigin[0] = cx * chunkSize;
+            constants.chunkOrigin[1] = cy * chunkSize;
+            std::memcpy(draw.pushData, &constants, sizeof(constants));
+            draw.instanceCount = entry.tileCount;
+            draw.firstInstance = entry.slot * TilemapRenderer::CHUNK_TILES;
+            queue.submit(key, draw);
+            m_lastDrawnChunks++;
+        }
+    }
+}
+
+void WorldStreamer::waitForIo() {
+    // Drops queued loads, lets running ones finish and discards the results
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_queue.clear();
+    m_queueHead = 0;
+    m_ioIdle.wait(lock, [this] { return m_activeLoads == 0; });
+    m_finished.clear();
+
+    m_freeLoads.clear();
+    for (auto& load : m_loadStorage) {
+        m_freeLoads.push_back(load.get());
+    }
+}
+
+void WorldStreamer::ioThreadMain() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true) {
+        m_loadAvailable.wait(lock, [this] { return m_stopping || m_queueHead < m_queue.size(); });
+        if (m_stopping) return;
+
+        ChunkLoad* load = m_queue[m_queueHead++];
+        if (m_queueHead == m_queue.size()) {
+            m_queue.clear();
+            m_queueHead = 0;
+        }
+        m_activeLoads++;
+
+        // Touching the chunk's pages is what reads it from disk
+        lock.unlock();
+        const TileId* tiles = m_file.getChunk(load->chunk);
+        load->recordCount = tiles ? buildTileChunk(tiles, load->records) : 0;
+        lock.lock();
+
+        m_finished.push_back(load);
+        if (--m_activeLoads == 0) {
+            m_ioIdle.notify_all();
+        }
+    }
+}
@@ -1,9 +1,60 @@
 #include "Window.h"
 #include "VulkanRenderer.h"
+#include "Benchmark.h"
+#include "FrameGovernor.h"
+#include "GameOptions.h"
+#include "Random.h"
+#include "WorldFile.h"
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Flat-coloured cells with a darker border, one per tile id of the world's
+// tileset, so chunk seams would show
+Texture createWorldTileset(VulkanRenderer& renderer, const WorldFileHeader& header) {
+    constexpr uint32_t CELL_PIXELS = 16;
+    uint32_t width = header.tilesetColumns * CELL_PIXELS;
+    uint32_t height = header.tilesetRows * CELL_PIXELS;
+    std::vector<uint32_t> pixels(static_cast<size_t>(width) * height);
+
+    Random random(1, 7);
+    for (uint32_t cell = 0; cell < header.tilesetColumns * header.tilesetRows; cell++) {
+        uint32_t color = (64 + random.below(192)) | ((64 + random.below(192)) << 8) |
+                         ((64 + random.below(192)) << 16) | 0xFF000000u;
+        uint32_t border = ((color >> 1) & 0x7F7F7F7Fu) | 0xFF000000u;
+        uint32_t x0 = (cell % header.tilesetColumns) * CELL_PIXELS;
+        uint32_t y0 = (cell / header.tilesetColumns) * CELL_PIXELS;
+        for (uint32_t y = 0; y < CELL_PIXELS; y++) {
+            for (uint32_t x = 0; x < CELL_PIXELS; x++) {
+                bool edge = x == 0 || y == 0 || x == CELL_PIXELS - 1 || y == CELL_PIXELS - 1;
+                pixels[(y0 + y) * width + x0 + x] = edge ? border : color;
+            }
+        }
+    }
+    return renderer.createTexture(width, height, vk::Format::eR8G8B8A8Unorm, pixels.data(),
+                                  pixels.size() * sizeof(uint32_t), SamplerType::Nearest, "world tileset");
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    GameOptions options;
+    std::string argumentError;
+    if (!options.parse(argc, argv, argumentError)) {
+        std::cerr << argumentError << std::endl;
+        GameOptions::printUsage(std::cerr);
+        return 1;
+    }
+    if (options.showHelp) {
+        GameOptions::printUsage(std::cout);
+        return 0;
+    }
 
-int main() {
     try {
         // Initialize GLFW
         if (!glfwInit()) {
@@ -24,13 +75,93 @@ int main() {
 
         std::cout << "Vulkan game initialized successfully!" << std::endl;
 
+        // Benchmark mode runs the scripted scenes instead of the game
+        if (options.benchmark.enabled) {
+            BenchmarkRunner runner(options);
+            int exitCode = runner.run(window, renderer);
+            renderer.cleanup();
+            window.cleanup();
+            glfwTerminate();
+            return exitCode;
+        }
+
+        // An optional world to explore; its chunks stream in around the camera
+        WorldStreamer& world = renderer.getWorldStreamer();
+        Texture worldTileset;
+        glm::vec2 camera(0.0f);
+        float zoom = 1.0f;
+        if (!options.worldPath.empty()) {
+            if (options.generateWorldSize > 0) {
+                std::cout << "Generating a " << options.generateWorldSize << " tile world..." << std::endl;
+                if (!writeProceduralWorld(options.worldPath, options.generateWorldSize,
+                                          options.seed)) {
+                    throw std::runtime_error("Failed to generate world");
+                }
+            }
+
+            WorldFile file;
+            if (!world.isAvailable() || !file.open(options.worldPath)) {
+                throw std::runtime_error("Failed to open world: " + options.worldPath);
+            }
+            worldTileset = createWorldTileset(renderer, file.getHeader());
+            file.close();
+            if (!world.open(options.worldPath, worldTileset.bindlessIndex)) {
+                throw std::runtime_error("Failed to open world: " + options.worldPath);
+            }
+            camera = world.getWorldSize() * 0.5f;
+        }
+
+        // Otherwise the scene resolution follows GPU frame time
+        if (options.renderScale > 0.0f) {
+            renderer.getDynamicResolution().setFixedScale(options.renderScale);
+        }
+
+        // Frames are copied back and written on another thread, so
+        // recording doesn't slow the loop down
+        FrameReadback& readback = renderer.getFrameReadback();
+        if (!options.capturePath.empty() && !readback.startRecording(options.capturePath)) {
+            throw std::runtime_error("Failed to start recording: " + options.capturePath);
+        }
+
+        // Paces the loop down while nobody is looking at the window
+        FrameGovernor governor;
+        FrameGovernorSettings governorSettings;
+        governorSettings.activeFps = options.maxFps;
+        governorSettings.backgroundFps = options.backgroundFps;
+        governor.setSettings(governorSettings);
+
         // Main game loop
-        while (!window.shouldClose()) {
-            // Poll events
-            window.pollEvents();
+        auto previousFrame = std::chrono::steady_clock::now();
+        while (governor.waitForFrame(window)) {
+            if (window.takeFramebufferResized()) {
+                renderer.onFramebufferResized();
+            }
+
+            auto now = std::chrono::steady_clock::now();
+            float deltaTime = std::min(std::chrono::duration<float>(now - previousFrame).count(), 0.1f);
+            previousFrame = now;
+
+            // Begin frame; skipped while there is nothing to render to
+            if (!renderer.beginFrame()) continue;
+            renderer.setHudVisible(window.isHudVisible());
 
-            // Begin frame
-            renderer.beginFrame();
+            // Move the camera, then let the world request what it now needs.
+            // Only queues loads: chunks still on disk are drawn when they arrive
+            if (world.isOpen()) {
+                vk::Extent2D extent = renderer.getSwapchainExtent();
+                InputFrame input = InputRecording::sample(window);
+                glm::vec2 velocity = glm::vec2(input.panX, input.panY) * (extent.width / zoom);
+                camera += velocity * deltaTime;
+                zoom = std::clamp(zoom * input.zoom, MIN_CAMERA_ZOOM, MAX_CAMERA_ZOOM);
+
+                SpriteRenderer& sprites = renderer.getSpriteRenderer();
+                sprites.setCamera(camera, zoom);
+                world.update(sprites.getViewBounds(extent), velocity);
+            }
+
+            if (window.takeScreenshotRequest()) {
+                readback.saveScreenshot("screenshot_" + std::to_string(renderer.getFrameNumber()) + ".png");
+            }
 
             // Draw frame
             renderer.drawFrame();
@@ -39,7 +170,13 @@ int main() {
             renderer.endFrame();
         }
 
-        // Cleanup
+        // Cleanup; the renderer writes out frames still being read back
+        readback.stopRecording();
+        if (world.isOpen()) {
+            renderer.waitIdle();
+            world.close();
+            renderer.destroyTexture(worldTileset);
+        }
         renderer.cleanup();
         window.cleanup();
         glfwTerminate();
@@ -52,4 +189,4 @@ int main() {
         glfwTerminate();
         return -1;
     }
-} 
\ No newline at end of file
+}